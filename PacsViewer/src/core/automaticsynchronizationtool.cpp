@@ -21,6 +21,7 @@
 #include "volume.h"
 #include "imageplane.h"
 #include "slicelocator.h"
+#include "slicegeometryindex.h"
 
 #include <vtkPlane.h>
 
@@ -125,7 +126,15 @@ void AutomaticSynchronizationTool::setPositionToToolData()
 {
     QString frameOfReference = m_2DViewer->getMainInput()->getImage(0)->getParentSeries()->getFrameOfReferenceUID();
     
-    Vector3 center = m_2DViewer->getCurrentImagePlane()->getCenter();
+    const ImagePlane *currentPlane = m_2DViewer->getMainInput()->getSliceGeometryIndex(m_2DViewer->getCurrentViewPlane())
+            ->getImagePlane(m_2DViewer->getCurrentSlice());
+
+    if (!currentPlane)
+    {
+        return;
+    }
+
+    Vector3 center = currentPlane->getCenter();
 
     int slice = m_2DViewer->getCurrentSlice();
     double currentSpacingBetweenSlices = m_2DViewer->getCurrentSpacingBetweenSlices();
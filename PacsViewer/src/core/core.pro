@@ -33,6 +33,7 @@ TRANSLATIONS += core_ca_ES.ts \
 HEADERS +=  extensionfactory.h \
             genericfactory.h \
             singleton.h \
+            stringpool.h \
             genericsingletonfactoryregister.h \
             extensionfactoryregister.h \
             extensionmediator.h \
@@ -180,6 +181,7 @@ HEADERS +=  extensionfactory.h \
             vtk4dlinearregressiongradientestimator.h \
             combiningvoxelshader.h \
             viewpointgenerator.h \
+            thumbnailcache.h \
             thumbnailcreator.h \
             nonclosedangletool.h \
             abortrendercommand.h \
@@ -283,6 +285,7 @@ HEADERS +=  extensionfactory.h \
             applicationupdatechecker.h \
             diagnosistestfactory.h \
             diagnosistestfactoryregister.h \
+            slicegeometryindex.h \
             slicelocator.h \
             slicehandler.h \
             automaticsynchronizationtool.h \
@@ -400,6 +403,8 @@ HEADERS +=  extensionfactory.h \
             nmctfusionroidataprinter.h \
             vtkcorrectimageblend.h \
             volumereaderjobfactory.h \
+            volumeloadscheduler.h \
+            renderscheduler.h \
             relativegeometrylayout.h \
             griditerator.h \
             voilut.h \
@@ -574,6 +579,8 @@ SOURCES  += extensionmediator.cpp \
             vtk4dlinearregressiongradientestimator.cpp \
             combiningvoxelshader.cpp \
             viewpointgenerator.cpp \
+            thumbnailcache.cpp \
+            stringpool.cpp \
             thumbnailcreator.cpp \
             nonclosedangletool.cpp \
             abortrendercommand.cpp \
@@ -672,6 +679,7 @@ SOURCES  += extensionmediator.cpp \
             machineinformation.cpp \
             diagnosistestresult.cpp \
             applicationupdatechecker.cpp \
+            slicegeometryindex.cpp \
             slicelocator.cpp \
             slicehandler.cpp \
             automaticsynchronizationtool.cpp \
@@ -785,6 +793,8 @@ SOURCES  += extensionmediator.cpp \
             nmctfusionroidataprinter.cpp \
             vtkcorrectimageblend.cpp \
             volumereaderjobfactory.cpp \
+            volumeloadscheduler.cpp \
+            renderscheduler.cpp \
             relativegeometrylayout.cpp \
             griditerator.cpp \
             voilut.cpp \
@@ -59,7 +59,13 @@ const QString CoreSettings::UpdateCheckUrlAdditionalParameters("UpdateCheckUrlAd
 const QString CoreSettings::MammographyAutoOrientationExceptions("MammographyAutoOrientationExceptions");
 
 const QString CoreSettings::AllowAsynchronousVolumeLoading("AllowAsynchronousVolumeLoading");
+const QString CoreSettings::AllowProgressiveVolumeLoading("AllowProgressiveVolumeLoading");
 const QString CoreSettings::MaximumNumberOfVolumesLoadingConcurrently("MaximumNumberOfVolumesLoadingConcurrently");
+const QString CoreSettings::MaximumNumberOfThreadsDecodingVolume("MaximumNumberOfThreadsDecodingVolume");
+const QString CoreSettings::VolumeCacheMemoryBudget("VolumeCacheMemoryBudget");
+const QString CoreSettings::VolumePrefetchMemoryBudget("VolumePrefetchMemoryBudget");
+const QString CoreSettings::ThumbnailCachePath("ThumbnailCache/path");
+const QString CoreSettings::ThumbnailCacheMaximumSize("ThumbnailCache/maximumSize");
 
 const QString CoreSettings::MaximumNumberOfVisibleVoiLutComboItems("MaximumNumberOfVisibleVoiLutComboItems");
 
@@ -126,7 +132,13 @@ void CoreSettings::init()
 #endif
     settingsRegistry->addSetting(MammographyAutoOrientationExceptions, (QStringList() << "BAV" << "BAG" << "estereot"));
     settingsRegistry->addSetting(AllowAsynchronousVolumeLoading, true);
-    settingsRegistry->addSetting(MaximumNumberOfVolumesLoadingConcurrently, 1);
+    settingsRegistry->addSetting(AllowProgressiveVolumeLoading, true);
+    settingsRegistry->addSetting(MaximumNumberOfVolumesLoadingConcurrently, 0);
+    settingsRegistry->addSetting(MaximumNumberOfThreadsDecodingVolume, 0);
+    settingsRegistry->addSetting(VolumeCacheMemoryBudget, 0);
+    settingsRegistry->addSetting(VolumePrefetchMemoryBudget, 1024);
+    settingsRegistry->addSetting(ThumbnailCachePath, UserDataRootPath + "thumbnails/");
+    settingsRegistry->addSetting(ThumbnailCacheMaximumSize, 500);
     settingsRegistry->addSetting(MaximumNumberOfVisibleVoiLutComboItems, 50);
     settingsRegistry->addSetting(EnableQ2DViewerSliceScrollLoop, false);
     settingsRegistry->addSetting(EnableQ2DViewerPhaseScrollLoop, false);
@@ -76,8 +76,22 @@ public:
 
     /// Indica si es pot realitzar càrrega de volums asíncrona o no
     static const QString AllowAsynchronousVolumeLoading;
+    /// If true, the 2D viewer displays the volumes while they are being loaded asynchronously, starting from the middle slice.
+    static const QString AllowProgressiveVolumeLoading;
     /// Indica quans volums poden estar-se carregant a la vegada com a màxim.
+    /// If it's 0, it's decided for each volume from its estimated reading cost, the available memory and the type of storage.
     static const QString MaximumNumberOfVolumesLoadingConcurrently;
+    /// Maximum number of threads used to decode the slices of a single volume concurrently. If it's 0, the ideal thread count of the machine is used.
+    static const QString MaximumNumberOfThreadsDecodingVolume;
+    /// Memory budget in megabytes for the pixel data of the loaded volumes. When exceeded, the pixel data of the least recently used volumes not shown in any
+    /// viewer is released. If it's 0, half of the physical memory is used, and a negative value means no limit.
+    static const QString VolumeCacheMemoryBudget;
+    /// Maximum memory in megabytes that the volumes read in the background, because they are likely to be opened next, can use. 0 disables prefetching.
+    static const QString VolumePrefetchMemoryBudget;
+    /// Directory where the thumbnails of the images are saved to be reused in later sessions.
+    static const QString ThumbnailCachePath;
+    /// Maximum size in megabytes of the thumbnail cache. The least recently used thumbnails are removed when it is exceeded.
+    static const QString ThumbnailCacheMaximumSize;
 
     /// Defineix el nombre màxim d'ítems visibles al desplegar-se el combo de window/levels per defecte.
     /// Si tenim més presets que els que indiqui aquest setting, apareixerà un scroll vertical.
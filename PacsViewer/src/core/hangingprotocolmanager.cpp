@@ -29,6 +29,8 @@
 #include "identifier.h"
 #include "logging.h"
 #include "volumerepository.h"
+#include "volumereaderjobfactory.h"
+#include "coresettings.h"
 #include "applyhangingprotocolqviewercommand.h"
 #include "hangingprotocolfiller.h"
 // Necessari per poder anar a buscar prèvies
@@ -238,6 +240,8 @@ void HangingProtocolManager::applyHangingProtocol(HangingProtocol *hangingProtoc
     }
 
     INFO_LOG(QString("Hanging protocol aplicat: %1").arg(hangingProtocol->getName()));
+
+    prefetchSeriesLikelyToBeOpened(hangingProtocol, patient);
 }
 
 bool HangingProtocolManager::isModalityCompatible(HangingProtocol *protocol, Study *study)
@@ -430,6 +434,75 @@ void HangingProtocolManager::setInputToViewer(Q2DViewerWidget *viewerWidget, Han
     }
 }
 
+void HangingProtocolManager::prefetchSeriesLikelyToBeOpened(HangingProtocol *hangingProtocol, Patient *patient)
+{
+    if (!patient || !Settings().getValue(CoreSettings::AllowAsynchronousVolumeLoading).toBool())
+    {
+        return;
+    }
+
+    QList<Series*> displayedSeries;
+    QList<Study*> displayedStudies;
+    foreach (HangingProtocolDisplaySet *displaySet, hangingProtocol->getDisplaySets())
+    {
+        Series *series = displaySet->getImageSet()->getSeriesToDisplay();
+        if (displaySet->getImageSet()->isDownloaded() && series && !displayedSeries.contains(series))
+        {
+            displayedSeries << series;
+
+            if (!displayedStudies.contains(series->getParentStudy()))
+            {
+                displayedStudies << series->getParentStudy();
+            }
+        }
+    }
+
+    QList<Series*> seriesToPrefetch;
+    // First the rest of series of the displayed studies, most recent studies first
+    foreach (Study *study, patient->getStudies())
+    {
+        if (displayedStudies.contains(study))
+        {
+            foreach (Series *series, study->getViewableSeries())
+            {
+                if (!displayedSeries.contains(series))
+                {
+                    seriesToPrefetch << series;
+                }
+            }
+        }
+    }
+
+    // Then the series of the other studies that match the displayed ones
+    foreach (Series *displayed, displayedSeries)
+    {
+        foreach (Study *study, patient->getStudies())
+        {
+            if (displayedStudies.contains(study))
+            {
+                continue;
+            }
+
+            foreach (Series *series, study->getViewableSeries())
+            {
+                if (series->getModality() == displayed->getModality()
+                    && series->getDescription().compare(displayed->getDescription(), Qt::CaseInsensitive) == 0 && !seriesToPrefetch.contains(series))
+                {
+                    seriesToPrefetch << series;
+                }
+            }
+        }
+    }
+
+    QList<Volume*> volumesToPrefetch;
+    foreach (Series *series, seriesToPrefetch)
+    {
+        volumesToPrefetch << series->getVolumesList();
+    }
+
+    VolumeReaderJobFactory::instance()->prefetch(volumesToPrefetch);
+}
+
 void HangingProtocolManager::thumbnailUpateImages(ViewersLayout *layout, Patient *patient, const QRectF &geometry)
 {
 	// Clean up viewer of the working area
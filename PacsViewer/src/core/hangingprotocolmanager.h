@@ -94,6 +94,10 @@ private:
     /// based on the specifications of the displaySet + imageSet.
     void setInputToViewer(Q2DViewerWidget *viewerWidget, HangingProtocolDisplaySet *displaySet);
 
+    /// Starts reading in the background the series the user is likely to open next after the given hanging protocol has been applied: the rest of series of
+    /// the displayed studies and, from the other studies of the patient, the series equivalent to the displayed ones.
+    void prefetchSeriesLikelyToBeOpened(HangingProtocol *hangingProtocol, Patient *patient);
+
 private:
     /// Structure to store the data needed when it is received that a patient has merged with a new study
     /// We have to save all the information because we only know
@@ -20,6 +20,7 @@
 #include "mathtools.h"
 #include "imageoverlayreader.h"
 #include "preferredpixelspacingselector.h"
+#include "stringpool.h"
 
 #include <QFileInfo>
 
@@ -331,12 +332,12 @@ const QString& Image::getAcquisitionNumber() const
 
 void Image::setAcquisitionNumber(QString acquisitionNumber)
 {
-    m_acquisitionNumber = std::move(acquisitionNumber);
+    m_acquisitionNumber = StringPool::intern(acquisitionNumber);
 }
 
 void Image::setImageType(const QString &imageType)
 {
-    m_imageType = imageType;
+    m_imageType = StringPool::intern(imageType);
 }
 
 QString Image::getImageType() const
@@ -346,7 +347,7 @@ QString Image::getImageType() const
 
 void Image::setViewPosition(const QString &viewPosition)
 {
-    m_viewPosition = viewPosition;
+    m_viewPosition = StringPool::intern(viewPosition);
 }
 
 QString Image::getViewPosition() const
@@ -366,7 +367,7 @@ QChar Image::getImageLaterality() const
 
 void Image::setViewCodeMeaning(const QString &viewCodeMeaning)
 {
-    m_viewCodeMeaning = viewCodeMeaning;
+    m_viewCodeMeaning = StringPool::intern(viewCodeMeaning);
 }
 
 QString Image::getViewCodeMeaning() const
@@ -450,7 +451,7 @@ QString Image::getFormattedImageTime() const
 
 void Image::setTransferSyntaxUID(const QString &transferSyntaxUID)
 {
-    m_transferSyntaxUID = transferSyntaxUID;
+    m_transferSyntaxUID = StringPool::intern(transferSyntaxUID);
 }
 
 const QString& Image::getTransferSyntaxUID() const
@@ -633,55 +634,31 @@ Series* Image::getParentSeries() const
 
 void Image::setPath(const QString &path)
 {
-    m_path = path;
+    // All the files of a series are usually in the same directory
+    int fileNameStart = path.lastIndexOf('/') + 1;
+    m_pathDirectory = StringPool::intern(path.left(fileNameStart));
+    m_pathFileName = path.mid(fileNameStart);
 }
 
 QString Image::getPath() const
 {
-    return m_path;
+    return m_pathDirectory + m_pathFileName;
 }
 
-QPixmap Image::getThumbnail(bool getFromCache, int resolution)
+const QString& Image::getPathDirectory() const
 {
-    ThumbnailCreator thumbnailCreator;
-//    bool createThumbnail = true;
+    return m_pathDirectory;
+}
 
-    if (m_thumbnail.isNull())
-    {
-        // if (getFromCache)
-        // {
-        //     //First we try to find the thumbnail with volume number and then without volume number
-        //     ///If we can't find any files, we'll have to re-create them
-
-        //     ///We get the base directory where the thumbnail can be found
-        //     QString thumbnailPath = QFileInfo(getPath()).absolutePath();
-        //     ///Absolute path of the thumbnail file
-        //     QString thumbnailFilePath = QString("%1/thumbnail%2.png").arg(thumbnailPath).arg(getVolumeNumberInSeries());
-
-        //     QFileInfo thumbnailFile(thumbnailFilePath);
-        //     if (thumbnailFile.exists())
-        //     {
-        //         m_thumbnail = QPixmap(thumbnailFilePath);
-        //         createThumbnail = false;
-        //     }
-        //     else
-        //     {
-        //         thumbnailFilePath = QString("%1/thumbnail.png").arg(thumbnailPath);
-        //         thumbnailFile.setFile(thumbnailFilePath);
-        //         if (thumbnailFile.exists())
-        //         {
-        //             m_thumbnail = QPixmap(thumbnailFilePath);
-        //             createThumbnail = false;
-        //         }
-        //     }
-        // }
-
-        // if (createThumbnail)
-        //{
-        m_thumbnail = QPixmap::fromImage(thumbnailCreator.getThumbnail(this, resolution));
-        //}
-    }
-    return m_thumbnail;
+const QString& Image::getPathFileName() const
+{
+    return m_pathFileName;
+}
+
+QPixmap Image::getThumbnail(int resolution)
+{
+    // It's not kept in the image, since it's only asked for a few images of each series and the thumbnail cache already keeps it on disk
+    return QPixmap::fromImage(ThumbnailCreator().getThumbnail(this, resolution));
 }
 
 QStringList Image::getSupportedModalities()
@@ -737,7 +714,7 @@ bool Image::readOverlays(bool splitOverlays)
 
 void Image::setDICOMKVP(QString KVP)
 {
-	m_dicomKVP = KVP;
+	m_dicomKVP = StringPool::intern(KVP);
 }
 QString Image::getDICOMKVP()
 {
@@ -746,7 +723,7 @@ QString Image::getDICOMKVP()
 
 void Image::setXRayTubeCurrent(QString XRayTubeCurrent)
 {
-	m_dicomXRayTubeCurrent = XRayTubeCurrent;
+	m_dicomXRayTubeCurrent = StringPool::intern(XRayTubeCurrent);
 }
 
 QString Image::getXRayTubeCurrent()
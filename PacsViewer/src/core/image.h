@@ -37,6 +37,9 @@ class Series;
 
 /**
   Class that encapsulates the properties of an image of a series of the Series class
+
+  Since a series can have tens of thousands of images, the attributes that take few different values, like the transfer syntax or the image type,
+  are kept through StringPool so that all the images share the same strings.
 */
 class Image : public QObject {
     Q_OBJECT
@@ -150,6 +153,10 @@ public:
     void setPath(const QString &path);
     QString getPath() const;
 
+    /// Return the two parts in which the path is kept: the directory, with the final separator, and the file name
+    const QString& getPathDirectory() const;
+    const QString& getPathFileName() const;
+
     /// Assigns / returns the slice location of the image
     void setSliceLocation(const QString &sliceLocation);
     QString getSliceLocation() const;
@@ -253,12 +260,10 @@ public:
     ///It returns the key that identifies the image
     QString getKeyIdentifier() const;
 
-    /// The method returns the thumbnail of the image. It will be created the first time it is requested
-    /// @param getFromCache If true it will try to load the thumbnail if it is created in the cache.
-    /// Otherwise, it will simply check that it is not created in memory and enough
+    /// The method returns the thumbnail of the image. It's not kept in memory: it's loaded from the thumbnail cache, or created the first time
     /// @param resolution The resolution with which we want the thumbnail
     /// @return A QPixmap with the thumbnail
-    QPixmap getThumbnail(bool getFromCache = false, int resolution = 100);
+    QPixmap getThumbnail(int resolution = 100);
 
     ///Returns a list of the modes we support as Image
     static QStringList getSupportedModalities();
@@ -434,8 +439,9 @@ private:
 
     /// Atributs NO-DICOM
 
-    /// El path absolut de la imatge
-    QString m_path;
+    /// Absolute path of the image, split into the directory, shared by all the images in the same directory, and the file name
+    QString m_pathDirectory;
+    QString m_pathFileName;
 
     /// Date the image was downloaded to the local database
     QDate m_retrievedDate;
@@ -473,9 +479,6 @@ private:
     /// The parent series
     Series *m_parentSeries;
 
-    /// Preview image cache
-    QPixmap m_thumbnail;
-
     //Indicates the origin of DICOM images
     DICOMSource m_imageDICOMSource;
 
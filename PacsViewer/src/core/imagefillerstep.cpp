@@ -296,7 +296,8 @@ bool ImageFillerStep::fillIndividually()
     if (dicomReader)
     {
         ok = true;
-        QList<Image*> generatedImages = processDICOMFile(dicomReader);
+        QList<Image*> images = m_input->hasPreparedImages() ? m_input->takePreparedImages() : createImages(dicomReader);
+        QList<Image*> generatedImages = addImagesToCurrentSeries(images);
         if (!generatedImages.isEmpty())
         {
             m_input->setCurrentImages(generatedImages);
@@ -306,16 +307,16 @@ bool ImageFillerStep::fillIndividually()
     return ok;
 }
 
-QList<Image*> ImageFillerStep::processDICOMFile(const DICOMTagReader *dicomReader)
+QList<Image*> ImageFillerStep::createImages(const DICOMTagReader *dicomReader)
 {
-    QList<Image*> generatedImages;
+    QList<Image*> images;
     bool ok = dicomReader->tagExists(DICOMPixelData);
     if (ok)
     {
         // We check if the image is enhanced or not in order to call the most appropriate specific method
         if (isEnhancedImageSOPClass(dicomReader->getValueAttributeAsQString(DICOMSOPClassUID)))
         {
-            generatedImages = processEnhancedDICOMFile(dicomReader);
+            images = createEnhancedImages(dicomReader);
         }
         else
         {
@@ -326,20 +327,31 @@ QList<Image*> ImageFillerStep::processDICOMFile(const DICOMTagReader *dicomReade
                 Image *image = new Image();
                 image->setFrameNumber(frameNumber);
                 processImage(image, dicomReader);
-
-                // We will add the image to the list if it could be added to the corresponding series
-                if (m_input->getCurrentSeries()->addImage(image))
-                {
-                    generatedImages << image;
-                }
-                else
-                {
-                    delete image;
-                }
+                images << image;
             }
         }
     }
-    return generatedImages;
+    return images;
+}
+
+QList<Image*> ImageFillerStep::addImagesToCurrentSeries(const QList<Image*> &images)
+{
+    QList<Image*> addedImages;
+
+    foreach (Image *image, images)
+    {
+        // We will add the image to the list if it could be added to the corresponding series
+        if (m_input->getCurrentSeries()->addImage(image))
+        {
+            addedImages << image;
+        }
+        else
+        {
+            delete image;
+        }
+    }
+
+    return addedImages;
 }
 
 void ImageFillerStep::fillCommonImageInformation(Image *image, const DICOMTagReader *dicomReader)
@@ -540,10 +552,11 @@ void ImageFillerStep::processImage(Image *image, const DICOMTagReader *dicomRead
 	}
 }
 
-QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *dicomReader)
+QList<Image*> ImageFillerStep::createEnhancedImages(const DICOMTagReader *dicomReader)
 {
-    QList<Image*> generatedImages;
+    QList<Image*> images;
     int numberOfFrames = getNumberOfFrames(dicomReader);
+    QString sopClassUID = dicomReader->getValueAttributeAsQString(DICOMSOPClassUID);
 
     for (int frameNumber = 0; frameNumber < numberOfFrames; frameNumber++)
     {
@@ -551,12 +564,7 @@ QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *di
         fillCommonImageInformation(image, dicomReader);
         //We assign the frame node and the volume node to which it belongs
         image->setFrameNumber(frameNumber);
-
-        // Afegirem la imatge a la llista si aquesta s'ha pogut afegir a la corresponent sèrie
-        if (m_input->getCurrentSeries()->addImage(image))
-        {
-            generatedImages << image;
-        }
+        images << image;
     }
 
     //We deal with the Shared Functional Groups Sequence
@@ -567,9 +575,9 @@ QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *di
         QList<DICOMSequenceItem*> sharedItems = sharedFunctionalGroupsSequence->getItems();
         if (!sharedItems.isEmpty())
         {
-            foreach (Image *image, generatedImages)
+            foreach (Image *image, images)
             {
-                fillFunctionalGroupsInformation(image, sharedItems.first());
+                fillFunctionalGroupsInformation(image, sharedItems.first(), sopClassUID);
             }
         }
     }
@@ -585,7 +593,13 @@ QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *di
         int frameNumber = 0;
         foreach (DICOMSequenceItem *item, perFrameItems)
         {
-            fillFunctionalGroupsInformation(generatedImages.at(frameNumber), item);
+            if (frameNumber >= images.size())
+            {
+                ERROR_LOG("The Per-Frame Functional Groups Sequence has more items than the number of frames");
+                break;
+            }
+
+            fillFunctionalGroupsInformation(images.at(frameNumber), item, sopClassUID);
             frameNumber++;
         }
     }
@@ -594,14 +608,12 @@ QList<Image*> ImageFillerStep::processEnhancedDICOMFile(const DICOMTagReader *di
         ERROR_LOG("We did not find the per-frame Functional Groups Sequence in a DICOM file that is assumed to be Enhanced");
     }
 
-    return generatedImages;
+    return images;
 }
 
-void ImageFillerStep::fillFunctionalGroupsInformation(Image *image, DICOMSequenceItem *frameItem)
+void ImageFillerStep::fillFunctionalGroupsInformation(Image *image, DICOMSequenceItem *frameItem, const QString &sopClassUID)
 {
     // There are some attributes that we will have to look for in different places depending on the modality
-    QString sopClassUID = m_input->getDICOMFile()->getValueAttributeAsQString(DICOMSOPClassUID);
-
     // Attributes of CT and MRi MG Breast Tomosynthesis
     if (sopClassUID == UIDEnhancedCTImageStorage || sopClassUID == UIDEnhancedMRImageStorage || sopClassUID == UIDBreastTomosynthesisImageStorage)
     {
@@ -34,18 +34,22 @@ public:
     ImageFillerStep();
     virtual ~ImageFillerStep();
 
+    /// Adds the images of the current DICOM file to the current series. If the input has prepared images they are used, otherwise they are created.
     virtual bool fillIndividually() override;
 
+    /// Creates and fills the set of images contained in the given DICOM file, without adding them to any series.
+    /// It only reads the DICOM source from the input, so it can be called concurrently for different files while the input is not modified.
+    QList<Image*> createImages(const DICOMTagReader *dicomReader);
+
 private:
     /// Method for processing patient-specific information, series and image
     void processImage(Image *image, const DICOMTagReader *dicomReader);
 
-    /// Method responsible for processing the DICOM file to extract the set of images
-    /// that make it up, filling in the necessary information
-    QList<Image*> processDICOMFile(const DICOMTagReader *dicomReader);
+    /// Specific method for creating the images of files that are of the Enhanced type
+    QList<Image*> createEnhancedImages(const DICOMTagReader *dicomReader);
 
-    /// Specific method for processing files that are of the Enhanced type
-    QList<Image*> processEnhancedDICOMFile(const DICOMTagReader *dicomReader);
+    /// Adds the given images to the current series and returns the ones that could be added. The rest are deleted.
+    QList<Image*> addImagesToCurrentSeries(const QList<Image*> &images);
 
     /// Fill in the information common to all images.
     /// Image and dicomReader must be valid objects.
@@ -54,7 +58,7 @@ private:
     /// Fill in the given image with the information of the functional groups contained in the item provided
     /// This method is intended to be used with the items obtained
     /// with both the Shared Functional Groups Sequence and the Per-Frame Functional Groups Sequence
-    void fillFunctionalGroupsInformation(Image *image, DICOMSequenceItem *frameItem);
+    void fillFunctionalGroupsInformation(Image *image, DICOMSequenceItem *frameItem, const QString &sopClassUID);
 
     ///Returns how many overlays are in the provided dataset
     unsigned short getNumberOfOverlays(const DICOMTagReader *dicomReader);
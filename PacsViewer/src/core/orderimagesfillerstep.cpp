@@ -21,8 +21,33 @@
 #include "image.h"
 #include "mathtools.h"
 
+#include <algorithm>
+#include <numeric>
+
 namespace udg {
 
+namespace {
+
+// Compares two doubles so that NaN values, which can come from malformed headers, are sorted after the rest instead of breaking the sort.
+bool lessThan(double a, double b)
+{
+    return qIsNaN(b) ? !qIsNaN(a) : a < b;
+}
+
+// Returns true if a and b are equivalent according to lessThan().
+bool equivalent(double a, double b)
+{
+    return !lessThan(a, b) && !lessThan(b, a);
+}
+
+// Returns the key used to sort images by instance number, which is the instance number followed by a 0 and the frame number.
+unsigned long getInstanceAndFrameNumberKey(const Image *image)
+{
+    return QString("%1%2%3").arg(image->getInstanceNumber()).arg("0").arg(image->getFrameNumber()).toULong();
+}
+
+}
+
 OrderImagesFillerStep::OrderImagesFillerStep()
     : PatientFillerStep()
 {
@@ -30,38 +55,6 @@ OrderImagesFillerStep::OrderImagesFillerStep()
 
 OrderImagesFillerStep::~OrderImagesFillerStep()
 {
-    QMap<unsigned long, Image*> *instanceNumberSet;
-    QMap<double, QMap<unsigned long, Image*>*> *imagePositionSet;
-    QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*> *orderedImageSet;
-    QMap<double, QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*> *normalVectorImageSet;
-    QMap<int, QMap<double, QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*>*> *volumesInSeries;
-
-    foreach (Series *key, m_orderImagesInternalInfo.keys())
-    {
-        volumesInSeries = m_orderImagesInternalInfo.take(key);
-        foreach (int volumeNumber, volumesInSeries->keys())
-        {
-            normalVectorImageSet = volumesInSeries->take(volumeNumber);
-            foreach (double normalVectorKey, normalVectorImageSet->keys())
-            {
-                orderedImageSet = normalVectorImageSet->take(normalVectorKey);
-                foreach (const QString &key, orderedImageSet->keys())
-                {
-                    imagePositionSet = orderedImageSet->take(key);
-                    foreach (double distanceKey, imagePositionSet->keys())
-                    {
-                        instanceNumberSet = imagePositionSet->take(distanceKey);
-                        delete instanceNumberSet;
-                    }
-                    delete imagePositionSet;
-                }
-                delete orderedImageSet;
-            }
-            delete normalVectorImageSet;
-        }
-        delete volumesInSeries;
-    }
-
     foreach (Series *series, m_phasesPerPositionEvaluation.keys())
     {
         QHash<int, PhasesPerPositionHashType*> *volumeHash = m_phasesPerPositionEvaluation.take(series);
@@ -91,36 +84,11 @@ OrderImagesFillerStep::~OrderImagesFillerStep()
 
 bool OrderImagesFillerStep::fillIndividually()
 {
-    QMap<int, QMap<double, QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*>*> *volumesInSeries;
-
-    if (m_orderImagesInternalInfo.contains(m_input->getCurrentSeries()))
-    {
-        volumesInSeries = m_orderImagesInternalInfo.value(m_input->getCurrentSeries());
-        if (volumesInSeries->contains(m_input->getCurrentVolumeNumber()))
-        {
-            m_orderedNormalsSet = volumesInSeries->value(m_input->getCurrentVolumeNumber());
-        }
-        else
-        {
-            DEBUG_LOG(QString("Null list for volume %1 of series %2. We create a new one.").arg(m_input->getCurrentVolumeNumber()).arg(
-                          m_input->getCurrentSeries()->getInstanceUID()));
-            m_orderedNormalsSet = new QMap<double,QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*>();
-            volumesInSeries->insert(m_input->getCurrentVolumeNumber(), m_orderedNormalsSet);
-        }
-    }
-    else
-    {
-        DEBUG_LOG(QString("Null list We create a new one for series%1.").arg(m_input->getCurrentSeries()->getInstanceUID()));
-        volumesInSeries = new QMap<int, QMap<double, QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*>*>();
-        m_orderedNormalsSet = new QMap<double, QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*>();
-
-        volumesInSeries->insert(m_input->getCurrentVolumeNumber(), m_orderedNormalsSet);
-        m_orderImagesInternalInfo.insert(m_input->getCurrentSeries(), volumesInSeries);
-    }
+    VolumeOrderingInfo &volumeInfo = m_orderImagesInternalInfo[m_input->getCurrentSeries()][m_input->getCurrentVolumeNumber()];
 
     foreach (Image * image, m_input->getCurrentImages())
     {
-        processImage(image);
+        processImage(image, volumeInfo);
         // Evaluation of the number of phases per position
         processPhasesPerPositionEvaluation(image);
     }
@@ -195,144 +163,101 @@ void OrderImagesFillerStep::postProcessing()
     }
 }
 
-void OrderImagesFillerStep::processImage(Image *image)
+void OrderImagesFillerStep::processImage(Image *image, VolumeOrderingInfo &volumeInfo)
 {
     /// We obtain the normal vector of the plane, which also determines to which "stack" the image belongs
     QVector3D planeNormalVector3D = image->getImageOrientationPatient().getNormalVector();
-    /// We pass it to string which will be easier for us to compare, because this is how it is saved in the sort structure
+    /// We pass it to string which will be easier for us to compare
     QString planeNormalString = QString("%1\\%2\\%3").arg(planeNormalVector3D.x(), 0, 'f', 5).arg(planeNormalVector3D.y(), 0, 'f', 5)
             .arg(planeNormalVector3D.z(), 0, 'f', 5);
 
-    QMap<double, QMap<unsigned long, Image*>*> *imagePositionSet;
-    QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*> *orderedImageSet;
-    QMap<unsigned long, Image*> *instanceNumberSet;
-
     double distance = Image::distance(image);
 
-    /// First we look for the most similar key (normal of the plan) of all
-    /// Each key is the normal of each plane saved as a string.
-    /// In case we have different normals, I would indicate that we have for example, different stacks in the same volume
-
-    /// TODO WARN BUG: We are doing insertMulti () in another place, so there may be keys with multiple values,
-    /// but we are getting only the last value for each key, so some plane normals can be missed.
-    /// We should iterate over the values instead of the unique keys and use a QSet for planeNormals.
-    QStringList planeNormals;
-    foreach (double key, m_orderedNormalsSet->uniqueKeys())
-    {
-        planeNormals << m_orderedNormalsSet->value(key)->uniqueKeys();
-    }
-
-    // This loop is used to find if the normal of the new image
-    // matches any normal of the already processed images
-    QString keyPlaneNormal;
-    foreach (const QString &normal, planeNormals)
+    /// We look for a group with the same normal or a normal with a difference of less than 1 degree, since sometimes there are just small inaccuracies.
+    /// Different normals indicate for example different stacks in the same volume.
+    /// TODO WARN BUG: Only the last group created for each angle is compared, so some plane normals can be missed.
+    int groupIndex = -1;
+    foreach (int index, volumeInfo.comparableGroups)
     {
-        if (normal == planeNormalString)
+        const NormalGroup &group = volumeInfo.groups.at(index);
+        /// EVERYTHING better define this threshold
+        if (group.normal == planeNormalString || MathTools::angleInDegrees(group.normalVector, planeNormalVector3D) < 1.0)
         {
-            /// The normal of this plan already exists (most typical case)
-            keyPlaneNormal = normal;
+            groupIndex = index;
             break;
         }
-        /// The normal ones are different, check if they are completely or not
-        else
-        {
-            if (normal.isEmpty())
-            {
-                keyPlaneNormal = planeNormalString;
-                break;
-            }
-            else
-            {
-                /// Although they are different, they may be almost the same
-                /// then you have to check that in fact they are quite different
-                /// since sometimes there are just small inaccuracies simply
-                QStringList normalSplitted = normal.split("\\");
-                QVector3D normalVector(normalSplitted.at(0).toDouble(), normalSplitted.at(1).toDouble(), normalSplitted.at(2).toDouble());
-
-                double angle = MathTools::angleInDegrees(normalVector, planeNormalVector3D);
-
-                if (angle < 1.0)
-                {
-                    /// If the angle between the normals
-                    /// is within a threshold,
-                    /// we can consider them equal
-                    /// EVERYTHING better define this threshold
-                    keyPlaneNormal = normal;
-                    break;
-                }
-            }
-        }
     }
-    /// Now you need to insert the image in the sorted list
-    /// If we didn't put any value, it means that the normal one is new and didn't exist until now
-    if (keyPlaneNormal.isEmpty())
-    {
-        ///We assign the key
-        keyPlaneNormal = planeNormalString;
-        ///Now you need to insert the new key
-        instanceNumberSet = new QMap<unsigned long, Image*>();
-        instanceNumberSet->insert(QString("%1%2%3").arg(image->getInstanceNumber()).arg("0").arg(image->getFrameNumber()).toULong(), image);
-
-        imagePositionSet = new QMap<double, QMap<unsigned long, Image*>*>();
-        imagePositionSet->insert(distance, instanceNumberSet);
-        
-        orderedImageSet = new QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>();
-        orderedImageSet->insert(keyPlaneNormal, imagePositionSet);
-
-        double angle = 0;
 
-        if (m_orderedNormalsSet->isEmpty())
+    if (groupIndex < 0)
+    {
+        /// The normal is new, so we create a new group
+        NormalGroup group;
+        group.normal = planeNormalString;
+        QStringList normalSplitted = planeNormalString.split("\\");
+        group.normalVector = QVector3D(normalSplitted.at(0).toDouble(), normalSplitted.at(1).toDouble(), normalSplitted.at(2).toDouble());
+        group.angle = 0;
+        group.minimumDistance = distance;
+        group.maximumDistance = distance;
+
+        if (volumeInfo.groups.isEmpty())
         {
             m_firstPlaneVector3D = planeNormalVector3D;
         }
         else
         {
-            if (m_orderedNormalsSet->size() == 1) /// We look for the normal to know the direction by which to order
+            if (volumeInfo.groups.size() == 1) /// We look for the normal to know the direction by which to order
             {
                 m_direction = QVector3D::crossProduct(m_firstPlaneVector3D, planeNormalVector3D);
                 m_direction = QVector3D::crossProduct(m_direction, m_firstPlaneVector3D);
             }
-            
-            angle = MathTools::angleInRadians(m_firstPlaneVector3D, planeNormalVector3D);
+
+            group.angle = MathTools::angleInRadians(m_firstPlaneVector3D, planeNormalVector3D);
 
             if (QVector3D::dotProduct(planeNormalVector3D, m_direction) <= 0) // Direcció d'ordenació
             {
-                angle = 2 * MathTools::PiNumber - angle;
+                group.angle = 2 * MathTools::PiNumber - group.angle;
             }
         }
-        m_orderedNormalsSet->insertMulti(angle, orderedImageSet);
 
-    }
-    ///Normal already existed [m_orderedImageSet-> contains (keyPlaneNormal) == true],
-    /// so just update the structure La normal ja existia [m_orderedImageSet->contains(keyPlaneNormal) == true], per tant només cal actualitzar l'estructura
-    else
-    {
-        /// TODO WARN BUG: We are doing insertMulti() in another place, so there may be keys with multiple values,
-        ///                but we are getting only the last value for each key, so some plane normals can be missed.
-        ///                We should iterate over the values instead of the unique keys.
-        foreach (double key, m_orderedNormalsSet->keys())
+        groupIndex = volumeInfo.groups.size();
+        volumeInfo.groups.append(group);
+
+        /// The new group replaces the comparable group with the same angle, if any
+        int position = 0;
+        while (position < volumeInfo.comparableGroups.size() && lessThan(volumeInfo.groups.at(volumeInfo.comparableGroups.at(position)).angle, group.angle))
         {
-            if (m_orderedNormalsSet->value(key)->contains(keyPlaneNormal))
-            {
-                orderedImageSet = m_orderedNormalsSet->value(key);
-            }
+            position++;
         }
 
-        imagePositionSet = orderedImageSet->value(keyPlaneNormal);
-        if (imagePositionSet->contains(distance))
+        if (position < volumeInfo.comparableGroups.size() && equivalent(volumeInfo.groups.at(volumeInfo.comparableGroups.at(position)).angle, group.angle))
         {
-            /// There are series where the images share the same instance number.
-            /// To avoid the problem an insertMulti is made.
-            imagePositionSet->value(distance)->insertMulti(QString("%1%2%3").arg(image->getInstanceNumber()).arg("0")
-                                                           .arg(image->getFrameNumber()).toULong(), image);
+            volumeInfo.comparableGroups[position] = groupIndex;
         }
         else
         {
-            instanceNumberSet = new QMap<unsigned long, Image*>();
-            instanceNumberSet->insert(QString("%1%2%3").arg(image->getInstanceNumber()).arg("0").arg(image->getFrameNumber()).toULong(), image);
-            imagePositionSet->insert(distance, instanceNumberSet);
+            volumeInfo.comparableGroups.insert(position, groupIndex);
+        }
+    }
+    else
+    {
+        NormalGroup &group = volumeInfo.groups[groupIndex];
+        if (lessThan(distance, group.minimumDistance))
+        {
+            group.minimumDistance = distance;
+        }
+        if (lessThan(group.maximumDistance, distance))
+        {
+            group.maximumDistance = distance;
         }
     }
+
+    ImageSortKey sortKey;
+    sortKey.image = image;
+    sortKey.group = groupIndex;
+    sortKey.distance = distance;
+    sortKey.instanceAndFrameNumber = getInstanceAndFrameNumberKey(image);
+    sortKey.processingOrder = volumeInfo.images.size();
+    volumeInfo.images.append(sortKey);
 }
 
 void OrderImagesFillerStep::processPhasesPerPositionEvaluation(Image *image)
@@ -392,20 +317,9 @@ void OrderImagesFillerStep::processPhasesPerPositionEvaluation(Image *image)
 void OrderImagesFillerStep::setOrderedImagesIntoSeries(Series *series)
 {
     QList<Image*> imageSet;
-    QMap<unsigned long, Image*> *instanceNumberSet;
-    QMap<double, QMap<unsigned long, Image*>*> *imagePositionSet;
-    QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*> *orderedImageSet;
-    QMap<double, QMap<double, QMap<double, QMap<unsigned long, Image*>*>*>*> lastOrderedImageSetDistanceAngle;
-    QMap<double, QMap<double, QMap<double, QMap<unsigned long, Image*>*>*>*> lastOrderedImageSetDistanceStack;
-    QMap<double, QMap<double, QMap<unsigned long, Image*>*>*> *lastOrderedImageSetDistance;
-    QMap<int, QMap<double, QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*>*> *volumesInSeries;
-
-    Image *currentImage;
-    int orderNumberInVolume;
+    QMap<int, VolumeOrderingInfo> volumesInSeries = m_orderImagesInternalInfo.take(series);
 
-    volumesInSeries = m_orderImagesInternalInfo.take(series);
-
-    foreach (int currentVolumeNumber, volumesInSeries->keys())
+    foreach (int currentVolumeNumber, volumesInSeries.keys())
     {
         bool orderByInstanceNumber = false;
         /// Different number of images per phase
@@ -427,112 +341,124 @@ void OrderImagesFillerStep::setOrderedImagesIntoSeries(Series *series)
                          currentVolumeNumber).arg(series->getInstanceUID()));
         }
 
-        if (orderByInstanceNumber)
+        int orderNumberInVolume = 0;
+
+        foreach (Image *image, getOrderedImages(volumesInSeries[currentVolumeNumber], orderByInstanceNumber))
         {
-            m_orderedNormalsSet = volumesInSeries->take(currentVolumeNumber);
-            QMap<unsigned long, Image*> sortedImagesByInstanceNumber;
+            image->setOrderNumberInVolume(orderNumberInVolume);
+            image->setVolumeNumberInSeries(currentVolumeNumber);
+            orderNumberInVolume++;
 
-            foreach (double key, m_orderedNormalsSet->keys())
-            {
-                orderedImageSet = m_orderedNormalsSet->take(key);
-                foreach (const QString &key, orderedImageSet->keys())
-                {
-                    imagePositionSet = orderedImageSet->take(key);
-                    foreach (double key2, imagePositionSet->keys())
-                    {
-                        instanceNumberSet = imagePositionSet->take(key2);
-                        foreach (unsigned long key3, instanceNumberSet->keys())
-                        {
-                            currentImage = instanceNumberSet->take(key3);
-                            sortedImagesByInstanceNumber.insertMulti(key3, currentImage);
-                        }
-                    }
-                }
-            }
+            imageSet += image;
+        }
+    }
+    series->setImages(imageSet);
+}
 
-            orderNumberInVolume = 0;
+QList<Image*> OrderImagesFillerStep::getOrderedImages(VolumeOrderingInfo &volumeInfo, bool orderByInstanceNumber) const
+{
+    const QVector<NormalGroup> &groups = volumeInfo.groups;
+    QVector<ImageSortKey> &images = volumeInfo.images;
+
+    /// Groups are traversed by ascending angle and, when several have the same angle, from the last created to the first.
+    /// Ties in the rest of criteria are resolved in the reverse order of this traversal.
+    QVector<int> groupsByAngle(groups.size());
+    std::iota(groupsByAngle.begin(), groupsByAngle.end(), 0);
+    std::sort(groupsByAngle.begin(), groupsByAngle.end(), [&groups](int a, int b)
+    {
+        if (!equivalent(groups.at(a).angle, groups.at(b).angle))
+        {
+            return lessThan(groups.at(a).angle, groups.at(b).angle);
+        }
+        return a > b;
+    });
 
-            foreach (Image *image, sortedImagesByInstanceNumber.values())
-            {
-                image->setOrderNumberInVolume(orderNumberInVolume);
-                image->setVolumeNumberInSeries(currentVolumeNumber);
-                orderNumberInVolume++;
+    QVector<int> angleRank(groups.size());
+    for (int i = 0; i < groupsByAngle.size(); i++)
+    {
+        angleRank[groupsByAngle.at(i)] = i;
+    }
 
-                imageSet += image;
-            }
+    /// Images of a group are ordered by distance and then by instance and frame number, and the last processed image goes first if these are equal
+    auto isBeforeInGroup = [](const ImageSortKey &a, const ImageSortKey &b)
+    {
+        if (!equivalent(a.distance, b.distance))
+        {
+            return lessThan(a.distance, b.distance);
         }
-        else
+        if (a.instanceAndFrameNumber != b.instanceAndFrameNumber)
         {
-            m_orderedNormalsSet = volumesInSeries->take(currentVolumeNumber);
+            return a.instanceAndFrameNumber < b.instanceAndFrameNumber;
+        }
+        return a.processingOrder > b.processingOrder;
+    };
 
-            ///Image groupings need to be sorted
-            foreach (double angle, m_orderedNormalsSet->keys())
+    if (orderByInstanceNumber)
+    {
+        /// Images with the same instance and frame number are ordered in the reverse order of the groups and the order inside each group
+        std::sort(images.begin(), images.end(), [&angleRank, &isBeforeInGroup](const ImageSortKey &a, const ImageSortKey &b)
+        {
+            if (a.instanceAndFrameNumber != b.instanceAndFrameNumber)
             {
-                orderedImageSet = m_orderedNormalsSet->take(angle);
-                lastOrderedImageSetDistance = new QMap<double, QMap<double, QMap<unsigned long, Image*>*>*>();
-                bool isRotational = true;
-
-                foreach (const QString &normal, orderedImageSet->keys())
-                {
-                    imagePositionSet = orderedImageSet->take(normal);
-                    
-                    Image *firstImage = (*(*imagePositionSet->begin())->begin());
-                    double distance = Image::distance(firstImage);
-                    lastOrderedImageSetDistance->insertMulti(distance, imagePositionSet);
-
-                    if (imagePositionSet->size() > 1)
-                    {
-                        int pos = (imagePositionSet->size())-1;
-                        double key = imagePositionSet->keys().at(pos);
-                        Image *lastImage = (*(imagePositionSet->value(key))->begin());
-                        double distanceToFirstImage = qAbs(Image::distance(lastImage)-distance);
-                        if (distanceToFirstImage > 1.0)
-                        {
-                            isRotational = false;
-                        }
-                    }
-                }
+                return a.instanceAndFrameNumber < b.instanceAndFrameNumber;
+            }
+            if (a.group != b.group)
+            {
+                return angleRank.at(a.group) > angleRank.at(b.group);
+            }
+            return isBeforeInGroup(b, a);
+        });
+    }
+    else
+    {
+        /// Stacks, which have images more than 1 mm apart, go first ordered by their minimum distance.
+        /// Then go the planes of rotational acquisitions, ordered by angle.
+        QVector<int> orderedGroups = groupsByAngle;
+        std::sort(orderedGroups.begin(), orderedGroups.end(), [&groups, &angleRank](int a, int b)
+        {
+            const NormalGroup &groupA = groups.at(a);
+            const NormalGroup &groupB = groups.at(b);
+            bool isStackA = groupA.maximumDistance - groupA.minimumDistance > 1.0;
+            bool isStackB = groupB.maximumDistance - groupB.minimumDistance > 1.0;
 
-                if (isRotational)//Rotacionals
-                {
-                    lastOrderedImageSetDistanceAngle.insertMulti(angle, lastOrderedImageSetDistance);
-                }
-                else //Stacks
-                {
-                    Image *image = (*(*imagePositionSet->begin())->begin());
-                    lastOrderedImageSetDistanceStack.insertMulti(Image::distance(image), lastOrderedImageSetDistance);
-                }
+            if (isStackA != isStackB)
+            {
+                return isStackA;
             }
-            
-            QList<QMap<double, QMap<double, QMap<unsigned long, Image*>*>*>*> orderedSet = lastOrderedImageSetDistanceStack.values();
-            orderedSet.append(lastOrderedImageSetDistanceAngle.values());
-            
-            orderNumberInVolume = 0;
 
-            for (int position = 0; position < orderedSet.size(); position++)
+            double keyA = isStackA ? groupA.minimumDistance : groupA.angle;
+            double keyB = isStackB ? groupB.minimumDistance : groupB.angle;
+            if (!equivalent(keyA, keyB))
             {
-                lastOrderedImageSetDistance = orderedSet.value(position);
-                foreach (double key2, lastOrderedImageSetDistance->keys())
-                {
-                    imagePositionSet = lastOrderedImageSetDistance->take(key2);
-                    foreach (double key3, imagePositionSet->keys())
-                    {
-                        instanceNumberSet = imagePositionSet->take(key3);
-                        foreach (unsigned long key4, instanceNumberSet->keys())
-                        {
-                            currentImage = instanceNumberSet->take(key4);
-                            currentImage->setOrderNumberInVolume(orderNumberInVolume);
-                            currentImage->setVolumeNumberInSeries(currentVolumeNumber);
-                            orderNumberInVolume++;
-
-                            imageSet += currentImage;
-                        }
-                    }
-                }
+                return lessThan(keyA, keyB);
             }
+            return angleRank.at(a) > angleRank.at(b);
+        });
+
+        QVector<int> groupPosition(groups.size());
+        for (int i = 0; i < orderedGroups.size(); i++)
+        {
+            groupPosition[orderedGroups.at(i)] = i;
         }
+
+        std::sort(images.begin(), images.end(), [&groupPosition, &isBeforeInGroup](const ImageSortKey &a, const ImageSortKey &b)
+        {
+            if (a.group != b.group)
+            {
+                return groupPosition.at(a.group) < groupPosition.at(b.group);
+            }
+            return isBeforeInGroup(a, b);
+        });
     }
-    series->setImages(imageSet);
+
+    QList<Image*> orderedImages;
+    orderedImages.reserve(images.size());
+    foreach (const ImageSortKey &sortKey, images)
+    {
+        orderedImages << sortKey.image;
+    }
+
+    return orderedImages;
 }
 
 }
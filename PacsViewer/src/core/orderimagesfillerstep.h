@@ -19,6 +19,7 @@
 #include <QMap>
 #include <QHash>
 #include <QString>
+#include <QVector>
 #include <QVector3D>
 
 namespace udg {
@@ -42,19 +43,59 @@ public:
     void postProcessing();
 
 private:
+    /// Group of images of a volume that share the same plane normal. It's a stack or a plane of a rotational acquisition.
+    struct NormalGroup
+    {
+        /// Normal formatted with 5 decimals, which is how normals are compared.
+        QString normal;
+        /// Normal vector obtained from the formatted normal.
+        QVector3D normalVector;
+        /// Angle between the normal of the first group of the volume and this normal, following the ordering direction.
+        double angle;
+        /// Minimum and maximum distance of the images of the group along the normal.
+        double minimumDistance;
+        double maximumDistance;
+    };
+
+    /// Keys used to sort an image inside its volume.
+    struct ImageSortKey
+    {
+        Image *image;
+        /// Index of the group of the image.
+        int group;
+        /// Distance of the image along its normal.
+        double distance;
+        /// Instance number followed by a 0 and the frame number.
+        unsigned long instanceAndFrameNumber;
+        /// Position of the image in the order in which images have been processed.
+        int processingOrder;
+    };
+
+    /// Information gathered from the images of a volume to sort them.
+    struct VolumeOrderingInfo
+    {
+        /// Groups in the order they have been created.
+        QVector<NormalGroup> groups;
+        /// Indices of the groups whose normal is compared with the normal of new images, sorted by angle.
+        /// When several groups have the same angle, only the last created is compared.
+        QVector<int> comparableGroups;
+        /// Sort keys of the images in the order they have been processed.
+        QVector<ImageSortKey> images;
+    };
+
     /// Methods for processing series-specific information
-    void processImage(Image *image);
+    void processImage(Image *image, VolumeOrderingInfo &volumeInfo);
 
     /// Method for calculating how many phases per position each image actually has within each series and subvolume.
     void processPhasesPerPositionEvaluation(Image *image);
-    ///Method that transforms the structure of ordered images into a list and inserts it into the series
+    ///Method that sorts the images of each volume of the series and inserts them into the series
     void setOrderedImagesIntoSeries(Series *series);
 
-    /// Method that transforms the structure of ordered images into a list and inserts it into the series.
-    QMap<double, QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*> *m_orderedNormalsSet;
+    /// Returns the images of the given volume sorted by position or by instance number, with a single sort of their keys.
+    QList<Image*> getOrderedImages(VolumeOrderingInfo &volumeInfo, bool orderByInstanceNumber) const;
 
-    // Angle NormalVector Distance InstanceNumber0FrameNumber
-    QHash<Series*, QMap<int, QMap<double, QMap<QString, QMap<double, QMap<unsigned long, Image*>*>*>*>*>*> m_orderImagesInternalInfo;
+    /// Information to sort the images of each volume of each series.
+    QHash<Series*, QMap<int, VolumeOrderingInfo>> m_orderImagesInternalInfo;
 
     QHash<Series*, QHash<int, QPair<QString, bool>*> > m_acquisitionNumberEvaluation;
 
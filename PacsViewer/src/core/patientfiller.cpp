@@ -17,6 +17,7 @@
 #include "dicomfileclassifierfillerstep.h"
 #include "dicomtagreader.h"
 #include "encapsulateddocumentfillerstep.h"
+#include "image.h"
 #include "imagefillerstep.h"
 //#include "keyimagenotefillerstep.h"       // future use
 #include "logging.h"
@@ -29,16 +30,63 @@
 #include "temporaldimensionfillerstep.h"
 #include "volumefillerstep.h"
 
+#include <QThread>
+#include <QtConcurrentMap>
+
 namespace udg {
 
 namespace {
 
+// Number of files prepared by each thread in each batch. Batches bound the number of DICOM files held in memory at the same time.
+const int FilesPerThreadInBatch = 8;
+
 // Returns true if the list contains MHD files and false otherwise. Only the first file is checked.
 bool containsMHDFiles(const QStringList &files)
 {
     return !files.isEmpty() && files.first().endsWith(".mhd", Qt::CaseInsensitive);
 }
 
+// A DICOM file whose header has been read and whose images have been created, ready to be added to the patients.
+struct PreparedDICOMFile
+{
+    DICOMTagReader *dicomTagReader;
+    QList<Image*> images;
+};
+
+// Reads the header of a DICOM file and creates its images. It's used concurrently from the threads of the pool.
+class DICOMFilePreparer {
+public:
+    typedef PreparedDICOMFile result_type;
+
+    DICOMFilePreparer(ImageFillerStep *imageFillerStep, QThread *targetThread)
+        : m_imageFillerStep(imageFillerStep), m_targetThread(targetThread)
+    {
+    }
+
+    PreparedDICOMFile operator()(const QString &file) const
+    {
+        PreparedDICOMFile preparedFile;
+        preparedFile.dicomTagReader = new DICOMTagReader(file);
+
+        if (preparedFile.dicomTagReader->canReadFile())
+        {
+            preparedFile.images = m_imageFillerStep->createImages(preparedFile.dicomTagReader);
+
+            // Images are QObjects created in a thread of the pool, so they must be moved to the thread that will use them
+            foreach (Image *image, preparedFile.images)
+            {
+                image->moveToThread(m_targetThread);
+            }
+        }
+
+        return preparedFile;
+    }
+
+private:
+    ImageFillerStep *m_imageFillerStep;
+    QThread *m_targetThread;
+};
+
 }
 
 PatientFiller::PatientFiller(DICOMSource dicomSource, QObject *parent)
@@ -78,7 +126,11 @@ void PatientFiller::processDICOMFile(const DICOMTagReader *dicomTagReader)
     Q_ASSERT(dicomTagReader);
 
     m_patientFillerInput->setDICOMFile(dicomTagReader);
+    processCurrentDICOMFile();
+}
 
+void PatientFiller::processCurrentDICOMFile()
+{
     foreach (PatientFillerStep *fillerStep, m_firstStageSteps)
     {
         // If some step fails to fill we can skip the rest of steps.
@@ -120,6 +172,7 @@ void PatientFiller::finishDICOMFilesProcess()
     }
 
     emit patientProcessed(m_patientFillerInput->getPatient());
+    emit patientsProcessed(m_patientFillerInput->getPatientList());
 }
 
 QList<Patient*> PatientFiller::processFiles(const QStringList &files)
@@ -162,11 +215,24 @@ QList<Patient*> PatientFiller::processMHDFiles(const QStringList &files)
 
 QList<Patient*> PatientFiller::processDICOMFiles(const QStringList &files)
 {
-    foreach (const QString &dicomFile, files)
+    // Reading the headers and creating the images only depends on each file, so it's done concurrently in batches. Then the files of each batch are added
+    // to the patients one by one in the original order, so the result is the same as if all the work was done sequentially.
+    ImageFillerStep imageFillerStep;
+    imageFillerStep.setInput(m_patientFillerInput);
+    DICOMFilePreparer preparer(&imageFillerStep, QThread::currentThread());
+    int batchSize = qMax(1, QThread::idealThreadCount()) * FilesPerThreadInBatch;
+
+    for (int first = 0; first < files.size(); first += batchSize)
     {
-        // The DICOMTagReader is deleted by the PatientFillerInput
-        DICOMTagReader *dicomTagReader = new DICOMTagReader(dicomFile);
-        this->processDICOMFile(dicomTagReader);
+        QList<PreparedDICOMFile> preparedFiles = QtConcurrent::blockingMapped<QList<PreparedDICOMFile>>(files.mid(first, batchSize), preparer);
+
+        foreach (const PreparedDICOMFile &preparedFile, preparedFiles)
+        {
+            // The DICOMTagReader and the images that are not used are deleted by the PatientFillerInput
+            m_patientFillerInput->setDICOMFile(preparedFile.dicomTagReader);
+            m_patientFillerInput->setPreparedImages(preparedFile.images);
+            processCurrentDICOMFile();
+        }
     }
 
     this->finishDICOMFilesProcess();
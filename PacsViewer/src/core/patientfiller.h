@@ -32,6 +32,7 @@ class PatientFillerStep;
  * Files can be given to it one by one (e.g. as they arrive from PACS) in processDICOMFile()
  * and then call finishDICOMFilesProcess() after the last file.
  * Alternatively, files can be given to it all at once (e.g. when reading fils from a directory) in processFiles().
+ * In that case the DICOM headers are read and the images are created on a thread pool, and only the merge into the patients is sequential.
  *
  * The files are processed by several steps that share a common PatientFillerInput.
  */
@@ -48,7 +49,7 @@ public slots:
     void processDICOMFile(const DICOMTagReader *dicomTagReader);
 
     /// Executes the second stage steps with all the images generated in the first stage and then executes the post-processing.
-    /// Emits the patientProcessed() signal at the end.
+    /// Emits the patientProcessed() and patientsProcessed() signals at the end.
     void finishDICOMFilesProcess();
 
     /// Processes the given files executing both stages and post-processing. Returns the generated patients.
@@ -59,9 +60,12 @@ signals:
     void progress(int numberOfProcessedFiles);
 
     /// This signal is emitted when finishDICOMFilesProcess() has finished, with the first generated patient.
-    /// \todo If more than one patient was generated, all but the first will be ignored.
+    /// If more than one patient was generated, all but the first are ignored; use patientsProcessed() to get all of them.
     void patientProcessed(Patient *patient);
 
+    /// This signal is emitted when finishDICOMFilesProcess() has finished, with all the generated patients.
+    void patientsProcessed(const QList<Patient*> &patients);
+
 private:
     /// Creates the steps of the patient filler.
     void createSteps();
@@ -70,8 +74,12 @@ private:
     QList<Patient*> processMHDFiles(const QStringList &files);
 
     /// Processes the given DICOM files and returns the generated patients.
+    /// Headers are read and images are created concurrently, but files are added to the patients in the given order.
     QList<Patient*> processDICOMFiles(const QStringList &files);
 
+    /// Executes the first stage steps with the current DICOM file of the input. Emits the progress() signal at the end.
+    void processCurrentDICOMFile();
+
 private:
     /// Steps that are executed in the first stage of processing.
     QList<PatientFillerStep*> m_firstStageSteps;
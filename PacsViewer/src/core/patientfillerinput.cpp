@@ -15,19 +15,21 @@
 #include "patientfillerinput.h"
 
 #include "dicomtagreader.h"
+#include "image.h"
 #include "logging.h"
 #include "patient.h"
 
 namespace udg {
 
 PatientFillerInput::PatientFillerInput()
-    : m_dicomFile(nullptr), m_currentSeries(nullptr)
+    : m_dicomFile(nullptr), m_hasPreparedImages(false), m_currentSeries(nullptr)
 {
 }
 
 PatientFillerInput::~PatientFillerInput()
 {
     delete m_dicomFile;
+    qDeleteAll(m_preparedImages);
 }
 
 const DICOMSource& PatientFillerInput::getDICOMSource() const
@@ -49,6 +51,30 @@ void PatientFillerInput::setDICOMFile(const DICOMTagReader *dicomTagReader)
 {
     delete m_dicomFile;
     m_dicomFile = dicomTagReader;
+
+    qDeleteAll(m_preparedImages);
+    m_preparedImages.clear();
+    m_hasPreparedImages = false;
+}
+
+bool PatientFillerInput::hasPreparedImages() const
+{
+    return m_hasPreparedImages;
+}
+
+void PatientFillerInput::setPreparedImages(const QList<Image*> &images)
+{
+    qDeleteAll(m_preparedImages);
+    m_preparedImages = images;
+    m_hasPreparedImages = true;
+}
+
+QList<Image*> PatientFillerInput::takePreparedImages()
+{
+    QList<Image*> images = m_preparedImages;
+    m_preparedImages.clear();
+    m_hasPreparedImages = false;
+    return images;
 }
 
 const QString& PatientFillerInput::getFile() const
@@ -43,8 +43,17 @@ public:
     /// Returns the DICOM file that is currently being processed.
     const DICOMTagReader* getDICOMFile() const;
     /// Sets the DICOM file that will be processed. PatientFillerInput takes ownership of the DICOMTagReader.
+    /// Any prepared images of the previous file that have not been taken are deleted.
     void setDICOMFile(const DICOMTagReader *dicomTagReader);
 
+    /// Returns true if the images of the current DICOM file have been created in advance and have not been taken yet.
+    bool hasPreparedImages() const;
+    /// Sets the images created in advance from the current DICOM file, so that they don't have to be created again when the file is processed.
+    /// PatientFillerInput takes ownership of the images until they are taken. It must be called after setDICOMFile().
+    void setPreparedImages(const QList<Image*> &images);
+    /// Returns the images created in advance from the current DICOM file and releases their ownership.
+    QList<Image*> takePreparedImages();
+
     /// Returns the non-DICOM file that is currently being processed.
     const QString& getFile() const;
     /// Sets the non-DICOM file that will be processed.
@@ -92,6 +101,11 @@ private:
     /// The DICOM file that is currently being processed.
     const DICOMTagReader *m_dicomFile;
 
+    /// Images created in advance from the current DICOM file that have not been taken yet.
+    QList<Image*> m_preparedImages;
+    /// True if the images of the current DICOM file have been created in advance and have not been taken yet.
+    bool m_hasPreparedImages;
+
     /// The non-DICOM file that is currently being processed.
     QString m_file;
 
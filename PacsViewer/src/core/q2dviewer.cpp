@@ -32,6 +32,8 @@
 #include "blendfilter.h"
 #include "imagepipeline.h"
 #include "volumereadermanager.h"
+#include "volumereaderjob.h"
+#include "volumerepository.h"
 #include "qviewercommand.h"
 #include "renderqviewercommand.h"
 #include "mammographyimagehelper.h"
@@ -42,6 +44,7 @@
 #include "patientbrowsermenu.h"
 #include "voiluthelper.h"
 #include "sliceorientedvolumepixeldata.h"
+#include "volumepixeldata.h"
 
 // Qt
 #include <QResizeEvent>
@@ -64,11 +67,13 @@
 namespace udg {
 
 const QString Q2DViewer::OverlaysDrawerGroup("Overlays");
+const int Q2DViewer::MaximumNumberOfSlicesWithOverlayBitmaps = 16;
 const QString Q2DViewer::DummyVolumeObjectName("Dummy Volume");
 
 Q2DViewer::Q2DViewer(QWidget *parent)
     : QViewer(parent), m_overlayVolume(0), m_blender(0), m_overlapMethod(Q2DViewer::Blend), m_rotateFactor(0), m_applyFlip(false),
-      m_isImageFlipped(false), m_slabProjectionMode(VolumeDisplayUnit::Max), m_fusionBalance(50)
+      m_isImageFlipped(false), m_slabProjectionMode(VolumeDisplayUnit::Max), m_fusionBalance(50), m_progressiveLoadingFirstSlice(-1),
+      m_isShowingPartiallyLoadedVolume(false)
 {
     m_displayUnitsFactory = new VolumeDisplayUnitHandlerFactory;
     initializeDummyDisplayUnit();
@@ -76,6 +81,7 @@ Q2DViewer::Q2DViewer(QWidget *parent)
     m_inputFinishedCommand = NULL;
 
     connect(m_volumeReaderManager, SIGNAL(readingFinished()), SLOT(volumeReaderJobFinished()));
+    connect(m_volumeReaderManager, SIGNAL(slicesAvailable(Volume*, int, int)), SLOT(volumeReaderSlicesAvailable(Volume*, int, int)));
     connect(m_volumeReaderManager, SIGNAL(progress(int)), m_workInProgressWidget, SLOT(updateProgress(int)));
     //connect(m_patientBrowserMenu, SIGNAL(selectedVolumes(QList<Volume*>)), this, SLOT(setInputAndRender(QList<Volume*>)));
 
@@ -86,6 +92,10 @@ Q2DViewer::Q2DViewer(QWidget *parent)
     // We create the drawer, passing the this object as a viewfinder
     m_drawer = new Drawer(this);
 
+    // The overlay bitmaps are created when their slice is shown
+    connect(this, SIGNAL(sliceChanged(int)), SLOT(updateOverlayBitmaps()));
+    connect(this, SIGNAL(viewChanged(int)), SLOT(updateOverlayBitmaps()));
+
     m_imageOrientationOperationsMapper = new ImageOrientationOperationsMapper();
 
     m_alignPosition = Q2DViewer::AlignCenter;
@@ -403,6 +413,8 @@ void Q2DViewer::setInput(Volume *volume)
     }
 
     m_volumeReaderManager->cancelReading();
+    m_progressiveLoadingFirstSlice = -1;
+    m_isShowingPartiallyLoadedVolume = false;
     deleteInputFinishedCommand();
 
     setNewVolumes(QList<Volume*>() << volume);
@@ -422,7 +434,11 @@ void Q2DViewer::setInputAsynchronously(Volume *volume, QViewerCommand *inputFini
 void Q2DViewer::setInputAsynchronously(const QList<Volume *> &volumes, QViewerCommand *inputFinishedCommand)
 {
     m_volumeReaderManager->cancelReading();
+    m_progressiveLoadingFirstSlice = -1;
+    m_isShowingPartiallyLoadedVolume = false;
     setInputFinishedCommand(inputFinishedCommand);
+    // The requested volumes are marked as in use before loading them, so that they aren't evicted while they are being set
+    VolumeRepository::getRepository()->setVolumesInUse(this, volumes);
 
     bool allowAsynchronousVolumeLoading = Settings().getValue(CoreSettings::AllowAsynchronousVolumeLoading).toBool();
     bool thereAreVolumesNotLoaded = false;
@@ -491,7 +507,19 @@ void Q2DViewer::loadVolumesAsynchronously(const QList<Volume*> &volumes)
 {
     setViewerStatus(LoadingVolume);
 
-    m_volumeReaderManager->readVolumes(volumes);
+    // A single volume without phases can be displayed progressively, starting from the middle of the stack
+    m_progressiveLoadingFirstSlice = -1;
+    m_isShowingPartiallyLoadedVolume = false;
+
+    if (volumes.size() == 1 && volumes.first()->getNumberOfPhases() == 1 && volumes.first()->getImages().size() > 1
+        && Settings().getValue(CoreSettings::AllowProgressiveVolumeLoading).toBool())
+    {
+        m_progressiveLoadingFirstSlice = volumes.first()->getImages().size() / 2;
+    }
+
+    // Volumes of visible viewers are read before the others
+    int priority = isVisible() ? VolumeReaderJob::VisibleViewerPriority : VolumeReaderJob::DefaultPriority;
+    m_volumeReaderManager->readVolumes(volumes, m_progressiveLoadingFirstSlice, priority);
 
     /// TODO:At the moment we have no choice but to specify a fake volume.
     /// The rest of the viewer (and those that depend on it) are expected
@@ -510,9 +538,20 @@ void Q2DViewer::loadVolumesAsynchronously(const QList<Volume*> &volumes)
 
 void Q2DViewer::volumeReaderJobFinished()
 {
+    bool wasShowingPartiallyLoadedVolume = m_isShowingPartiallyLoadedVolume && getCurrentViewPlane() == OrthogonalPlane::XYPlane;
+    int currentSlice = getCurrentSlice();
+    m_progressiveLoadingFirstSlice = -1;
+    m_isShowingPartiallyLoadedVolume = false;
+
     if (m_volumeReaderManager->readingSuccess())
     {
         setNewVolumesAndExecuteCommand(m_volumeReaderManager->getVolumes());
+
+        if (wasShowingPartiallyLoadedVolume && getViewerStatus() == VisualizingVolume)
+        {
+            // Keep the slice the user was looking at while the volume was loading
+            setSlice(currentSlice);
+        }
     }
     else
     {
@@ -521,6 +560,69 @@ void Q2DViewer::volumeReaderJobFinished()
     }
 }
 
+void Q2DViewer::volumeReaderSlicesAvailable(Volume *volume, int firstSlice, int lastSlice)
+{
+    if (m_progressiveLoadingFirstSlice < 0)
+    {
+        return;
+    }
+
+    if (!m_isShowingPartiallyLoadedVolume)
+    {
+        if (firstSlice > m_progressiveLoadingFirstSlice || lastSlice < m_progressiveLoadingFirstSlice)
+        {
+            return;
+        }
+
+        VolumePixelData *partialPixelData = m_volumeReaderManager->createPartialPixelData(volume);
+
+        if (!partialPixelData)
+        {
+            return;
+        }
+
+        try
+        {
+            setNewVolumes(QList<Volume*>() << getPartiallyLoadedVolumeFromVolume(volume, partialPixelData));
+        }
+        catch (...)
+        {
+            // Not being able to show the partial volume is not an error, the volume will be shown when completely loaded
+            WARN_LOG("Could not display the partially loaded volume");
+            m_progressiveLoadingFirstSlice = -1;
+            setViewerStatus(LoadingVolume);
+            return;
+        }
+
+        m_isShowingPartiallyLoadedVolume = true;
+        m_partiallyLoadedSlices[0] = firstSlice;
+        m_partiallyLoadedSlices[1] = lastSlice;
+
+        if (getCurrentViewPlane() == OrthogonalPlane::XYPlane)
+        {
+            setSlice(m_progressiveLoadingFirstSlice);
+        }
+
+        render();
+    }
+    else
+    {
+        int currentSlice = getCurrentSlice();
+        bool currentSliceWasLoaded = currentSlice >= m_partiallyLoadedSlices[0] && currentSlice <= m_partiallyLoadedSlices[1];
+        m_partiallyLoadedSlices[0] = firstSlice;
+        m_partiallyLoadedSlices[1] = lastSlice;
+
+        // The data has been modified behind the pipeline's back, so it has to be marked as modified to be displayed
+        getMainInput()->getVtkData()->Modified();
+
+        // Only render when the displayed slice has just been loaded, or if it's not an acquisition plane slice, since it may cross any slice
+        if (getCurrentViewPlane() != OrthogonalPlane::XYPlane || (!currentSliceWasLoaded && currentSlice >= firstSlice && currentSlice <= lastSlice))
+        {
+            render();
+        }
+    }
+}
+
 void Q2DViewer::setNewVolumesAndExecuteCommand(const QList<Volume*> &volumes)
 {
     try
@@ -550,6 +652,17 @@ Volume* Q2DViewer::getDummyVolumeFromVolume(Volume *volume)
     return newVolume;
 }
 
+Volume* Q2DViewer::getPartiallyLoadedVolumeFromVolume(Volume *volume, VolumePixelData *partialPixelData)
+{
+    Volume *newVolume = new Volume(this);
+    newVolume->setObjectName(DummyVolumeObjectName);
+    newVolume->setImages(volume->getImages());
+    newVolume->setPixelData(partialPixelData);
+    newVolume->setIdentifier(volume->getIdentifier());
+
+    return newVolume;
+}
+
 void Q2DViewer::setNewVolumes(const QList<Volume*> &volumes, bool setViewerStatusToVisualizingVolume)
 {
     if (volumes.isEmpty())
@@ -619,9 +732,7 @@ void Q2DViewer::setNewVolumes(const QList<Volume*> &volumes, bool setViewerStatu
 
     m_annotationsHandler->updateAnnotations(MainInformationAnnotation | AdditionalInformationAnnotation);
 
-    loadOverlays(volumes.first());
-
-    // Reset the view to the acquisition plane
+    // Reset the view to the acquisition plane, which also creates the overlay bitmaps of the first slice
     resetViewToAcquisitionPlane();
 
     // HACK
@@ -638,76 +749,114 @@ void Q2DViewer::setNewVolumes(const QList<Volume*> &volumes, bool setViewerStatu
 void Q2DViewer::removeViewerBitmaps()
 {
     // We deleted the bitmaps we had so far
-    foreach (DrawerBitmap *bitmap, m_viewerBitmaps)
+    foreach (int slice, m_leastRecentlyUsedOverlaySlices)
+    {
+        removeOverlayBitmaps(slice);
+    }
+    m_leastRecentlyUsedOverlaySlices.clear();
+}
+
+void Q2DViewer::removeOverlayBitmaps(int slice)
+{
+    foreach (DrawerBitmap *bitmap, m_overlayBitmaps.take(slice))
     {
         bitmap->decreaseReferenceCount();
         delete bitmap;
     }
-    m_viewerBitmaps.clear();
 }
 
-void Q2DViewer::loadOverlays(Volume *volume)
+void Q2DViewer::updateOverlayBitmaps()
 {
-    if (!volume)
+    if (!hasInput() || !m_overlaysAreEnabled || getCurrentViewPlane() != OrthogonalPlane::XYPlane)
     {
         return;
     }
 
-    if (volume->objectName() == DummyVolumeObjectName)
+    int slice = getCurrentSlice();
+
+    if (m_overlayBitmaps.contains(slice))
     {
+        // It becomes the most recently shown slice
+        m_leastRecentlyUsedOverlaySlices.removeOne(slice);
+        m_leastRecentlyUsedOverlaySlices.append(slice);
         return;
     }
 
+    QList<DrawerBitmap*> bitmaps = createOverlayBitmaps(slice);
+
+    // Slices without overlays are not kept, so that they don't push out the ones that have
+    if (bitmaps.isEmpty())
+    {
+        return;
+    }
+
+    m_overlayBitmaps.insert(slice, bitmaps);
+    m_leastRecentlyUsedOverlaySlices.append(slice);
+
+    while (m_leastRecentlyUsedOverlaySlices.size() > MaximumNumberOfSlicesWithOverlayBitmaps)
+    {
+        removeOverlayBitmaps(m_leastRecentlyUsedOverlaySlices.takeFirst());
+    }
+}
+
+QList<DrawerBitmap*> Q2DViewer::createOverlayBitmaps(int slice)
+{
+    QList<DrawerBitmap*> bitmaps;
+    Volume *volume = getMainInput();
+
+    if (!volume)
+    {
+        return bitmaps;
+    }
+
+    if (volume->objectName() == DummyVolumeObjectName)
+    {
+        return bitmaps;
+    }
+
     double volumeSpacing[3];
     volume->getSpacing(volumeSpacing);
     double volumeOrigin[3];
     volume->getOrigin(volumeOrigin);
-    
-    int numberOfSlices = volume->getNumberOfSlicesPerPhase();
+
     int numberOfPhases = volume->getNumberOfPhases();
-    for (int sliceIndex = 0; sliceIndex < numberOfSlices; ++sliceIndex)
+    for (int phaseIndex = 0; phaseIndex < numberOfPhases; ++phaseIndex)
     {
-        for (int phaseIndex = 0; phaseIndex < numberOfPhases; ++ phaseIndex)
+        Image *image = volume->getImage(slice, phaseIndex);
+        if (!image)
         {
-            Image *image = volume->getImage(sliceIndex, phaseIndex);
-            if (!image)
-            {
-                ERROR_LOG(QString("Unexpected error trying to access image with indexes: %1 (slice), %2 (phase) of current volume")
-                          .arg(sliceIndex).arg(phaseIndex));
-                DEBUG_LOG(QString("Unexpected error trying to access image with indexes: %1 (slice), %2 (phase) of current volume")
-                          .arg(sliceIndex).arg(phaseIndex));
-            }
-            else
+            ERROR_LOG(QString("Unexpected error trying to access image with indexes: %1 (slice), %2 (phase) of current volume")
+                      .arg(slice).arg(phaseIndex));
+            DEBUG_LOG(QString("Unexpected error trying to access image with indexes: %1 (slice), %2 (phase) of current volume")
+                      .arg(slice).arg(phaseIndex));
+        }
+        else
+        {
+            if (image->hasOverlays())
             {
-                if (image->hasOverlays())
+                // Calculem l'origen del bitmap corresponent a aquesta imatge
+                double imageOrigin[3];
+                imageOrigin[0] = volumeOrigin[0];
+                imageOrigin[1] = volumeOrigin[1];
+                imageOrigin[2] = volumeOrigin[2] + slice * volumeSpacing[2];
+                // Creem els bitmaps
+                foreach(const ImageOverlay &overlay, image->getOverlaysSplit())
                 {
-                    // Calculem l'origen del bitmap corresponent a aquesta imatge
-                    double imageOrigin[3];
-                    imageOrigin[0] = volumeOrigin[0];
-                    imageOrigin[1] = volumeOrigin[1];
-                    imageOrigin[2] = volumeOrigin[2] + sliceIndex * volumeSpacing[2];
-                    // Creem els bitmaps
-                    foreach(const ImageOverlay &overlay, image->getOverlaysSplit())
-                    {
-                        DrawerBitmap *overlayBitmap = overlay.getAsDrawerBitmap(imageOrigin, volumeSpacing);
-                        //Initially it will not be, according to the slice we are in the Drawer will decide on its visibility
-                        overlayBitmap->setVisibility(false);
-                        // The primitive cannot be deleted with the tools
-                        overlayBitmap->setErasable(false);
-                        overlayBitmap->increaseReferenceCount();
-                        getDrawer()->draw(overlayBitmap, OrthogonalPlane::XYPlane, sliceIndex);
-                        getDrawer()->addToGroup(overlayBitmap, OverlaysDrawerGroup);
-                        m_viewerBitmaps << overlayBitmap;
-                    }
+                    DrawerBitmap *overlayBitmap = overlay.getAsDrawerBitmap(imageOrigin, volumeSpacing);
+                    //Initially it will not be, according to the slice we are in the Drawer will decide on its visibility
+                    overlayBitmap->setVisibility(false);
+                    // The primitive cannot be deleted with the tools
+                    overlayBitmap->setErasable(false);
+                    overlayBitmap->increaseReferenceCount();
+                    getDrawer()->draw(overlayBitmap, OrthogonalPlane::XYPlane, slice);
+                    getDrawer()->addToGroup(overlayBitmap, OverlaysDrawerGroup);
+                    bitmaps << overlayBitmap;
                 }
             }
         }
     }
 
-    if (!m_overlaysAreEnabled)
-    {
-        showImageOverlays(m_overlaysAreEnabled);
-    }
+    return bitmaps;
 }
 
 void Q2DViewer::setOverlayInput(Volume *volume)
@@ -1019,11 +1168,12 @@ void Q2DViewer::updateSecondaryVolumesSlices()
 
     SliceLocator sliceLocator;
     sliceLocator.setPlane(getCurrentViewPlane());
+    ImagePlane *currentPlane = getCurrentImagePlane();
 
     for (int i = 1; i < getNumberOfInputs(); i++)
     {
         sliceLocator.setVolume(getDisplayUnit(i)->getVolume());
-        int nearestSlice = sliceLocator.getNearestSlice(getCurrentImagePlane());
+        int nearestSlice = sliceLocator.getNearestSlice(currentPlane);
 
         if (nearestSlice >= 0)
         {
@@ -1036,6 +1186,8 @@ void Q2DViewer::updateSecondaryVolumesSlices()
             getDisplayUnit(i)->setSlice(0);
         }
     }
+
+    delete currentPlane;
 }
 
 void Q2DViewer::setOverlapMethod(OverlapMethod method)
@@ -1779,16 +1931,18 @@ void Q2DViewer::setImageOrientation(const PatientOrientation &desiredPatientOrie
 
 void Q2DViewer::showImageOverlays(bool enable)
 {
+    m_overlaysAreEnabled = enable;
+
     if (enable)
     {
+        // The bitmaps of the current slice are not created while the overlays are disabled
+        updateOverlayBitmaps();
         getDrawer()->enableGroup(OverlaysDrawerGroup);
     }
     else
     {
         getDrawer()->disableGroup(OverlaysDrawerGroup);
     }
-
-    m_overlaysAreEnabled = enable;
 }
 
 void Q2DViewer::showDisplayShutters(bool enable)
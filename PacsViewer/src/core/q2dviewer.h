@@ -20,6 +20,7 @@
 #include "anatomicalplane.h"
 #include "volumedisplayunit.h"
 
+#include <QHash>
 #include <QPointer>
 
 // Fordward declarations
@@ -514,6 +515,9 @@ private:
     /// Returns a dummy volume
     Volume* getDummyVolumeFromVolume(Volume *volume);
 
+    /// Returns a dummy volume with the images of the given volume and the given partially loaded pixel data, to be displayed while the volume is loading.
+    Volume* getPartiallyLoadedVolumeFromVolume(Volume *volume, VolumePixelData *partialPixelData);
+
     /// Specifies which command to run after specifying a volume as input
     void setInputFinishedCommand(QViewerCommand *command);
 
@@ -533,9 +537,12 @@ private:
     ///Delete the bitmaps created by this viewer
     void removeViewerBitmaps();
 
-    /// Loads ImageOverlays from the last volume per parameter (as long as it's not a dummy)
-    /// and adds them to the Drawer
-    void loadOverlays(Volume *volume);
+    /// Creates the bitmaps of the ImageOverlays of all the phases of the given slice of the main input (as long as it's not a dummy),
+    /// adds them to the Drawer and returns them
+    QList<DrawerBitmap*> createOverlayBitmaps(int slice);
+
+    /// Deletes the overlay bitmaps of the given slice
+    void removeOverlayBitmaps(int slice);
 
     /// Enum to define the different dimensions an image slice could be associated to
     enum SliceDimension { SpatialDimension, TemporalDimension };
@@ -571,6 +578,14 @@ private slots:
 
     void volumeReaderJobFinished();
 
+    /// Called during a progressive load when more slices of the loading volume are available. The first time the first slice to read is available, it
+    /// displays the partially loaded volume; afterwards it updates it as more slices arrive.
+    void volumeReaderSlicesAvailable(Volume *volume, int firstSlice, int lastSlice);
+
+    /// Creates the overlay bitmaps of the current slice if they don't exist yet, when the overlays are enabled and the acquisition plane is shown.
+    /// Only the bitmaps of the MaximumNumberOfSlicesWithOverlayBitmaps most recently shown slices are kept.
+    void updateOverlayBitmaps();
+
 protected:
     /// This is the second volume added to overlap
     Volume *m_overlayVolume;
@@ -585,6 +600,9 @@ private:
     /// Name of the groups in the drawer for Overlays
     static const QString OverlaysDrawerGroup;
 
+    /// Maximum number of slices whose overlay bitmaps are kept
+    static const int MaximumNumberOfSlicesWithOverlayBitmaps;
+
     /// Constant to define the object name of the "dummy" volumes
     static const QString DummyVolumeObjectName;
 
@@ -619,8 +637,11 @@ private:
 
     QViewerCommand *m_inputFinishedCommand;
 
-    /// List of overlays
-    QList<DrawerBitmap*> m_viewerBitmaps;
+    /// Overlay bitmaps of the slices of the main input that have been shown, indexed by slice
+    QHash<int, QList<DrawerBitmap*> > m_overlayBitmaps;
+
+    /// Slices with overlay bitmaps, from the least to the most recently shown
+    QList<int> m_leastRecentlyUsedOverlaySlices;
 
     /// Controls whether overlays are enabled or not
     bool m_overlaysAreEnabled;
@@ -645,6 +666,13 @@ private:
     /// representing the weight of the second input.
     int m_fusionBalance;
 
+    /// Slice that is read first in the current progressive load, or -1 if the current load is not progressive.
+    int m_progressiveLoadingFirstSlice;
+    /// True while a partially loaded volume is displayed.
+    bool m_isShowingPartiallyLoadedVolume;
+    /// Range of slices of the partially loaded volume that contain valid data.
+    int m_partiallyLoadedSlices[2];
+
 };
 
 };  //  End namespace udg
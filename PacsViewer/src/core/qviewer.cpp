@@ -26,6 +26,8 @@
 #include "mathtools.h"
 #include "starviewerapplication.h"
 #include "coresettings.h"
+#include "volumerepository.h"
+#include "renderscheduler.h"
 
 // TODO:  EVERYTHING: Ouch! SuperGuarrada (tm). To be able to bring out
 // the menu and have access to the Main Patient. Must be fixed when removing dependencies from
@@ -144,10 +146,14 @@ QViewer::QViewer(QWidget *parent)
 	//20241219
 	m_qeventMouse = new QeventMouse(this);
 	installEventFilter(m_qeventMouse);
+
+    connect(this, SIGNAL(volumeChanged(Volume*)), SLOT(updateVolumesInUse()));
 }
 
 QViewer::~QViewer()
 {
+    RenderScheduler::instance()->cancelRender(this);
+    VolumeRepository::getRepository()->setVolumesInUse(this, QList<Volume*>());
     // The removal of the vtkWidget must be at the end as the others
     // objects that we remove can be used during their destruction
     delete m_toolProxy;
@@ -181,6 +187,18 @@ Volume* QViewer::getMainInput() const
 */
 
 
+QList<Volume*> QViewer::getInputs() const
+{
+    QList<Volume*> inputs;
+
+    if (hasInput())
+    {
+        inputs << getMainInput();
+    }
+
+    return inputs;
+}
+
 int QViewer::getNumberOfInputs() const
 {
     if (hasInput())
@@ -534,6 +552,15 @@ void QViewer::clearGrabbedViews()
 }
 
 void QViewer::render()
+{
+    // The same conditions as in renderNow() are checked here too, so that the request is ignored if rendering is enabled again before the next frame
+    if (m_isRenderingEnabled && getViewerStatus() == VisualizingVolume)
+    {
+        RenderScheduler::instance()->requestRender(this);
+    }
+}
+
+void QViewer::renderNow()
 {
     // ATTENTION It is important that it is only rendered when we are in VisualizingVolume state
     // because otherwise it can cause rendering problems in some cases
@@ -729,6 +756,8 @@ void QViewer::setVoiLutData(VoiLutPresetsToolData *voiLutData)
 
 void QViewer::grabCurrentView()
 {
+    // vtkWindowToImageFilter renders the window before grabbing it, so a pending render isn't needed anymore
+    RenderScheduler::instance()->cancelRender(this);
     m_windowToImageFilter->Update();
     m_windowToImageFilter->Modified();
 
@@ -1034,6 +1063,11 @@ void QViewer::setInputAndRender(Volume *volume)
     this->render();
 }
 
+void QViewer::updateVolumesInUse()
+{
+    VolumeRepository::getRepository()->setVolumesInUse(this, getInputs());
+}
+
 void QViewer::setVoiLut(const VoiLut &voiLut)
 {
     Q_UNUSED(voiLut)
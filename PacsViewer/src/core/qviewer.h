@@ -70,6 +70,9 @@ public:
     /// Returns the main input
     virtual Volume* getMainInput() const = 0;
 
+    /// Returns all the inputs of the viewer. The default implementation returns the main input, if any.
+    virtual QList<Volume*> getInputs() const;
+
     /// Returns the total number of inputs of the viewer
     virtual int getNumberOfInputs() const;
     
@@ -188,9 +191,12 @@ public slots:
     /// Manage the events you receive from the window
     void eventHandler(vtkObject *object, unsigned long vtkEvent, void *clientData, void *callData, vtkCommand *command);
 
-    /// Force display execution
+    /// Requests the rendering of the viewer, which is done by the RenderScheduler in the next display frame together with the other viewers
     void render();
 
+    /// Renders the viewer immediately
+    void renderNow();
+
     /// Assign whether this viewer is active, that is, what you are interacting with
     /// @param active
     void setActive(bool active);
@@ -305,6 +311,9 @@ private slots:
     /// TODO: Converted to virtual in order to be reimplemented by Q2DViewer by asynchronous upload
     virtual void setInputAndRender(Volume *volume);
 
+    /// Tells the volume repository which volumes are being shown in this viewer, so that their pixel data is not evicted.
+    void updateVolumesInUse();
+
 private:
     /// Updates the current widget displayed on the screen from the viewer status
     void setCurrentWidgetByViewerStatus(ViewerStatus status);
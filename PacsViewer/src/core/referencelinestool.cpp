@@ -24,6 +24,7 @@
 #include "drawerpolygon.h"
 #include "drawerline.h"
 #include "mathtools.h"
+#include "slicegeometryindex.h"
 // Vtk
 #include <vtkPlane.h>
 
@@ -142,13 +143,14 @@ void ReferenceLinesTool::updateProjectionLines()
             }
             else
             {
+                // El pla de la llesca actual ja està calculat a l'índex de geometria de les llesques del volum
+                const ImagePlane *localizerPlane = m_2DViewer->getMainInput()->getSliceGeometryIndex(m_2DViewer->getCurrentViewPlane())
+                        ->getImagePlane(m_2DViewer->getCurrentSlice());
                 int drawerLineOffset = 0;
                 foreach (ImagePlane *referencePlane, planesToProject)
                 {
                     // Aquí ja ho deixem en mans de la projecció
-                    ImagePlane *localizerPlane = m_2DViewer->getCurrentImagePlane();
                     projectIntersection(referencePlane, localizerPlane, drawerLineOffset);
-                    delete localizerPlane;
                     drawerLineOffset += m_showPlaneThickness ? 2 : 1;
                 }
             }
@@ -165,7 +167,7 @@ void ReferenceLinesTool::updateProjectionLines()
     }
 }
 
-void ReferenceLinesTool::projectIntersection(ImagePlane *referencePlane, ImagePlane *localizerPlane, int drawerLineOffset)
+void ReferenceLinesTool::projectIntersection(const ImagePlane *referencePlane, const ImagePlane *localizerPlane, int drawerLineOffset)
 {
     if (!(referencePlane && localizerPlane))
     {
@@ -213,7 +215,7 @@ void ReferenceLinesTool::projectIntersection(ImagePlane *referencePlane, ImagePl
     }
 }
 
-bool ReferenceLinesTool::computeIntersectionAndUpdateProjectionLines(ImagePlane *localizerPlane, ImagePlane *referencePlane,
+bool ReferenceLinesTool::computeIntersectionAndUpdateProjectionLines(const ImagePlane *localizerPlane, const ImagePlane *referencePlane,
                                                                      const QList<ImagePlane::CornersLocation> &cornerLocations, int lineOffset)
 {
     bool hasEnoughIntersections = true;
@@ -438,7 +440,7 @@ void ReferenceLinesTool::createAndRemoveLines(int neededLines, QList<DrawerLine*
     }
 }
 
-bool ReferenceLinesTool::meetAngleConstraint(ImagePlane *firstPlane, ImagePlane *secondPlane)
+bool ReferenceLinesTool::meetAngleConstraint(const ImagePlane *firstPlane, const ImagePlane *secondPlane)
 {
     if (!firstPlane || !secondPlane)
     {
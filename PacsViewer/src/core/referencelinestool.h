@@ -76,12 +76,12 @@ private:
 
     /// Projecta la intersecció del pla de referència amb el localitzador, sobre el pla de localitzador
     /// tambe li indiquem quina es la linia a modificar
-    void projectIntersection(ImagePlane *referencePlane, ImagePlane *localizerPlane, int drawerLineOffset = 0);
+    void projectIntersection(const ImagePlane *referencePlane, const ImagePlane *localizerPlane, int drawerLineOffset = 0);
     
     /// Computes intersection between given localizer and reference plane. boundsList shows which reference bound planes should be used to
     /// compute intersections (upper, lower, central). If there is intersection with a bound plane, updates the correspoding lines
     /// according to the given offset. If there is intersection with all the given bound planes returns true, false otherwise.
-    bool computeIntersectionAndUpdateProjectionLines(ImagePlane *localizerPlane, ImagePlane *referencePlane,
+    bool computeIntersectionAndUpdateProjectionLines(const ImagePlane *localizerPlane, const ImagePlane *referencePlane,
                                                      const QList<ImagePlane::CornersLocation> &cornerLocations, int lineOffset);
     
     /// Projects the given intersection points and updates the corresponding lines according to lineOffset
@@ -110,7 +110,7 @@ private:
 
     /// Comprova si els dos plans donats compleixen la restricció de l'angle que hi ha d'haver entre els plans de referència i localitzador
     /// per poder aplicar reference lines
-    bool meetAngleConstraint(ImagePlane *firstPlane, ImagePlane *secondPlane);
+    bool meetAngleConstraint(const ImagePlane *firstPlane, const ImagePlane *secondPlane);
 
 private:
     /// Nom del grup del drawer on agruparem les primitives del reference lines
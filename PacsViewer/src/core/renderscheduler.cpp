@@ -0,0 +1,179 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "renderscheduler.h"
+
+#include "logging.h"
+#include "qviewer.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+
+namespace udg {
+
+namespace {
+
+// Refresh rate used when the one of the screen is unknown
+const double DefaultRefreshRate = 60.0;
+
+}
+
+RenderScheduler::RenderScheduler()
+{
+    m_frameInterval = getScreenFrameInterval();
+    resetStatistics();
+
+    m_frameTimer.setSingleShot(true);
+    m_frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_frameTimer, SIGNAL(timeout()), SLOT(renderPendingViewers()));
+}
+
+RenderScheduler::~RenderScheduler()
+{
+}
+
+void RenderScheduler::requestRender(QViewer *viewer)
+{
+    if (!viewer)
+    {
+        return;
+    }
+
+    if (m_pendingViewers.contains(viewer))
+    {
+        m_numberOfCoalescedRenders++;
+        return;
+    }
+
+    m_pendingViewers << viewer;
+
+    if (!m_frameTimer.isActive())
+    {
+        // After an idle period the frame starts at once, otherwise it waits until the frame interval has elapsed since the last one
+        int delay = 0;
+
+        if (m_lastFrameTimer.isValid())
+        {
+            delay = static_cast<int>(qMax<qint64>(0, m_frameInterval - m_lastFrameTimer.elapsed()));
+        }
+
+        m_frameTimer.start(delay);
+    }
+}
+
+void RenderScheduler::cancelRender(QViewer *viewer)
+{
+    m_pendingViewers.removeAll(viewer);
+    m_viewersBeingRendered.removeAll(viewer);
+
+    if (m_pendingViewers.isEmpty())
+    {
+        m_frameTimer.stop();
+    }
+}
+
+bool RenderScheduler::isRenderPending(QViewer *viewer) const
+{
+    return m_pendingViewers.contains(viewer);
+}
+
+int RenderScheduler::getFrameInterval() const
+{
+    return m_frameInterval;
+}
+
+void RenderScheduler::setFrameInterval(int milliseconds)
+{
+    m_frameInterval = qMax(0, milliseconds);
+}
+
+int RenderScheduler::getNumberOfFramesRendered() const
+{
+    return m_numberOfFramesRendered;
+}
+
+int RenderScheduler::getNumberOfViewerRenders() const
+{
+    return m_numberOfViewerRenders;
+}
+
+int RenderScheduler::getNumberOfCoalescedRenders() const
+{
+    return m_numberOfCoalescedRenders;
+}
+
+int RenderScheduler::getNumberOfDroppedFrames() const
+{
+    return m_numberOfDroppedFrames;
+}
+
+void RenderScheduler::resetStatistics()
+{
+    m_numberOfFramesRendered = 0;
+    m_numberOfViewerRenders = 0;
+    m_numberOfCoalescedRenders = 0;
+    m_numberOfDroppedFrames = 0;
+}
+
+void RenderScheduler::renderPendingViewers()
+{
+    m_frameTimer.stop();
+
+    if (m_pendingViewers.isEmpty())
+    {
+        return;
+    }
+
+    m_lastFrameTimer.start();
+
+    // The renders requested while rendering this frame, e.g. from the signals emitted by the viewers, are left for the next one
+    m_viewersBeingRendered = m_pendingViewers;
+    m_pendingViewers.clear();
+
+    while (!m_viewersBeingRendered.isEmpty())
+    {
+        renderViewer(m_viewersBeingRendered.takeFirst());
+        m_numberOfViewerRenders++;
+    }
+
+    m_numberOfFramesRendered++;
+
+    qint64 frameDuration = m_lastFrameTimer.elapsed();
+
+    if (m_frameInterval > 0 && frameDuration > m_frameInterval)
+    {
+        m_numberOfDroppedFrames += frameDuration / m_frameInterval;
+        DEBUG_LOG(QString("Frame rendered in %1 ms, longer than the frame interval (%2 ms)").arg(frameDuration).arg(m_frameInterval));
+    }
+}
+
+void RenderScheduler::renderViewer(QViewer *viewer)
+{
+    viewer->renderNow();
+}
+
+int RenderScheduler::getScreenFrameInterval()
+{
+    double refreshRate = DefaultRefreshRate;
+    QScreen *screen = QGuiApplication::primaryScreen();
+
+    if (screen && screen->refreshRate() > 0.0)
+    {
+        refreshRate = screen->refreshRate();
+    }
+
+    return qRound(1000.0 / refreshRate);
+}
+
+} // namespace udg
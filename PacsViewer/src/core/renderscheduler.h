@@ -0,0 +1,103 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_RENDERSCHEDULER_H
+#define UDG_RENDERSCHEDULER_H
+
+#include "singleton.h"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+namespace udg {
+
+class QViewer;
+
+/**
+    Renders the viewers that need it at most once per display frame.
+
+    QViewer::render() doesn't render the viewer at once, but marks it as pending with requestRender(). All the pending viewers are rendered together
+    in the next frame, which starts as soon as possible after an idle period and then follows the refresh rate of the screen. This way the several
+    renders requested by each event, e.g. by the sync actions applied to all the synchronized viewers, become a single render of each viewer.
+
+    Some statistics are kept to know how well the renders are being coalesced. It must be used from the main thread.
+ */
+class RenderScheduler : public QObject, public Singleton<RenderScheduler> {
+Q_OBJECT
+public:
+    /// Marks the given viewer to be rendered in the next frame.
+    void requestRender(QViewer *viewer);
+
+    /// Removes the given viewer from the viewers to render. It must be called when the viewer is destroyed.
+    void cancelRender(QViewer *viewer);
+
+    /// Returns true if the given viewer is waiting to be rendered.
+    bool isRenderPending(QViewer *viewer) const;
+
+    /// Returns the minimum time between frames in milliseconds.
+    int getFrameInterval() const;
+    /// Sets the minimum time between frames in milliseconds. 0 renders each frame as soon as possible.
+    void setFrameInterval(int milliseconds);
+
+    /// Returns the number of frames rendered.
+    int getNumberOfFramesRendered() const;
+    /// Returns the number of viewer renders done in all the frames.
+    int getNumberOfViewerRenders() const;
+    /// Returns the number of render requests of viewers that were already pending, which haven't needed a render of their own.
+    int getNumberOfCoalescedRenders() const;
+    /// Returns the number of display frames missed because the rendering of a frame took longer than the frame interval.
+    int getNumberOfDroppedFrames() const;
+    /// Sets all the statistics to 0.
+    void resetStatistics();
+
+public slots:
+    /// Renders all the pending viewers now.
+    void renderPendingViewers();
+
+protected:
+    friend class Singleton<RenderScheduler>;
+    RenderScheduler();
+    virtual ~RenderScheduler();
+
+    /// Renders the given viewer.
+    virtual void renderViewer(QViewer *viewer);
+
+private:
+    /// Returns the frame interval corresponding to the refresh rate of the primary screen.
+    static int getScreenFrameInterval();
+
+private:
+    /// Viewers waiting for the next frame, in the order they were requested.
+    QList<QViewer*> m_pendingViewers;
+    /// Viewers of the frame being rendered that haven't been rendered yet.
+    QList<QViewer*> m_viewersBeingRendered;
+
+    /// Starts the next frame.
+    QTimer m_frameTimer;
+    /// Time since the beginning of the last frame.
+    QElapsedTimer m_lastFrameTimer;
+    /// Minimum time between frames in milliseconds.
+    int m_frameInterval;
+
+    int m_numberOfFramesRendered;
+    int m_numberOfViewerRenders;
+    int m_numberOfCoalescedRenders;
+    int m_numberOfDroppedFrames;
+};
+
+} // namespace udg
+
+#endif // UDG_RENDERSCHEDULER_H
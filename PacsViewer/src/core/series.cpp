@@ -18,6 +18,7 @@
 #include "study.h"
 #include "image.h"
 #include "logging.h"
+#include "stringpool.h"
 #include "volumerepository.h"
 #include "thumbnailcreator.h"
 
@@ -204,7 +205,7 @@ QString Series::getSOPClassUID() const
 
 void Series::setModality(QString modality)
 {
-    m_modality = modality;
+    m_modality = StringPool::intern(modality);
 }
 
 QString Series::getModality() const
@@ -254,7 +255,7 @@ QString Series::getDescription() const
 
 void Series::setPatientPosition(QString position)
 {
-    m_patientPosition = position;
+    m_patientPosition = StringPool::intern(position);
 }
 
 QString Series::getPatientPosition() const
@@ -376,7 +377,7 @@ QString Series::getTimeAsString()
 
 void Series::setInstitutionName(QString institutionName)
 {
-    m_institutionName = institutionName;
+    m_institutionName = StringPool::intern(institutionName);
 }
 
 QString Series::getInstitutionName() const
@@ -386,7 +387,7 @@ QString Series::getInstitutionName() const
 
 void Series::setBodyPartExamined(QString bodyPart)
 {
-    m_bodyPartExamined = bodyPart;
+    m_bodyPartExamined = StringPool::intern(bodyPart);
 }
 
 QString Series::getBodyPartExamined() const
@@ -396,7 +397,7 @@ QString Series::getBodyPartExamined() const
 
 void Series::setViewPosition(QString viewPosition)
 {
-    m_viewPosition = viewPosition;
+    m_viewPosition = StringPool::intern(viewPosition);
 }
 
 QString Series::getViewPosition() const
@@ -660,7 +661,7 @@ bool Series::isMRSurvey() const
 
 void Series::setManufacturer(QString manufacturer)
 {
-    m_manufacturer = manufacturer;
+    m_manufacturer = StringPool::intern(manufacturer);
 }
 
 QString Series::getManufacturer() const
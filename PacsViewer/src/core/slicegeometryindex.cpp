@@ -0,0 +1,225 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+
+#include "slicegeometryindex.h"
+
+#include "imageplane.h"
+#include "orthogonalplane.h"
+#include "volume.h"
+
+#include <QPair>
+
+#include <algorithm>
+
+namespace udg {
+
+namespace {
+
+// Slices whose normals differ less than this (1 - |cosine of the angle|) are considered parallel, which admits rounding errors of the orientations
+const double ParallelismTolerance = 1e-6;
+
+double dotProduct(const double a[3], const double b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+}
+
+SliceGeometryIndex::SliceGeometryIndex()
+{
+    m_normal[0] = m_normal[1] = m_normal[2] = 0.0;
+    m_slicesAreParallel = false;
+}
+
+SliceGeometryIndex::~SliceGeometryIndex()
+{
+    clear();
+}
+
+void SliceGeometryIndex::build(Volume *volume, const OrthogonalPlane &plane)
+{
+    clear();
+
+    if (!volume)
+    {
+        return;
+    }
+
+    int numberOfSlices = volume->getMaximumSlice(plane) + 1;
+    m_imagePlanes.reserve(numberOfSlices);
+
+    for (int slice = 0; slice < numberOfSlices; slice++)
+    {
+        m_imagePlanes.append(volume->getImagePlane(slice, plane));
+    }
+
+    QVector<QPair<double, int> > positions;
+    positions.reserve(numberOfSlices);
+    m_slicesAreParallel = true;
+
+    for (int slice = 0; slice < numberOfSlices && m_slicesAreParallel; slice++)
+    {
+        const ImagePlane *imagePlane = m_imagePlanes.at(slice);
+
+        if (!imagePlane)
+        {
+            continue;
+        }
+
+        std::array<double, 3> normal = Vector3(imagePlane->getImageOrientation().getNormalVector());
+
+        if (positions.isEmpty())
+        {
+            std::copy(normal.begin(), normal.end(), m_normal);
+        }
+        else if (1.0 - qAbs(dotProduct(normal.data(), m_normal)) > ParallelismTolerance)
+        {
+            m_slicesAreParallel = false;
+        }
+
+        // Slices with opposite normals are at the same distance of a point, so projecting all of them on the first normal is enough
+        positions.append(qMakePair(dotProduct(imagePlane->getOrigin().toArray().data(), m_normal), slice));
+    }
+
+    if (!m_slicesAreParallel || positions.isEmpty())
+    {
+        m_slicesAreParallel = false;
+        return;
+    }
+
+    // Slices at the same position are sorted by slice number, to return the first one like the search over all the planes
+    std::sort(positions.begin(), positions.end());
+
+    m_sortedPositions.reserve(positions.size());
+    m_sortedSlices.reserve(positions.size());
+
+    for (int i = 0; i < positions.size(); i++)
+    {
+        m_sortedPositions.append(positions.at(i).first);
+        m_sortedSlices.append(positions.at(i).second);
+    }
+}
+
+int SliceGeometryIndex::getNumberOfSlices() const
+{
+    return m_imagePlanes.size();
+}
+
+bool SliceGeometryIndex::areSlicesParallel() const
+{
+    return m_slicesAreParallel;
+}
+
+const ImagePlane* SliceGeometryIndex::getImagePlane(int slice) const
+{
+    if (slice < 0 || slice >= m_imagePlanes.size())
+    {
+        return 0;
+    }
+
+    return m_imagePlanes.at(slice);
+}
+
+int SliceGeometryIndex::getNearestSlice(const double point[3], double &distance) const
+{
+    if (m_slicesAreParallel)
+    {
+        return getNearestSliceByPosition(point, distance);
+    }
+    else
+    {
+        return getNearestSliceByDistanceToEachPlane(point, distance);
+    }
+}
+
+void SliceGeometryIndex::clear()
+{
+    qDeleteAll(m_imagePlanes);
+    m_imagePlanes.clear();
+    m_sortedPositions.clear();
+    m_sortedSlices.clear();
+    m_slicesAreParallel = false;
+}
+
+int SliceGeometryIndex::getNearestSliceByPosition(const double point[3], double &distance) const
+{
+    double position = dotProduct(point, m_normal);
+
+    QVector<double>::const_iterator begin = m_sortedPositions.constBegin();
+    QVector<double>::const_iterator end = m_sortedPositions.constEnd();
+    // First slice at the position of the point or after it
+    QVector<double>::const_iterator next = std::lower_bound(begin, end, position);
+    int nearestIndex = -1;
+    double nearestDistance = 0.0;
+
+    if (next != end)
+    {
+        nearestIndex = next - begin;
+        nearestDistance = *next - position;
+    }
+
+    if (next != begin)
+    {
+        // First slice at the position of the last slice before the point
+        QVector<double>::const_iterator previous = std::lower_bound(begin, next, *(next - 1));
+        double previousDistance = position - *previous;
+
+        if (nearestIndex == -1 || previousDistance < nearestDistance
+            || (previousDistance == nearestDistance && m_sortedSlices.at(previous - begin) < m_sortedSlices.at(nearestIndex)))
+        {
+            nearestIndex = previous - begin;
+            nearestDistance = previousDistance;
+        }
+    }
+
+    if (nearestIndex == -1)
+    {
+        return -1;
+    }
+
+    distance = nearestDistance;
+    return m_sortedSlices.at(nearestIndex);
+}
+
+int SliceGeometryIndex::getNearestSliceByDistanceToEachPlane(const double point[3], double &distance) const
+{
+    int nearestSlice = -1;
+    double nearestDistance = 0.0;
+
+    for (int slice = 0; slice < m_imagePlanes.size(); slice++)
+    {
+        const ImagePlane *imagePlane = m_imagePlanes.at(slice);
+
+        if (imagePlane)
+        {
+            double currentDistance = imagePlane->getDistanceToPoint(Vector3(point[0], point[1], point[2]));
+
+            if (nearestSlice == -1 || currentDistance < nearestDistance)
+            {
+                nearestDistance = currentDistance;
+                nearestSlice = slice;
+            }
+        }
+    }
+
+    if (nearestSlice != -1)
+    {
+        distance = nearestDistance;
+    }
+
+    return nearestSlice;
+}
+
+} // namespace udg
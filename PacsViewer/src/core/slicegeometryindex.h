@@ -0,0 +1,84 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+
+#ifndef UDG_SLICEGEOMETRYINDEX_H
+#define UDG_SLICEGEOMETRYINDEX_H
+
+#include <QVector>
+
+namespace udg {
+
+class Volume;
+class ImagePlane;
+class OrthogonalPlane;
+
+/**
+    Precomputed geometry of the slices of a volume in an orthogonal plane.
+
+    It keeps the ImagePlane of each slice and, when all the slices are parallel, their positions along the common normal sorted in ascending
+    order, so that the nearest slice to a point is found with a binary search. Otherwise the stored planes are scanned one by one. In both cases
+    the queries don't allocate anything.
+ */
+class SliceGeometryIndex {
+public:
+    SliceGeometryIndex();
+    ~SliceGeometryIndex();
+
+    /// Builds the index with the slices of the given volume in the given plane, replacing the previous contents.
+    void build(Volume *volume, const OrthogonalPlane &plane);
+
+    /// Returns the number of slices in the index.
+    int getNumberOfSlices() const;
+
+    /// Returns true if all the slices are parallel, so that they can be located by their position along the normal.
+    bool areSlicesParallel() const;
+
+    /// Returns the plane of the given slice, or null if the slice is out of range or has no plane. The plane belongs to the index.
+    const ImagePlane* getImagePlane(int slice) const;
+
+    /// Returns the slice nearest to the given point and stores the distance between both in distance.
+    /// Returns -1 if there are no slices, in which case distance is not modified.
+    int getNearestSlice(const double point[3], double &distance) const;
+
+private:
+    /// Deletes the planes and empties the index.
+    void clear();
+
+    /// Returns the nearest slice with a binary search over the sorted positions. Only valid if the slices are parallel.
+    int getNearestSliceByPosition(const double point[3], double &distance) const;
+
+    /// Returns the nearest slice computing the distance to each plane.
+    int getNearestSliceByDistanceToEachPlane(const double point[3], double &distance) const;
+
+private:
+    /// Plane of each slice, indexed by slice number. It may contain null planes.
+    QVector<ImagePlane*> m_imagePlanes;
+
+    /// Normal common to all the slices when they are parallel.
+    double m_normal[3];
+
+    /// Positions of the slices along m_normal in ascending order.
+    QVector<double> m_sortedPositions;
+
+    /// Slice number at each position of m_sortedPositions.
+    QVector<int> m_sortedSlices;
+
+    /// True if all the slices are parallel.
+    bool m_slicesAreParallel;
+};
+
+} // namespace udg
+
+#endif // UDG_SLICEGEOMETRYINDEX_H
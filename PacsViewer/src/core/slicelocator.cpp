@@ -16,6 +16,7 @@
 
 #include "imageplane.h"
 #include "mathtools.h"
+#include "slicegeometryindex.h"
 #include "volume.h"
 
 namespace udg {
@@ -51,23 +52,7 @@ int SliceLocator::getNearestSlice(double point[3])
     }
     
     double nearestSliceDistance = MathTools::DoubleMaximumValue;
-    int nearestSlice = -1;
-    
-    for (int i = 0; i <= m_volume->getMaximumSlice(m_volumePlane); ++i)
-    {
-        ImagePlane *currentPlane = m_volume->getImagePlane(i, m_volumePlane);
-        if (currentPlane)
-        {
-            double currentDistance = currentPlane->getDistanceToPoint(point);
-            if (currentDistance < nearestSliceDistance)
-            {
-                nearestSliceDistance = currentDistance;
-                nearestSlice = i;
-            }
-
-            delete currentPlane;
-        }
-    }
+    int nearestSlice = m_volume->getSliceGeometryIndex(m_volumePlane)->getNearestSlice(point, nearestSliceDistance);
 
     if (isWithinProximityBounds(nearestSliceDistance))
     {
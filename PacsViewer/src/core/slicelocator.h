@@ -38,7 +38,8 @@ public:
     
     /// Returns the nearest slice to the given point or ImagePlane.
     /// The nearest slice will be computed against the given volume and plane from setVolume() and setPlane() methods.
-    /// If no slice is found to be considered near, -1 will be returned
+    /// If no slice is found to be considered near, -1 will be returned.
+    /// The slices are located through the slice geometry index of the volume, without creating their planes.
     int getNearestSlice(double point[3]);
     int getNearestSlice(ImagePlane *imagePlane);
 
@@ -33,7 +33,7 @@ const QString StarviewerBuildPlatform("Linux");
 #endif
 
 // Iindicates for this version of starviewer which bd revision is required
-const int StarviewerDatabaseRevisionRequired(9593);
+const int StarviewerDatabaseRevisionRequired(9596);
 
 const QString OrganizationNameString("GILab");
 const QString OrganizationDomainString("starviewer.udg.edu");
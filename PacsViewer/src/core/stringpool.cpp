@@ -0,0 +1,68 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "stringpool.h"
+
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QWriteLocker>
+
+namespace udg {
+
+namespace {
+
+// Most lookups find the string already in the pool, so they only take the read lock and the images can be filled from several threads without waiting
+QReadWriteLock poolLock;
+QSet<QString> pool;
+
+}
+
+QString StringPool::intern(const QString &string)
+{
+    if (string.isEmpty())
+    {
+        return string;
+    }
+
+    {
+        QReadLocker locker(&poolLock);
+        QSet<QString>::const_iterator iterator = pool.constFind(string);
+
+        if (iterator != pool.constEnd())
+        {
+            return *iterator;
+        }
+    }
+
+    QWriteLocker locker(&poolLock);
+
+    // Another thread can have added it since the read lock was released
+    QSet<QString>::const_iterator iterator = pool.constFind(string);
+
+    if (iterator == pool.constEnd())
+    {
+        iterator = pool.insert(string);
+    }
+
+    return *iterator;
+}
+
+int StringPool::size()
+{
+    QReadLocker locker(&poolLock);
+    return pool.size();
+}
+
+}
@@ -0,0 +1,41 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDGSTRINGPOOL_H
+#define UDGSTRINGPOOL_H
+
+#include <QString>
+
+namespace udg {
+
+/**
+    Pool of shared copies of the strings repeated in many objects of the information model, like transfer syntax UIDs, image types or the directories of
+    the files. Each value read from a file is a different string, but since QString is implicitly shared, keeping the copy returned by intern() instead
+    makes all the objects with the same value share a single buffer.
+
+    The strings are kept until the end of the application, so only values that are repeated a lot and have few different values must be interned.
+    It can be used from any thread.
+ */
+class StringPool {
+public:
+    /// Returns the copy of the pool equal to the given string, adding it if it isn't yet. Empty strings are returned as they are.
+    static QString intern(const QString &string);
+
+    /// Returns the number of different strings in the pool.
+    static int size();
+};
+
+}
+
+#endif // UDGSTRINGPOOL_H
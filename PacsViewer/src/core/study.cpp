@@ -15,6 +15,7 @@
 #include "study.h"
 #include "patient.h"
 #include "logging.h"
+#include "stringpool.h"
 
 #include <QStringList>
 
@@ -176,7 +177,7 @@ void Study::addModality(const QString &modality)
 {
     if (!m_modalities.contains(modality) && !modality.isEmpty())
     {
-        m_modalities << modality;
+        m_modalities << StringPool::intern(modality);
     }
 }
 
@@ -319,7 +320,7 @@ QTime Study::getRetrievedTime() const
 
 void Study::setInstitutionName(const QString &institutionName)
 {
-    m_institutionName = institutionName;
+    m_institutionName = StringPool::intern(institutionName);
 }
 
 QString Study::getInstitutionName() const
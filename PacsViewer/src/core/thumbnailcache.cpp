@@ -0,0 +1,297 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "thumbnailcache.h"
+
+#include "coresettings.h"
+#include "image.h"
+#include "logging.h"
+#include "thumbnailcreator.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QSemaphore>
+#include <QThread>
+#include <QVector>
+
+#include <algorithm>
+
+namespace udg {
+
+namespace {
+
+// Returns the hash that identifies the thumbnails of the image with the given SOP Instance UID.
+QString getSOPInstanceUIDHash(const QString &sopInstanceUID)
+{
+    return QCryptographicHash::hash(sopInstanceUID.toLatin1(), QCryptographicHash::Md5).toHex();
+}
+
+bool isLessRecentlyUsed(const QFileInfo &fileInfo1, const QFileInfo &fileInfo2)
+{
+    return fileInfo1.lastModified() < fileInfo2.lastModified();
+}
+
+}
+
+class ThumbnailCache::ThumbnailLoader : public QRunnable {
+public:
+    ThumbnailLoader(ThumbnailCache *cache, const Image *image, int resolution, QImage *thumbnail, QSemaphore *finishedLoaders)
+        : m_cache(cache), m_image(image), m_resolution(resolution), m_thumbnail(thumbnail), m_finishedLoaders(finishedLoaders)
+    {
+    }
+
+    virtual void run()
+    {
+        *m_thumbnail = m_cache->getThumbnail(m_image, m_resolution);
+        m_finishedLoaders->release();
+    }
+
+private:
+    ThumbnailCache *m_cache;
+    const Image *m_image;
+    int m_resolution;
+    QImage *m_thumbnail;
+    QSemaphore *m_finishedLoaders;
+};
+
+ThumbnailCache::ThumbnailCache()
+    : m_cacheSize(0), m_cacheSizeIsKnown(false)
+{
+    m_threadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    m_threadPool.waitForDone();
+}
+
+QImage ThumbnailCache::getThumbnail(const Image *image, int resolution)
+{
+    bool isValid;
+
+    // Images without UID, like the ones that don't come from DICOM files, can't be identified between sessions
+    if (image->getSOPInstanceUID().isEmpty())
+    {
+        return createThumbnail(image, resolution, isValid);
+    }
+
+    QString filePath = getThumbnailFilePath(image->getSOPInstanceUID(), resolution);
+    QImage thumbnail;
+
+    if (thumbnail.load(filePath, "PNG"))
+    {
+        // The modification time tells which thumbnails have been used least recently. It's updated at most once a day to avoid a write on each read.
+        QDateTime now = QDateTime::currentDateTime();
+
+        if (QFileInfo(filePath).lastModified().daysTo(now) > 0)
+        {
+            QFile file(filePath);
+
+            if (file.open(QIODevice::Append))
+            {
+                file.setFileTime(now, QFileDevice::FileModificationTime);
+            }
+        }
+
+        return thumbnail;
+    }
+
+    thumbnail = createThumbnail(image, resolution, isValid);
+
+    // Placeholders aren't cached, since the image may be readable later
+    if (isValid)
+    {
+        save(thumbnail, filePath);
+    }
+
+    return thumbnail;
+}
+
+QList<QImage> ThumbnailCache::getThumbnails(const QList<Image*> &images, int resolution)
+{
+    QVector<QImage> thumbnails(images.size());
+    QSemaphore finishedLoaders;
+
+    for (int i = 0; i < images.size(); i++)
+    {
+        m_threadPool.start(new ThumbnailLoader(this, images.at(i), resolution, &thumbnails[i], &finishedLoaders));
+    }
+
+    finishedLoaders.acquire(images.size());
+
+    return thumbnails.toList();
+}
+
+void ThumbnailCache::removeThumbnails(const QStringList &sopInstanceUIDs)
+{
+    // Thumbnails are grouped by subdirectory so that each one is listed only once, whatever the number of images
+    QHash<QString, QStringList> nameFiltersBySubdirectory;
+
+    foreach (const QString &sopInstanceUID, sopInstanceUIDs)
+    {
+        QString hash = getSOPInstanceUIDHash(sopInstanceUID);
+        nameFiltersBySubdirectory[hash.left(2)] << hash + "_*.png";
+    }
+
+    QDir cacheDirectory(getCachePath());
+    qint64 removedBytes = 0;
+
+    for (QHash<QString, QStringList>::const_iterator it = nameFiltersBySubdirectory.constBegin(); it != nameFiltersBySubdirectory.constEnd(); ++it)
+    {
+        QDir subdirectory(cacheDirectory.filePath(it.key()));
+
+        foreach (const QFileInfo &fileInfo, subdirectory.entryInfoList(it.value(), QDir::Files))
+        {
+            qint64 fileSize = fileInfo.size();
+
+            if (QFile::remove(fileInfo.absoluteFilePath()))
+            {
+                removedBytes += fileSize;
+            }
+            else
+            {
+                ERROR_LOG("Could not remove the thumbnail " + fileInfo.absoluteFilePath());
+            }
+        }
+    }
+
+    QMutexLocker locker(&m_cacheSizeMutex);
+
+    if (m_cacheSizeIsKnown)
+    {
+        m_cacheSize = qMax(Q_INT64_C(0), m_cacheSize - removedBytes);
+    }
+}
+
+QString ThumbnailCache::getThumbnailFilePath(const QString &sopInstanceUID, int resolution) const
+{
+    // Files are spread in subdirectories named after the first characters of the hash, so that none of them gets too many files
+    QString hash = getSOPInstanceUIDHash(sopInstanceUID);
+    QDir cacheDirectory(getCachePath());
+
+    return cacheDirectory.filePath(QString("%1/%2_%3.png").arg(hash.left(2)).arg(hash).arg(resolution));
+}
+
+QImage ThumbnailCache::createThumbnail(const Image *image, int resolution, bool &isValid)
+{
+    ThumbnailCreator thumbnailCreator;
+    QImage thumbnail = thumbnailCreator.createImageThumbnail(image->getPath(), resolution);
+    isValid = thumbnailCreator.isLastThumbnailValid();
+
+    return thumbnail;
+}
+
+qint64 ThumbnailCache::getMaximumCacheSize() const
+{
+    QScopedPointer<SettingsInterface> settings(getSettings());
+
+    return settings->getValue(CoreSettings::ThumbnailCacheMaximumSize).toLongLong() * 1024 * 1024;
+}
+
+SettingsInterface* ThumbnailCache::getSettings() const
+{
+    return new Settings();
+}
+
+QString ThumbnailCache::getCachePath() const
+{
+    QScopedPointer<SettingsInterface> settings(getSettings());
+
+    return settings->getValue(CoreSettings::ThumbnailCachePath).toString();
+}
+
+void ThumbnailCache::save(const QImage &thumbnail, const QString &filePath)
+{
+    if (!QDir().mkpath(QFileInfo(filePath).absolutePath()))
+    {
+        ERROR_LOG("Could not create the thumbnail cache directory for " + filePath);
+        return;
+    }
+
+    // The file is written under another name and renamed at the end, so that a thumbnail saved concurrently or partially is never read
+    QSaveFile file(filePath);
+
+    if (!file.open(QIODevice::WriteOnly) || !thumbnail.save(&file, "PNG") || !file.commit())
+    {
+        ERROR_LOG("Could not save the thumbnail " + filePath);
+        return;
+    }
+
+    addToCacheSize(QFileInfo(filePath).size());
+}
+
+void ThumbnailCache::addToCacheSize(qint64 bytes)
+{
+    QMutexLocker locker(&m_cacheSizeMutex);
+
+    if (!m_cacheSizeIsKnown)
+    {
+        // The walk also finds the size of the saved thumbnail
+        removeLeastRecentlyUsedThumbnails();
+        return;
+    }
+
+    m_cacheSize += bytes;
+
+    if (m_cacheSize > getMaximumCacheSize())
+    {
+        removeLeastRecentlyUsedThumbnails();
+    }
+}
+
+void ThumbnailCache::removeLeastRecentlyUsedThumbnails()
+{
+    QList<QFileInfo> thumbnailFiles;
+    qint64 cacheSize = 0;
+    QDirIterator iterator(getCachePath(), QStringList("*.png"), QDir::Files, QDirIterator::Subdirectories);
+
+    while (iterator.hasNext())
+    {
+        iterator.next();
+        thumbnailFiles << iterator.fileInfo();
+        cacheSize += iterator.fileInfo().size();
+    }
+
+    qint64 maximumCacheSize = getMaximumCacheSize();
+
+    if (cacheSize > maximumCacheSize)
+    {
+        // Some margin is freed so that the cache isn't walked again after saving the next thumbnail
+        qint64 targetCacheSize = maximumCacheSize * 9 / 10;
+        std::sort(thumbnailFiles.begin(), thumbnailFiles.end(), isLessRecentlyUsed);
+
+        for (int i = 0; i < thumbnailFiles.size() && cacheSize > targetCacheSize; i++)
+        {
+            if (QFile::remove(thumbnailFiles.at(i).absoluteFilePath()))
+            {
+                cacheSize -= thumbnailFiles.at(i).size();
+            }
+        }
+
+        INFO_LOG(QString("Thumbnail cache exceeded %1 bytes, least recently used thumbnails removed down to %2 bytes").arg(maximumCacheSize).arg(cacheSize));
+    }
+
+    m_cacheSize = cacheSize;
+    m_cacheSizeIsKnown = true;
+}
+
+} // namespace udg
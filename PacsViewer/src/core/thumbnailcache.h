@@ -0,0 +1,101 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_THUMBNAILCACHE_H
+#define UDG_THUMBNAILCACHE_H
+
+#include "singleton.h"
+
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+namespace udg {
+
+class Image;
+class SettingsInterface;
+
+/**
+    Keeps the thumbnails of the images on disk, so that they are created only once even between sessions.
+
+    Thumbnails are identified by the SOP Instance UID of their image and their resolution. Those that aren't cached yet are created with
+    ThumbnailCreator, and several of them can be created concurrently in a pool of worker threads with getThumbnails().
+
+    The size of the cache is limited by CoreSettings::ThumbnailCacheMaximumSize. When it is exceeded the least recently used thumbnails are removed,
+    and the thumbnails of the images deleted from the local database must be removed with removeThumbnails().
+
+    This class can be used concurrently from any thread.
+ */
+class ThumbnailCache : public Singleton<ThumbnailCache> {
+public:
+    /// Returns the thumbnail of the given image with the given resolution, reading it from the cache or creating and caching it if it isn't there.
+    QImage getThumbnail(const Image *image, int resolution);
+
+    /// Returns the thumbnails of the given images with the given resolution, in the same order. The ones that aren't cached are created concurrently.
+    QList<QImage> getThumbnails(const QList<Image*> &images, int resolution);
+
+    /// Removes from the cache the thumbnails of all resolutions of the images with the given SOP Instance UIDs.
+    void removeThumbnails(const QStringList &sopInstanceUIDs);
+
+    /// Returns the path of the file where the thumbnail of the image with the given SOP Instance UID and resolution is cached.
+    QString getThumbnailFilePath(const QString &sopInstanceUID, int resolution) const;
+
+protected:
+    friend class Singleton<ThumbnailCache>;
+    ThumbnailCache();
+    virtual ~ThumbnailCache();
+
+    /// Creates the thumbnail of the given image with the given resolution. isValid is set to false if a placeholder has been created instead.
+    virtual QImage createThumbnail(const Image *image, int resolution, bool &isValid);
+
+    /// Returns the maximum size in bytes of the cache.
+    virtual qint64 getMaximumCacheSize() const;
+
+    /// Returns the settings the cache path and size are read from. The caller takes ownership of the returned object.
+    virtual SettingsInterface* getSettings() const;
+
+private:
+    class ThumbnailLoader;
+
+    /// Returns the directory where the thumbnails are cached.
+    QString getCachePath() const;
+
+    /// Saves the given thumbnail to the given cache file.
+    void save(const QImage &thumbnail, const QString &filePath);
+
+    /// Adds the given number of bytes to the size of the cache and removes the least recently used thumbnails if it exceeds the maximum size.
+    void addToCacheSize(qint64 bytes);
+
+    /// Removes the least recently used thumbnails until the cache is below the maximum size. Updates the size of the cache with the one found on disk.
+    /// m_cacheSizeMutex must be locked.
+    void removeLeastRecentlyUsedThumbnails();
+
+private:
+    /// Threads that create the thumbnails requested with getThumbnails().
+    QThreadPool m_threadPool;
+
+    /// Size in bytes of the cached thumbnails. It's measured on disk the first time a thumbnail is saved.
+    qint64 m_cacheSize;
+    bool m_cacheSizeIsKnown;
+
+    /// Protects the size of the cache and the removal of the least recently used thumbnails.
+    QMutex m_cacheSizeMutex;
+};
+
+} // namespace udg
+
+#endif // UDG_THUMBNAILCACHE_H
@@ -16,8 +16,7 @@
 
 #include <QObject>
 #include <QImage>
-#include <QIcon>
-#include <QPixmap>
+#include <QImageReader>
 #include <QString>
 #include <QPainter>
 
@@ -25,6 +24,7 @@
 #include "image.h"
 #include "logging.h"
 #include "dicomtagreader.h"
+#include "thumbnailcache.h"
 // We use dcmtk for scaling dicom images
 #include <dcmimage.h>
 #include <ofbmanip.h>
@@ -53,6 +53,11 @@ namespace udg {
 
 const QString PreviewNotAvailableText(QObject::tr("Preview image not available"));
 
+ThumbnailCreator::ThumbnailCreator()
+    : m_lastThumbnailIsValid(false)
+{
+}
+
 QImage ThumbnailCreator::getThumbnail(const Series *series, int resolution)
 {
     QImage thumbnail;
@@ -74,7 +79,7 @@ QImage ThumbnailCreator::getThumbnail(const Series *series, int resolution)
         int numberOfImages = series->getImages().size();
         if (numberOfImages > 0)
         {
-            thumbnail = createImageThumbnail(series->getImages()[numberOfImages / 2]->getPath(), resolution);
+            thumbnail = getThumbnail(series->getImages()[numberOfImages / 2], resolution);
         }
         else
         {
@@ -90,7 +95,7 @@ QImage ThumbnailCreator::getThumbnail(const Series *series, int resolution)
 
 QImage ThumbnailCreator::getThumbnail(const Image *image, int resolution)
 {
-    return createImageThumbnail(image->getPath(), resolution);
+    return ThumbnailCache::instance()->getThumbnail(image, resolution);
 }
 
 QImage ThumbnailCreator::getThumbnail(const DICOMTagReader *reader, int resolution)
@@ -98,6 +103,11 @@ QImage ThumbnailCreator::getThumbnail(const DICOMTagReader *reader, int resoluti
     return createThumbnail(reader, resolution);
 }
 
+bool ThumbnailCreator::isLastThumbnailValid() const
+{
+    return m_lastThumbnailIsValid;
+}
+
 QImage ThumbnailCreator::makeEmptyThumbnailWithCustomText(const QString &text,  const DICOMTagReader *reader, int resolution)
 {
     QImage thumbnail;
@@ -188,6 +198,7 @@ QImage ThumbnailCreator::createImageThumbnail(const QString &imageFileName, int
 {
 	if (imageFileName.right(3).toUpper().contains("MHD"))
 	{
+		m_lastThumbnailIsValid = false;
 		QImage thumbnail;
 		thumbnail = QImage(resolution, resolution, QImage::Format_RGB32);
 		thumbnail.fill(Qt::black);
@@ -202,56 +213,40 @@ QImage ThumbnailCreator::createImageThumbnail(const QString &imageFileName, int
 
 QImage ThumbnailCreator::createIconThumbnail(const QString &iconFileName, int resolution)
 {
-    QImage thumbnail;
-    QIcon icon = QIcon(iconFileName);
-    thumbnail = icon.pixmap(resolution).toImage();
-    return thumbnail;
+    // QIcon would render it to a QPixmap, which can't be used outside the GUI thread
+    QImageReader iconReader(iconFileName);
+    iconReader.setScaledSize(QSize(resolution, resolution));
+    return iconReader.read();
 }
 
 QImage ThumbnailCreator::createThumbnail(const DICOMTagReader *reader, int resolution)
 {
-	resolution = 256;
     QImage thumbnail;
+    m_lastThumbnailIsValid = false;
 
     if (isSuitableForThumbnailCreation(reader))
     {
         try
         {
-            /// Let's load the dicom file to scale
-            /// Let's say that in the case of a multiframe image,
-            /// just load the first image and enough, saving unnecessarily hosting memory
-            /// /// JPEG 2000 (lossless)
-            //EXS_JPEG2000LosslessOnly = 26,
-            ///// JPEG 2000 (lossless or lossy)
-            //EXS_JPEG2000 = 27,
-            ///// JPEG 2000 part 2 multi-component extensions (lossless)
-            //EXS_JPEG2000MulticomponentLosslessOnly = 28,
-            ///// JPEG 2000 part 2 multi-component extensions (lossless or lossy)
-            //EXS_JPEG2000Multicomponent = 29,
-            DicomImage *dicomImage = NULL;
-			dicomImage = new DicomImage(qPrintable(reader->getFileName()));
-			if (dicomImage)
-			{
-				OFString value;
-				reader->getDcmDataset()->findAndGetOFString(DCM_SeriesDescription, value);
-				QString vl = value.c_str();		
-				dicomImage->hideAllOverlays();
-				if (vl.length() > 1 && vl.toLower().contains("report"))
-				{
-					dicomImage->setWindow(-2, 1);
-					thumbnail = createThumbnail(dicomImage, 512);
-				}
-				else
-				{
-					dicomImage->setMinMaxWindow(1);
-					thumbnail = createThumbnail(dicomImage, resolution);
-				}
-			}
-            // DicomImage must be deleted to avoid memory leaks
-            if (dicomImage)
+            // The dataset already read is rendered instead of reading the file again. With partial access only the first frame is decoded and only
+            // its pixels are read, instead of loading and decompressing the whole pixel data of multiframe images
+            DcmDataset *dataset = reader->getDcmDataset();
+            DicomImage dicomImage(dataset, dataset->getOriginalXfer(), CIF_UsePartialAccessToPixelData, 0, 1);
+
+            OFString value;
+            dataset->findAndGetOFString(DCM_SeriesDescription, value);
+            QString seriesDescription = value.c_str();
+            dicomImage.hideAllOverlays();
+
+            if (seriesDescription.length() > 1 && seriesDescription.toLower().contains("report"))
             {
-                delete dicomImage;
-                dicomImage = NULL;
+                dicomImage.setWindow(-2, 1);
+                thumbnail = createThumbnail(&dicomImage, 512);
+            }
+            else
+            {
+                dicomImage.setMinMaxWindow(1);
+                thumbnail = createThumbnail(&dicomImage, resolution);
             }
         }
         catch (std::bad_alloc &e)
@@ -306,8 +301,8 @@ QImage ThumbnailCreator::createThumbnail(DicomImage *dicomImage, int resolution)
         }
         else if (scaledImage->getStatus() == EIS_Normal)
         {
-            QPixmap pixmap = convertToQPixmap(scaledImage);
-            if (pixmap.isNull())
+            QImage image = convertToQImage(scaledImage);
+            if (image.isNull())
             {
                 DEBUG_LOG("Could not convert DicomImage to QImage. A Preview not available thumbnail is created.");
                 ok = false;
@@ -315,25 +310,25 @@ QImage ThumbnailCreator::createThumbnail(DicomImage *dicomImage, int resolution)
             else
             {
                 // The smallest side will be of "resolution" size.
-                pixmap = pixmap.scaled(resolution,resolution, Qt::AspectRatioMode::KeepAspectRatioByExpanding, Qt::TransformationMode::SmoothTransformation);
+                image = image.scaled(resolution,resolution, Qt::AspectRatioMode::KeepAspectRatioByExpanding, Qt::TransformationMode::SmoothTransformation);
 
                 // By cropping the longer side, a squared image is made.
-                int width = pixmap.width();
-                int height = pixmap.height();
+                int width = image.width();
+                int height = image.height();
                 if (width > height) // heigth == resolution
                 {
-                    pixmap = pixmap.copy((width-resolution) / 2, 0, height, height);
+                    image = image.copy((width-resolution) / 2, 0, height, height);
                 }
                 else if (height > width) // width == resolution
                 {
-                    pixmap = pixmap.copy(0, (height-resolution) / 2, width, width);
+                    image = image.copy(0, (height-resolution) / 2, width, width);
                 }
                 else
                 {
                     // A perfect square, nothing to do
                 }
 
-                thumbnail = pixmap.toImage();
+                thumbnail = image;
                 ok = true;
             }
 
@@ -352,6 +347,8 @@ QImage ThumbnailCreator::createThumbnail(DicomImage *dicomImage, int resolution)
         DEBUG_LOG(QString("Error loading the DicomImage. Error: %1 ").arg(DicomImage::getString(dicomImage->getStatus())));
     }
 
+    m_lastThumbnailIsValid = ok;
+
     //If we were unable to generate the thumbnail, we create a blank one
     if (!ok)
     {
@@ -378,7 +375,7 @@ bool ThumbnailCreator::isSuitableForThumbnailCreation(const DICOMTagReader *read
     return true;
 }
 
-QPixmap ThumbnailCreator::convertToQPixmap(DicomImage *dicomImage)
+QImage ThumbnailCreator::convertToQImage(DicomImage *dicomImage)
 {
     Q_ASSERT(dicomImage);
 
@@ -406,8 +403,8 @@ QPixmap ThumbnailCreator::convertToQPixmap(DicomImage *dicomImage)
     const int height = (int)(dicomImage->getHeight());
     imageHeader += QString("\n%1 %2\n255\n").arg(width).arg(height);
 
-    // QPixmap in which we will load the data buffer
-    QPixmap thumbnail;
+    // QImage in which we will load the data buffer
+    QImage thumbnail;
     // Create output buffer for DicomImage class
     const int offset = imageHeader.size();
     const unsigned int length = (width * height) * bytesPerComponent + offset;
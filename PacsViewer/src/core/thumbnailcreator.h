@@ -16,7 +16,6 @@
 #define UDGTHUMBNAILCREATOR_H
 
 class QImage;
-class QPixmap;
 class QString;
 class DicomImage;
 //class DcmDataset;
@@ -25,21 +24,34 @@ namespace udg {
 class Series;
 class Image;
 class DICOMTagReader;
+/**
+    Creates the thumbnails of series and images.
+
+    Thumbnails are created with QImage, so this class can be used from any thread.
+ */
 class ThumbnailCreator {
 public:
+    ThumbnailCreator();
+
     /// Create a thumbnail from the images in the series
     QImage getThumbnail(const Series *series, int resolution = 96);
 
-    /// Creates the thumbnail of the image passed by parameter
+    /// Creates the thumbnail of the image passed by parameter. It's read from ThumbnailCache if it was created before.
     QImage getThumbnail(const Image *image, int resolution = 96);
 
-    /// Get the thumbnail from the DICOMTagReader
+    /// Get the thumbnail from the DICOMTagReader. The pixel data of the dataset already read is used, decoding only its first frame.
     QImage getThumbnail(const DICOMTagReader *reader, int resolution = 96);
 
+    /// Returns false if the last thumbnail created is a placeholder because the image couldn't be rendered.
+    bool isLastThumbnailValid() const;
+
     /// Create a custom blank thumbnail with the text we give it
     static QImage makeEmptyThumbnailWithCustomText(const QString &text, const DICOMTagReader *reader = nullptr, int resolution = 96);
 
 private:
+    /// Creates the thumbnails that aren't cached yet
+    friend class ThumbnailCache;
+
     /// Create the thumbnail of an object that is said to be an image
     QImage createImageThumbnail(const QString &imageFileName, int resolution);
 
@@ -56,8 +68,12 @@ private:
     /// Returns true if it is a valid dataset, false otherwise
     bool isSuitableForThumbnailCreation(const DICOMTagReader *reader) const;
 
-    /// Convert DicomImage to a QPixmap
-    QPixmap convertToQPixmap(DicomImage *dicomImage);
+    /// Convert DicomImage to a QImage
+    QImage convertToQImage(DicomImage *dicomImage);
+
+private:
+    /// False if the last thumbnail created is a placeholder
+    bool m_lastThumbnailIsValid;
 };
 
 }
@@ -15,6 +15,7 @@
 #include "volume.h"
 
 #include "volumereader.h"
+#include "volumerepository.h"
 #include "logging.h"
 #include "image.h"
 #include "series.h"
@@ -22,6 +23,7 @@
 #include "mathtools.h"
 #include "volumepixeldataiterator.h"
 #include "imageplane.h"
+#include "slicegeometryindex.h"
 #include "dicomtagreader.h"
 #include "volumehelper.h"
 
@@ -39,6 +41,7 @@ Volume::Volume(QObject *parent)
 Volume::~Volume()
 {
     DEBUG_LOG(QString("Destructor ~Volume %1, name: %2").arg(m_identifier.getValue()).arg(this->objectName()));
+    clearSliceGeometryIndices();
     delete m_volumePixelData;
 }
 
@@ -55,11 +58,13 @@ vtkImageData* Volume::getVtkData()
 void Volume::setData(ItkImageTypePointer itkImage)
 {
     m_volumePixelData->setData(itkImage);
+    clearSliceGeometryIndices();
 }
 
 void Volume::setData(vtkImageData *vtkImage)
 {
     m_volumePixelData->setData(vtkImage);
+    clearSliceGeometryIndices();
 }
 
 void Volume::setPixelData(VolumePixelData *pixelData)
@@ -69,6 +74,7 @@ void Volume::setPixelData(VolumePixelData *pixelData)
     m_volumePixelData = pixelData;
     // Set the number of phases to the new pixel data
     m_volumePixelData->setNumberOfPhases(m_numberOfPhases);
+    clearSliceGeometryIndices();
 }
 
 VolumePixelData* Volume::getPixelData()
@@ -78,10 +84,16 @@ VolumePixelData* Volume::getPixelData()
         VolumeReader *volumeReader = createVolumeReader();
         connect(volumeReader, SIGNAL(progress(int)), SIGNAL(progress(int)));
         volumeReader->read(this);
+        bool success = volumeReader->getLastErrorMessageToUser().isEmpty();
         delete volumeReader;
 
         // Set the number of phases to the new pixel data
         m_volumePixelData->setNumberOfPhases(m_numberOfPhases);
+
+        if (success)
+        {
+            VolumeRepository::getRepository()->volumePixelDataLoaded(this);
+        }
     }
 
     return m_volumePixelData;
@@ -162,6 +174,7 @@ void Volume::setNumberOfPhases(int phases)
     if (phases >= 1)
     {
         m_numberOfPhases = phases;
+        clearSliceGeometryIndices();
 
         // Set the number of phases to the pixel data only if it's already loaded, because we don't want to load it now
         if (isPixelDataLoaded())
@@ -190,6 +203,14 @@ Volume* Volume::getPhaseVolume(int index)
         result = new Volume();
         result->setImages(this->getPhaseImages(index));
     }
+
+    // The pixel data of the phase is a view over the loaded one, so that the images don't have to be read again.
+    // It can only be done if the slices of each phase are together, otherwise the images of the phase are read again.
+    if (result && isPixelDataLoaded() && (m_numberOfPhases == 1 || getPixelData()->areSlicesArrangedByPhase()))
+    {
+        result->setData(getPixelData()->getPhaseData(m_numberOfPhases == 1 ? 0 : index));
+    }
+
     return result;
 }
 
@@ -213,6 +234,7 @@ QList<Image*> Volume::getPhaseImages(int index)
 void Volume::setNumberOfSlicesPerPhase(int slicesPerPhase)
 {
     m_numberOfSlicesPerPhase = slicesPerPhase;
+    clearSliceGeometryIndices();
 }
 
 int Volume::getNumberOfSlicesPerPhase() const
@@ -244,6 +266,7 @@ void Volume::addImage(Image *image)
         }
 
         m_checkedImagesAnatomicalPlane = false;
+        clearSliceGeometryIndices();
     }
 }
 
@@ -258,6 +281,7 @@ void Volume::setImages(const QList<Image*> &imageList)
     }
 
     m_checkedImagesAnatomicalPlane = false;
+    clearSliceGeometryIndices();
 }
 
 QList<Image*> Volume::getImages() const
@@ -582,6 +606,21 @@ ImagePlane* Volume::getImagePlane(int sliceNumber, const OrthogonalPlane &plane,
     return imagePlane;
 }
 
+const SliceGeometryIndex* Volume::getSliceGeometryIndex(const OrthogonalPlane &plane)
+{
+    SliceGeometryIndex *index = m_sliceGeometryIndices.value(plane);
+
+    if (!index)
+    {
+        // Building the index may load the pixel data, which clears the indices, so it's inserted once built
+        index = new SliceGeometryIndex();
+        index->build(this, plane);
+        m_sliceGeometryIndices.insert(plane, index);
+    }
+
+    return index;
+}
+
 void Volume::getSliceRange(int &min, int &max, const OrthogonalPlane &plane)
 {
     if (m_numberOfPhases > 1 && plane == OrthogonalPlane::XYPlane)
@@ -674,6 +713,7 @@ double Volume::getScalarValue(int x, int y, int z)
 void Volume::convertToNeutralVolume()
 {
     m_volumePixelData->convertToNeutralPixelData();
+    clearSliceGeometryIndices();
 
     // When we create the neutral volume we indicate that we only have 1 single phase
     // EVERYTHING Maybe as many phases should be created as the series indicates?
@@ -772,6 +812,12 @@ int Volume::getImageIndex(int sliceNumber, int phaseNumber) const
     return sliceNumber * m_numberOfPhases + phaseNumber;
 }
 
+void Volume::clearSliceGeometryIndices()
+{
+    qDeleteAll(m_sliceGeometryIndices);
+    m_sliceGeometryIndices.clear();
+}
+
 VolumeReader* Volume::createVolumeReader()
 {
     return new VolumeReader(this);
@@ -22,6 +22,7 @@
 #include "anatomicalplane.h"
 #include "orthogonalplane.h"
 // Qt
+#include <QHash>
 #include <QPixmap>
 #include <QVector>
 // FWD declarations
@@ -35,6 +36,7 @@ class Study;
 class Patient;
 class VolumeReader;
 class ImagePlane;
+class SliceGeometryIndex;
 
 /**
 This class represents a volume of data. This will be the class where the data we want to process will be saved.
@@ -104,6 +106,7 @@ public:
     /// TODO Transitional methods for design changes to the phase theme
     void setNumberOfPhases(int phases);
     int getNumberOfPhases() const;
+    /// Returns a new volume with the images of the given phase. If the pixel data of this volume is loaded, the one of the new volume is a view over it.
     Volume* getPhaseVolume(int index);
     QList<Image*> getPhaseImages(int index);
     void setNumberOfSlicesPerPhase(int slicesPerPhase);
@@ -149,6 +152,10 @@ public:
     /// @return The corresponding image plane
     ImagePlane* getImagePlane(int sliceNumber, const OrthogonalPlane &plane, bool vtkReconstructionHack = false);
 
+    /// Returns the geometry of the slices of the given orthogonal plane, which allows to locate the slices without creating their ImagePlanes.
+    /// It's built the first time it's requested and kept until the images or the pixel data of the volume change. It belongs to the volume.
+    const SliceGeometryIndex* getSliceGeometryIndex(const OrthogonalPlane &plane);
+
     /// Returns the pixel units for this volume. If the units cannot be specified, an empty string will be returned
     QString getPixelUnits();
     /// Returns the slice range of the current volume corresponding to an specified orthogonal plane
@@ -239,6 +246,9 @@ private:
     /// Lazy loading of the units of the pixels of PT series
     QString getPTPixelUnits(const Image *image);
 
+    /// Deletes the slice geometry indices, which have to be built again because the geometry of the volume has changed
+    void clearSliceGeometryIndices();
+
 private:
 
     /// Set of images that make up the volume
@@ -265,6 +275,9 @@ private:
     /// Stores the units of the pixel values of PT series.
     /// getPTPixelUnits should always be used to get this value
     QString m_PTPixelUnits;
+
+    /// Slice geometry index of each orthogonal plane, built on demand
+    QHash<int, SliceGeometryIndex*> m_sliceGeometryIndices;
 };
 
 }  // End namespace udg
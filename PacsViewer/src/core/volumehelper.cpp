@@ -105,7 +105,7 @@ void VolumeHelper::generatePatientVolumes(Patient *patient)
                 volume->setImages(imageList);
                 volume->setNumberOfPhases(numberOfPhases);
                 volume->setNumberOfSlicesPerPhase(numberOfSlicesPerPhase);
-                volume->setThumbnail(imageList.at(imageList.count() / 2)->getThumbnail(true));
+                volume->setThumbnail(imageList.at(imageList.count() / 2)->getThumbnail());
                 series->addVolume(volume);
             }
         }
@@ -0,0 +1,247 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "volumeloadscheduler.h"
+
+#include "image.h"
+#include "logging.h"
+#include "volume.h"
+
+#include <ThreadWeaver/JobInterface>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStorageInfo>
+#include <QThread>
+
+namespace udg {
+
+namespace {
+
+// Decoding cost budget for each CPU core. It's equivalent to a 512x512x512 uncompressed volume, so that several of them can be read concurrently while
+// large volumes with expensive compressions are read one or two at a time.
+const qint64 DecodingCostBudgetPerCore = Q_INT64_C(512) * 512 * 512;
+
+}
+
+VolumeLoadScheduler::VolumeLoadScheduler()
+    : m_runningMemory(0), m_runningDecodingCost(0), m_maximumNumberOfConcurrentJobs(0), m_availableMemory(0)
+{
+    m_decodingCostBudget = qMax(1, QThread::idealThreadCount()) * DecodingCostBudgetPerCore;
+}
+
+VolumeLoadScheduler::~VolumeLoadScheduler()
+{
+}
+
+void VolumeLoadScheduler::setMaximumNumberOfConcurrentJobs(int maximum)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maximumNumberOfConcurrentJobs = qMax(0, maximum);
+}
+
+int VolumeLoadScheduler::getMaximumNumberOfConcurrentJobs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maximumNumberOfConcurrentJobs;
+}
+
+void VolumeLoadScheduler::setAvailableMemory(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_availableMemory = qMax(Q_INT64_C(0), bytes);
+}
+
+void VolumeLoadScheduler::addJob(ThreadWeaver::JobInterface *job, const LoadCost &cost)
+{
+    QMutexLocker locker(&m_mutex);
+    m_jobCosts.insert(job, cost);
+}
+
+VolumeLoadScheduler::LoadCost VolumeLoadScheduler::estimateLoadCost(Volume *volume)
+{
+    LoadCost cost;
+    cost.memory = 0;
+    cost.decoding = 0;
+    cost.storageType = UnknownStorage;
+
+    QList<Image*> images = volume->getImages();
+
+    foreach (Image *image, images)
+    {
+        qint64 pixels = static_cast<qint64>(image->getRows()) * image->getColumns() * qMax(1, image->getSamplesPerPixel());
+        cost.memory += pixels * qMax(1, image->getBitsAllocated() / 8);
+        cost.decoding += pixels * getDecodingCostFactor(image->getTransferSyntaxUID());
+    }
+
+    if (!images.isEmpty())
+    {
+        QString rootPath = QStorageInfo(images.first()->getPath()).rootPath();
+
+        QMutexLocker locker(&m_mutex);
+        if (!m_storageTypes.contains(rootPath))
+        {
+            m_storageTypes.insert(rootPath, getStorageType(images.first()->getPath()));
+        }
+        cost.storageType = m_storageTypes.value(rootPath);
+    }
+
+    return cost;
+}
+
+int VolumeLoadScheduler::getDecodingCostFactor(const QString &transferSyntaxUID)
+{
+    // Implicit and explicit VR little endian, explicit VR big endian, or unknown
+    if (transferSyntaxUID.isEmpty() || transferSyntaxUID == "1.2.840.10008.1.2" || transferSyntaxUID == "1.2.840.10008.1.2.1"
+        || transferSyntaxUID == "1.2.840.10008.1.2.2")
+    {
+        return 1;
+    }
+    // Deflated explicit VR little endian and RLE lossless
+    else if (transferSyntaxUID == "1.2.840.10008.1.2.1.99" || transferSyntaxUID == "1.2.840.10008.1.2.5")
+    {
+        return 2;
+    }
+    // JPEG-LS
+    else if (transferSyntaxUID == "1.2.840.10008.1.2.4.80" || transferSyntaxUID == "1.2.840.10008.1.2.4.81")
+    {
+        return 6;
+    }
+    // JPEG 2000
+    else if (transferSyntaxUID.startsWith("1.2.840.10008.1.2.4.9"))
+    {
+        return 10;
+    }
+    // JPEG and other compressions
+    else
+    {
+        return 4;
+    }
+}
+
+VolumeLoadScheduler::StorageType VolumeLoadScheduler::getStorageType(const QString &path)
+{
+#ifdef Q_OS_LINUX
+    // The device is something like /dev/sda1, /dev/nvme0n1p1 or a link to /dev/dm-0, and the sysfs entry of a partition is inside the one of its disk
+    QString device = QFileInfo(QString::fromLocal8Bit(QStorageInfo(path).device())).canonicalFilePath();
+    QString blockDevicePath = QFileInfo("/sys/class/block/" + QFileInfo(device).fileName()).canonicalFilePath();
+
+    if (!blockDevicePath.isEmpty())
+    {
+        QDir blockDevice(blockDevicePath);
+        QStringList candidates;
+        candidates << blockDevice.filePath("queue/rotational") << blockDevice.filePath("../queue/rotational");
+
+        foreach (const QString &candidate, candidates)
+        {
+            QFile rotational(candidate);
+            if (rotational.open(QIODevice::ReadOnly))
+            {
+                bool isRotational = rotational.readAll().trimmed() == "1";
+                DEBUG_LOG(QString("Storage of %1 is %2").arg(path).arg(isRotational ? "rotational" : "solid state"));
+                return isRotational ? RotationalStorage : SolidStateStorage;
+            }
+        }
+    }
+#else
+    Q_UNUSED(path)
+#endif
+
+    return UnknownStorage;
+}
+
+bool VolumeLoadScheduler::canRun(ThreadWeaver::JobPointer job)
+{
+    QMutexLocker locker(&m_mutex);
+
+    LoadCost cost = m_jobCosts.value(job.data());
+
+    if (!m_runningJobs.isEmpty())
+    {
+        if (m_runningJobs.size() >= getEffectiveMaximumNumberOfConcurrentJobs(cost.storageType))
+        {
+            return false;
+        }
+
+        if (m_availableMemory > 0 && m_runningMemory + cost.memory > m_availableMemory)
+        {
+            return false;
+        }
+
+        if (m_runningDecodingCost + cost.decoding > m_decodingCostBudget)
+        {
+            return false;
+        }
+    }
+
+    m_runningJobs.insert(job.data());
+    m_runningMemory += cost.memory;
+    m_runningDecodingCost += cost.decoding;
+
+    return true;
+}
+
+void VolumeLoadScheduler::free(ThreadWeaver::JobPointer job)
+{
+    removeRunningJob(job.data());
+}
+
+void VolumeLoadScheduler::release(ThreadWeaver::JobPointer job)
+{
+    removeRunningJob(job.data());
+}
+
+void VolumeLoadScheduler::destructed(ThreadWeaver::JobInterface *job)
+{
+    removeRunningJob(job);
+
+    QMutexLocker locker(&m_mutex);
+    m_jobCosts.remove(job);
+}
+
+int VolumeLoadScheduler::getEffectiveMaximumNumberOfConcurrentJobs(StorageType storageType) const
+{
+    if (m_maximumNumberOfConcurrentJobs > 0)
+    {
+        return m_maximumNumberOfConcurrentJobs;
+    }
+
+    switch (storageType)
+    {
+        case RotationalStorage:
+            // Concurrent reads make the disk seek continuously
+            return 1;
+        case SolidStateStorage:
+            // Each job already decodes with several threads, so more jobs than this don't make the reading faster
+            return qBound(2, QThread::idealThreadCount() / 2, 8);
+        case UnknownStorage:
+        default:
+            return 2;
+    }
+}
+
+void VolumeLoadScheduler::removeRunningJob(ThreadWeaver::JobInterface *job)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_runningJobs.remove(job))
+    {
+        LoadCost cost = m_jobCosts.value(job);
+        m_runningMemory -= cost.memory;
+        m_runningDecodingCost -= cost.decoding;
+    }
+}
+
+} // namespace udg
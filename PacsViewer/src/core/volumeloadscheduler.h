@@ -0,0 +1,118 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_VOLUMELOADSCHEDULER_H
+#define UDG_VOLUMELOADSCHEDULER_H
+
+#include <ThreadWeaver/QueuePolicy>
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+namespace udg {
+
+class Volume;
+
+/**
+    ThreadWeaver queue policy that decides how many volume reading jobs can run concurrently.
+
+    Instead of a fixed cap, each job is admitted according to the estimated cost of reading its volume:
+    - The number of concurrent jobs is limited according to the type of storage where the files are, since rotational disks slow down with concurrent reads.
+    - The memory needed by the running jobs must fit in the available memory.
+    - The decoding cost of the running jobs, which depends on the number of pixels and the transfer syntax, must fit in a budget proportional to the number
+      of CPU cores.
+    A job is always admitted when no other job is running, so that every volume can be read regardless of its cost.
+
+    Jobs must be registered with addJob() before being enqueued. This class can be used concurrently from the ThreadWeaver threads.
+ */
+class VolumeLoadScheduler : public ThreadWeaver::QueuePolicy {
+public:
+    /// Type of storage where the files of a volume are.
+    enum StorageType { UnknownStorage, RotationalStorage, SolidStateStorage };
+
+    /// Estimated resources needed to read a volume.
+    struct LoadCost
+    {
+        /// Memory needed by the pixel data, in bytes.
+        qint64 memory;
+        /// Number of pixels weighted by the relative cost of decoding the transfer syntax of each image.
+        qint64 decoding;
+        /// Type of storage where the files are.
+        StorageType storageType;
+    };
+
+    VolumeLoadScheduler();
+    virtual ~VolumeLoadScheduler();
+
+    /// Sets the maximum number of jobs that can run concurrently. If it's 0, it's decided from the storage type and the number of CPU cores.
+    void setMaximumNumberOfConcurrentJobs(int maximum);
+    /// Returns the maximum number of jobs that can run concurrently, 0 if it's decided automatically.
+    int getMaximumNumberOfConcurrentJobs() const;
+
+    /// Sets the memory available for the pixel data of the running jobs, in bytes. 0 means that there's no limit.
+    void setAvailableMemory(qint64 bytes);
+
+    /// Registers the given job with the given cost. It must be called before the job is enqueued.
+    void addJob(ThreadWeaver::JobInterface *job, const LoadCost &cost);
+
+    /// Returns the estimated cost of reading the given volume.
+    LoadCost estimateLoadCost(Volume *volume);
+
+    /// Returns the relative cost of decoding a pixel encoded with the given transfer syntax, 1 being the cost of an uncompressed pixel.
+    static int getDecodingCostFactor(const QString &transferSyntaxUID);
+
+    /// Returns the type of storage of the given path, or UnknownStorage if it can't be determined in this platform.
+    static StorageType getStorageType(const QString &path);
+
+    virtual bool canRun(ThreadWeaver::JobPointer job);
+    virtual void free(ThreadWeaver::JobPointer job);
+    virtual void release(ThreadWeaver::JobPointer job);
+    virtual void destructed(ThreadWeaver::JobInterface *job);
+
+private:
+    /// Returns the maximum number of concurrent jobs when a job with the given storage type is going to start.
+    int getEffectiveMaximumNumberOfConcurrentJobs(StorageType storageType) const;
+
+    /// Removes the given job from the running jobs.
+    void removeRunningJob(ThreadWeaver::JobInterface *job);
+
+private:
+    /// Protects all the members, since the policy is used from the ThreadWeaver threads.
+    mutable QMutex m_mutex;
+
+    /// Cost of each registered job.
+    QHash<ThreadWeaver::JobInterface*, LoadCost> m_jobCosts;
+    /// Jobs currently running.
+    QSet<ThreadWeaver::JobInterface*> m_runningJobs;
+    /// Sum of the memory of the running jobs.
+    qint64 m_runningMemory;
+    /// Sum of the decoding cost of the running jobs.
+    qint64 m_runningDecodingCost;
+
+    /// Maximum number of concurrent jobs, or 0 to decide it automatically.
+    int m_maximumNumberOfConcurrentJobs;
+    /// Memory available for the running jobs, or 0 if there's no limit.
+    qint64 m_availableMemory;
+    /// Maximum decoding cost of the running jobs.
+    qint64 m_decodingCostBudget;
+
+    /// Storage type of each mount point already checked.
+    QHash<QString, StorageType> m_storageTypes;
+};
+
+} // namespace udg
+
+#endif // UDG_VOLUMELOADSCHEDULER_H
@@ -17,6 +17,11 @@
 #include "volumepixeldataiterator.h"
 #include "voxel.h"
 #include "mathtools.h"
+#include "phasefilter.h"
+#include "filteroutput.h"
+#include "vtkimageextractphase.h"
+
+#include <QByteArray>
 
 #include <vtkImageChangeInformation.h>
 #include <vtkImageData.h>
@@ -26,10 +31,8 @@
 namespace udg {
 
 VolumePixelData::VolumePixelData() :
-    m_loaded(false)
+    m_loaded(false), m_numberOfPhases(1)
 {
-    setNumberOfPhases(1);
-    
     m_imageDataVTK = vtkSmartPointer<vtkImageData>::New();
 
     m_itkToVtkFilter = ItkToVtkFilterType::New();
@@ -116,10 +119,60 @@ void VolumePixelData::setData(unsigned char *data, int extent[6], int bytesPerPi
 
 void VolumePixelData::setNumberOfPhases(int numberOfPhases)
 {
-    if (numberOfPhases > 0)
+    if (numberOfPhases > 0 && numberOfPhases != m_numberOfPhases)
     {
         m_numberOfPhases = numberOfPhases;
+
+        // Slices arranged in another number of phases are put back in the order of the images, and arranged again if they were
+        int numberOfPhasesOfArrangedSlices = VtkImageExtractPhase::getNumberOfPhasesOfArrangedSlices(this->getVtkData());
+
+        if (numberOfPhasesOfArrangedSlices > 1 && numberOfPhasesOfArrangedSlices != m_numberOfPhases)
+        {
+            int numberOfSlices = m_imageDataVTK->GetExtent()[5] - m_imageDataVTK->GetExtent()[4] + 1;
+            transposeSlices(numberOfPhasesOfArrangedSlices, numberOfSlices / numberOfPhasesOfArrangedSlices);
+            VtkImageExtractPhase::setNumberOfPhasesOfArrangedSlices(this->getVtkData(), 1);
+            arrangeSlicesByPhase();
+        }
+    }
+}
+
+void VolumePixelData::arrangeSlicesByPhase()
+{
+    vtkImageData *imageData = this->getVtkData();
+
+    if (areSlicesArrangedByPhase() || !m_loaded || m_numberOfPhases < 2 || !imageData->GetScalarPointer())
+    {
+        return;
+    }
+
+    int *extent = imageData->GetExtent();
+    int numberOfSlices = extent[5] - extent[4] + 1;
+
+    if (numberOfSlices % m_numberOfPhases != 0)
+    {
+        WARN_LOG(QString("The %1 slices can't be arranged in %2 phases").arg(numberOfSlices).arg(m_numberOfPhases));
+        return;
     }
+
+    // The slice at slice * numberOfPhases + phase goes to phase * numberOfSlicesPerPhase + slice
+    transposeSlices(numberOfSlices / m_numberOfPhases, m_numberOfPhases);
+    VtkImageExtractPhase::setNumberOfPhasesOfArrangedSlices(imageData, m_numberOfPhases);
+}
+
+bool VolumePixelData::areSlicesArrangedByPhase() const
+{
+    return m_numberOfPhases > 1 && VtkImageExtractPhase::getNumberOfPhasesOfArrangedSlices(m_imageDataVTK) == m_numberOfPhases;
+}
+
+vtkSmartPointer<vtkImageData> VolumePixelData::getPhaseData(int phase)
+{
+    PhaseFilter phaseFilter;
+    phaseFilter.setInput(this->getVtkData());
+    phaseFilter.setNumberOfPhases(m_numberOfPhases);
+    phaseFilter.setPhase(phase);
+    phaseFilter.update();
+
+    return phaseFilter.getOutput().getVtkImageData();
 }
 
 bool VolumePixelData::isLoaded() const
@@ -163,17 +216,29 @@ bool VolumePixelData::computeCoordinateIndex(const double coordinate[3], int ind
         index[i] = qRound((coordinate[i] - origin[i]) / spacing[i]);
     }
 
+    int *extent = this->getVtkData()->GetExtent();
+    bool insidePhase = true;
+
     // Apply phase correction (Safety check, phaseNumber and numberOfPhases must be coherent to apply it)
-    if (MathTools::isInsideRange(phaseNumber, 0, m_numberOfPhases - 1))
+    if (m_numberOfPhases > 1 && MathTools::isInsideRange(phaseNumber, 0, m_numberOfPhases - 1))
     {
         // HACK This calculation is necessary to alleviate the lack of knowledge of the phase
         // TODO This must be resolved in a more elegant way, which involves a redesign of the treatment of phases and volumes
-        // We calculate the correct index in case we have phases
-        index[2] = index[2] * m_numberOfPhases + phaseNumber;
+        // We calculate the correct index in case we have phases, whose slices are consecutive if they have been arranged (see arrangeSlicesByPhase())
+        if (areSlicesArrangedByPhase())
+        {
+            int numberOfSlicesPerPhase = (extent[5] - extent[4] + 1) / m_numberOfPhases;
+            insidePhase = index[2] >= 0 && index[2] < numberOfSlicesPerPhase;
+            index[2] = phaseNumber * numberOfSlicesPerPhase + index[2];
+        }
+        else
+        {
+            index[2] = index[2] * m_numberOfPhases + phaseNumber;
+        }
     }
 
-    int *extent = this->getVtkData()->GetExtent();
-    bool inside = index[0] >= extent[0] && index[0] <= extent[1] &&
+    bool inside = insidePhase &&
+                  index[0] >= extent[0] && index[0] <= extent[1] &&
                   index[1] >= extent[2] && index[1] <= extent[3] &&
                   index[2] >= extent[4] && index[2] <= extent[5];
 
@@ -281,6 +346,9 @@ void VolumePixelData::setSpacing(double x, double y, double z)
     changeInformation->SetInputData(m_imageDataVTK);
     changeInformation->SetOutputSpacing(x, y, z);
     changeInformation->Update();
+    // The filter doesn't pass the field data, where the arrangement of the slices is recorded
+    VtkImageExtractPhase::setNumberOfPhasesOfArrangedSlices(changeInformation->GetOutput(),
+                                                            VtkImageExtractPhase::getNumberOfPhasesOfArrangedSlices(m_imageDataVTK));
     this->setData(changeInformation->GetOutput());
     changeInformation->Delete();
 }
@@ -314,4 +382,47 @@ int VolumePixelData::getNumberOfPoints()
 {
     return m_imageDataVTK->GetNumberOfPoints();
 } 
+
+void VolumePixelData::transposeSlices(int numberOfRows, int numberOfColumns)
+{
+    vtkImageData *imageData = this->getVtkData();
+    int *extent = imageData->GetExtent();
+    int numberOfSlices = numberOfRows * numberOfColumns;
+    size_t sliceSize = static_cast<size_t>(extent[1] - extent[0] + 1) * (extent[3] - extent[2] + 1) * imageData->GetScalarSize()
+                     * imageData->GetNumberOfScalarComponents();
+    char *data = static_cast<char*>(imageData->GetScalarPointer());
+
+    // The slices are moved following the cycles of the permutation, so that only two of them have to be kept apart at a time
+    QVector<bool> moved(numberOfSlices, false);
+    QByteArray carriedSlice(static_cast<int>(sliceSize), Qt::Uninitialized);
+    QByteArray displacedSlice(static_cast<int>(sliceSize), Qt::Uninitialized);
+
+    for (int first = 0; first < numberOfSlices; first++)
+    {
+        if (moved[first])
+        {
+            continue;
+        }
+
+        memcpy(carriedSlice.data(), data + first * sliceSize, sliceSize);
+        int current = first;
+
+        do
+        {
+            int destination = (current % numberOfColumns) * numberOfRows + current / numberOfColumns;
+            char *destinationPointer = data + destination * sliceSize;
+
+            memcpy(displacedSlice.data(), destinationPointer, sliceSize);
+            memcpy(destinationPointer, carriedSlice.constData(), sliceSize);
+            carriedSlice.swap(displacedSlice);
+
+            moved[destination] = true;
+            current = destination;
+        }
+        while (current != first);
+    }
+
+    imageData->Modified();
+}
+
 } // End namespace udg
@@ -70,7 +70,20 @@ public:
     /// Sets the number of phases of this pixel data.
     /// This information is needed to be able to access to the right pixels when accessing through world coordinate
     /// The minimum value must be 1, is less than, the method will do nothing
+    /// If the slices are arranged in another number of phases, they are arranged again in the new one
     void setNumberOfPhases(int numberOfPhases);
+
+    /// Rearranges in place the slices of the data, which are read in the order of the images (the phases of each slice together), so that the slices of
+    /// each phase are consecutive. The data of a volume with phases is kept this way, so that a phase can be shown and processed without copying it.
+    void arrangeSlicesByPhase();
+
+    /// Returns true if the slices of the current data are arranged in the current number of phases. They aren't when the number of slices isn't a multiple
+    /// of the number of phases, for instance. The arrangement is recorded in the data itself, so it's kept when data arranged elsewhere is set.
+    bool areSlicesArrangedByPhase() const;
+
+    /// Returns the data of the given phase, which is a view over its slices in the data of this object if they are arranged by phase, or a copy of them
+    /// otherwise.
+    vtkSmartPointer<vtkImageData> getPhaseData(int phase);
     
     /// Retorna cert si conté dades carregades.
     bool isLoaded() const;
@@ -129,6 +142,10 @@ public:
     // Get the number of points
     int getNumberOfPoints();
    
+private:
+    /// Moves in place the slice at row * numberOfColumns + column of the data to column * numberOfRows + row.
+    void transposeSlices(int numberOfRows, int numberOfColumns);
+
 private:
     /// Filtres per importar/exportar
     typedef itk::ImageToVTKImageFilter<ItkImageType> ItkToVtkFilterType;
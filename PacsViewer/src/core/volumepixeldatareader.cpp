@@ -20,6 +20,7 @@ VolumePixelDataReader::VolumePixelDataReader(QObject *parent)
 : QObject(parent)
 {
     m_volumePixelData = NULL;
+    m_firstSliceToRead = -1;
 }
 
 VolumePixelDataReader::~VolumePixelDataReader()
@@ -31,9 +32,19 @@ void VolumePixelDataReader::setFrameNumbers(const QList<int> &frameNumbers)
     m_frameNumbers = frameNumbers;
 }
 
+void VolumePixelDataReader::setFirstSliceToRead(int slice)
+{
+    m_firstSliceToRead = slice;
+}
+
 VolumePixelData* VolumePixelDataReader::getVolumePixelData()
 {
     return m_volumePixelData;
 }
 
+VolumePixelData* VolumePixelDataReader::createPartialVolumePixelData()
+{
+    return 0;
+}
+
 } // End namespace udg
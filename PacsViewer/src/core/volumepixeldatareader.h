@@ -40,6 +40,10 @@ public:
     /// Sets the list of frame numbers in the order they must be read from a multiframe file.
     void setFrameNumbers(const QList<int> &frameNumbers);
 
+    /// Sets the slice that must be read first, so that it and the slices around it are available as soon as possible. A negative value (the default) reads
+    /// the slices in order. Readers that can't read in a different order can ignore it.
+    void setFirstSliceToRead(int slice);
+
     /// Donada una llista de noms de fitxer, la llegeix i omple
     /// l'estructura d'imatge que fem servir internament.
     /// Ens retorna un enter que ens indicarà si hi ha hagut alguna mena d'error en el
@@ -54,14 +58,25 @@ public:
     /// Ens retorna les dades llegides
     VolumePixelData* getVolumePixelData();
 
+    /// Returns a new VolumePixelData that shares the buffer that is being filled by the current read, or null if the reader can't provide it (yet).
+    /// Only the slices reported by slicesRead() contain valid data. The caller takes ownership of the returned object. Can be called from any thread.
+    virtual VolumePixelData* createPartialVolumePixelData();
+
 signals:
     /// Ens indica el progrés del procés de lectura
     void progress(int progress);
 
+    /// Emitted during the read with the range of consecutive slices, around the first slice to read, that already contain valid data in the buffer returned
+    /// by createPartialVolumePixelData().
+    void slicesRead(int firstSlice, int lastSlice);
+
 protected:
     /// List of frame numbers in the order they must be read from a multiframe file. Can be ignored for single-frame files.
     QList<int> m_frameNumbers;
 
+    /// Slice that must be read first, or a negative value to read the slices in order.
+    int m_firstSliceToRead;
+
     /// Les dades d'imatge en format vtk
     VolumePixelData *m_volumePixelData;
 
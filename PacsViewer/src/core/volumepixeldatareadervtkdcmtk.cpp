@@ -14,6 +14,7 @@
 
 #include "volumepixeldatareadervtkdcmtk.h"
 
+#include "coresettings.h"
 #include "logging.h"
 #include "volumepixeldata.h"
 #include "vtkdcmtkimagereader.h"
@@ -21,6 +22,7 @@
 #include <QStringList>
 
 #include <vtkEventQtSlotConnect.h>
+#include <vtkImageData.h>
 #include <vtkStringArray.h>
 
 namespace udg {
@@ -30,9 +32,15 @@ VolumePixelDataReaderVTKDCMTK::VolumePixelDataReaderVTKDCMTK(QObject *parent) :
 {
     m_reader = VtkDcmtkImageReader::New();
 
+    Settings settings;
+    m_reader->setNumberOfThreads(settings.getValue(CoreSettings::MaximumNumberOfThreadsDecodingVolume).toInt());
+
     // VTK progress
     m_vtkQtConnections = vtkEventQtSlotConnect::New();
     m_vtkQtConnections->Connect(m_reader, vtkCommand::ProgressEvent, this, SLOT(progressSlot()));
+
+    m_lastNotifiedSliceRange[0] = 0;
+    m_lastNotifiedSliceRange[1] = -1;
 }
 
 VolumePixelDataReaderVTKDCMTK::~VolumePixelDataReaderVTKDCMTK()
@@ -75,6 +83,9 @@ int VolumePixelDataReaderVTKDCMTK::read(const QStringList &filenames)
 
     // Set frame numbers to the reader (needed for multiframe files)
     m_reader->setFrameNumbers(m_frameNumbers);
+    m_reader->setFirstFrameToDecode(m_firstSliceToRead);
+    m_lastNotifiedSliceRange[0] = 0;
+    m_lastNotifiedSliceRange[1] = -1;
 
     try
     {
@@ -122,9 +133,40 @@ void VolumePixelDataReaderVTKDCMTK::requestAbort()
     m_reader->AbortExecuteOn();
 }
 
+VolumePixelData* VolumePixelDataReaderVTKDCMTK::createPartialVolumePixelData()
+{
+    if (!m_reader->isOutputReadyForPartialAccess())
+    {
+        return 0;
+    }
+
+    // A shallow copy shares the scalars with the reader output but can be modified and put in a pipeline independently
+    vtkImageData *imageData = vtkImageData::New();
+    imageData->ShallowCopy(m_reader->GetOutput());
+
+    VolumePixelData *volumePixelData = new VolumePixelData();
+    volumePixelData->setData(imageData);
+    imageData->Delete();
+
+    return volumePixelData;
+}
+
 void VolumePixelDataReaderVTKDCMTK::progressSlot()
 {
     emit progress(static_cast<int>(m_reader->GetProgress() * 100));
+
+    if (m_firstSliceToRead >= 0 && m_reader->isOutputReadyForPartialAccess())
+    {
+        int firstSlice, lastSlice;
+        m_reader->getDecodedFrameRange(firstSlice, lastSlice);
+
+        if (lastSlice >= firstSlice && (firstSlice != m_lastNotifiedSliceRange[0] || lastSlice != m_lastNotifiedSliceRange[1]))
+        {
+            m_lastNotifiedSliceRange[0] = firstSlice;
+            m_lastNotifiedSliceRange[1] = lastSlice;
+            emit slicesRead(firstSlice, lastSlice);
+        }
+    }
 }
 
 } // end namespace udg
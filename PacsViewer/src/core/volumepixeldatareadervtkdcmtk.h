@@ -41,6 +41,10 @@ public:
     /// Requests abortion of the current read operation.
     virtual void requestAbort();
 
+    /// Returns a new VolumePixelData sharing the scalars that are being filled by the current read, or null if they aren't allocated yet or their scalar
+    /// type may still change.
+    virtual VolumePixelData* createPartialVolumePixelData();
+
 private slots:
 
     /// Receives the VTK progress event from the reader and emits the Qt progress signal.
@@ -54,6 +58,8 @@ private:
     vtkEventQtSlotConnect *m_vtkQtConnections;
     /// True when a read abortion has been requested.
     bool m_abortRequested;
+    /// Last range of consecutive read slices notified with slicesRead().
+    int m_lastNotifiedSliceRange[2];
 
 };
 
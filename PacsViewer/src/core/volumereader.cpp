@@ -38,7 +38,7 @@ int getFrameNumber(const Image *image)
 }
 
 VolumeReader::VolumeReader(QObject *parent)
-    : QObject(parent), m_volumePixelDataReader(0), m_abortRequested(false)
+    : QObject(parent), m_volumePixelDataReader(0), m_abortRequested(false), m_firstSliceToRead(-1)
 {
      m_lastError = VolumePixelDataReader::NoError;
 }
@@ -95,9 +95,16 @@ void VolumeReader::executePixelDataReader(Volume *volume)
             {
                 // Tot ha anat ok, assignem les dades al volum
                 volume->setPixelData(m_volumePixelDataReader->getVolumePixelData());
+                // The phases are shown and processed as views over the loaded data, which needs the slices of each phase together
+                volume->getPixelData()->arrangeSlicesByPhase();
                 runPostprocessors(volume);
                 fixSpacingIssues(volume);
             }
+            else if (m_lastError == VolumePixelDataReader::ReadAborted)
+            {
+                // The volume is left without pixel data, so that it can be read again later
+                DEBUG_LOG(QString("Reading of volume %1 aborted").arg(volume->getIdentifier().getValue()));
+            }
             else
             {
                 volume->convertToNeutralVolume();
@@ -130,6 +137,23 @@ void VolumeReader::requestAbort()
     m_abortRequested = true;
 }
 
+void VolumeReader::setFirstSliceToRead(int slice)
+{
+    m_firstSliceToRead = slice;
+}
+
+VolumePixelData* VolumeReader::createPartialVolumePixelData()
+{
+    QMutexLocker locker(&m_volumePixelDataReaderMutex);
+
+    if (!m_volumePixelDataReader)
+    {
+        return 0;
+    }
+
+    return m_volumePixelDataReader->createPartialVolumePixelData();
+}
+
 void VolumeReader::showMessageBoxWithLastError() const
 {
     if (m_lastError == VolumePixelDataReader::NoError)
@@ -239,6 +263,8 @@ QStringList VolumeReader::getFilesToRead(Volume *volume) const
 
 void VolumeReader::setUpReader(Volume *volume)
 {
+    QMutexLocker locker(&m_volumePixelDataReaderMutex);
+
     // Eliminem un lector anterior si l'havia
     if (m_volumePixelDataReader)
     {
@@ -250,8 +276,12 @@ void VolumeReader::setUpReader(Volume *volume)
     m_volumePixelDataReader = readerFactory.getReader();
     m_postprocessorsQueue = readerFactory.getPostprocessors();
 
+    // Progressive reading only makes sense when each slice is a single frame in the order of the volume, i.e. without phases
+    m_volumePixelDataReader->setFirstSliceToRead(volume->getNumberOfPhases() == 1 ? m_firstSliceToRead : -1);
+
     // Connectem les senyals de notificació de progrés
     connect(m_volumePixelDataReader, SIGNAL(progress(int)), SIGNAL(progress(int)));
+    connect(m_volumePixelDataReader, SIGNAL(slicesRead(int, int)), SIGNAL(slicesRead(int, int)));
 }
 
 void VolumeReader::runPostprocessors(Volume *volume)
@@ -17,6 +17,7 @@
 
 #include <QObject>
 
+#include <QMutex>
 #include <QQueue>
 #include <QSharedPointer>
 
@@ -24,6 +25,7 @@ namespace udg {
 
 class Postprocessor;
 class Volume;
+class VolumePixelData;
 class VolumePixelDataReader;
 
 /**
@@ -60,12 +62,23 @@ public:
     /// Si no hi ha cap "últim error" es retorna un QString buit.
     QString getLastErrorMessageToUser() const;
 
+    /// Sets the slice that must be read first in the following reads. A negative value (the default) reads the slices in order.
+    void setFirstSliceToRead(int slice);
+
+    /// Returns a new VolumePixelData sharing the buffer that is being filled by the current read, or null if it's not available.
+    /// Only the slices reported by slicesRead() contain valid data. The caller takes ownership. Can be called from any thread.
+    VolumePixelData* createPartialVolumePixelData();
+
 signals:
     /// Ens indica el progrés del procés de lectura
     /// TODO: De moment quan es vulgui llegir només un fitxer, p.ex. multiframes, mamos, etc. per limitacions de la lectura,
     /// no tindrem cap tipus de progrés.
     void progress(int progress);
 
+    /// Emitted during the read with the range of consecutive slices, around the first slice to read, that are already available through
+    /// createPartialVolumePixelData().
+    void slicesRead(int firstSlice, int lastSlice);
+
 private:
     /// Executa el pixel reader i llegeix el volume
     void executePixelDataReader(Volume *volume);
@@ -101,6 +114,12 @@ private:
     /// Used to know that abort has been requested before having the pixel data reader.
     bool m_abortRequested;
 
+    /// Slice that must be read first, or a negative value to read the slices in order.
+    int m_firstSliceToRead;
+
+    /// Protects m_volumePixelDataReader from being replaced while it's accessed from another thread.
+    QMutex m_volumePixelDataReaderMutex;
+
 };
 
 } // End namespace udg
@@ -28,6 +28,7 @@ VolumeReaderJob::VolumeReaderJob(Volume *volume, QObject *parent)
     m_volumeReadSuccessfully = false;
     m_lastErrorMessageToUser = "";
     m_abortRequested = false;
+    m_priority = DefaultPriority;
 }
 
 VolumeReaderJob::~VolumeReaderJob()
@@ -63,6 +64,26 @@ const Identifier& VolumeReaderJob::getVolumeIdentifier() const
     return m_volumeIdentifier;
 }
 
+void VolumeReaderJob::setFirstSliceToRead(int slice)
+{
+    m_volumeReader->setFirstSliceToRead(slice);
+}
+
+void VolumeReaderJob::setPriority(int priority)
+{
+    m_priority = priority;
+}
+
+int VolumeReaderJob::priority() const
+{
+    return m_priority;
+}
+
+VolumePixelData* VolumeReaderJob::createPartialVolumePixelData()
+{
+    return m_volumeReader->createPartialVolumePixelData();
+}
+
 void VolumeReaderJob::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *thread)
 {
     Q_UNUSED(thread)
@@ -74,8 +95,13 @@ void VolumeReaderJob::run(ThreadWeaver::JobPointer self, ThreadWeaver::Thread *t
     auto connection = connect(m_volumeReader, &VolumeReader::progress, [=](int value) {
         emit progress(self, value);
     });
+    auto slicesReadConnection = connect(m_volumeReader, &VolumeReader::slicesRead, [=](int firstSlice, int lastSlice) {
+        emit slicesRead(self, firstSlice, lastSlice);
+    });
     m_volumeReadSuccessfully = m_volumeReader->readWithoutShowingError(m_volumeToRead);
-    disconnect(connection); // it's important to disconnect so that the lambda with its captured shared pointer is destroyed at the end of the method
+    // it's important to disconnect so that the lambdas with their captured shared pointer are destroyed at the end of the method
+    disconnect(connection);
+    disconnect(slicesReadConnection);
     m_lastErrorMessageToUser = m_volumeReader->getLastErrorMessageToUser();
 
     DEBUG_LOG(QString("End VolumeReaderJob::run() with Volume: %1 and result %2").arg(m_volumeIdentifier.getValue()).arg(m_volumeReadSuccessfully));
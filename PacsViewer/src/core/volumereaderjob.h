@@ -22,6 +22,7 @@
 namespace udg {
 
 class Volume;
+class VolumePixelData;
 class VolumeReader;
 
 /**
@@ -34,6 +35,9 @@ class VolumeReader;
 class VolumeReaderJob : public QObject, public ThreadWeaver::Job {
 Q_OBJECT
 public:
+    /// Priorities of the jobs in the queue. Jobs with higher priority are executed first.
+    enum Priority { PrefetchPriority = -1, DefaultPriority = 0, VisibleViewerPriority = 1 };
+
     /// Constructor, cal passar-li el volume del que es vol llegir el pixel data.
     VolumeReaderJob(Volume *volume, QObject *parent = 0);
     virtual ~VolumeReaderJob();
@@ -56,9 +60,24 @@ public:
     /// Returns the identifier of the volume, even if the volume is destructed.
     const Identifier& getVolumeIdentifier() const;
 
+    /// Sets the slice that must be read first. It must be called before the job is enqueued. A negative value (the default) reads the slices in order.
+    void setFirstSliceToRead(int slice);
+
+    /// Sets the priority of the job in the queue. Jobs with higher priority are executed first. It must be called before the job is enqueued.
+    /// The default priority is DefaultPriority.
+    void setPriority(int priority);
+    /// Returns the priority of the job in the queue.
+    virtual int priority() const;
+
+    /// Returns a new VolumePixelData sharing the buffer that is being filled by the job, or null if it's not available.
+    /// Only the slices reported by slicesRead() contain valid data. The caller takes ownership.
+    VolumePixelData* createPartialVolumePixelData();
+
 signals:
     /// Signal que s'emet amb el progrés de lectura
     void progress(ThreadWeaver::JobPointer, int progress);
+    /// Signal emitted with the range of consecutive slices, around the first slice to read, that are already available through createPartialVolumePixelData().
+    void slicesRead(ThreadWeaver::JobPointer, int firstSlice, int lastSlice);
     void done(ThreadWeaver::JobPointer);
 
 protected:
@@ -78,6 +97,9 @@ private:
     /// Ens indica si s'ha fet o no un requestAbort
     bool m_abortRequested;
 
+    /// Priority of the job in the queue.
+    int m_priority;
+
 };
 
 } // End namespace udg
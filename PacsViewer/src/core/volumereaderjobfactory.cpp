@@ -68,7 +68,7 @@
 namespace udg {
 
 	VolumeReaderJobFactory::VolumeReaderJobFactory(QObject *parent)
-		: QObject(parent)
+		: QObject(parent), m_prefetchedBytes(0), m_prefetchMemoryBudget(0)
 	{
 	}
 
@@ -76,24 +76,30 @@ namespace udg {
 	{
 		m_volumesLoading.clear();
 		m_volumeRequesters.clear();
+		m_pendingPrefetchVolumes.clear();
+		m_volumesPrefetching.clear();
+		m_abortedPrefetchVolumes.clear();
 
 		this->getWeaverInstance()->dequeue();
 		this->getWeaverInstance()->requestAbort();
 		this->getWeaverInstance()->shutDown();
 
 		// Since jobs' signals are connected through queued connections and they include shared pointers to the jobs itselfs, we need to make sure that any pending
-		// signals are delivered to the corresponding receivers so that the jobs aren't kept alive in the signals queue after the factory and the resource
-		// restriction policy have been deleted.
+		// signals are delivered to the corresponding receivers so that the jobs aren't kept alive in the signals queue after the factory and the load
+		// scheduler have been deleted.
 		QApplication::processEvents();
 
 		DEBUG_LOG("VolumeReaderJobFactory is closed");
 	}
 
-	void VolumeReaderJobFactory::read(void *requester, Volume *volume)
+	void VolumeReaderJobFactory::read(void *requester, Volume *volume, int firstSliceToRead, int priority)
 	{
 		int id = volume->getIdentifier().getValue();
 		DEBUG_LOG(QString("Begin reading volume: %1").arg(id));
 
+		// Requested volumes have precedence over the prefetched ones
+		suspendPrefetch(volume);
+
 		if (this->isVolumeLoading(volume))
 		{
 			// If the volume is already loading we just add the new requester to the hash.
@@ -101,23 +107,36 @@ namespace udg {
 			// new requester is added; it can't be called until the next iteration of the event loop.
 			DEBUG_LOG(QString("Volume already loading: %1").arg(id));
 			m_volumeRequesters.insert(id, requester);
+
+			// The priority can only be changed while the job is waiting in the queue
+			QSharedPointer<VolumeReaderJob> job = this->getVolumeReaderJob(volume);
+			if (job->priority() < priority && this->getWeaverInstance()->dequeue(job))
+			{
+				DEBUG_LOG(QString("Raising the priority of volume %1 to %2").arg(id).arg(priority));
+				job->setPriority(priority);
+				this->getWeaverInstance()->enqueue(job);
+			}
 		}
 		else
 		{
-			VolumeReaderJob *volumeReaderJob = new VolumeReaderJob(volume);
-			QSharedPointer<VolumeReaderJob> jobPointer(volumeReaderJob);
-			assignResourceRestrictionPolicy(volumeReaderJob);
-
-			connect(volumeReaderJob, &VolumeReaderJob::progress, this, &VolumeReaderJobFactory::onJobProgress);
-			connect(volumeReaderJob, &VolumeReaderJob::done, this, &VolumeReaderJobFactory::onJobDone);
-			// These connections are undone when the job is destroyed
-
-			m_volumesLoading.insert(id, jobPointer);
 			m_volumeRequesters.insert(id, requester);
+			enqueueJob(volume, firstSliceToRead, priority);
+		}
+	}
 
-			ThreadWeaver::Queue *queue = this->getWeaverInstance();
-			queue->enqueue(jobPointer);
+	void VolumeReaderJobFactory::prefetch(const QList<Volume*> &volumes)
+	{
+		m_pendingPrefetchVolumes.clear();
+		foreach (Volume *volume, volumes)
+		{
+			m_pendingPrefetchVolumes << QPointer<Volume>(volume);
 		}
+
+		m_prefetchedBytes = 0;
+		m_prefetchMemoryBudget = getPrefetchMemoryBudget();
+		DEBUG_LOG(QString("Prefetch requested for %1 volumes with a budget of %2 MB").arg(volumes.size()).arg(m_prefetchMemoryBudget / (1024 * 1024)));
+
+		startPendingPrefetch();
 	}
 
 	void VolumeReaderJobFactory::cancelRead(void *requester, Volume *volume)
@@ -142,12 +161,119 @@ namespace udg {
 		}
 	}
 
-	void VolumeReaderJobFactory::assignResourceRestrictionPolicy(VolumeReaderJob *volumeReaderJob)
+	void VolumeReaderJobFactory::enqueueJob(Volume *volume, int firstSliceToRead, int priority)
+	{
+		VolumeReaderJob *volumeReaderJob = new VolumeReaderJob(volume);
+		QSharedPointer<VolumeReaderJob> jobPointer(volumeReaderJob);
+		volumeReaderJob->setFirstSliceToRead(firstSliceToRead);
+		volumeReaderJob->setPriority(priority);
+		assignLoadScheduler(volumeReaderJob);
+
+		connect(volumeReaderJob, &VolumeReaderJob::progress, this, &VolumeReaderJobFactory::onJobProgress);
+		connect(volumeReaderJob, &VolumeReaderJob::slicesRead, this, &VolumeReaderJobFactory::onJobSlicesRead);
+		connect(volumeReaderJob, &VolumeReaderJob::done, this, &VolumeReaderJobFactory::onJobDone);
+		// These connections are undone when the job is destroyed
+
+		m_volumesLoading.insert(volume->getIdentifier().getValue(), jobPointer);
+
+		ThreadWeaver::Queue *queue = this->getWeaverInstance();
+		queue->enqueue(jobPointer);
+	}
+
+	void VolumeReaderJobFactory::suspendPrefetch(Volume *requestedVolume)
+	{
+		int requestedId = requestedVolume->getIdentifier().getValue();
+		QList<QPointer<Volume> > suspendedVolumes;
+
+		foreach (int id, m_volumesPrefetching)
+		{
+			QSharedPointer<VolumeReaderJob> job = m_volumesLoading.value(id);
+			Volume *volume = job->getVolume();
+
+			if (this->getWeaverInstance()->dequeue(job))
+			{
+				m_volumesLoading.remove(id);
+				m_prefetchedBytes -= m_loadScheduler.estimateLoadCost(volume).memory;
+
+				if (id != requestedId)
+				{
+					suspendedVolumes << QPointer<Volume>(volume);
+				}
+			}
+			else if (id != requestedId)
+			{
+				// It will be prefetched again when the job finishes, see onJobDone()
+				DEBUG_LOG(QString("Aborting prefetch of volume %1").arg(id));
+				job->requestAbort();
+				m_abortedPrefetchVolumes.insert(id);
+				m_prefetchedBytes -= m_loadScheduler.estimateLoadCost(volume).memory;
+			}
+			// Otherwise the requested volume is already being prefetched and it just goes on as a regular read
+		}
+
+		m_volumesPrefetching.clear();
+		m_pendingPrefetchVolumes = suspendedVolumes + m_pendingPrefetchVolumes;
+	}
+
+	void VolumeReaderJobFactory::startPendingPrefetch()
+	{
+		// Nothing is prefetched while there are other volumes being read
+		foreach (int id, m_volumesLoading.keys())
+		{
+			if (!m_volumesPrefetching.contains(id))
+			{
+				return;
+			}
+		}
+
+		while (!m_pendingPrefetchVolumes.isEmpty())
+		{
+			Volume *volume = m_pendingPrefetchVolumes.first();
+
+			if (!volume || VolumeRepository::getRepository()->getVolume(volume->getIdentifier()) != volume || this->isVolumeLoading(volume)
+				|| volume->isPixelDataLoaded())
+			{
+				m_pendingPrefetchVolumes.removeFirst();
+				continue;
+			}
+
+			qint64 size = m_loadScheduler.estimateLoadCost(volume).memory;
+			if (m_prefetchedBytes + size > m_prefetchMemoryBudget)
+			{
+				DEBUG_LOG(QString("Prefetch memory budget reached, %1 volumes won't be prefetched").arg(m_pendingPrefetchVolumes.size()));
+				m_pendingPrefetchVolumes.clear();
+				break;
+			}
+
+			m_pendingPrefetchVolumes.removeFirst();
+			m_prefetchedBytes += size;
+			m_volumesPrefetching << volume->getIdentifier().getValue();
+			DEBUG_LOG(QString("Prefetching volume %1").arg(volume->getIdentifier().getValue()));
+			enqueueJob(volume, -1, VolumeReaderJob::PrefetchPriority);
+		}
+	}
+
+	qint64 VolumeReaderJobFactory::getPrefetchMemoryBudget() const
+	{
+		qint64 budget = qMax(Q_INT64_C(0), Settings().getValue(CoreSettings::VolumePrefetchMemoryBudget).toLongLong()) * 1024 * 1024;
+
+		VolumeRepository *repository = VolumeRepository::getRepository();
+		qint64 repositoryBudget = repository->getMemoryBudget();
+		if (repositoryBudget > 0)
+		{
+			// Prefetched volumes must not force the eviction of other volumes
+			budget = qMin(budget, qMax(Q_INT64_C(0), repositoryBudget - repository->getResidentBytes()));
+		}
+
+		return budget;
+	}
+
+	void VolumeReaderJobFactory::assignLoadScheduler(VolumeReaderJob *volumeReaderJob)
 	{
 		Settings settings;
 		int maximumNumberOfVolumesLoadingConcurrently = settings.getValue(CoreSettings::MaximumNumberOfVolumesLoadingConcurrently).toInt();
 
-		if (maximumNumberOfVolumesLoadingConcurrently <= 0)
+		if (maximumNumberOfVolumesLoadingConcurrently < 0)
 		{
 			WARN_LOG(QString("Invalid value in \"%1\" setting: %2. Resetting it to default.").arg(CoreSettings::MaximumNumberOfVolumesLoadingConcurrently)
 				.arg(maximumNumberOfVolumesLoadingConcurrently));
@@ -156,9 +282,30 @@ namespace udg {
 			DEBUG_LOG(QString("Default maximumNumberOfVolumesLoadingConcurrently: %1").arg(maximumNumberOfVolumesLoadingConcurrently));
 		}
 
-		m_resourceRestrictionPolicy.setCap(maximumNumberOfVolumesLoadingConcurrently);
-		volumeReaderJob->assignQueuePolicy(&m_resourceRestrictionPolicy);
-		INFO_LOG(QString("We limit to %1 the number of volumes loading simultaneously.").arg(m_resourceRestrictionPolicy.cap()));
+		m_loadScheduler.setMaximumNumberOfConcurrentJobs(maximumNumberOfVolumesLoadingConcurrently);
+
+		// Volumes being read must not exceed the memory left in the budget of the repository
+		VolumeRepository *repository = VolumeRepository::getRepository();
+		qint64 memoryBudget = repository->getMemoryBudget();
+		if (memoryBudget > 0)
+		{
+			m_loadScheduler.setAvailableMemory(qMax(Q_INT64_C(1), memoryBudget - repository->getResidentBytes()));
+		}
+		else
+		{
+			m_loadScheduler.setAvailableMemory(0);
+		}
+
+		VolumeLoadScheduler::LoadCost cost = m_loadScheduler.estimateLoadCost(volumeReaderJob->getVolume());
+		m_loadScheduler.addJob(volumeReaderJob, cost);
+		volumeReaderJob->assignQueuePolicy(&m_loadScheduler);
+
+		if (maximumNumberOfVolumesLoadingConcurrently > 0)
+		{
+			INFO_LOG(QString("We limit to %1 the number of volumes loading simultaneously.").arg(maximumNumberOfVolumesLoadingConcurrently));
+		}
+		DEBUG_LOG(QString("Volume %1 load cost: %2 MB, decoding %3 Mpixels, storage type %4").arg(volumeReaderJob->getVolumeIdentifier().getValue())
+			.arg(cost.memory / (1024 * 1024)).arg(cost.decoding / (1000 * 1000)).arg(cost.storageType));
 	}
 
 	void VolumeReaderJobFactory::onJobProgress(ThreadWeaver::JobPointer job, int progress)
@@ -172,17 +319,81 @@ namespace udg {
 		}
 	}
 
+	void VolumeReaderJobFactory::onJobSlicesRead(ThreadWeaver::JobPointer job, int firstSlice, int lastSlice)
+	{
+		VolumeReaderJob *volumeReaderJob = static_cast<VolumeReaderJob*>(job.get());
+		int id = volumeReaderJob->getVolumeIdentifier().getValue();
+
+		foreach(void *requester, m_volumeRequesters.values(id))
+		{
+			emit volumeReadingSlicesAvailable(requester, volumeReaderJob->getVolume(), firstSlice, lastSlice);
+		}
+	}
+
+	VolumePixelData* VolumeReaderJobFactory::createPartialPixelData(Volume *volume) const
+	{
+		QSharedPointer<VolumeReaderJob> job = this->getVolumeReaderJob(volume);
+
+		if (!job)
+		{
+			return 0;
+		}
+
+		return job->createPartialVolumePixelData();
+	}
+
 	void VolumeReaderJobFactory::onJobDone(ThreadWeaver::JobPointer job)
 	{
 		VolumeReaderJob *volumeReaderJob = static_cast<VolumeReaderJob*>(job.get());
 		int id = volumeReaderJob->getVolumeIdentifier().getValue();
 		m_volumesLoading.remove(id);
+		m_volumesPrefetching.removeAll(id);
+
+		if (m_abortedPrefetchVolumes.remove(id))
+		{
+			Volume *volume = volumeReaderJob->getVolume();
+			QList<void*> requesters = m_volumeRequesters.values(id);
+			m_volumeRequesters.remove(id);
+
+			// The volume may have been removed from the repository and be about to be deleted
+			if (VolumeRepository::getRepository()->getVolume(Identifier(id)) == volume)
+			{
+				if (volume->isPixelDataLoaded())
+				{
+					// The abort arrived too late and the volume was read anyway
+					VolumeRepository::getRepository()->volumePixelDataLoaded(volume);
+				}
+
+				if (requesters.isEmpty())
+				{
+					m_pendingPrefetchVolumes.prepend(QPointer<Volume>(volume));
+				}
+				else
+				{
+					// The volume was requested while its prefetch was being aborted, so it has to be read again
+					foreach (void *requester, requesters)
+					{
+						this->read(requester, volume);
+					}
+				}
+			}
+
+			startPendingPrefetch();
+			return;
+		}
+
+		if (volumeReaderJob->success())
+		{
+			VolumeRepository::getRepository()->volumePixelDataLoaded(volumeReaderJob->getVolume());
+		}
 		foreach(void *requester, m_volumeRequesters.values(id))
 		{
 			emit volumeReadingFinished(requester, volumeReaderJob);
 		}
 
 		m_volumeRequesters.remove(id);  // this removes all the items with id
+
+		startPendingPrefetch();
 	}
 
 	bool VolumeReaderJobFactory::isVolumeLoading(Volume *volume) const
@@ -215,6 +426,7 @@ namespace udg {
 				delete volume;
 				m_volumesLoading.remove(id);
 				m_volumeRequesters.remove(id);
+				m_volumesPrefetching.removeAll(id);
 			}
 			else
 			{
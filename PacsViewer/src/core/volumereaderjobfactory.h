@@ -19,8 +19,10 @@
 #include "singleton.h"
 
 #include <QHash>
+#include <QPointer>
+#include <QSet>
 
-#include <ThreadWeaver/ResourceRestrictionPolicy>
+#include "volumeloadscheduler.h"
 
 namespace ThreadWeaver {
 class Job;
@@ -32,6 +34,7 @@ namespace udg {
 class Identifier;
 class VolumeReaderJob;
 class Volume;
+class VolumePixelData;
 
 /**
     Classe que permet llegir el pixel data d'un volume asíncronament.
@@ -51,7 +54,15 @@ Q_OBJECT
 public:
     /// Starts reading the given volume asynchronously. Returns the job that performs the reading.
     /// It is recommended to pass the this pointer as requester.
-    void read(void *requester, Volume *volume);
+    /// If firstSliceToRead is not negative, that slice and the ones around it are read first and volumeReadingSlicesAvailable is emitted as they are
+    /// available. It's ignored if the volume is already being read.
+    /// Volumes are read in order of priority (see VolumeReaderJob::Priority). If the volume is already waiting to be read with a lower priority, its priority
+    /// is raised.
+    void read(void *requester, Volume *volume, int firstSliceToRead = -1, int priority = 0);
+
+    /// Returns a new VolumePixelData sharing the buffer that is being filled for the given volume, or null if the volume is not loading or the partial
+    /// data is not available. Only the slices reported by volumeReadingSlicesAvailable contain valid data. The caller takes ownership.
+    VolumePixelData* createPartialPixelData(Volume *volume) const;
 
     /// Removes the requester from the list of requesters of the given volume.
     void cancelRead(void *requester, Volume *volume);
@@ -61,9 +72,20 @@ public:
     /// Si volume no s'està carregant, l'esborrarà directament.
     void cancelLoadingAndDeleteVolume(Volume *volume);
 
+    /// Ens indica si el volume que se li passa s'està carregant
+    bool isVolumeLoading(Volume *volume) const;
+
+    /// Reads the given volumes in the background, in the given order, with a lower priority than the volumes requested with read(), as long as they fit in
+    /// the prefetch memory budget. Replaces the volumes of any previous prefetch request that haven't started reading yet.
+    /// Prefetching is suspended as soon as a volume is requested with read() and resumed when there are no requested volumes left to read.
+    void prefetch(const QList<Volume*> &volumes);
+
 signals:
     /// Emitted to update progress on a requested volume. The requester is the one given in read.
     void volumeReadingProgress(void *requester, Volume *volume, int progress);
+    /// Emitted with the range of consecutive slices that can already be accessed through createPartialPixelData while the volume is being read.
+    /// The requester is the one given in read.
+    void volumeReadingSlicesAvailable(void *requester, Volume *volume, int firstSlice, int lastSlice);
     /// Emitted to notify the a volume has finished reading. The requester is the one given in read.
     /// \todo Could avoid exposing the job to the outside.
     void volumeReadingFinished(void *requester, VolumeReaderJob *job);
@@ -76,29 +98,53 @@ protected:
 private slots:
     /// Emits volumeReadingProgress for each requester of the volume of this job.
     void onJobProgress(ThreadWeaver::JobPointer job, int progress);
+    /// Emits volumeReadingSlicesAvailable for each requester of the volume of this job.
+    void onJobSlicesRead(ThreadWeaver::JobPointer job, int firstSlice, int lastSlice);
     /// Emits volumeReadingFinished for each requester of the volume of this job and then removes the corresponding values from the hashes.
     void onJobDone(ThreadWeaver::JobPointer job);
 
 private:
-    /// Ens indica si el volume que se li passa s'està carregant
-    bool isVolumeLoading(Volume *volume) const;
-
     /// Ens retorna la instància de Weaver que hem de fer servir per treballar amb els jobs
     ThreadWeaver::Queue* getWeaverInstance() const;
 
     /// Ens retorna el VolumeReaderJob del Volume que se li passi, si aquest té un job assignat que l'està llegint. Si no, retornarà null.
     QSharedPointer<VolumeReaderJob> getVolumeReaderJob(Volume *volume) const;
 
-    /// Assigna una política restrictiva si tenim el setting MaximumNumberOfVolumesLoadingConcurrently definit o si
-    /// estem a windows 32 bits i hi ha possibilitat d'obrir volums que requereixin molta memòria.
-    void assignResourceRestrictionPolicy(VolumeReaderJob *volumeReaderJob);
+    /// Creates a job to read the given volume, connects it and enqueues it.
+    void enqueueJob(Volume *volume, int firstSliceToRead, int priority);
+
+    /// Dequeues the prefetch jobs that haven't started and aborts the ones that are running, so that the requested volumes are read as soon as possible.
+    /// The prefetch job of the given volume, if running, is kept and becomes a regular job. Dequeued and aborted volumes are prefetched again later.
+    void suspendPrefetch(Volume *requestedVolume);
+
+    /// Enqueues the pending prefetch volumes that fit in the prefetch memory budget, if there are no requested volumes being read.
+    void startPendingPrefetch();
+
+    /// Returns the memory budget for a new prefetch request in bytes, taking into account the memory left in the budget of the volume repository.
+    qint64 getPrefetchMemoryBudget() const;
+
+    /// Registers the job in the load scheduler with the estimated cost of reading its volume, and updates the scheduler according to the
+    /// MaximumNumberOfVolumesLoadingConcurrently setting and the memory left in the budget of the volume repository.
+    void assignLoadScheduler(VolumeReaderJob *volumeReaderJob);
 
 private:
     /// Llista dels volums que s'estan carregant
     QHash<int, QSharedPointer<VolumeReaderJob> > m_volumesLoading;
     /// Maps a volume id to its requesters.
     QMultiHash<int, void*> m_volumeRequesters;
-    ThreadWeaver::ResourceRestrictionPolicy m_resourceRestrictionPolicy;
+    /// Decides how many volumes are read concurrently.
+    VolumeLoadScheduler m_loadScheduler;
+
+    /// Volumes waiting to be prefetched, in order.
+    QList<QPointer<Volume> > m_pendingPrefetchVolumes;
+    /// Ids of the volumes being prefetched that haven't been requested with read(), in the order they were enqueued.
+    QList<int> m_volumesPrefetching;
+    /// Ids of the volumes whose prefetch has been aborted but whose job hasn't finished yet.
+    QSet<int> m_abortedPrefetchVolumes;
+    /// Memory that the volumes enqueued by the current prefetch request are expected to use, in bytes.
+    qint64 m_prefetchedBytes;
+    /// Memory budget of the current prefetch request, in bytes.
+    qint64 m_prefetchMemoryBudget;
 };
 
 } // End namespace udg
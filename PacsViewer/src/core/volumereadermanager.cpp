@@ -47,19 +47,20 @@ void VolumeReaderManager::readVolume(Volume *volume)
     readVolumes(volumes);
 }
 
-void VolumeReaderManager::readVolumes(const QList<Volume*> &volumes)
+void VolumeReaderManager::readVolumes(const QList<Volume*> &volumes, int firstSliceToRead, int priority)
 {
     initialize();
     VolumeReaderJobFactory *volumeReaderFactory = VolumeReaderJobFactory::instance();
 
     connect(volumeReaderFactory, &VolumeReaderJobFactory::volumeReadingProgress, this, &VolumeReaderManager::updateProgress);
     connect(volumeReaderFactory, &VolumeReaderJobFactory::volumeReadingFinished, this, &VolumeReaderManager::jobFinished);
+    connect(volumeReaderFactory, &VolumeReaderJobFactory::volumeReadingSlicesAvailable, this, &VolumeReaderManager::updateSlicesAvailable);
 
     foreach (Volume *volume, volumes)
     {
         m_volumesProgress.insert(volume, 0);
         m_volumes.append(volume);
-        volumeReaderFactory->read(this, volume);
+        volumeReaderFactory->read(this, volume, firstSliceToRead, priority);
     }
 }
 
@@ -97,6 +98,16 @@ QString VolumeReaderManager::getLastErrorMessageToUser()
     return m_lastError;
 }
 
+VolumePixelData* VolumeReaderManager::createPartialPixelData(Volume *volume) const
+{
+    if (!m_volumes.contains(volume))
+    {
+        return 0;
+    }
+
+    return VolumeReaderJobFactory::instance()->createPartialPixelData(volume);
+}
+
 bool VolumeReaderManager::isReading()
 {
     return m_numberOfFinishedJobs < m_volumesProgress.size();
@@ -120,6 +131,14 @@ void VolumeReaderManager::updateProgress(void *requester, Volume *volume, int pr
 }
 }
 
+void VolumeReaderManager::updateSlicesAvailable(void *requester, Volume *volume, int firstSlice, int lastSlice)
+{
+    if (requester == this && m_volumes.contains(volume))    // check also the volume just in case this comes from a previous cancelled request
+    {
+        emit slicesAvailable(volume, firstSlice, lastSlice);
+    }
+}
+
 void VolumeReaderManager::jobFinished(void *requester, VolumeReaderJob *job)
 {
     if (requester == this && m_volumes.contains(job->getVolume()))  // check also the volume just in case this comes from a previous cancelled request
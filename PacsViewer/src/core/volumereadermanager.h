@@ -22,6 +22,7 @@
 namespace udg {
 
 class Volume;
+class VolumePixelData;
 class VolumeReaderJob;
 
 /// Class that controls the asyncronous reading of volumes
@@ -36,7 +37,13 @@ public:
     void readVolume(Volume *volume);
 
     ///Starts the reading of n volumes
-    void readVolumes(const QList<Volume *> &volumes);
+    /// If firstSliceToRead is not negative, that slice and the ones around it are read first and slicesAvailable() is emitted as they are available.
+    /// The volumes are read with the given priority (see VolumeReaderJob::Priority).
+    void readVolumes(const QList<Volume *> &volumes, int firstSliceToRead = -1, int priority = 0);
+
+    /// Returns a new VolumePixelData sharing the buffer that is being filled for the given volume, or null if it's not available.
+    /// Only the slices reported by slicesAvailable() contain valid data. The caller takes ownership.
+    VolumePixelData* createPartialPixelData(Volume *volume) const;
 
     /// Cancels the reading
     void cancelReading();
@@ -59,10 +66,15 @@ signals:
     void progress(int progress);
     /// Signal emitted at the end of the reading
     void readingFinished();
+    /// Signal emitted during a progressive reading with the range of consecutive slices of the volume that can already be accessed through
+    /// createPartialPixelData().
+    void slicesAvailable(Volume *volume, int firstSlice, int lastSlice);
 
 private slots:
     /// Updates the progress of the job and emits the global progress
     void updateProgress(void *requester, Volume *volume, int progressValue);
+    /// Emits slicesAvailable() if the notification corresponds to a volume requested by this manager.
+    void updateSlicesAvailable(void *requester, Volume *volume, int firstSlice, int lastSlice);
     /// Slot executed when a job finished. It emits the signal readingFinished() if no jobs are reading.
     void jobFinished(void *requester, VolumeReaderJob *job);
 
@@ -16,11 +16,27 @@
 #include "volume.h"
 #include "logging.h"
 #include "volumereaderjobfactory.h"
+#include "volumepixeldata.h"
+#include "coresettings.h"
+#include "systeminformation.h"
+
+#include <QTimer>
+
+#include <vtkImageData.h>
 
 namespace udg {
 
 VolumeRepository::VolumeRepository()
+    : m_memoryBudget(-1), m_memoryBudgetEnforcementScheduled(false)
 {
+    m_statistics.residentBytes = 0;
+    m_statistics.memoryBudget = 0;
+    m_statistics.hits = 0;
+    m_statistics.misses = 0;
+    m_statistics.evictions = 0;
+    m_statistics.reloads = 0;
+    m_statistics.totalReloadTime = 0;
+    m_statistics.maximumReloadTime = 0;
 }
 
 Identifier VolumeRepository::addVolume(Volume *model)
@@ -50,6 +66,7 @@ void VolumeRepository::deleteVolume(Identifier id)
 
     //We remove it from the list
     this->removeItem(id);
+    forgetVolume(id.getValue());
 
     // And we eliminate it
     VolumeReaderJobFactory *volumeReader = VolumeReaderJobFactory::instance();
@@ -64,4 +81,270 @@ int VolumeRepository::getNumberOfVolumes()
     return this->getNumberOfItems();
 }
 
+void VolumeRepository::setVolumesInUse(const void *user, const QList<Volume*> &volumes)
+{
+    QSet<int> previousVolumes = m_volumesInUse.value(user);
+    QSet<int> currentVolumes;
+
+    foreach (Volume *inputVolume, volumes)
+    {
+        if (!inputVolume)
+        {
+            continue;
+        }
+
+        // Dummy volumes that stand for a volume of the repository, like the ones shown while it's being loaded, keep that volume in use.
+        // Volumes not related to the repository are ignored.
+        Volume *volume = this->getVolume(inputVolume->getIdentifier());
+        if (!volume)
+        {
+            continue;
+        }
+
+        int id = volume->getIdentifier().getValue();
+        currentVolumes.insert(id);
+
+        if (!previousVolumes.contains(id))
+        {
+            if (!VolumeReaderJobFactory::instance()->isVolumeLoading(volume) && volume->isPixelDataLoaded())
+            {
+                m_statistics.hits++;
+            }
+            else
+            {
+                m_statistics.misses++;
+
+                if (m_evictedVolumes.contains(id) && !m_reloadTimers.contains(id))
+                {
+                    m_reloadTimers[id].start();
+                }
+            }
+        }
+
+        touch(id);
+    }
+
+    if (currentVolumes.isEmpty())
+    {
+        m_volumesInUse.remove(user);
+    }
+    else
+    {
+        m_volumesInUse.insert(user, currentVolumes);
+    }
+
+    // Released volumes become the most recently used ones among the evictable volumes
+    foreach (int id, previousVolumes - currentVolumes)
+    {
+        touch(id);
+    }
+
+    if (!(previousVolumes - currentVolumes).isEmpty())
+    {
+        scheduleMemoryBudgetEnforcement();
+    }
+}
+
+void VolumeRepository::volumePixelDataLoaded(Volume *volume)
+{
+    if (!volume || this->getVolume(volume->getIdentifier()) != volume || !volume->isPixelDataLoaded())
+    {
+        return;
+    }
+
+    int id = volume->getIdentifier().getValue();
+
+    if (m_evictedVolumes.remove(id))
+    {
+        m_statistics.reloads++;
+
+        if (m_reloadTimers.contains(id))
+        {
+            qint64 reloadTime = m_reloadTimers.take(id).elapsed();
+            m_statistics.totalReloadTime += reloadTime;
+            m_statistics.maximumReloadTime = qMax(m_statistics.maximumReloadTime, reloadTime);
+            INFO_LOG(QString("Volume %1 has been reloaded in %2 ms after being evicted").arg(id).arg(reloadTime));
+        }
+    }
+
+    if (!m_leastRecentlyUsedVolumes.contains(id))
+    {
+        m_leastRecentlyUsedVolumes.append(id);
+    }
+    touch(id);
+
+    scheduleMemoryBudgetEnforcement();
+}
+
+void VolumeRepository::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = qMax(Q_INT64_C(0), bytes);
+}
+
+qint64 VolumeRepository::getMemoryBudget()
+{
+    if (m_memoryBudget < 0)
+    {
+        // The setting is in megabytes. 0 means half of the physical memory, if known, and a negative value means no limit
+        qint64 budgetInMegabytes = Settings().getValue(CoreSettings::VolumeCacheMemoryBudget).toLongLong();
+
+        if (budgetInMegabytes == 0)
+        {
+            SystemInformation *systemInformation = SystemInformation::newInstance();
+            budgetInMegabytes = systemInformation->getRAMTotalAmount() / 2;
+            delete systemInformation;
+        }
+
+        m_memoryBudget = qMax(Q_INT64_C(0), budgetInMegabytes) * 1024 * 1024;
+        INFO_LOG(QString("Volume pixel data memory budget: %1 MB").arg(m_memoryBudget / (1024 * 1024)));
+    }
+
+    return m_memoryBudget;
+}
+
+qint64 VolumeRepository::getResidentBytes() const
+{
+    qint64 residentBytes = 0;
+
+    foreach (Volume *volume, this->getItems())
+    {
+        residentBytes += getPixelDataSize(volume);
+    }
+
+    return residentBytes;
+}
+
+VolumeRepository::CacheStatistics VolumeRepository::getCacheStatistics()
+{
+    CacheStatistics statistics = m_statistics;
+    statistics.residentBytes = getResidentBytes();
+    statistics.memoryBudget = getMemoryBudget();
+    return statistics;
+}
+
+void VolumeRepository::enforceMemoryBudget()
+{
+    qint64 memoryBudget = getMemoryBudget();
+
+    if (memoryBudget <= 0)
+    {
+        return;
+    }
+
+    qint64 residentBytes = getResidentBytes();
+    int i = 0;
+
+    while (residentBytes > memoryBudget && i < m_leastRecentlyUsedVolumes.size())
+    {
+        int id = m_leastRecentlyUsedVolumes.at(i);
+        Volume *volume = this->getVolume(Identifier(id));
+
+        if (!isEvictable(volume))
+        {
+            i++;
+            continue;
+        }
+
+        qint64 pixelDataSize = getPixelDataSize(volume);
+        volume->setPixelData(new VolumePixelData());
+        residentBytes -= pixelDataSize;
+
+        m_leastRecentlyUsedVolumes.removeAt(i);
+        m_evictedVolumes.insert(id);
+        m_statistics.evictions++;
+        INFO_LOG(QString("Pixel data of volume %1 evicted to fit in the memory budget, %2 MB released").arg(id).arg(pixelDataSize / (1024 * 1024)));
+    }
+
+    if (residentBytes > memoryBudget)
+    {
+        DEBUG_LOG(QString("Volume pixel data uses %1 MB, over the budget of %2 MB, but no more volumes can be evicted")
+                  .arg(residentBytes / (1024 * 1024)).arg(memoryBudget / (1024 * 1024)));
+    }
+}
+
+void VolumeRepository::enforceScheduledMemoryBudget()
+{
+    if (m_memoryBudgetEnforcementScheduled)
+    {
+        m_memoryBudgetEnforcementScheduled = false;
+        enforceMemoryBudget();
+    }
+}
+
+void VolumeRepository::scheduleMemoryBudgetEnforcement()
+{
+    if (!m_memoryBudgetEnforcementScheduled)
+    {
+        m_memoryBudgetEnforcementScheduled = true;
+        QTimer::singleShot(0, this, SLOT(enforceScheduledMemoryBudget()));
+    }
+}
+
+bool VolumeRepository::isInUse(int id) const
+{
+    foreach (const QSet<int> &volumes, m_volumesInUse)
+    {
+        if (volumes.contains(id))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VolumeRepository::isEvictable(Volume *volume) const
+{
+    return volume && !isInUse(volume->getIdentifier().getValue()) && !VolumeReaderJobFactory::instance()->isVolumeLoading(volume)
+        && volume->isPixelDataLoaded();
+}
+
+qint64 VolumeRepository::getPixelDataSize(Volume *volume)
+{
+    // The pixel data of a volume that is being loaded is replaced from another thread, so it can't be accessed
+    if (!volume || VolumeReaderJobFactory::instance()->isVolumeLoading(volume) || !volume->isPixelDataLoaded())
+    {
+        return 0;
+    }
+
+    vtkImageData *imageData = volume->getPixelData()->getVtkData();
+
+    if (!imageData)
+    {
+        return 0;
+    }
+
+    // GetActualMemorySize() returns kibibytes
+    return static_cast<qint64>(imageData->GetActualMemorySize()) * 1024;
+}
+
+void VolumeRepository::touch(int id)
+{
+    int index = m_leastRecentlyUsedVolumes.indexOf(id);
+
+    if (index >= 0)
+    {
+        m_leastRecentlyUsedVolumes.move(index, m_leastRecentlyUsedVolumes.size() - 1);
+    }
+}
+
+void VolumeRepository::forgetVolume(int id)
+{
+    m_leastRecentlyUsedVolumes.removeAll(id);
+    m_evictedVolumes.remove(id);
+    m_reloadTimers.remove(id);
+
+    QMutableHashIterator<const void*, QSet<int> > iterator(m_volumesInUse);
+    while (iterator.hasNext())
+    {
+        iterator.next();
+        iterator.value().remove(id);
+
+        if (iterator.value().isEmpty())
+        {
+            iterator.remove();
+        }
+    }
+}
+
 }
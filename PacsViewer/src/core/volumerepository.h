@@ -19,7 +19,10 @@
 #include "volume.h"
 #include "identifier.h"
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QSet>
 
 namespace udg {
 
@@ -41,6 +44,10 @@ m_volumeRepository = VolumeRepository::getRepository();
 ...
 Volume* m_volume = m_volumeRepository->getVolume(id);
 \endcode
+
+The repository also acts as a cache of the pixel data of its volumes. When the memory used by the loaded pixel data exceeds the memory budget, the pixel data
+of the least recently used volumes that aren't shown in any viewer is released. Those volumes are loaded again, through the usual volume reading path, when
+they are needed again.
   */
 class VolumeRepository : public Repository<Volume> {
 Q_OBJECT
@@ -58,6 +65,48 @@ public:
     /// Returns the number of volumes in the repository
     int getNumberOfVolumes();
 
+    /// Statistics of the pixel data cache.
+    struct CacheStatistics
+    {
+        /// Memory used by the pixel data loaded in the volumes of the repository, in bytes.
+        qint64 residentBytes;
+        /// Memory budget, in bytes. 0 means that there's no limit.
+        qint64 memoryBudget;
+        /// Number of times a volume has been put in use with its pixel data already loaded.
+        int hits;
+        /// Number of times a volume has been put in use without its pixel data loaded.
+        int misses;
+        /// Number of times the pixel data of a volume has been released to fit in the memory budget.
+        int evictions;
+        /// Number of times the pixel data of an evicted volume has been loaded again.
+        int reloads;
+        /// Total time spent reloading evicted volumes, in milliseconds.
+        qint64 totalReloadTime;
+        /// Longest time spent reloading an evicted volume, in milliseconds.
+        qint64 maximumReloadTime;
+    };
+
+    /// Sets the volumes used by the given user (typically a viewer), replacing the ones set before. The pixel data of a volume used by someone is never
+    /// evicted. An empty list releases all the volumes of the user.
+    void setVolumesInUse(const void *user, const QList<Volume*> &volumes);
+
+    /// Notifies that the pixel data of the given volume has been read from its files, so it can be released and read again later if memory is needed.
+    void volumePixelDataLoaded(Volume *volume);
+
+    /// Sets the memory budget for the pixel data of the volumes, in bytes. 0 means that there's no limit.
+    void setMemoryBudget(qint64 bytes);
+    /// Returns the memory budget for the pixel data of the volumes, in bytes. 0 means that there's no limit.
+    qint64 getMemoryBudget();
+
+    /// Returns the memory used by the pixel data loaded in the volumes of the repository, in bytes.
+    qint64 getResidentBytes() const;
+
+    /// Returns the current statistics of the pixel data cache.
+    CacheStatistics getCacheStatistics();
+
+    /// Releases the pixel data of the least recently used volumes that aren't in use until the loaded pixel data fits in the memory budget.
+    void enforceMemoryBudget();
+
     /// Returns us the only instance of the repository.
     static VolumeRepository* getRepository()
     {
@@ -72,9 +121,54 @@ signals:
     void itemAdded(Identifier id);
     void itemRemoved(Identifier id);
 
+private slots:
+    /// Calls enforceMemoryBudget() if it has been scheduled.
+    void enforceScheduledMemoryBudget();
+
 private:
     /// It must be hidden so that we cannot create instances
     VolumeRepository();
+
+    /// Schedules a call to enforceMemoryBudget() for the next iteration of the event loop, so that the volumes involved in the current operation can be put in
+    /// use before deciding what to evict.
+    void scheduleMemoryBudgetEnforcement();
+
+    /// Returns true if the given volume is used by any user.
+    bool isInUse(int id) const;
+
+    /// Returns true if the pixel data of the given volume can be released.
+    bool isEvictable(Volume *volume) const;
+
+    /// Returns the memory used by the pixel data of the given volume, in bytes, or 0 if it's not loaded or it's being loaded.
+    static qint64 getPixelDataSize(Volume *volume);
+
+    /// Moves the given volume to the most recently used position.
+    void touch(int id);
+
+    /// Forgets everything known about the volume with the given id.
+    void forgetVolume(int id);
+
+private:
+    /// Ids of the volumes used by each user.
+    QHash<const void*, QSet<int> > m_volumesInUse;
+
+    /// Ids of the volumes whose pixel data has been read from files, from least to most recently used. Only these volumes can be evicted.
+    QList<int> m_leastRecentlyUsedVolumes;
+
+    /// Ids of the volumes whose pixel data has been evicted and hasn't been loaded again yet.
+    QSet<int> m_evictedVolumes;
+
+    /// Timers started when an evicted volume is put in use again, to measure the reload time.
+    QHash<int, QElapsedTimer> m_reloadTimers;
+
+    /// Memory budget in bytes, 0 if there's no limit or -1 if it hasn't been read from settings yet.
+    qint64 m_memoryBudget;
+
+    /// Cache statistics, except for the resident bytes and memory budget that are computed on demand.
+    CacheStatistics m_statistics;
+
+    /// True if a call to enforceMemoryBudget() has been scheduled.
+    bool m_memoryBudgetEnforcementScheduled;
 };
 
 }
@@ -32,6 +32,10 @@
 
 #include "logging.h"
 
+#include <QtGlobal>
+
+#include <vector>
+
 
 vtkCxxRevisionMacro(vtkProjectionImageFilter, "$Revision: 1.0 $");
 vtkStandardNewMacro(vtkProjectionImageFilter);
@@ -137,125 +141,217 @@ int vtkProjectionImageFilter::RequestUpdateExtent(
 }
 
 
+// Reducers of the values of the projected slices. They are selected at compile time, so that the loops that use them over whole rows of a slice
+// can be inlined and vectorized by the compiler.
 template <class T>
-void vtkProjectionImageFilterExecute(vtkProjectionImageFilter *self,
-                                     vtkImageData *inData, T *inPtr,
-                                     vtkImageData *outData, T *outPtr,
-                                     int inExt[6], int outExt[6],
-                                     int vtkNotUsed(id) )
+struct vtkProjectionImageFilterMaximum
 {
-    unsigned int projectionDimension = self->GetProjectionDimension();
-    unsigned int iA = projectionDimension, i0 = (iA + 1) % 3, i1 = (iA + 2) % 3;
+    typedef T AccumulatorType;
 
-    // per 1 thread això no cal, però per 2 o més potser sí
-    // compute the input region for this thread
-    for ( unsigned int i = 0; i < 6; i++ )
+    static inline AccumulatorType initialValue(T value)
     {
-//         DEBUG_LOG( QString( "inExt[%1] = %2 | outExt[%1] = %3" ).arg( i ).arg( inExt[i] ).arg( outExt[i] ) );
-        if( i / 2 != projectionDimension )
-        {
-            inExt[i] = outExt[i];
-        }
+        return value;
+    }
+    static inline AccumulatorType accumulate(AccumulatorType accumulated, T value)
+    {
+        // Same as qMax(accumulated, value)
+        return accumulated < value ? value : accumulated;
     }
+    static inline T getValue(AccumulatorType accumulated, unsigned long vtkNotUsed(projectionSize))
+    {
+        return accumulated;
+    }
+};
 
-    int inMin0, inMax0, inMin1, inMax1, inMinA, inMaxA;
-    inMin0 = inExt[2*i0]; inMax0 = inExt[2*i0+1];
-    inMin1 = inExt[2*i1]; inMax1 = inExt[2*i1+1];
-    inMinA = inExt[2*iA]; inMaxA = inExt[2*iA+1];
+template <class T>
+struct vtkProjectionImageFilterMinimum
+{
+    typedef T AccumulatorType;
 
-//     DEBUG_LOG( QString( "inMin0 = %1, inMax0 = %2" ).arg( inMin0 ).arg( inMax0 ) );
-//     DEBUG_LOG( QString( "inMin1 = %1, inMax1 = %2" ).arg( inMin1 ).arg( inMax1 ) );
-//     DEBUG_LOG( QString( "inMinA = %1, inMaxA = %2" ).arg( inMinA ).arg( inMaxA ) );
-    /*
-    switch (projectionDimension)
+    static inline AccumulatorType initialValue(T value)
     {
-        case 0:
-            inMin0 = inExt[2]; inMax0 = inExt[3];
-            inMin1 = inExt[4]; inMax1 = inExt[5];
-            inMinA = inExt[0]; inMaxA = inExt[1];
-            break;
-        case 1:
-            inMin0 = inExt[0]; inMax0 = inExt[1];
-            inMin1 = inExt[4]; inMax1 = inExt[5];
-            inMinA = inExt[2]; inMaxA = inExt[3];
-            break;
-        case 2:
-            inMin0 = inExt[0]; inMax0 = inExt[1];
-            inMin1 = inExt[2]; inMax1 = inExt[3];
-            inMinA = inExt[4]; inMaxA = inExt[5];
-            break;
+        return value;
+    }
+    static inline AccumulatorType accumulate(AccumulatorType accumulated, T value)
+    {
+        // Same as qMin(accumulated, value)
+        return accumulated < value ? accumulated : value;
     }
-    */
+    static inline T getValue(AccumulatorType accumulated, unsigned long vtkNotUsed(projectionSize))
+    {
+        return accumulated;
+    }
+};
 
+template <class T>
+struct vtkProjectionImageFilterAverage
+{
+    typedef double AccumulatorType;
 
-    vtkIdType inIncs[3], outIncs[3];
-    inData->GetIncrements(inIncs);
-    outData->GetIncrements(outIncs);
+    static inline AccumulatorType initialValue(T value)
+    {
+        return value;
+    }
+    static inline AccumulatorType accumulate(AccumulatorType accumulated, T value)
+    {
+        return accumulated + value;
+    }
+    /// \TODO si T és float o double no s'hauria de fer el round
+    static inline T getValue(AccumulatorType accumulated, unsigned long projectionSize)
+    {
+        return static_cast<T>(qRound(accumulated / projectionSize));
+    }
+};
+
+// Projects along an axis that is not the one of the consecutive values in memory (Y or Z). For each line of the output, the rows of all the
+// slices are reduced one after the other into a row buffer, so the values are always read consecutively.
+//   runLength - number of consecutive values of a row, including all the components
+//   inIncLine, outIncLine - increments between lines in the input and the output
+//   inIncSlice - increment between the slices to project
+template <class T, class Reducer>
+void vtkProjectionImageFilterProjectRows(vtkProjectionImageFilter *self, const T *inPtr, T *outPtr, int runLength, int numberOfLines,
+                                         vtkIdType inIncLine, vtkIdType outIncLine, int numberOfSlices, vtkIdType inIncSlice,
+                                         unsigned long projectionSize)
+{
+    typedef typename Reducer::AccumulatorType AccumulatorType;
 
+    if (runLength <= 0 || numberOfSlices <= 0)
+    {
+        return;
+    }
 
+    std::vector<AccumulatorType> row(runLength);
+    AccumulatorType *rowPtr = &row[0];
 
-    int outDims[3];
-    outData->GetDimensions( outDims );
-//     DEBUG_LOG(QString("out dims: (%1, %2, %3)").arg(outDims[0]).arg(outDims[1]).arg(outDims[2]));
-//     DEBUG_LOG(QString("size = %1").arg(outData->GetPointData()->GetScalars()->GetSize()));
-//     DEBUG_LOG(QString("out incs: (%1, %2, %3)").arg(outIncs[0]).arg(outIncs[1]).arg(outIncs[2]));
+    for (int line = 0; line < numberOfLines && !self->AbortExecute; line++)
+    {
+        const T *slicePtr = inPtr + line * inIncLine;
 
+        for (int i = 0; i < runLength; i++)
+        {
+            rowPtr[i] = Reducer::initialValue(slicePtr[i]);
+        }
 
+        for (int slice = 1; slice < numberOfSlices; slice++)
+        {
+            slicePtr += inIncSlice;
 
-    vtkIdType inInc0, inInc1, inIncA, outInc0, outInc1;
-    inInc0 = inIncs[i0]; inInc1 = inIncs[i1]; inIncA = inIncs[iA];
-//     DEBUG_LOG( QString( "inInc0 = %1" ).arg( inInc0 ) );
-//     DEBUG_LOG( QString( "inInc1 = %1" ).arg( inInc1 ) );
-//     DEBUG_LOG( QString( "inIncA = %1" ).arg( inIncA ) );
-    outInc0 = outIncs[i0]; outInc1 = outIncs[i1];
+            for (int i = 0; i < runLength; i++)
+            {
+                rowPtr[i] = Reducer::accumulate(rowPtr[i], slicePtr[i]);
+            }
+        }
 
-    int step = self->GetStep();
-//     DEBUG_LOG( QString( "step = %1" ).arg( step ) );
-    unsigned long projectionSize = self->GetNumberOfSlicesToProject();
+        T *outLinePtr = outPtr + line * outIncLine;
 
-    // instantiate the accumulator
-    udg::Accumulator<T> * accumulator = udg::AccumulatorFactory::getAccumulator<T>(self->GetAccumulatorType(), projectionSize);
+        for (int i = 0; i < runLength; i++)
+        {
+            outLinePtr[i] = Reducer::getValue(rowPtr[i], projectionSize);
+        }
+    }
+}
 
-    // Fem tota la composició per cada component
-    // TODO Potser es podria millorar la coherència de cache o alguna història d'aquestes canviant l'ordre dels bucles
-    //      però de moment ja funciona bé.
-    int numberOfComponents = inData->GetNumberOfScalarComponents();
+// Projects along the axis of the consecutive values in memory (X). Each output value is reduced from a run of values of the same row.
+template <class T, class Reducer>
+void vtkProjectionImageFilterProjectPixels(vtkProjectionImageFilter *self, const T *inPtr, T *outPtr, int numberOfComponents,
+                                           int size0, vtkIdType inInc0, vtkIdType outInc0, int size1, vtkIdType inInc1, vtkIdType outInc1,
+                                           int numberOfSlices, vtkIdType inIncSlice, unsigned long projectionSize)
+{
+    typedef typename Reducer::AccumulatorType AccumulatorType;
 
-    for (int component = 0; component < numberOfComponents; component++)
+    if (numberOfSlices <= 0)
     {
-        // loop through pixels of input
-        T * inPtr0 = inPtr + component;
-        T * outPtr0 = outPtr + component;
+        return;
+    }
 
-        for ( int inIdx0 = inMin0; inIdx0 <= inMax0 && !self->AbortExecute; ++inIdx0 )
+    for (int index1 = 0; index1 < size1 && !self->AbortExecute; index1++)
+    {
+        for (int index0 = 0; index0 < size0; index0++)
         {
-            T * inPtr1 = inPtr0;
-            T * outPtr1 = outPtr0;
+            const T *pixelPtr = inPtr + index1 * inInc1 + index0 * inInc0;
+            T *outPixelPtr = outPtr + index1 * outInc1 + index0 * outInc0;
 
-            for ( int inIdx1 = inMin1; inIdx1 <= inMax1 && !self->AbortExecute; ++inIdx1 )
+            for (int component = 0; component < numberOfComponents; component++)
             {
-                // init the accumulator before a new set of pixels
-                accumulator->initialize();
-
-                T * inPtrA = inPtr1;
+                const T *slicePtr = pixelPtr + component;
+                AccumulatorType accumulated = Reducer::initialValue(*slicePtr);
 
-                for ( int inIdxA = inMinA; inIdxA <= inMaxA && !self->AbortExecute; inIdxA += step )
+                for (int slice = 1; slice < numberOfSlices; slice++)
                 {
-                    accumulator->accumulate( *inPtrA );
-                    inPtrA += (step * inIncA);
+                    slicePtr += inIncSlice;
+                    accumulated = Reducer::accumulate(accumulated, *slicePtr);
                 }
 
-                *outPtr1 = accumulator->getValue();
-
-                inPtr1 += inInc1;
-                outPtr1 += outInc1;
+                outPixelPtr[component] = Reducer::getValue(accumulated, projectionSize);
             }
+        }
+    }
+}
+
+template <class T, class Reducer>
+void vtkProjectionImageFilterProject(vtkProjectionImageFilter *self, vtkImageData *inData, const T *inPtr, vtkImageData *outData, T *outPtr,
+                                     int inExt[6], int outExt[6])
+{
+    unsigned int iA = self->GetProjectionDimension();
+
+    vtkIdType inIncs[3], outIncs[3];
+    inData->GetIncrements(inIncs);
+    outData->GetIncrements(outIncs);
+
+    int step = self->GetStep();
+    int numberOfSlices = (inExt[2*iA+1] - inExt[2*iA]) / step + 1;
+    vtkIdType inIncSlice = step * inIncs[iA];
+    unsigned long projectionSize = self->GetNumberOfSlicesToProject();
+    int numberOfComponents = inData->GetNumberOfScalarComponents();
+
+    if (iA == 0)
+    {
+        vtkProjectionImageFilterProjectPixels<T, Reducer>(self, inPtr, outPtr, numberOfComponents,
+                                                          outExt[3] - outExt[2] + 1, inIncs[1], outIncs[1],
+                                                          outExt[5] - outExt[4] + 1, inIncs[2], outIncs[2],
+                                                          numberOfSlices, inIncSlice, projectionSize);
+    }
+    else
+    {
+        // The rows along X are consecutive in memory, with the components of each pixel together
+        unsigned int iLine = iA == 1 ? 2 : 1;
+        vtkProjectionImageFilterProjectRows<T, Reducer>(self, inPtr, outPtr, (outExt[1] - outExt[0] + 1) * numberOfComponents,
+                                                        outExt[2*iLine+1] - outExt[2*iLine] + 1, inIncs[iLine], outIncs[iLine],
+                                                        numberOfSlices, inIncSlice, projectionSize);
+    }
+}
+
+template <class T>
+void vtkProjectionImageFilterExecute(vtkProjectionImageFilter *self,
+                                     vtkImageData *inData, T *inPtr,
+                                     vtkImageData *outData, T *outPtr,
+                                     int inExt[6], int outExt[6],
+                                     int vtkNotUsed(id) )
+{
+    unsigned int projectionDimension = self->GetProjectionDimension();
 
-            inPtr0 += inInc0;
-            outPtr0 += outInc0;
+    // per 1 thread això no cal, però per 2 o més potser sí
+    // compute the input region for this thread
+    for ( unsigned int i = 0; i < 6; i++ )
+    {
+        if( i / 2 != projectionDimension )
+        {
+            inExt[i] = outExt[i];
         }
     }
-    delete accumulator;
+
+    switch (self->GetAccumulatorType())
+    {
+        case udg::AccumulatorFactory::Maximum:
+            vtkProjectionImageFilterProject<T, vtkProjectionImageFilterMaximum<T> >(self, inData, inPtr, outData, outPtr, inExt, outExt);
+            break;
+        case udg::AccumulatorFactory::Minimum:
+            vtkProjectionImageFilterProject<T, vtkProjectionImageFilterMinimum<T> >(self, inData, inPtr, outData, outPtr, inExt, outExt);
+            break;
+        case udg::AccumulatorFactory::Average:
+            vtkProjectionImageFilterProject<T, vtkProjectionImageFilterAverage<T> >(self, inData, inPtr, outData, outPtr, inExt, outExt);
+            break;
+    }
 }
 
 
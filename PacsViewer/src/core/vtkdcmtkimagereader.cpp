@@ -23,21 +23,32 @@
 #include "photometricinterpretation.h"
 #include "imageorientation.h"
 
+#include <climits>
+#include <cmath>
+#include <exception>
+#include <limits>
+
+#include <QAtomicInt>
 #include <QSharedPointer>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtConcurrentRun>
 
 #include <vtkDataArray.h>
-#include <vtkImageCast.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
+#include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkStringArray.h>
 
 #include <vtkObjectFactory.h>
 
+#include <dcdeftag.h>   // DCM_BitsStored, etc.
 #include <dcfilefo.h>   // DcmFileFormat
 #include <dcmimage.h>   // DicomImage
 
@@ -45,27 +56,14 @@ namespace udg {
 
 namespace {
 
+// Maximum size in bytes of the decoded data of the frames that don't fit in the scalar type kept until it's changed. Beyond it, those frames are decoded
+// again once the scalar type has been changed.
+const size_t MaximumDeferredFramesSize = 64 * 1024 * 1024;
+
 // This exception is thrown when a file can't be loaded.
 class CantLoadFileException {
 };
 
-// This exception is thrown when the current data scalar type has to be changed.
-class ChangeScalarTypeException {
-public:
-    ChangeScalarTypeException(int newScalarType) :
-        m_newScalarType(newScalarType)
-    {
-    }
-    // Returns the new scalar type.
-    int getNewScalarType() const
-    {
-        return m_newScalarType;
-    }
-private:
-    // New scalar type represented as a VTK constant.
-    int m_newScalarType;
-};
-
 // Reads the tag from the given functional groups sequence. Returns null string if it hasn't read.
 QString getTagValueFromFunctionalGroupsSequence(DICOMSequenceAttribute *functionalGroupsSequence, int index, const DICOMTag &sequenceTag, const DICOMTag &tag)
 {
@@ -137,6 +135,153 @@ int getSuitableScalarType(int bitsStored, int pixelRepresentation)
     }
 }
 
+// Returns the smallest VTK integer scalar type that can hold all the values in the given range using at most the given number of bytes. If the range needs
+// more bytes, returns the type with the given number of bytes and the appropriate signedness, and the few frames with values out of it are handled later.
+int getSmallestScalarTypeForRange(double minimum, double maximum, int maximumBytes)
+{
+    if (minimum >= 0.0)
+    {
+        if (maximum <= UCHAR_MAX || maximumBytes < 2)
+        {
+            return VTK_UNSIGNED_CHAR;
+        }
+        else if (maximum <= USHRT_MAX || maximumBytes < 4)
+        {
+            return VTK_UNSIGNED_SHORT;
+        }
+        else
+        {
+            return VTK_UNSIGNED_INT;
+        }
+    }
+    else
+    {
+        if ((minimum >= SCHAR_MIN && maximum <= SCHAR_MAX) || maximumBytes < 2)
+        {
+            return VTK_SIGNED_CHAR;
+        }
+        else if ((minimum >= SHRT_MIN && maximum <= SHRT_MAX) || maximumBytes < 4)
+        {
+            return VTK_SHORT;
+        }
+        else
+        {
+            return VTK_INT;
+        }
+    }
+}
+
+// Values read from a DICOM header that define the range of the stored pixel values and their rescale.
+struct StoredPixelValues
+{
+    double minimum;
+    double maximum;
+    int bytesStored;
+    double slope;
+    double intercept;
+};
+
+// Reads the stored pixel values range and the rescale from the header of the given file, without loading the pixel data. The range is taken from Smallest
+// and Largest Image Pixel Value if present, otherwise from Bits Stored and Pixel Representation. Returns false if the file can't be read.
+bool readStoredPixelValues(const char *filename, StoredPixelValues &values)
+{
+    DcmFileFormat dicomFile;
+    // Elements longer than the default maximum read length, like pixel data, are not loaded into memory
+    OFCondition status = dicomFile.loadFile(qPrintable(QString(filename)));
+
+    if (status.bad())
+    {
+        return false;
+    }
+
+    DcmDataset *dataset = dicomFile.getDataset();
+    Uint16 bitsStored = 0;
+    Uint16 pixelRepresentation = 0;
+
+    if (dataset->findAndGetUint16(DCM_BitsStored, bitsStored).bad() || bitsStored == 0 || bitsStored > 32)
+    {
+        return false;
+    }
+
+    dataset->findAndGetUint16(DCM_PixelRepresentation, pixelRepresentation);
+
+    values.bytesStored = MathTools::roundUpToPowerOf2(bitsStored) / 8;
+
+    if (pixelRepresentation == 0)
+    {
+        values.minimum = 0.0;
+        values.maximum = std::pow(2.0, bitsStored) - 1.0;
+    }
+    else
+    {
+        values.minimum = -std::pow(2.0, bitsStored - 1);
+        values.maximum = std::pow(2.0, bitsStored - 1) - 1.0;
+    }
+
+    OFString smallestPixelValue, largestPixelValue;
+
+    if (dataset->findAndGetOFString(DCM_SmallestImagePixelValue, smallestPixelValue).good() &&
+        dataset->findAndGetOFString(DCM_LargestImagePixelValue, largestPixelValue).good())
+    {
+        bool smallestOk, largestOk;
+        double smallest = QString(smallestPixelValue.c_str()).toDouble(&smallestOk);
+        double largest = QString(largestPixelValue.c_str()).toDouble(&largestOk);
+
+        if (smallestOk && largestOk && smallest <= largest)
+        {
+            values.minimum = smallest;
+            values.maximum = largest;
+        }
+    }
+
+    values.slope = 1.0;
+    values.intercept = 0.0;
+    Float64 slope, intercept;
+
+    if (dataset->findAndGetFloat64(DCM_RescaleSlope, slope).good() && slope != 0.0)
+    {
+        values.slope = slope;
+    }
+    if (dataset->findAndGetFloat64(DCM_RescaleIntercept, intercept).good())
+    {
+        values.intercept = intercept;
+    }
+
+    return true;
+}
+
+// Copies count values from the input buffer to the output buffer converting them to the output type.
+template <class InputType, class OutputType>
+void copyAndCast(const InputType *input, OutputType *output, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        output[i] = static_cast<OutputType>(input[i]);
+    }
+}
+
+// Copies count values from the input buffer to the output buffer converting them to the given output VTK scalar type.
+template <class InputType>
+void copyAndCast(const InputType *input, void *output, int outputScalarType, size_t count)
+{
+    switch (outputScalarType)
+    {
+        vtkTemplateMacro(copyAndCast(input, static_cast<VTK_TT*>(output), count));
+        default: throw std::invalid_argument("Unexpected output scalar type");  // Should not happen
+    }
+}
+
+// Copies count values from the input buffer with the given input VTK scalar type to the output buffer with the given output VTK scalar type, casting them
+// directly without intermediate buffers.
+void copyAndCast(const void *input, int inputScalarType, void *output, int outputScalarType, size_t count)
+{
+    switch (inputScalarType)
+    {
+        vtkTemplateMacro(copyAndCast(static_cast<const VTK_TT*>(input), output, outputScalarType, count));
+        default: throw std::invalid_argument("Unexpected input scalar type");  // Should not happen
+    }
+}
+
 // Converts the given DCMTK representation to the equivalent VTK scalar type constant.
 int dcmtkRepresentationToVtkScalarType(EP_Representation representation)
 {
@@ -263,6 +408,7 @@ void VtkDcmtkImageReader::PrintSelf(std::ostream &os, vtkIndent indent)
     os << indent << "Frame size: " << m_frameSize << " bytes\n";
     os << indent << "Maximum voxel value: " << m_maximumVoxelValue << "\n";
     os << indent << "Needs float scalar type: " << booleanToString(m_needsFloatScalarType) << "\n";
+    os << indent << "Number of threads: " << m_numberOfThreads << "\n";
 }
 
 void VtkDcmtkImageReader::setFrameNumbers(const QList<int> &frameNumbers)
@@ -270,10 +416,46 @@ void VtkDcmtkImageReader::setFrameNumbers(const QList<int> &frameNumbers)
     m_frameNumbers = frameNumbers;
 }
 
+void VtkDcmtkImageReader::setNumberOfThreads(int numberOfThreads)
+{
+    m_numberOfThreads = numberOfThreads;
+}
+
+int VtkDcmtkImageReader::getNumberOfThreads() const
+{
+    return m_numberOfThreads;
+}
+
+void VtkDcmtkImageReader::setFirstFrameToDecode(int frameIndex)
+{
+    m_firstFrameToDecode = frameIndex;
+}
+
+void VtkDcmtkImageReader::getDecodedFrameRange(int &firstFrame, int &lastFrame)
+{
+    QMutexLocker locker(&m_decodingMutex);
+    firstFrame = m_decodedFrameRange[0];
+    lastFrame = m_decodedFrameRange[1];
+}
+
+bool VtkDcmtkImageReader::isOutputReadyForPartialAccess()
+{
+    QMutexLocker locker(&m_decodingMutex);
+    return m_outputReadyForPartialAccess;
+}
+
 VtkDcmtkImageReader::VtkDcmtkImageReader()
 {
     this->SetNumberOfInputPorts(0);
     this->SetNumberOfOutputPorts(1);
+    m_numberOfThreads = 1;
+    m_firstFrameToDecode = -1;
+    m_decodedFramesOffset = 0;
+    m_decodedFrameRange[0] = 0;
+    m_decodedFrameRange[1] = -1;
+    m_scalarTypeIsFinal = false;
+    m_outputReadyForPartialAccess = false;
+    m_deferredFramesSize = 0;
 }
 
 int VtkDcmtkImageReader::RequestInformation(vtkInformation *vtkNotUsed(request), vtkInformationVector **vtkNotUsed(inputVector),
@@ -299,6 +481,14 @@ int VtkDcmtkImageReader::RequestInformation(vtkInformation *vtkNotUsed(request),
 
     // At the beginning we don't need a float scalar type. This will be set to true by the upcoming methods if needed.
     m_needsFloatScalarType = false;
+    m_scalarTypeIsFinal = false;
+
+    {
+        QMutexLocker locker(&m_decodingMutex);
+        m_outputReadyForPartialAccess = false;
+        m_decodedFrameRange[0] = 0;
+        m_decodedFrameRange[1] = -1;
+    }
 
     if (!readInformation(filename))
     {
@@ -306,7 +496,7 @@ int VtkDcmtkImageReader::RequestInformation(vtkInformation *vtkNotUsed(request),
         return 0;
     }
 
-    if (!decideInitialScalarTypeAndNumberOfComponents())
+    if (!decideScalarTypeAndNumberOfComponents())
     {
         throw CantReadImageException("Can't decide a scalar type for the image. This may be due to corrupt data.");
     }
@@ -338,36 +528,24 @@ int VtkDcmtkImageReader::RequestData(vtkInformation *vtkNotUsed(request), vtkInf
     int updateExtent[6];
     outputInformation->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), updateExtent);
 
-    bool retry;
+    int dimX = updateExtent[1] - updateExtent[0] + 1;
+    int dimY = updateExtent[3] - updateExtent[2] + 1;
+    m_frameSize = dimX * dimY * voxelSize(this->DataScalarType, this->NumberOfScalarComponents);
+    m_maximumVoxelValue = 0.0;
+    m_deferredFrames.clear();
+    m_deferredFramesSize = 0;
 
-    // The do-while construct allows to restart the reading with a new pixel type
-    do
+    try
     {
-        int dimX = updateExtent[1] - updateExtent[0] + 1;
-        int dimY = updateExtent[3] - updateExtent[2] + 1;
-        m_frameSize = dimX * dimY * voxelSize(this->DataScalarType, this->NumberOfScalarComponents);
-        m_maximumVoxelValue = 0.0;
-        retry = false;
-
-        try
-        {
-            if (!loadData(updateExtent))
-            {
-                return 0;
-            }
-        }
-        catch (const CantLoadFileException &)
+        if (!loadData(updateExtent))
         {
             return 0;
         }
-        catch (const ChangeScalarTypeException &exception)
-        {
-            this->DataScalarType = exception.getNewScalarType();
-            vtkDataObject::SetPointDataActiveScalarInfo(outputInformation, this->DataScalarType, this->NumberOfScalarComponents);
-            retry = true;
-        }
     }
-    while (retry);
+    catch (const CantLoadFileException &)
+    {
+        return 0;
+    }
 
     return 1;
 }
@@ -385,6 +563,8 @@ bool VtkDcmtkImageReader::readInformation(const QString &filename)
     readSpacing(dicomTagReader);
     readOrigin(dicomTagReader);
 
+    m_hasPerFrameRescale = false;
+
     // If we have a multiframe volume, read all per-frame rescale values now and keep them for later
     // Reading them individually while reading data is too slow
     if (m_isMultiframe)
@@ -602,7 +782,7 @@ void VtkDcmtkImageReader::readPerFrameRescale(const DICOMTagReader &dicomTagRead
     }
 }
 
-bool VtkDcmtkImageReader::decideInitialScalarTypeAndNumberOfComponents()
+bool VtkDcmtkImageReader::decideScalarTypeAndNumberOfComponents()
 {
     bool hasDecidedScalarType = false;
 
@@ -618,6 +798,19 @@ bool VtkDcmtkImageReader::decideInitialScalarTypeAndNumberOfComponents()
         }
     }
 
+    if (hasDecidedScalarType)
+    {
+        if (m_isMonochrome && !m_needsFloatScalarType)
+        {
+            decideMonochromeScalarTypeFromHeaders();
+        }
+        else
+        {
+            // Color data is always read as 8-bit RGB and float can hold any value
+            m_scalarTypeIsFinal = true;
+        }
+    }
+
     return hasDecidedScalarType;
 }
 
@@ -658,6 +851,69 @@ bool VtkDcmtkImageReader::decideInitialScalarTypeAndNumberOfComponents(const cha
     return true;
 }
 
+void VtkDcmtkImageReader::decideMonochromeScalarTypeFromHeaders()
+{
+    QStringList filenames;
+
+    if (this->FileName)
+    {
+        filenames << this->FileName;
+    }
+    else if (this->FileNames)
+    {
+        for (int i = 0; i < this->FileNames->GetNumberOfValues(); i++)
+        {
+            filenames << this->FileNames->GetValue(i).c_str();
+        }
+    }
+
+    double minimum = std::numeric_limits<double>::max();
+    double maximum = std::numeric_limits<double>::lowest();
+    // At least 2 bytes are allowed because rescale often moves 8-bit values out of the 8-bit range
+    int maximumBytes = 2;
+    bool hasReadAnyHeader = false;
+
+    foreach (const QString &filename, filenames)
+    {
+        StoredPixelValues storedValues;
+
+        if (!readStoredPixelValues(qPrintable(filename), storedValues))
+        {
+            continue;
+        }
+
+        QList<Rescale> rescales;
+
+        if (m_hasPerFrameRescale)
+        {
+            rescales = m_perFrameRescale;
+        }
+        else
+        {
+            Rescale rescale = { storedValues.intercept, storedValues.slope };
+            rescales << rescale;
+        }
+
+        foreach (const Rescale &rescale, rescales)
+        {
+            double rescaledMinimum = rescale.slope * storedValues.minimum + rescale.intercept;
+            double rescaledMaximum = rescale.slope * storedValues.maximum + rescale.intercept;
+            minimum = qMin(minimum, qMin(rescaledMinimum, rescaledMaximum));
+            maximum = qMax(maximum, qMax(rescaledMinimum, rescaledMaximum));
+        }
+
+        maximumBytes = qMax(maximumBytes, storedValues.bytesStored);
+        hasReadAnyHeader = true;
+    }
+
+    if (hasReadAnyHeader)
+    {
+        this->DataScalarType = getSmallestScalarTypeForRange(minimum, maximum, maximumBytes);
+        // If the type had to be limited to the stored width, some frames might not fit and the type might change after reading
+        m_scalarTypeIsFinal = this->DataScalarType == getSmallestScalarTypeForRange(minimum, maximum, sizeof(int));
+    }
+}
+
 bool VtkDcmtkImageReader::loadData(int updateExtent[6])
 {
     vtkImageData *output = this->GetOutput(0);
@@ -667,6 +923,17 @@ bool VtkDcmtkImageReader::loadData(int updateExtent[6])
 
     void *scalarPointer = output->GetScalarPointerForExtent(updateExtent);
 
+    if (m_firstFrameToDecode >= 0)
+    {
+        // Frames may be accessed before being decoded, so make sure they are blank instead of garbage
+        memset(scalarPointer, 0, m_frameSize * (updateExtent[5] - updateExtent[4] + 1));
+    }
+
+    {
+        QMutexLocker locker(&m_decodingMutex);
+        m_outputReadyForPartialAccess = m_scalarTypeIsFinal;
+    }
+
     if (this->FileName)
     {
         if (!m_isMultiframe)
@@ -680,15 +947,15 @@ bool VtkDcmtkImageReader::loadData(int updateExtent[6])
     }
     else if (this->FileNames && this->FileNames->GetNumberOfValues() > 0)
     {
-        double total = updateExtent[5] - updateExtent[4] + 1;
-        this->UpdateProgress(0.0);
-
-        for (int i = updateExtent[4]; i <= updateExtent[5] && !this->AbortExecute; i++)
+        FrameDecoderFactory decoderFactory = [this]() -> FrameDecoder
         {
-            this->loadSingleFrameFile(this->FileNames->GetValue(i), scalarPointer);
-            scalarPointer = static_cast<char*>(scalarPointer) + m_frameSize;
-            this->UpdateProgress((i - updateExtent[4] + 1) / total);
-        }
+            return [this](int frameIndex, void *frameBuffer)
+            {
+                this->loadSingleFrameFile(this->FileNames->GetValue(frameIndex), frameBuffer);
+            };
+        };
+
+        this->decodeFrames(updateExtent[4], updateExtent[5], scalarPointer, decoderFactory);
     }
     else
     {
@@ -696,7 +963,15 @@ bool VtkDcmtkImageReader::loadData(int updateExtent[6])
         return false;
     }
 
-    return !this->AbortExecute;
+    if (this->AbortExecute)
+    {
+        return false;
+    }
+
+    // The frames decoded by decodeFrames() have already been stored, and a single frame always keeps its data
+    this->storeDeferredFrames(updateExtent[4], FrameDecoderFactory());
+
+    return true;
 }
 
 void VtkDcmtkImageReader::loadSingleFrameFile(const char *filename, void *buffer)
@@ -709,10 +984,7 @@ void VtkDcmtkImageReader::loadSingleFrameFile(const char *filename, void *buffer
 
 void VtkDcmtkImageReader::loadMultiframeFile(const char *filename, void *buffer, int updateExtent[6])
 {
-    QSharedPointer<DcmDataset> dataset = getDataset(filename);
     unsigned long flags = CIF_UsePartialAccessToPixelData | (m_needsFloatScalarType ? CIF_UseFloatingInternalRepresentation : 0);
-    double total = updateExtent[5] - updateExtent[4] + 1;
-    this->UpdateProgress(0.0);
 
     if (m_frameNumbers.isEmpty())
     {
@@ -720,24 +992,209 @@ void VtkDcmtkImageReader::loadMultiframeFile(const char *filename, void *buffer,
         WARN_LOG("Reading multiframe file without frame numbers specified. Frames will be read sequentially.");
     }
 
-    for (int frameIndex = updateExtent[4]; frameIndex <= updateExtent[5] && !this->AbortExecute; frameIndex++)
+    // Partial access to pixel data modifies the dataset while reading, so each decoder needs its own dataset
+    FrameDecoderFactory decoderFactory = [this, filename, flags]() -> FrameDecoder
     {
-        int frameNumberInFile = m_frameNumbers.isEmpty() ? frameIndex : m_frameNumbers[frameIndex];
+        QSharedPointer<DcmDataset> dataset = getDataset(filename);
 
-        if (m_hasPerFrameRescale)
+        return [this, dataset, flags](int frameIndex, void *frameBuffer)
+        {
+            int frameNumberInFile = m_frameNumbers.isEmpty() ? frameIndex : m_frameNumbers.at(frameIndex);
+
+            if (m_hasPerFrameRescale)
+            {
+                const Rescale &rescale = m_perFrameRescale.at(frameNumberInFile);
+                DicomImage image(dataset.data(), dataset->getOriginalXfer(), rescale.slope, rescale.intercept, flags, frameNumberInFile, 1);
+                copyDcmtkImageToBuffer(frameBuffer, image);
+            }
+            else
+            {
+                DicomImage image(dataset.data(), dataset->getOriginalXfer(), flags, frameNumberInFile, 1);
+                copyDcmtkImageToBuffer(frameBuffer, image);
+            }
+        };
+    };
+
+    this->decodeFrames(updateExtent[4], updateExtent[5], buffer, decoderFactory);
+}
+
+void VtkDcmtkImageReader::decodeFrames(int firstFrame, int lastFrame, void *buffer, const FrameDecoderFactory &decoderFactory)
+{
+    int numberOfFrames = lastFrame - firstFrame + 1;
+    int numberOfThreads = getEffectiveNumberOfThreads(numberOfFrames);
+    QVector<int> decodingOrder = getDecodingOrder(firstFrame, lastFrame);
+    double total = numberOfFrames;
+
+    {
+        QMutexLocker locker(&m_decodingMutex);
+        m_decodedFrames.fill(false, numberOfFrames);
+        m_decodedFramesOffset = firstFrame;
+        m_decodedFrameRange[0] = 0;
+        m_decodedFrameRange[1] = -1;
+    }
+
+    this->UpdateProgress(0.0);
+
+    if (numberOfThreads <= 1)
+    {
+        FrameDecoder decodeFrame = decoderFactory();
+
+        for (int i = 0; i < numberOfFrames && !this->AbortExecute; i++)
         {
-            const Rescale &rescale = m_perFrameRescale.at(frameNumberInFile);
-            DicomImage image(dataset.data(), dataset->getOriginalXfer(), rescale.slope, rescale.intercept, flags, frameNumberInFile, 1);
-            copyDcmtkImageToBuffer(buffer, image);
+            int frameIndex = decodingOrder.at(i);
+            decodeFrame(frameIndex, static_cast<char*>(buffer) + static_cast<size_t>(frameIndex - firstFrame) * m_frameSize);
+            markFrameAsDecoded(frameIndex);
+            this->UpdateProgress((i + 1) / total);
         }
-        else
+
+        this->storeDeferredFrames(firstFrame, decoderFactory);
+        return;
+    }
+
+    // Workers claim frames in decoding order and decode each one straight into its final position in the buffer.
+    // Progress is reported from this thread because VTK observers (and the Qt slots connected to them) expect it.
+    QAtomicInt nextPositionInOrder(0);
+    QAtomicInt stopRequested(0);
+    QMutex mutex;
+    QWaitCondition frameFinished;
+    int decodedFrames = 0;
+    int finishedWorkers = 0;
+    std::exception_ptr firstException;
+
+    auto worker = [&]()
+    {
+        try
+        {
+            FrameDecoder decodeFrame = decoderFactory();
+            int positionInOrder;
+
+            while (!stopRequested.load() && !this->AbortExecute && (positionInOrder = nextPositionInOrder.fetchAndAddOrdered(1)) < numberOfFrames)
+            {
+                int frameIndex = decodingOrder.at(positionInOrder);
+                decodeFrame(frameIndex, static_cast<char*>(buffer) + static_cast<size_t>(frameIndex - firstFrame) * m_frameSize);
+                markFrameAsDecoded(frameIndex);
+
+                QMutexLocker locker(&mutex);
+                decodedFrames++;
+                frameFinished.wakeAll();
+            }
+        }
+        catch (...)
+        {
+            QMutexLocker locker(&mutex);
+
+            if (!firstException)
+            {
+                firstException = std::current_exception();
+            }
+
+            stopRequested.store(1);
+        }
+
+        QMutexLocker locker(&mutex);
+        finishedWorkers++;
+        frameFinished.wakeAll();
+    };
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(numberOfThreads);
+
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        QtConcurrent::run(&threadPool, worker);
+    }
+
+    QMutexLocker locker(&mutex);
+
+    while (finishedWorkers < numberOfThreads)
+    {
+        frameFinished.wait(&mutex);
+        int currentlyDecodedFrames = decodedFrames;
+        locker.unlock();
+        this->UpdateProgress(currentlyDecodedFrames / total);
+        locker.relock();
+    }
+
+    int currentlyDecodedFrames = decodedFrames;
+    locker.unlock();
+    threadPool.waitForDone();
+    this->UpdateProgress(currentlyDecodedFrames / total);
+
+    if (firstException)
+    {
+        std::rethrow_exception(firstException);
+    }
+
+    this->storeDeferredFrames(firstFrame, decoderFactory);
+}
+
+int VtkDcmtkImageReader::getEffectiveNumberOfThreads(int numberOfFrames) const
+{
+    int numberOfThreads = m_numberOfThreads < 1 ? QThread::idealThreadCount() : m_numberOfThreads;
+    return qBound(1, numberOfThreads, qMax(numberOfFrames, 1));
+}
+
+QVector<int> VtkDcmtkImageReader::getDecodingOrder(int firstFrame, int lastFrame) const
+{
+    QVector<int> decodingOrder;
+    decodingOrder.reserve(lastFrame - firstFrame + 1);
+
+    if (m_firstFrameToDecode < 0)
+    {
+        for (int frameIndex = firstFrame; frameIndex <= lastFrame; frameIndex++)
         {
-            DicomImage image(dataset.data(), dataset->getOriginalXfer(), flags, frameNumberInFile, 1);
-            copyDcmtkImageToBuffer(buffer, image);
+            decodingOrder.append(frameIndex);
         }
+    }
+    else
+    {
+        // Start from the first frame to decode and go alternately forwards and backwards
+        int center = qBound(firstFrame, m_firstFrameToDecode, lastFrame);
+        decodingOrder.append(center);
 
-        buffer = static_cast<char*>(buffer) + m_frameSize;
-        this->UpdateProgress((frameIndex - updateExtent[4] + 1) / total);
+        for (int distance = 1; decodingOrder.size() < lastFrame - firstFrame + 1; distance++)
+        {
+            if (center + distance <= lastFrame)
+            {
+                decodingOrder.append(center + distance);
+            }
+            if (center - distance >= firstFrame)
+            {
+                decodingOrder.append(center - distance);
+            }
+        }
+    }
+
+    return decodingOrder;
+}
+
+void VtkDcmtkImageReader::markFrameAsDecoded(int frameIndex)
+{
+    QMutexLocker locker(&m_decodingMutex);
+    m_decodedFrames[frameIndex - m_decodedFramesOffset] = true;
+
+    int lastFrame = m_decodedFramesOffset + m_decodedFrames.size() - 1;
+
+    if (m_decodedFrameRange[1] < m_decodedFrameRange[0])
+    {
+        // The range starts when the frame from which the decoding started is decoded
+        int center = m_firstFrameToDecode < 0 ? m_decodedFramesOffset : qBound(m_decodedFramesOffset, m_firstFrameToDecode, lastFrame);
+
+        if (frameIndex != center)
+        {
+            return;
+        }
+
+        m_decodedFrameRange[0] = m_decodedFrameRange[1] = center;
+    }
+
+    while (m_decodedFrameRange[0] > m_decodedFramesOffset && m_decodedFrames.at(m_decodedFrameRange[0] - 1 - m_decodedFramesOffset))
+    {
+        m_decodedFrameRange[0]--;
+    }
+    while (m_decodedFrameRange[1] < lastFrame && m_decodedFrames.at(m_decodedFrameRange[1] + 1 - m_decodedFramesOffset))
+    {
+        m_decodedFrameRange[1]++;
     }
 }
 
@@ -756,9 +1213,13 @@ void VtkDcmtkImageReader::copyDcmtkImageToBuffer(void *buffer, DicomImage &dicom
         double minimum, maximum;
         dicomImage.getMinMaxValues(minimum, maximum);
 
-        if (maximum > m_maximumVoxelValue)
         {
-            m_maximumVoxelValue = maximum;
+            QMutexLocker locker(&m_decodingMutex);
+
+            if (maximum > m_maximumVoxelValue)
+            {
+                m_maximumVoxelValue = maximum;
+            }
         }
 
         int dcmtkInternalDataScalarType = dcmtkRepresentationToVtkScalarType(dcmtkInternalData->getRepresentation());
@@ -770,34 +1231,38 @@ void VtkDcmtkImageReader::copyDcmtkImageToBuffer(void *buffer, DicomImage &dicom
         }
         else if (canConvertScalarType(dcmtkInternalDataScalarType, this->DataScalarType, maximum))
         {
-            // Internal data scalar type is different from the image data scalar type but can be converted to it
-            // Need to create temporal image data, cast it to the current image data scalar type and copy
-            vtkImageData *temporalImageData = vtkImageData::New();
-            int frameExtent[6];
-            this->GetDataExtent(frameExtent);
-            frameExtent[4] = frameExtent[5] = 0;
-            temporalImageData->SetExtent(frameExtent);
-            temporalImageData->AllocateScalars(dcmtkInternalDataScalarType, 1);
-            void *temporalImageDataBuffer = temporalImageData->GetScalarPointer();
-
-            size_t readSize = dcmtkInternalData->getCount() * voxelSize(dcmtkInternalDataScalarType, 1);
-            memcpy(temporalImageDataBuffer, dcmtkInternalData->getData(), readSize);
-
-            vtkImageCast *imageCast = vtkImageCast::New();
-            imageCast->SetInputData(temporalImageData);
-            imageCast->SetOutputScalarType(this->DataScalarType);
-            imageCast->Update();
-            memcpy(buffer, imageCast->GetOutput()->GetScalarPointer(), m_frameSize);
-
-            imageCast->Delete();
-            temporalImageData->Delete();
+            // Internal data scalar type is different from the image data scalar type but can be converted to it, cast directly into the buffer
+            copyAndCast(dcmtkInternalData->getData(), dcmtkInternalDataScalarType, buffer, this->DataScalarType, dcmtkInternalData->getCount());
         }
         else
         {
             // Internal data scalar type is different from the image data scalar type and can't be converted to it
-            // Need to find a new scalar type suitable for both and restart read
-            int newScalarType = decideNewScalarType(this->DataScalarType, dcmtkInternalDataScalarType, m_maximumVoxelValue);
-            throw ChangeScalarTypeException(newScalarType);
+            // Keep the decoded data to store it once all frames have been decoded and a suitable scalar type for all of them is known, unless too much
+            // data is already kept. The data of the first of them is always kept, so that a single frame is never decoded twice.
+            size_t dataSize = dcmtkInternalData->getCount() * voxelSize(dcmtkInternalDataScalarType, 1);
+            bool keepData;
+
+            {
+                QMutexLocker locker(&m_decodingMutex);
+                keepData = m_deferredFramesSize == 0 || m_deferredFramesSize + dataSize <= MaximumDeferredFramesSize;
+
+                if (keepData)
+                {
+                    m_deferredFramesSize += dataSize;
+                }
+            }
+
+            DeferredFrame deferredFrame;
+            deferredFrame.destination = buffer;
+            deferredFrame.scalarType = dcmtkInternalDataScalarType;
+
+            if (keepData)
+            {
+                deferredFrame.data = QByteArray(static_cast<const char*>(dcmtkInternalData->getData()), static_cast<int>(dataSize));
+            }
+
+            QMutexLocker locker(&m_decodingMutex);
+            m_deferredFrames.append(deferredFrame);
         }
     }
     else
@@ -807,6 +1272,74 @@ void VtkDcmtkImageReader::copyDcmtkImageToBuffer(void *buffer, DicomImage &dicom
     }
 }
 
+void VtkDcmtkImageReader::storeDeferredFrames(int firstFrame, const FrameDecoderFactory &decoderFactory)
+{
+    if (m_deferredFrames.isEmpty() || this->AbortExecute)
+    {
+        return;
+    }
+
+    int oldScalarType = this->DataScalarType;
+    int newScalarType = oldScalarType;
+
+    foreach (const DeferredFrame &deferredFrame, m_deferredFrames)
+    {
+        newScalarType = decideNewScalarType(newScalarType, deferredFrame.scalarType, m_maximumVoxelValue);
+    }
+
+    DEBUG_LOG(QString("%1 frames didn't fit in the scalar type decided from the headers. Changing scalar type from %2 to %3.").arg(m_deferredFrames.size())
+        .arg(oldScalarType).arg(newScalarType));
+
+    vtkImageData *output = this->GetOutput(0);
+    // Keep the old scalars alive until they have been converted
+    vtkSmartPointer<vtkDataArray> oldScalars = output->GetPointData()->GetScalars();
+    const char *oldBuffer = static_cast<const char*>(output->GetScalarPointer());
+    size_t oldFrameSize = m_frameSize;
+    size_t voxelsPerFrame = oldFrameSize / voxelSize(oldScalarType, this->NumberOfScalarComponents);
+    size_t numberOfFrames = output->GetExtent()[5] - output->GetExtent()[4] + 1;
+
+    this->DataScalarType = newScalarType;
+    vtkDataObject::SetPointDataActiveScalarInfo(this->GetOutputInformation(0), this->DataScalarType, this->NumberOfScalarComponents);
+    output->AllocateScalars(this->GetOutputInformation(0));
+    output->GetPointData()->GetScalars()->SetName("DCMTKImage");
+    char *newBuffer = static_cast<char*>(output->GetScalarPointer());
+    m_frameSize = voxelsPerFrame * voxelSize(newScalarType, this->NumberOfScalarComponents);
+
+    copyAndCast(oldBuffer, oldScalarType, newBuffer, newScalarType, voxelsPerFrame * numberOfFrames);
+
+    QList<DeferredFrame> deferredFrames = m_deferredFrames;
+    m_deferredFrames.clear();
+    m_deferredFramesSize = 0;
+    QList<int> framesToDecodeAgain;
+
+    foreach (const DeferredFrame &deferredFrame, deferredFrames)
+    {
+        int framePosition = static_cast<int>((static_cast<const char*>(deferredFrame.destination) - oldBuffer) / oldFrameSize);
+
+        if (deferredFrame.data.isEmpty())
+        {
+            framesToDecodeAgain.append(framePosition);
+        }
+        else
+        {
+            copyAndCast(deferredFrame.data.constData(), deferredFrame.scalarType, newBuffer + framePosition * m_frameSize, newScalarType, voxelsPerFrame);
+        }
+    }
+
+    if (!framesToDecodeAgain.isEmpty())
+    {
+        DEBUG_LOG(QString("Decoding again %1 frames whose data wasn't kept.").arg(framesToDecodeAgain.size()));
+
+        // Now they fit in the scalar type, so they're decoded straight into the output
+        FrameDecoder decodeFrame = decoderFactory();
+
+        foreach (int framePosition, framesToDecodeAgain)
+        {
+            decodeFrame(firstFrame + framePosition, newBuffer + framePosition * m_frameSize);
+        }
+    }
+}
+
 VtkDcmtkImageReader::CantReadImageException::CantReadImageException(const std::string &what) :
     std::runtime_error(what)
 {
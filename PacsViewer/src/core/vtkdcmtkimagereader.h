@@ -15,11 +15,15 @@
 #ifndef VTKDCMTKIMAGEREADER_H
 #define VTKDCMTKIMAGEREADER_H
 
+#include <functional>
 #include <stdexcept>
 
 #include <vtkImageReader2.h>
 
+#include <QByteArray>
 #include <QList>
+#include <QMutex>
+#include <QVector>
 
 class DicomImage;
 
@@ -56,6 +60,24 @@ public:
     /// Sets the list of frame numbers in the order they must be read from a multiframe file. No need to specify for single-frame files.
     void setFrameNumbers(const QList<int> &frameNumbers);
 
+    /// Sets the maximum number of threads used to decode frames concurrently. A value of 1 decodes all the frames sequentially in the calling thread, and a
+    /// value less than 1 uses the ideal thread count of the machine. Default value is 1.
+    void setNumberOfThreads(int numberOfThreads);
+    /// Returns the maximum number of threads used to decode frames concurrently, as set with setNumberOfThreads().
+    int getNumberOfThreads() const;
+
+    /// Sets the index of the frame that must be decoded first. The rest of frames are decoded from it outwards, so that the frames around it become available
+    /// as soon as possible. A negative value (the default) decodes the frames in order.
+    void setFirstFrameToDecode(int frameIndex);
+
+    /// Returns the largest range of consecutive frames around the first frame to decode that have already been decoded in the current read. If no frame has
+    /// been decoded yet, lastFrame will be less than firstFrame. Can be called from any thread.
+    void getDecodedFrameRange(int &firstFrame, int &lastFrame);
+
+    /// Returns true if the output scalars have been allocated with a scalar type that won't change anymore, so the frames reported by getDecodedFrameRange()
+    /// can be accessed while the rest are being read. Can be called from any thread.
+    bool isOutputReadyForPartialAccess();
+
 protected:
 
     VtkDcmtkImageReader();
@@ -84,13 +106,20 @@ private:
     void readOrigin(const DICOMTagReader &dicomTagReader);
     /// Reads rescale values from the DICOM per-frame functional groups sequence, if present.
     void readPerFrameRescale(const DICOMTagReader &dicomTagReader);
-    /// Decides the appropiate initial scalar type for the image data according to the range of values contained in one frame of the image and sets the number
-    /// of scalar components. The scalar type may change to a bigger one while reading all the data. Returns false in case of error, if it can't decide the
-    /// scalar type.
-    bool decideInitialScalarTypeAndNumberOfComponents();
+    /// Decides the appropiate scalar type for the image data according to the headers of the image files and sets the number of scalar components.
+    /// Returns false in case of error, if it can't decide the scalar type.
+    bool decideScalarTypeAndNumberOfComponents();
     /// Decides the appropiate initial scalar type for the image data according to given image file and sets the number of scalar components.
     /// Returns false in case of error, if it can't decide the scalar type.
     bool decideInitialScalarTypeAndNumberOfComponents(const char *filename);
+    /// Decides the scalar type for monochrome integer data from the bits stored, pixel value and rescale values found in the headers of all the files, so that
+    /// the type doesn't need to change while reading the data. Keeps the current scalar type if no header can be read. Sets m_scalarTypeIsFinal accordingly.
+    void decideMonochromeScalarTypeFromHeaders();
+
+    /// Function that decodes the frame with the given index into the given buffer.
+    typedef std::function<void(int, void*)> FrameDecoder;
+    /// Function that creates a frame decoder. Each decoding thread creates its own decoder, so decoders can keep state that must not be shared between threads.
+    typedef std::function<FrameDecoder()> FrameDecoderFactory;
 
     /// Loads image data from the file(s) for the given update extent.
     bool loadData(int updateExtent[6]);
@@ -98,8 +127,23 @@ private:
     void loadSingleFrameFile(const char *filename, void *buffer);
     /// Loads image data from a multiframe file, for the given update extent, into the given buffer.
     void loadMultiframeFile(const char *filename, void *buffer, int updateExtent[6]);
-    /// Copies the image data stored in the given dicom image into the given buffer.
+    /// Decodes the frames from firstFrame to lastFrame (both included) into consecutive frames of the given buffer, using decoders created by the given factory.
+    /// Frames are decoded concurrently if more than one thread is allowed, but progress is always reported from the calling thread. Any exception thrown while
+    /// decoding a frame stops the decoding of the remaining frames and is rethrown from the calling thread. The deferred frames are stored at the end.
+    void decodeFrames(int firstFrame, int lastFrame, void *buffer, const FrameDecoderFactory &decoderFactory);
+    /// Returns the number of threads that must be used to decode the given number of frames.
+    int getEffectiveNumberOfThreads(int numberOfFrames) const;
+    /// Returns the frames from firstFrame to lastFrame in the order they must be decoded, according to the first frame to decode.
+    QVector<int> getDecodingOrder(int firstFrame, int lastFrame) const;
+    /// Marks the given frame as decoded and updates the decoded frame range.
+    void markFrameAsDecoded(int frameIndex);
+    /// Copies the image data stored in the given dicom image into the given buffer. If the data doesn't fit in the current scalar type, it is kept as a
+    /// deferred frame to be stored by storeDeferredFrames().
     void copyDcmtkImageToBuffer(void *buffer, DicomImage &dicomImage);
+    /// Changes the output scalar type to one that can hold the values of all the deferred frames, converts the data already read to it and stores the
+    /// deferred frames. The deferred frames whose data wasn't kept are decoded again straight into the output with the given decoder factory, firstFrame
+    /// being the index of the frame at the start of the output.
+    void storeDeferredFrames(int firstFrame, const FrameDecoderFactory &decoderFactory);
 
 private:
 
@@ -110,6 +154,17 @@ private:
         double slope;
     };
 
+    /// Struct that holds a decoded frame that didn't fit in the scalar type that was being used when it was decoded.
+    struct DeferredFrame
+    {
+        /// Position of the frame in the output buffer at the time it was decoded.
+        void *destination;
+        /// Scalar type of the decoded data.
+        int scalarType;
+        /// Decoded data, or empty if it wasn't kept because of the size of the data already kept, and the frame has to be decoded again.
+        QByteArray data;
+    };
+
     /// List of frame numbers in the order they must be read from a multiframe file. Not used for single-frame files.
     QList<int> m_frameNumbers;
 
@@ -125,8 +180,29 @@ private:
     size_t m_frameSize;
     /// Maximum voxel value found in the image data.
     double m_maximumVoxelValue;
+    /// Frames that have to be stored after changing the scalar type.
+    QList<DeferredFrame> m_deferredFrames;
+    /// Size in bytes of the decoded data kept in m_deferredFrames.
+    size_t m_deferredFramesSize;
+    /// Protects m_maximumVoxelValue, m_deferredFrames, m_deferredFramesSize and the decoded frames state when frames are decoded concurrently or queried from other threads.
+    QMutex m_decodingMutex;
     /// If it's true, a float scalar type will be used.
     bool m_needsFloatScalarType;
+    /// Maximum number of threads used to decode frames concurrently.
+    int m_numberOfThreads;
+
+    /// Index of the frame that must be decoded first, or a negative value to decode the frames in order.
+    int m_firstFrameToDecode;
+    /// For each frame of the current read, true if it has already been decoded.
+    QVector<bool> m_decodedFrames;
+    /// Index of the frame corresponding to the first position of m_decodedFrames.
+    int m_decodedFramesOffset;
+    /// Range of consecutive decoded frames around the first frame to decode.
+    int m_decodedFrameRange[2];
+    /// True if the scalar type decided before reading can hold any value of the files, so it won't change while reading.
+    bool m_scalarTypeIsFinal;
+    /// True once the output scalars have been allocated with a final scalar type.
+    bool m_outputReadyForPartialAccess;
 
 };
 
@@ -16,14 +16,26 @@
 
 #include "logging.h"
 
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkIntArray.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 
 namespace udg {
 
+namespace {
+
+// Name of the field data array where the number of phases of the arranged slices is recorded, so that it goes along with the data
+const char *NumberOfPhasesOfArrangedSlicesArrayName = "NumberOfPhasesOfArrangedSlices";
+
+}
+
 vtkStandardNewMacro(VtkImageExtractPhase)
 
 void VtkImageExtractPhase::PrintSelf(std::ostream &os, vtkIndent indent)
@@ -56,6 +68,41 @@ void VtkImageExtractPhase::setPhase(int phase)
     this->Modified();
 }
 
+void VtkImageExtractPhase::setNumberOfPhasesOfArrangedSlices(vtkImageData *imageData, int numberOfPhases)
+{
+    if (!imageData)
+    {
+        return;
+    }
+
+    imageData->GetFieldData()->RemoveArray(NumberOfPhasesOfArrangedSlicesArrayName);
+
+    if (numberOfPhases > 1)
+    {
+        vtkSmartPointer<vtkIntArray> array = vtkSmartPointer<vtkIntArray>::New();
+        array->SetName(NumberOfPhasesOfArrangedSlicesArrayName);
+        array->InsertNextValue(numberOfPhases);
+        imageData->GetFieldData()->AddArray(array);
+    }
+}
+
+int VtkImageExtractPhase::getNumberOfPhasesOfArrangedSlices(vtkImageData *imageData)
+{
+    if (!imageData || !imageData->GetFieldData())
+    {
+        return 1;
+    }
+
+    vtkDataArray *array = imageData->GetFieldData()->GetArray(NumberOfPhasesOfArrangedSlicesArrayName);
+
+    if (!array || array->GetNumberOfTuples() < 1)
+    {
+        return 1;
+    }
+
+    return static_cast<int>(array->GetTuple1(0));
+}
+
 VtkImageExtractPhase::VtkImageExtractPhase()
  : m_numberOfPhases(1), m_phase(0)
 {
@@ -96,8 +143,11 @@ int VtkImageExtractPhase::RequestUpdateExtent(vtkInformation *vtkNotUsed(request
         vtkInformation *outInfo = outputVector->GetInformationObject(0);
         int extent[6];
         outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent);
+        int wholeExtent[6];
+        inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
 
-        computeInputExtentFromOutputExtent(extent, extent);
+        extent[4] = wholeExtent[4];
+        extent[5] = wholeExtent[5];
 
         inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), extent, 6);
     }
@@ -105,79 +155,64 @@ int VtkImageExtractPhase::RequestUpdateExtent(vtkInformation *vtkNotUsed(request
     return 1;
 }
 
-namespace {
-
-// Executes the algorithm for a specific data type.
-template <class T>
-void execute(vtkImageData *inData, vtkImageData *outData, int inExtent[6], int outExtent[6], int numberOfPhases)
+int VtkImageExtractPhase::RequestData(vtkInformation *vtkNotUsed(request), vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
-    T *outPtr = static_cast<T*>(outData->GetScalarPointerForExtent(outExtent));
-
-    // Get increments to march through data
-    vtkIdType inIncX, inIncY, inIncZ;
-    inData->GetContinuousIncrements(inExtent, inIncX, inIncY, inIncZ);
-    vtkIdType outIncX, outIncY, outIncZ;
-    outData->GetContinuousIncrements(outExtent, outIncX, outIncY, outIncZ);
+    vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+    vtkImageData *input = vtkImageData::GetData(inInfo);
+    vtkImageData *output = vtkImageData::GetData(outputVector);
+    vtkDataArray *inScalars = input->GetPointData()->GetScalars();
 
-    for (int iz = inExtent[4], oz = outExtent[4]; oz <= outExtent[5]; iz += numberOfPhases, oz++)
+    if (!canExtractPhase(inInfo) || !inScalars)
     {
-        // Extract each time the input pointer for the current slice
-        inExtent[4] = iz;
-        T *inPtr = static_cast<T*>(inData->GetScalarPointerForExtent(inExtent));
-
-        for (int y = outExtent[2]; y <= outExtent[3]; y++)
-        {
-            for (int x = outExtent[0]; x <= outExtent[1]; x++)
-            {
-                for (int c = 0; c < outData->GetNumberOfScalarComponents(); c++)
-                {
-                    // TODO progress
-                    *outPtr = *inPtr;
-                    inPtr++;
-                    outPtr++;
-                }
-
-//                inPtr += inIncX;      // incX is always 0 according to the documentation
-//                outPtr += outIncX;    // incX is always 0 according to the documentation
-            }
-
-            inPtr += inIncY;
-            outPtr += outIncY;
-        }
-
-        outPtr += outIncZ;
+        WARN_LOG(QString("Can't extract the desired phase. Will return the whole image instead. (number of phases = %1, phase = %2")
+                 .arg(m_numberOfPhases).arg(m_phase));
+        output->ShallowCopy(input);
+        return 1;
     }
-}
-
-}
 
-void VtkImageExtractPhase::ThreadedRequestData(vtkInformation *vtkNotUsed(request), vtkInformationVector **inputVector,
-                                               vtkInformationVector *vtkNotUsed(outputVector), vtkImageData ***inData, vtkImageData **outData, int outExtent[6],
-                                               int vtkNotUsed(threadId))
-{
-    int inExtent[6];
-    int numberOfPhases;
+    // The output keeps the rows and columns of the input data, so that the slices of the phase are a single block of memory, or can be copied as such
+    int outExtent[6];
+    outputVector->GetInformationObject(0)->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), outExtent);
+    int *inDataExtent = input->GetExtent();
 
-    if (canExtractPhase(inputVector[0]->GetInformationObject(0)))
+    for (int i = 0; i < 4; i++)
     {
-        computeInputExtentFromOutputExtent(inExtent, outExtent);
-        numberOfPhases = m_numberOfPhases;
+        outExtent[i] = inDataExtent[i];
     }
-    else
+
+    if (!areInputSlicesArrangedByPhase(input))
     {
-        memcpy(inExtent, outExtent, sizeof(inExtent));
-        numberOfPhases = 1;
-        WARN_LOG(QString("Can't extract the desired phase. Will copy the whole image instead. (number of phases = %1, phase = %2")
-                 .arg(m_numberOfPhases).arg(m_phase));
+        output->Initialize();
+        output->SetExtent(outExtent);
+        output->SetSpacing(input->GetSpacing());
+        output->SetOrigin(input->GetOrigin());
+        output->SetDirectionMatrix(input->GetDirectionMatrix());
+        copyPhaseSlices(input, output);
+        return 1;
     }
 
-    switch (inData[0][0]->GetScalarType())
-    {
-        vtkTemplateMacro(execute<VTK_TT>(inData[0][0], outData[0], inExtent, outExtent, numberOfPhases));
+    int inExtent[6];
+    computeInputExtentFromOutputExtent(inExtent, outExtent, getNumberOfSlicesPerPhase(inInfo));
+
+    vtkIdType numberOfValues = static_cast<vtkIdType>(outExtent[1] - outExtent[0] + 1) * (outExtent[3] - outExtent[2] + 1) * (outExtent[5] - outExtent[4] + 1)
+                             * inScalars->GetNumberOfComponents();
+
+    // The memory still belongs to the input scalars (save = 1)
+    vtkSmartPointer<vtkDataArray> outScalars = vtkSmartPointer<vtkDataArray>::Take(inScalars->NewInstance());
+    outScalars->SetName(inScalars->GetName());
+    outScalars->SetNumberOfComponents(inScalars->GetNumberOfComponents());
+    outScalars->SetVoidArray(input->GetScalarPointerForExtent(inExtent), numberOfValues, 1);
+
+    output->Initialize();
+    output->SetExtent(outExtent);
+    output->SetSpacing(input->GetSpacing());
+    output->SetOrigin(input->GetOrigin());
+    output->SetDirectionMatrix(input->GetDirectionMatrix());
+    output->GetPointData()->SetScalars(outScalars);
+    // The input scalars are referenced from the output, so that the view stays valid while the output exists, even if the input is released
+    output->GetFieldData()->AddArray(inScalars);
 
-        default:
-            ERROR_LOG("Unknown scalar type");
-    }
+    return 1;
 }
 
 bool VtkImageExtractPhase::canExtractPhase(vtkInformation *inInfo) const
@@ -189,15 +224,47 @@ bool VtkImageExtractPhase::canExtractPhase(vtkInformation *inInfo) const
     return m_numberOfPhases > 0 && m_phase >= 0 && m_phase < m_numberOfPhases && depth % m_numberOfPhases == 0;
 }
 
-void VtkImageExtractPhase::computeInputExtentFromOutputExtent(int inExtent[6], const int outExtent[6]) const
+int VtkImageExtractPhase::getNumberOfSlicesPerPhase(vtkInformation *inInfo) const
+{
+    int extent[6];
+    inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent);
+
+    return (extent[5] - extent[4] + 1) / m_numberOfPhases;
+}
+
+bool VtkImageExtractPhase::areInputSlicesArrangedByPhase(vtkImageData *input) const
+{
+    // With one phase both arrangements are the same
+    return m_numberOfPhases == 1 || getNumberOfPhasesOfArrangedSlices(input) == m_numberOfPhases;
+}
+
+void VtkImageExtractPhase::computeInputExtentFromOutputExtent(int inExtent[6], const int outExtent[6], int numberOfSlicesPerPhase) const
 {
     for (int i = 0; i < 4; i++)
     {
         inExtent[i] = outExtent[i];
     }
 
-    inExtent[4] = outExtent[4] * m_numberOfPhases + m_phase;
-    inExtent[5] = outExtent[5] * m_numberOfPhases + m_phase;
+    inExtent[4] = m_phase * numberOfSlicesPerPhase + outExtent[4];
+    inExtent[5] = m_phase * numberOfSlicesPerPhase + outExtent[5];
+}
+
+void VtkImageExtractPhase::copyPhaseSlices(vtkImageData *input, vtkImageData *output) const
+{
+    vtkDataArray *inScalars = input->GetPointData()->GetScalars();
+    output->AllocateScalars(inScalars->GetDataType(), inScalars->GetNumberOfComponents());
+    output->GetPointData()->GetScalars()->SetName(inScalars->GetName());
+
+    int *outExtent = output->GetExtent();
+    size_t sliceSize = static_cast<size_t>(outExtent[1] - outExtent[0] + 1) * (outExtent[3] - outExtent[2] + 1) * input->GetScalarSize()
+                     * inScalars->GetNumberOfComponents();
+
+    // The slice of the phase at z is at z * numberOfPhases + phase in the input
+    for (int z = outExtent[4]; z <= outExtent[5]; z++)
+    {
+        memcpy(output->GetScalarPointer(outExtent[0], outExtent[2], z), input->GetScalarPointer(outExtent[0], outExtent[2], z * m_numberOfPhases + m_phase),
+               sliceSize);
+    }
 }
 
 } // namespace udg
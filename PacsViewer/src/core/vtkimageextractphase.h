@@ -15,21 +15,25 @@
 #ifndef UDG_VTKIMAGEEXTRACTPHASE_H
 #define UDG_VTKIMAGEEXTRACTPHASE_H
 
-#include <vtkThreadedImageAlgorithm.h>
+#include <vtkImageAlgorithm.h>
+
+class vtkImageData;
 
 namespace udg {
 
 /**
  * @brief The VtkImageExtractPhase class is a filter that returns the selected phase from a multi-phase image.
  *
- * Currently, all phases must have the same number of slices.
+ * All phases must have the same number of slices. If the slices of each phase are consecutive in the input (see VolumePixelData::arrangeSlicesByPhase()),
+ * which is recorded in the input itself (see setNumberOfPhasesOfArrangedSlices()), the output is a view over the slices of the phase in the input, without
+ * copying them. Otherwise the phases of each slice are expected to be together, in the order of the images, and the slices of the phase are copied.
  */
-class VtkImageExtractPhase : public vtkThreadedImageAlgorithm
+class VtkImageExtractPhase : public vtkImageAlgorithm
 {
 public:
     static VtkImageExtractPhase* New();
 
-    vtkTypeMacro(VtkImageExtractPhase, vtkThreadedImageAlgorithm)
+    vtkTypeMacro(VtkImageExtractPhase, vtkImageAlgorithm)
 
     virtual void PrintSelf(std::ostream &os, vtkIndent indent) override;
 
@@ -43,6 +47,12 @@ public:
     /// Sets the current phase.
     void setPhase(int phase);
 
+    /// Records in the given image data that its slices are arranged in the given number of phases, so that the slices of each phase are consecutive.
+    /// A number of phases of 1 records that they are in the order of the images.
+    static void setNumberOfPhasesOfArrangedSlices(vtkImageData *imageData, int numberOfPhases);
+    /// Returns the number of phases in which the slices of the given image data are arranged, or 1 if they are in the order of the images.
+    static int getNumberOfPhasesOfArrangedSlices(vtkImageData *imageData);
+
 protected:
     VtkImageExtractPhase();
     virtual ~VtkImageExtractPhase();
@@ -50,19 +60,30 @@ protected:
     /// Copies all the input information to the output, except the whole extent which is divided by the number of phases in the z dimension.
     virtual int RequestInformation(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector) override;
 
-    /// Sets the input update extent corresponding to the output update extent.
+    /// Sets the input update extent corresponding to the output update extent, which contains all the slices, since the arrangement of the slices is only
+    /// known from the input data.
     virtual int RequestUpdateExtent(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector) override;
 
-    /// Copies the selected phase from the input data to the output data.
-    virtual void ThreadedRequestData(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector, vtkImageData ***inData,
-                                     vtkImageData **outData, int outExtent[6], int threadId) override;
+    /// Makes the output data a view over the slices of the selected phase in the input data if they are arranged by phase, or copies them otherwise.
+    virtual int RequestData(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector) override;
 
 private:
     /// Returns true if this filter can extract a phase with the current values and the given input information, and false otherwise.
     bool canExtractPhase(vtkInformation *inInfo) const;
 
-    /// Computes the input extent corresponding to the given output extent.
-    void computeInputExtentFromOutputExtent(int inExtent[6], const int outExtent[6]) const;
+    /// Returns the number of slices of each phase according to the given input information.
+    int getNumberOfSlicesPerPhase(vtkInformation *inInfo) const;
+
+    /// Returns true if the slices of each phase are consecutive in the given input data, and false if they are in the order of the images.
+    bool areInputSlicesArrangedByPhase(vtkImageData *input) const;
+
+    /// Computes the input extent corresponding to the given output extent, with the given number of slices per phase. The slices of each phase must be
+    /// consecutive in the input.
+    void computeInputExtentFromOutputExtent(int inExtent[6], const int outExtent[6], int numberOfSlicesPerPhase) const;
+
+    /// Copies to the given output data, whose extent must be set, the slices of the selected phase in the given input data, which are in the order of the
+    /// images.
+    void copyPhaseSlices(vtkImageData *input, vtkImageData *output) const;
 
 private:
     /// Number of phases in the image.
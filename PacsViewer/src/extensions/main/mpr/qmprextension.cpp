@@ -28,6 +28,7 @@
 #include "toolproxy.h"
 #include "volume.h"
 #include "voilutpresetstooldata.h"
+#include "vtkimageextractphase.h"
 // Qt
 #include <QMessageBox>
 #include <QMenu>
@@ -1011,6 +1012,9 @@ void QMPRExtension::setInput(Volume *input)
     changeInfo->SetInputData(input->getVtkData());
     changeInfo->SetOutputOrigin(.0, .0, .0);
     changeInfo->Update();
+    // The filter doesn't pass the field data, where the arrangement of the slices by phase is recorded
+    VtkImageExtractPhase::setNumberOfPhasesOfArrangedSlices(changeInfo->GetOutput(),
+                                                            VtkImageExtractPhase::getNumberOfPhasesOfArrangedSlices(input->getVtkData()));
 
     // TODO Es crea un nou volum cada cop!
     m_volume = new Volume;
@@ -17,6 +17,8 @@
 #include "databaseconnection.h"
 #include "directoryutilities.h"
 #include "localdatabasemanager.h"
+#include "localdatabasepatientdal.h"
+#include "localdatabasestudydal.h"
 #include "logging.h"
 #include "starviewerapplication.h"
 #include "upgradedatabaserevisioncommands.h"
@@ -132,7 +134,19 @@ bool DatabaseInstallation::checkDatabase()
 {
     m_errorMessage = "";
 
-    return checkLocalImagePath() && checkDatabaseFile() && checkDatabaseRevision();
+    if (!checkLocalImagePath() || !checkDatabaseFile() || !checkDatabaseRevision())
+    {
+        return false;
+    }
+
+    // Without the index only searches by patient name fail, so it's not a reason to stop
+    checkPatientNameIndex();
+    // Without the column the sizes of the studies are measured again in each session
+    checkStudySizeColumn();
+    // Without the indexes saving the images of a study scans the DisplayShutter and VoiLut tables once per image
+    checkDisplayShutterAndVoiLutIndexes();
+
+    return true;
 }
 
 bool DatabaseInstallation::reinstallDatabase()
@@ -331,6 +345,66 @@ bool DatabaseInstallation::checkDatabaseRevision()
     return true;
 }
 
+void DatabaseInstallation::checkPatientNameIndex()
+{
+    DatabaseConnection databaseConnection;
+    LocalDatabasePatientDAL patientDAL(databaseConnection);
+
+    if (patientDAL.isNameIndexUpToDate())
+    {
+        return;
+    }
+
+    INFO_LOG("The patient name index is missing or outdated. It will be rebuilt.");
+
+    databaseConnection.beginTransaction();
+
+    if (patientDAL.rebuildNameIndex())
+    {
+        databaseConnection.commitTransaction();
+    }
+    else
+    {
+        databaseConnection.rollbackTransaction();
+        ERROR_LOG("Could not rebuild the patient name index. Searches by patient name will fail.");
+    }
+}
+
+void DatabaseInstallation::checkStudySizeColumn()
+{
+    DatabaseConnection databaseConnection;
+    LocalDatabaseStudyDAL studyDAL(databaseConnection);
+
+    if (studyDAL.hasSizeColumn())
+    {
+        return;
+    }
+
+    INFO_LOG("The Study table doesn't have the Size column. It will be added.");
+
+    if (!studyDAL.addSizeColumn())
+    {
+        ERROR_LOG("Could not add the Size column to the Study table. The sizes of the studies will be measured in each session.");
+    }
+}
+
+void DatabaseInstallation::checkDisplayShutterAndVoiLutIndexes()
+{
+    DatabaseConnection databaseConnection;
+    QSqlQuery query(databaseConnection.getConnection());
+    QStringList sqlCommands;
+    sqlCommands << "CREATE INDEX IF NOT EXISTS IndexDisplayShutter_ImageInstanceUIDImageFrameNumber ON DisplayShutter (ImageInstanceUID, ImageFrameNumber)"
+                << "CREATE INDEX IF NOT EXISTS IndexVoiLut_ImageInstanceUIDImageFrameNumber ON VoiLut (ImageInstanceUID, ImageFrameNumber)";
+
+    foreach (const QString &sqlCommand, sqlCommands)
+    {
+        if (!query.exec(sqlCommand))
+        {
+            ERROR_LOG(QString("Could not create an index: %1. Error: %2").arg(query.lastQuery()).arg(query.lastError().text()));
+        }
+    }
+}
+
 bool DatabaseInstallation::createLocalImagePath()
 {
     QDir localImageDir;
@@ -63,6 +63,18 @@ private:
     /// Returns true if the database revision is the expected one or if it has been upgraded or reinstalled, and false otherwise.
     bool checkDatabaseRevision();
 
+    /// Checks that the full-text index of patient names is up to date, and rebuilds it otherwise. Databases created or upgraded before the index existed
+    /// have it empty, since the names must be normalized to be indexed.
+    void checkPatientNameIndex();
+
+    /// Checks that the Study table has the column where the sizes of the studies are saved, and adds it otherwise. The database revision check doesn't
+    /// upgrade the database, so databases created before the column existed don't have it.
+    void checkStudySizeColumn();
+
+    /// Creates the indexes of the display shutters and the VOI LUTs by image if they don't exist. The database revision check doesn't upgrade the
+    /// database, so databases created before the indexes existed don't have them.
+    void checkDisplayShutterAndVoiLutIndexes();
+
     /// Creates the directory where images are stored. Returns true if successful and false otherwise.
     bool createLocalImagePath();
 
@@ -0,0 +1,489 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "incomingdicomconnectionsdispatcher.h"
+
+// Make sure OS specific configuration is included first
+#include <osconfig.h>
+#include <diutil.h>
+#include <dcfilefo.h>
+#include <dcdeftag.h>
+#include <dimse.h>
+
+#include <QRunnable>
+#include <QThread>
+
+#include "inputoutputsettings.h"
+#include "logging.h"
+#include "retrievedicomfilesfrompacs.h"
+
+namespace udg {
+
+namespace {
+
+// Seconds the listener waits for an association before checking if it has to stop
+const int ListenerPollingTimeout = 1;
+// Maximum number of associations served at the same time. Each association keeps a thread blocked while the PACS sends the files
+const int MaximumNumberOfConcurrentAssociations = 32;
+
+struct StoreSCPCallbackData
+{
+    IncomingDICOMConnectionsDispatcher *dispatcher;
+    /// File being received. It's set to null when it's handed over to its retrieve
+    DcmFileFormat *dcmFileFormat;
+    bool abortAssociation;
+};
+
+}
+
+class IncomingDICOMConnectionsDispatcher::ListenerThread : public QThread {
+public:
+    ListenerThread(IncomingDICOMConnectionsDispatcher *dispatcher)
+        : m_dispatcher(dispatcher)
+    {
+    }
+
+protected:
+    virtual void run()
+    {
+        m_dispatcher->listen();
+    }
+
+private:
+    IncomingDICOMConnectionsDispatcher *m_dispatcher;
+};
+
+class IncomingDICOMConnectionsDispatcher::AssociationHandler : public QRunnable {
+public:
+    AssociationHandler(IncomingDICOMConnectionsDispatcher *dispatcher, T_ASC_Association *association)
+        : m_dispatcher(dispatcher), m_association(association)
+    {
+    }
+
+    virtual void run()
+    {
+        m_dispatcher->serveAssociation(m_association);
+    }
+
+private:
+    IncomingDICOMConnectionsDispatcher *m_dispatcher;
+    T_ASC_Association *m_association;
+};
+
+IncomingDICOMConnectionsDispatcher::IncomingDICOMConnectionsDispatcher()
+    : m_network(NULL), m_listenerThread(NULL), m_stopRequested(0), m_timeout(0)
+{
+    m_associationsThreadPool.setMaxThreadCount(MaximumNumberOfConcurrentAssociations);
+}
+
+IncomingDICOMConnectionsDispatcher::~IncomingDICOMConnectionsDispatcher()
+{
+    stopListening();
+}
+
+PACSRequestStatus::RetrieveRequestStatus IncomingDICOMConnectionsDispatcher::registerRetrieve(RetrieveDICOMFilesFromPACS *retrieve, const QString &studyInstanceUID)
+{
+    QMutexLocker registrationLocker(&m_registrationMutex);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_retrievesByStudyInstanceUID.contains(studyInstanceUID))
+        {
+            ERROR_LOG("The study " + studyInstanceUID + " is already being retrieved, its files can't be received by another retrieve");
+            return PACSRequestStatus::RetrieveStudyAlreadyBeingRetrieved;
+        }
+    }
+
+    if (m_network == NULL && !startListening())
+    {
+        return PACSRequestStatus::RetrieveIncomingDICOMConnectionsPortInUse;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_retrievesByStudyInstanceUID.insert(studyInstanceUID, retrieve);
+    m_numberOfDeliveriesInProgress.insert(retrieve, 0);
+
+    return PACSRequestStatus::RetrieveOk;
+}
+
+void IncomingDICOMConnectionsDispatcher::unregisterRetrieve(RetrieveDICOMFilesFromPACS *retrieve)
+{
+    QMutexLocker registrationLocker(&m_registrationMutex);
+
+    bool noRetrievesLeft;
+    {
+        QMutexLocker locker(&m_mutex);
+
+        // Once it's removed no new files are delivered to it, but the ones being delivered must finish before the retrieve can be destroyed
+        QString studyInstanceUID = m_retrievesByStudyInstanceUID.key(retrieve);
+        m_retrievesByStudyInstanceUID.remove(studyInstanceUID);
+
+        while (m_numberOfDeliveriesInProgress.value(retrieve) > 0)
+        {
+            m_deliveryFinished.wait(&m_mutex);
+        }
+        m_numberOfDeliveriesInProgress.remove(retrieve);
+
+        noRetrievesLeft = m_retrievesByStudyInstanceUID.isEmpty();
+    }
+
+    if (noRetrievesLeft)
+    {
+        stopListening();
+    }
+}
+
+bool IncomingDICOMConnectionsDispatcher::startListening()
+{
+    Settings settings;
+    int port = settings.getValue(InputOutputSettings::IncomingDICOMConnectionsPort).toInt();
+    m_timeout = settings.getValue(InputOutputSettings::PACSConnectionTimeout).toInt();
+
+    OFCondition condition = ASC_initializeNetwork(NET_ACCEPTOR, port, m_timeout, &m_network);
+    if (condition.bad())
+    {
+        ERROR_LOG("The port " + QString::number(port) + " for incoming PACS connections could not be opened, description error: " +
+                  QString(condition.text()));
+        m_network = NULL;
+        return false;
+    }
+
+    INFO_LOG("Listening for incoming PACS connections on port " + QString::number(port));
+
+    m_stopRequested.store(0);
+    m_listenerThread = new ListenerThread(this);
+    m_listenerThread->start();
+
+    return true;
+}
+
+void IncomingDICOMConnectionsDispatcher::stopListening()
+{
+    if (m_network == NULL)
+    {
+        return;
+    }
+
+    m_stopRequested.store(1);
+    m_listenerThread->wait();
+    delete m_listenerThread;
+    m_listenerThread = NULL;
+    m_associationsThreadPool.waitForDone();
+
+    OFCondition condition = ASC_dropNetwork(&m_network);
+    if (condition.bad())
+    {
+        ERROR_LOG("Error closing incoming connection port, descripcio error: " + QString(condition.text()));
+    }
+    m_network = NULL;
+
+    INFO_LOG("Incoming PACS connections port closed");
+}
+
+void IncomingDICOMConnectionsDispatcher::listen()
+{
+    while (m_stopRequested.load() == 0)
+    {
+        if (!ASC_associationWaiting(m_network, ListenerPollingTimeout))
+        {
+            continue;
+        }
+
+        T_ASC_Association *association = NULL;
+        OFCondition condition = acceptAssociation(&association);
+        if (condition.bad())
+        {
+            ERROR_LOG("An error occurred while negotiating the association of the incoming DICOM connection, description error: " +
+                      QString(condition.text()));
+        }
+        else
+        {
+            INFO_LOG(QString("Connection request received by the incoming DICOM connection port from %1.").arg(association->params->DULparams.callingAPTitle));
+            m_associationsThreadPool.start(new AssociationHandler(this, association));
+        }
+    }
+}
+
+OFCondition IncomingDICOMConnectionsDispatcher::acceptAssociation(T_ASC_Association **association)
+{
+    const char *knownAbstractSyntaxes[] = { UID_VerificationSOPClass };
+    const char *transferSyntaxes[] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                       NULL, NULL, NULL , NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+    int numTransferSyntaxes;
+
+    OFCondition condition = ASC_receiveAssociation(m_network, association, ASC_DEFAULTMAXPDU);
+
+    if (condition.good())
+    {
+#ifndef DISABLE_COMPRESSION_EXTENSION
+        // If we have compression we ask for it, and we can speed up the download time considerably
+        // For now we ask for the lossless compression that every PACS that supports compression has
+        // to provide: JPEGLossless: Non-Hierarchical-1stOrderPrediction
+        transferSyntaxes[0] = UID_JPEGProcess14SV1TransferSyntax;//UID_LittleEndianImplicitTransferSyntax;//
+        transferSyntaxes[1] = UID_LittleEndianExplicitTransferSyntax;
+        transferSyntaxes[2] = UID_BigEndianExplicitTransferSyntax;
+        transferSyntaxes[3] = UID_LittleEndianImplicitTransferSyntax;//UID_JPEGProcess14SV1TransferSyntax;//
+        transferSyntaxes[4] = UID_JPEGLSLosslessTransferSyntax;
+        transferSyntaxes[5] = UID_JPEG2000LosslessOnlyTransferSyntax;
+        transferSyntaxes[6] = UID_JPEG2000TransferSyntax;
+        transferSyntaxes[7] = UID_JPEGProcess2_4TransferSyntax;
+        transferSyntaxes[8] = UID_JPEGProcess1TransferSyntax;
+        transferSyntaxes[9] = UID_JPEGLSLossyTransferSyntax;
+        numTransferSyntaxes = 10;
+
+        //  transferSyntaxes ??? ---> query ASC_acceptContextsWithPreferredTransferSyntaxes
+
+#else
+        // Defined in dcxfer.h
+        if (gLocalByteOrder == EBO_LittleEndian)
+        {
+            transferSyntaxes[0] = UID_LittleEndianExplicitTransferSyntax;
+            transferSyntaxes[1] = UID_BigEndianExplicitTransferSyntax;
+        }
+        else
+        {
+            transferSyntaxes[0] = UID_BigEndianExplicitTransferSyntax;
+            transferSyntaxes[1] = UID_LittleEndianExplicitTransferSyntax;
+        }
+        transferSyntaxes[2] = UID_LittleEndianImplicitTransferSyntax;
+        numTransferSyntaxes = 3;
+#endif
+
+        // Accept the Verification SOP Class if presented
+        condition = ASC_acceptContextsWithPreferredTransferSyntaxes(
+                    (*association)->params, knownAbstractSyntaxes, DIM_OF(knownAbstractSyntaxes),
+                    transferSyntaxes, numTransferSyntaxes);
+
+        if (condition.good())
+        {
+#ifdef  PACKAGE_VERSION_NUMBER
+
+#if PACKAGE_VERSION_NUMBER == 361
+            // The array of Storage SOP Class UIDs comes from dcuid.h
+            condition = ASC_acceptContextsWithPreferredTransferSyntaxes(
+                        (*association)->params, dcmAllStorageSOPClassUIDs, numberOfAllDcmStorageSOPClassUIDs,
+                        transferSyntaxes, numTransferSyntaxes);
+#else //if  PACKAGE_VERSION_NUMBER  >= 363
+
+            condition = ASC_acceptContextsWithPreferredTransferSyntaxes(
+                        (*association)->params, dcmAllStorageSOPClassUIDs, numberOfDcmAllStorageSOPClassUIDs,
+                        transferSyntaxes, numTransferSyntaxes);
+
+#endif
+
+#endif
+        }
+        else
+        {
+            ERROR_LOG("acceptAssociation ASC_acceptContextsWithPreferredTransferSyntaxes error!" + QString(condition.text()));
+        }
+    }
+
+    if (condition.good())
+    {
+        condition = ASC_acknowledgeAssociation(*association);
+    }
+    else
+    {
+        ASC_dropAssociation(*association);
+        ASC_destroyAssociation(association);
+    }
+    return condition;
+}
+
+void IncomingDICOMConnectionsDispatcher::serveAssociation(T_ASC_Association *association)
+{
+    /// We become like a service. The PACS makes us requests that we must respond,
+    /// it can ask us to store an image or do an echo
+    int secondsWithoutRequests = 0;
+
+    while (true)
+    {
+        T_DIMSE_Message dimseMessage;
+        T_ASC_PresentationContextID presentationContextID;
+        bool abortAssociation = false;
+
+        OFCondition condition = DIMSE_receiveCommand(association, DIMSE_NONBLOCKING, ListenerPollingTimeout, &presentationContextID, &dimseMessage, NULL);
+
+        if (condition == DIMSE_NODATAAVAILABLE)
+        {
+            secondsWithoutRequests += ListenerPollingTimeout;
+
+            if (m_stopRequested.load() == 0 && (m_timeout <= 0 || secondsWithoutRequests < m_timeout))
+            {
+                continue;
+            }
+
+            ERROR_LOG("The PACS has not sent any request through the incoming DICOM connection, we abort it");
+            abortAssociation = true;
+        }
+        else if (condition == EC_Normal)
+        {
+            secondsWithoutRequests = 0;
+
+            switch (dimseMessage.CommandField)
+            {
+            case DIMSE_C_STORE_RQ:
+                condition = storeSCP(association, &dimseMessage, presentationContextID, abortAssociation);
+                break;
+
+            case DIMSE_C_ECHO_RQ:
+                condition = echoSCP(association, &dimseMessage, presentationContextID);
+                break;
+
+            default:
+                ERROR_LOG("The PACS has requested an invalid type of operation");
+                condition = DIMSE_BADCOMMANDTYPE;
+                break;
+            }
+        }
+
+        // Clean up on association termination
+        if (condition == DUL_PEERREQUESTEDRELEASE)
+        {
+            INFO_LOG("The PACS requests to close the connection through which it sent us the files");
+            ASC_acknowledgeRelease(association);
+            ASC_dropSCPAssociation(association);
+            ASC_destroyAssociation(&association);
+            return;
+        }
+        else if (condition == DUL_PEERABORTEDASSOCIATION)
+        {
+            INFO_LOG("PACS aborted connection");
+            break;
+        }
+        else if (condition.bad() && condition != DIMSE_NODATAAVAILABLE)
+        {
+            ERROR_LOG("An error occurred while receiving a suboperation request, error description: " + QString(condition.text()));
+            ASC_abortAssociation(association);
+            break;
+        }
+        else if (abortAssociation)
+        {
+            INFO_LOG("We abort the connection through which we receive the images");
+            condition = ASC_abortAssociation(association);
+            if (condition.bad())
+            {
+                ERROR_LOG("Error aborting the connection for which we received the images" + QString(condition.text()));
+            }
+            break;
+        }
+    }
+
+    ASC_dropAssociation(association);
+    ASC_destroyAssociation(&association);
+}
+
+OFCondition IncomingDICOMConnectionsDispatcher::echoSCP(T_ASC_Association *association, T_DIMSE_Message *dimseMessage,
+                                                        T_ASC_PresentationContextID presentationContextID)
+{
+    // The echo succeeded
+    OFCondition condition = DIMSE_sendEchoResponse(association, presentationContextID, &dimseMessage->msg.CEchoRQ, STATUS_Success, NULL);
+    if (condition.bad())
+    {
+        ERROR_LOG("The PACS requested an echo during the download but the response to this failed");
+    }
+
+    return condition;
+}
+
+OFCondition IncomingDICOMConnectionsDispatcher::storeSCP(T_ASC_Association *association, T_DIMSE_Message *dimseMessage,
+                                                         T_ASC_PresentationContextID presentationContextID, bool &abortAssociation)
+{
+    T_DIMSE_C_StoreRQ *storeRequest = &dimseMessage->msg.CStoreRQ;
+    OFBool useMetaheader = OFTrue;
+    StoreSCPCallbackData storeSCPCallbackData;
+    // The file is allocated in the heap because its retrieve saves it in another thread
+    DcmFileFormat *retrievedFile = new DcmFileFormat();
+    DcmDataset *retrievedDataset = retrievedFile->getDataset();
+
+    storeSCPCallbackData.dispatcher = this;
+    storeSCPCallbackData.dcmFileFormat = retrievedFile;
+    storeSCPCallbackData.abortAssociation = false;
+
+    OFCondition condition = DIMSE_storeProvider(association, presentationContextID, storeRequest, NULL, useMetaheader, &retrievedDataset, storeSCPCallback,
+                                                (void*) &storeSCPCallbackData, DIMSE_BLOCKING, 0);
+
+    if (condition.bad())
+    {
+        ERROR_LOG("Occurred while processing a download request from a file, description error " + QString(condition.text()));
+    }
+
+    // If it hasn't been handed over to a retrieve it's ours
+    delete storeSCPCallbackData.dcmFileFormat;
+    abortAssociation = storeSCPCallbackData.abortAssociation;
+
+    return condition;
+}
+
+RetrieveDICOMFilesFromPACS* IncomingDICOMConnectionsDispatcher::beginDelivery(const QString &studyInstanceUID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    RetrieveDICOMFilesFromPACS *retrieve = m_retrievesByStudyInstanceUID.value(studyInstanceUID);
+    if (retrieve)
+    {
+        m_numberOfDeliveriesInProgress[retrieve]++;
+    }
+
+    return retrieve;
+}
+
+void IncomingDICOMConnectionsDispatcher::endDelivery(RetrieveDICOMFilesFromPACS *retrieve)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_numberOfDeliveriesInProgress[retrieve]--;
+    m_deliveryFinished.wakeAll();
+}
+
+void IncomingDICOMConnectionsDispatcher::storeSCPCallback(void *callbackData, T_DIMSE_StoreProgress *progress, T_DIMSE_C_StoreRQ *storeRequest,
+                                                          char *imageFileName, DcmDataset **imageDataSet, T_DIMSE_C_StoreRSP *storeResponse,
+                                                          DcmDataset **statusDetail)
+{
+    Q_UNUSED(imageFileName);
+
+    // If the package is at the end of an image we must deliver it
+    if (progress->state == DIMSE_StoreEnd)
+    {
+        // No status detail
+        *statusDetail = NULL;
+
+        if ((imageDataSet) && (*imageDataSet))
+        {
+            StoreSCPCallbackData *storeSCPCallbackData = (StoreSCPCallbackData*)callbackData;
+            IncomingDICOMConnectionsDispatcher *dispatcher = storeSCPCallbackData->dispatcher;
+
+            OFString studyInstanceUID;
+            (*imageDataSet)->findAndGetOFString(DCM_StudyInstanceUID, studyInstanceUID);
+
+            RetrieveDICOMFilesFromPACS *retrieve = dispatcher->beginDelivery(studyInstanceUID.c_str());
+            if (!retrieve)
+            {
+                storeResponse->DimseStatus = STATUS_STORE_Refused_OutOfResources;
+                ERROR_LOG(QString("Received image %1 of study %2, but no retrieve of this study is running. The image is refused.")
+                          .arg(storeRequest->AffectedSOPInstanceUID).arg(studyInstanceUID.c_str()));
+                return;
+            }
+
+            bool keepReceiving = retrieve->storeRetrievedDICOMFile(storeSCPCallbackData->dcmFileFormat, storeRequest, imageDataSet, storeResponse);
+            storeSCPCallbackData->dcmFileFormat = NULL;
+            dispatcher->endDelivery(retrieve);
+
+            storeSCPCallbackData->abortAssociation = !keepReceiving;
+        }
+    }
+}
+
+} // namespace udg
@@ -0,0 +1,128 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_INCOMINGDICOMCONNECTIONSDISPATCHER_H
+#define UDG_INCOMINGDICOMCONNECTIONSDISPATCHER_H
+
+#include "singleton.h"
+#include "pacsrequeststatus.h"
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <ofcond.h>
+#include <assoc.h>
+
+struct T_DIMSE_Message;
+struct T_DIMSE_StoreProgress;
+struct T_DIMSE_C_StoreRQ;
+struct T_DIMSE_C_StoreRSP;
+
+class DcmDataset;
+
+namespace udg {
+
+class RetrieveDICOMFilesFromPACS;
+
+/**
+    Listens on the incoming DICOM connections port and delivers the files received through the C-STORE sub-operations of all the running retrieves.
+
+    Instead of each retrieve opening the port during its C-MOVE, the port is opened while there is at least one retrieve registered, so that several
+    retrieves can run at the same time. Each association opened by a PACS is served in its own thread, and each received file is delivered to the
+    registered retrieve of its Study Instance UID. Only one retrieve of each study can be registered at a time, which is guaranteed by
+    RetrieveDICOMFilesFromPACSQueuePolicy. Files that don't belong to any registered retrieve are refused.
+ */
+class IncomingDICOMConnectionsDispatcher : public Singleton<IncomingDICOMConnectionsDispatcher> {
+public:
+    /// Registers the given retrieve to receive the files of the given study. If it's the first registered retrieve, the incoming DICOM connections port
+    /// is opened. Returns RetrieveIncomingDICOMConnectionsPortInUse if the port can't be opened, RetrieveStudyAlreadyBeingRetrieved if another retrieve of
+    /// the same study is already registered and RetrieveOk otherwise.
+    PACSRequestStatus::RetrieveRequestStatus registerRetrieve(RetrieveDICOMFilesFromPACS *retrieve, const QString &studyInstanceUID);
+
+    /// Unregisters the given retrieve, waiting until the files being delivered to it have been processed. If it was the last registered retrieve, the
+    /// incoming DICOM connections port is closed.
+    void unregisterRetrieve(RetrieveDICOMFilesFromPACS *retrieve);
+
+protected:
+    friend class Singleton<IncomingDICOMConnectionsDispatcher>;
+    IncomingDICOMConnectionsDispatcher();
+    ~IncomingDICOMConnectionsDispatcher();
+
+private:
+    class ListenerThread;
+    class AssociationHandler;
+
+    /// Opens the incoming DICOM connections port and starts accepting associations. Returns false if the port can't be opened.
+    bool startListening();
+    /// Stops accepting associations, waits until the open ones have finished and closes the port.
+    void stopListening();
+
+    /// Accepts associations until stopListening() is called. It's run in the listener thread.
+    void listen();
+
+    /// Receives the association requested by a PACS, indicating which presentation contexts and transfer syntaxes we support.
+    OFCondition acceptAssociation(T_ASC_Association **association);
+
+    /// Serves the requests received through the given association until it's closed, and destroys it.
+    void serveAssociation(T_ASC_Association *association);
+
+    /// We respond to an echo request
+    OFCondition echoSCP(T_ASC_Association *association, T_DIMSE_Message *dimseMessage, T_ASC_PresentationContextID presentationContextID);
+
+    /// We respond to a request to save an image. If the retrieve the image belongs to has been cancelled, abortAssociation is set to true.
+    OFCondition storeSCP(T_ASC_Association *association, T_DIMSE_Message *dimseMessage, T_ASC_PresentationContextID presentationContextID,
+                         bool &abortAssociation);
+
+    /// Returns the registered retrieve of the given study and marks that a file is being delivered to it, or null if there isn't any.
+    /// Each call that returns a retrieve must be followed by a call to endDelivery().
+    RetrieveDICOMFilesFromPACS* beginDelivery(const QString &studyInstanceUID);
+    /// Marks that a file has been delivered to the given retrieve.
+    void endDelivery(RetrieveDICOMFilesFromPACS *retrieve);
+
+    /// Called by DIMSE_storeProvider while an image is being received, delivers it to its retrieve once it has been received completely.
+    static void storeSCPCallback(void *callbackData, T_DIMSE_StoreProgress *progress, T_DIMSE_C_StoreRQ *storeRequest, char *imageFileName,
+                                 DcmDataset **imageDataSet, T_DIMSE_C_StoreRSP *storeResponse, DcmDataset **statusDetail);
+
+private:
+    /// Serializes the registration of retrieves, so that the port is not opened and closed at the same time.
+    QMutex m_registrationMutex;
+
+    /// Protects the registered retrieves and the deliveries in progress.
+    QMutex m_mutex;
+    /// Signaled each time a delivery finishes.
+    QWaitCondition m_deliveryFinished;
+    /// Registered retrieves, indexed by Study Instance UID.
+    QHash<QString, RetrieveDICOMFilesFromPACS*> m_retrievesByStudyInstanceUID;
+    /// Number of files being delivered to each retrieve.
+    QHash<RetrieveDICOMFilesFromPACS*, int> m_numberOfDeliveriesInProgress;
+
+    /// Network that accepts the associations on the incoming DICOM connections port, null if it's closed.
+    T_ASC_Network *m_network;
+    /// Thread that accepts the associations.
+    ListenerThread *m_listenerThread;
+    /// Threads that serve the accepted associations.
+    QThreadPool m_associationsThreadPool;
+    /// Set to 1 to stop accepting and serving associations.
+    QAtomicInt m_stopRequested;
+    /// Seconds without receiving any request after which an association is aborted. If it's 0 or less associations are never aborted for being idle.
+    int m_timeout;
+};
+
+} // namespace udg
+
+#endif // UDG_INCOMINGDICOMCONNECTIONSDISPATCHER_H
@@ -46,6 +46,7 @@ HEADERS += databaseconnection.h \
     queryscreen.h \
     qadvancedsearchwidget.h \
     qbasicsearchwidget.h \
+    localcachestorage.h \
     localdatabasemanager.h \
     localdatabasebasedal.h \
     localdatabasedisplayshutterdal.h \
@@ -73,6 +74,7 @@ HEADERS += databaseconnection.h \
     dicomdirburningapplication.h \
     risrequestmanager.h \
     relatedstudiesmanager.h \
+    relatedstudiesquerycache.h \
     risrequestwrapper.h \
     qwidgetselectpacstostoredicomimage.h \
     qrelatedstudieswidget.h \
@@ -81,6 +83,8 @@ HEADERS += databaseconnection.h \
     senddicomfilestopacsjob.h \
     pacsrequeststatus.h \
     retrievedicomfilesfrompacsjob.h \
+    retrievedicomfilesfrompacsqueuepolicy.h \
+    incomingdicomconnectionsdispatcher.h \
     echotopacs.h \
     gdcmanonymizerstarviewer.h \
     dicomanonymizer.h \
@@ -123,6 +127,7 @@ SOURCES += databaseconnection.cpp \
     queryscreen.cpp \
     qadvancedsearchwidget.cpp \
     qbasicsearchwidget.cpp \
+    localcachestorage.cpp \
     localdatabasemanager.cpp \
     localdatabasebasedal.cpp \
     localdatabasedisplayshutterdal.cpp \
@@ -150,6 +155,7 @@ SOURCES += databaseconnection.cpp \
     dicomdirburningapplication.cpp \
     risrequestmanager.cpp \
     relatedstudiesmanager.cpp \
+    relatedstudiesquerycache.cpp \
     risrequestwrapper.cpp \
     qwidgetselectpacstostoredicomimage.cpp \
     qrelatedstudieswidget.cpp \
@@ -157,6 +163,8 @@ SOURCES += databaseconnection.cpp \
     pacsjob.cpp \
     senddicomfilestopacsjob.cpp  \
     retrievedicomfilesfrompacsjob.cpp \
+    retrievedicomfilesfrompacsqueuepolicy.cpp \
+    incomingdicomconnectionsdispatcher.cpp \
     echotopacs.cpp \
     gdcmanonymizerstarviewer.cpp \
     dicomanonymizer.cpp \
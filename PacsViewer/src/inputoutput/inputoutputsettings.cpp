@@ -69,6 +69,10 @@ const QString InputOutputSettings::IncomingDICOMConnectionsPort(PACSParametersBa
 const QString InputOutputSettings::LocalAETitle(PACSParametersBase + "AETitle");
 const QString InputOutputSettings::PACSConnectionTimeout(PACSParametersBase + "timeout");
 const QString InputOutputSettings::MaximumPACSConnections(PACSParametersBase + "MaxConnects");
+const QString InputOutputSettings::MaximumConcurrentRetrieves(PACSParametersBase + "MaxConcurrentRetrieves");
+const QString InputOutputSettings::MaximumConcurrentRetrievesPerPACS(PACSParametersBase + "MaxConcurrentRetrievesPerPACS");
+const QString InputOutputSettings::SendDICOMFilesAssociationsPerPACS(PACSParametersBase + "SendAssociationsPerPACS");
+const QString InputOutputSettings::ProposeTransferSyntaxesOfDICOMFilesToSend(PACSParametersBase + "ProposeTransferSyntaxesOfFilesToSend");
 
 //TODO: Clau duplicada a CoreSettings
 const QString InputOutputSettings::PacsListConfigurationSectionName = "PacsList";
@@ -95,6 +99,7 @@ const QString InputOutputSettings::InstitutionPhoneNumber(InstitutionInformation
 const QString InputOutputSettings::InstitutionEmail(InstitutionInformationBase + "InstitutionEmail");
 
 const QString InputOutputSettings::SearchRelatedStudiesByName("SearchRelatedStudiesByName");
+const QString InputOutputSettings::RelatedStudiesQueryCacheTimeToLive("RelatedStudiesQueryCacheTimeToLive");
 
 InputOutputSettings::InputOutputSettings()
 {
@@ -128,6 +133,10 @@ void InputOutputSettings::init()
     settingsRegistry->addSetting(LocalAETitle, QHostInfo::localHostName(), Settings::Parseable);
     settingsRegistry->addSetting(PACSConnectionTimeout, 20);
     settingsRegistry->addSetting(MaximumPACSConnections, 3);
+    settingsRegistry->addSetting(MaximumConcurrentRetrieves, 3);
+    settingsRegistry->addSetting(MaximumConcurrentRetrievesPerPACS, 1);
+    settingsRegistry->addSetting(SendDICOMFilesAssociationsPerPACS, 4);
+    settingsRegistry->addSetting(ProposeTransferSyntaxesOfDICOMFilesToSend, true);
 
     settingsRegistry->addSetting(ConvertDICOMDIRImagesToLittleEndianKey, false);
 #if defined(Q_OS_WIN)
@@ -170,6 +179,7 @@ void InputOutputSettings::init()
     settingsRegistry->addSetting(OperationStateListSortOrder, Qt::AscendingOrder);
 
     settingsRegistry->addSetting(SearchRelatedStudiesByName, false);
+    settingsRegistry->addSetting(RelatedStudiesQueryCacheTimeToLive, 300);
 }
 
 } // end namespace udg
@@ -70,6 +70,14 @@ public:
     static const QString IncomingDICOMConnectionsPort;
     static const QString PACSConnectionTimeout;
     static const QString MaximumPACSConnections;
+    /// Maximum number of studies that can be retrieved at the same time, from all the PACS
+    static const QString MaximumConcurrentRetrieves;
+    /// Maximum number of studies that can be retrieved at the same time from the same PACS
+    static const QString MaximumConcurrentRetrievesPerPACS;
+    /// Number of associations opened with a PACS to send files to it, each one with a C-STORE operation in progress
+    static const QString SendDICOMFilesAssociationsPerPACS;
+    /// Whether the transfer syntaxes in which the files to send are encoded are proposed to the PACS, to send them without transcoding
+    static const QString ProposeTransferSyntaxesOfDICOMFilesToSend;
 
     /// Llista de PACS
     //TODO: Clau duplicada a CoreSettings
@@ -110,6 +118,8 @@ public:
 
     // Boolea per saber si s'ha de cercar previes a partir del nom del pacient.
     static const QString SearchRelatedStudiesByName;
+    /// Time in seconds that the results of the related studies queries are reused before querying the PACS again. 0 disables the cache.
+    static const QString RelatedStudiesQueryCacheTimeToLive;
 };
 
 } // end namespace udg
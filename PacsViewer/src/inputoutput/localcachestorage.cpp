@@ -0,0 +1,350 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "localcachestorage.h"
+
+#include "databaseconnection.h"
+#include "directoryutilities.h"
+#include "harddiskinformation.h"
+#include "localdatabasemanager.h"
+#include "localdatabasestudydal.h"
+#include "logging.h"
+
+#include <QRunnable>
+#include <QThread>
+
+namespace udg {
+
+namespace {
+
+// Maximum number of threads that measure and delete study directories. More threads than this only make the disk busier
+const int MaximumNumberOfStorageThreads = 4;
+
+// Time after which the free space on disk is measured again, since other applications can also use the disk
+const qint64 FreeSpaceMeasurementLifetimeInMilliseconds = 60 * 1000;
+
+}
+
+class LocalCacheStorage::StudySizeMeasurer : public QRunnable {
+public:
+    StudySizeMeasurer(LocalCacheStorage *storage, const QString &studyInstanceUID, int measurementNumber, bool filesHaveChanged)
+        : m_storage(storage), m_studyInstanceUID(studyInstanceUID), m_measurementNumber(measurementNumber), m_filesHaveChanged(filesHaveChanged)
+    {
+    }
+
+    virtual void run()
+    {
+        m_storage->measureStudySize(m_studyInstanceUID, m_measurementNumber, m_filesHaveChanged);
+    }
+
+private:
+    LocalCacheStorage *m_storage;
+    QString m_studyInstanceUID;
+    int m_measurementNumber;
+    bool m_filesHaveChanged;
+};
+
+class LocalCacheStorage::StudyFilesDeleter : public QRunnable {
+public:
+    StudyFilesDeleter(LocalCacheStorage *storage, const QString &studyInstanceUID, qint64 size)
+        : m_storage(storage), m_studyInstanceUID(studyInstanceUID), m_size(size)
+    {
+    }
+
+    virtual void run()
+    {
+        m_storage->deleteStudyDirectory(m_studyInstanceUID, m_size);
+    }
+
+private:
+    LocalCacheStorage *m_storage;
+    QString m_studyInstanceUID;
+    qint64 m_size;
+};
+
+LocalCacheStorage::LocalCacheStorage()
+    : m_studySizesAreLoaded(false), m_knownCacheSize(0), m_lastMeasurementNumber(0), m_bytesPendingDeletion(0), m_measuredFreeSpace(0),
+      m_cacheSizeAtFreeSpaceMeasurement(0)
+{
+    m_threadPool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), MaximumNumberOfStorageThreads));
+}
+
+LocalCacheStorage::~LocalCacheStorage()
+{
+    waitForDone();
+}
+
+qint64 LocalCacheStorage::getStudySize(const QString &studyInstanceUID)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_studySizes.contains(studyInstanceUID))
+        {
+            return m_studySizes.value(studyInstanceUID);
+        }
+
+        if (m_studiesBeingDeleted.contains(studyInstanceUID))
+        {
+            return 0;
+        }
+    }
+
+    qint64 size = measureStudyDirectorySize(studyInstanceUID);
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        // A background measurement could have finished meanwhile. If it's still pending it will keep the size, since it knows whether the files are new
+        if (m_studySizes.contains(studyInstanceUID) || m_pendingMeasurements.contains(studyInstanceUID) || m_studiesBeingDeleted.contains(studyInstanceUID))
+        {
+            return size;
+        }
+
+        setStudySize(studyInstanceUID, size, false);
+    }
+
+    saveStudySize(studyInstanceUID, size);
+
+    return size;
+}
+
+void LocalCacheStorage::updateStudySize(const QString &studyInstanceUID)
+{
+    QMutexLocker locker(&m_mutex);
+    enqueueMeasurement(studyInstanceUID, true);
+}
+
+void LocalCacheStorage::removeStudySize(const QString &studyInstanceUID)
+{
+    QMutexLocker locker(&m_mutex);
+    m_knownCacheSize -= m_studySizes.take(studyInstanceUID);
+    m_pendingMeasurements.remove(studyInstanceUID);
+}
+
+qint64 LocalCacheStorage::getKnownCacheSize()
+{
+    loadStudySizes();
+
+    QMutexLocker locker(&m_mutex);
+    return m_knownCacheSize;
+}
+
+qint64 LocalCacheStorage::getFreeSpace()
+{
+    loadStudySizes();
+
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_freeSpaceMeasurementTimer.isValid() || m_freeSpaceMeasurementTimer.hasExpired(FreeSpaceMeasurementLifetimeInMilliseconds))
+    {
+        measureFreeSpaceLocked();
+    }
+
+    // The files being deleted aren't in the known size anymore, so they are counted as free space
+    return m_measuredFreeSpace + m_cacheSizeAtFreeSpaceMeasurement - m_knownCacheSize;
+}
+
+void LocalCacheStorage::measureFreeSpace()
+{
+    QMutexLocker locker(&m_mutex);
+    measureFreeSpaceLocked();
+}
+
+void LocalCacheStorage::deleteStudyFiles(const QString &studyInstanceUID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_studiesBeingDeleted.contains(studyInstanceUID))
+    {
+        return;
+    }
+
+    qint64 size = m_studySizes.take(studyInstanceUID);
+    m_knownCacheSize -= size;
+    m_pendingMeasurements.remove(studyInstanceUID);
+
+    m_studiesBeingDeleted.insert(studyInstanceUID);
+    m_bytesPendingDeletion += size;
+    m_threadPool.start(new StudyFilesDeleter(this, studyInstanceUID, size));
+}
+
+qint64 LocalCacheStorage::getBytesPendingDeletion() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytesPendingDeletion;
+}
+
+void LocalCacheStorage::waitForStudyFilesDeleted(const QString &studyInstanceUID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_studiesBeingDeleted.contains(studyInstanceUID))
+    {
+        m_studyFilesDeleted.wait(&m_mutex);
+    }
+}
+
+void LocalCacheStorage::waitForDone()
+{
+    m_threadPool.waitForDone();
+}
+
+qint64 LocalCacheStorage::measureStudyDirectorySize(const QString &studyInstanceUID)
+{
+    return HardDiskInformation::getDirectorySizeInBytes(LocalDatabaseManager::getStudyPath(studyInstanceUID));
+}
+
+bool LocalCacheStorage::removeStudyDirectory(const QString &studyInstanceUID)
+{
+    return DirectoryUtilities().deleteDirectory(LocalDatabaseManager::getStudyPath(studyInstanceUID), true);
+}
+
+qint64 LocalCacheStorage::measureDiskFreeSpace()
+{
+    return HardDiskInformation().getNumberOfFreeBytes(LocalDatabaseManager::getCachePath());
+}
+
+QHash<QString, qint64> LocalCacheStorage::querySavedStudySizes()
+{
+    DatabaseConnection databaseConnection;
+    LocalDatabaseStudyDAL studyDAL(databaseConnection);
+    return studyDAL.querySizes();
+}
+
+void LocalCacheStorage::saveStudySize(const QString &studyInstanceUID, qint64 size)
+{
+    DatabaseConnection databaseConnection;
+    LocalDatabaseStudyDAL studyDAL(databaseConnection);
+
+    if (!studyDAL.updateSize(studyInstanceUID, size))
+    {
+        ERROR_LOG(QString("The size of the study %1 couldn't be saved in the database").arg(studyInstanceUID));
+    }
+}
+
+void LocalCacheStorage::loadStudySizes()
+{
+    QMutexLocker loadLocker(&m_loadStudySizesMutex);
+
+    if (m_studySizesAreLoaded)
+    {
+        return;
+    }
+
+    QHash<QString, qint64> savedStudySizes = querySavedStudySizes();
+    int numberOfStudiesToMeasure = 0;
+
+    QMutexLocker locker(&m_mutex);
+
+    for (QHash<QString, qint64>::const_iterator it = savedStudySizes.constBegin(); it != savedStudySizes.constEnd(); ++it)
+    {
+        // The studies changed since the application started are already known or being measured
+        if (m_studySizes.contains(it.key()) || m_pendingMeasurements.contains(it.key()) || m_studiesBeingDeleted.contains(it.key()))
+        {
+            continue;
+        }
+
+        if (it.value() >= 0)
+        {
+            setStudySize(it.key(), it.value(), false);
+        }
+        else
+        {
+            enqueueMeasurement(it.key(), false);
+            numberOfStudiesToMeasure++;
+        }
+    }
+
+    m_studySizesAreLoaded = true;
+
+    INFO_LOG(QString("Loaded the sizes of %1 studies of the local cache, %2 studies are being measured")
+             .arg(savedStudySizes.size() - numberOfStudiesToMeasure).arg(numberOfStudiesToMeasure));
+}
+
+void LocalCacheStorage::enqueueMeasurement(const QString &studyInstanceUID, bool filesHaveChanged)
+{
+    // The files of a study being deleted can't be measured, and it will be measured again if it's retrieved after being deleted
+    if (m_studiesBeingDeleted.contains(studyInstanceUID))
+    {
+        return;
+    }
+
+    m_lastMeasurementNumber++;
+    m_pendingMeasurements.insert(studyInstanceUID, m_lastMeasurementNumber);
+    m_threadPool.start(new StudySizeMeasurer(this, studyInstanceUID, m_lastMeasurementNumber, filesHaveChanged));
+}
+
+void LocalCacheStorage::measureStudySize(const QString &studyInstanceUID, int measurementNumber, bool filesHaveChanged)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_pendingMeasurements.value(studyInstanceUID) != measurementNumber)
+        {
+            return;
+        }
+    }
+
+    qint64 size = measureStudyDirectorySize(studyInstanceUID);
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_pendingMeasurements.value(studyInstanceUID) != measurementNumber)
+        {
+            return;
+        }
+
+        m_pendingMeasurements.remove(studyInstanceUID);
+        setStudySize(studyInstanceUID, size, filesHaveChanged);
+    }
+
+    // If the study is measured again meanwhile the newer size could be saved before this one, but it will be corrected the next time its files change
+    saveStudySize(studyInstanceUID, size);
+}
+
+void LocalCacheStorage::setStudySize(const QString &studyInstanceUID, qint64 size, bool filesHaveChanged)
+{
+    qint64 sizeIncrease = size - m_studySizes.value(studyInstanceUID);
+    m_studySizes.insert(studyInstanceUID, size);
+    m_knownCacheSize += sizeIncrease;
+
+    if (!filesHaveChanged)
+    {
+        m_cacheSizeAtFreeSpaceMeasurement += sizeIncrease;
+    }
+}
+
+void LocalCacheStorage::deleteStudyDirectory(const QString &studyInstanceUID, qint64 size)
+{
+    if (!removeStudyDirectory(studyInstanceUID))
+    {
+        ERROR_LOG(QString("The files of the study %1 couldn't be deleted from the local cache").arg(studyInstanceUID));
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_studiesBeingDeleted.remove(studyInstanceUID);
+    m_bytesPendingDeletion -= size;
+    m_studyFilesDeleted.wakeAll();
+}
+
+void LocalCacheStorage::measureFreeSpaceLocked()
+{
+    m_measuredFreeSpace = measureDiskFreeSpace();
+    m_cacheSizeAtFreeSpaceMeasurement = m_knownCacheSize + m_bytesPendingDeletion;
+    m_freeSpaceMeasurementTimer.start();
+}
+
+} // namespace udg
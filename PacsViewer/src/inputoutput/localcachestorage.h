@@ -0,0 +1,146 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_LOCALCACHESTORAGE_H
+#define UDG_LOCALCACHESTORAGE_H
+
+#include "singleton.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+namespace udg {
+
+/**
+    Keeps track of the disk space used by the studies of the local cache and deletes their files in the background.
+
+    The size of each study is measured when it's saved and is kept in the database, so that it's only measured again when its files change. The sizes are
+    loaded from the database the first time they are needed, and those that aren't there yet are measured in the background. Thus freeing up space doesn't
+    need to walk the study directories, and the free space on disk can be estimated from the sum of the sizes of the studies without asking the disk each
+    time. The files of deleted studies are removed in parallel by a thread pool, and their bytes are counted as free space as soon as they are deleted.
+
+    This class can be used concurrently from any thread.
+ */
+class LocalCacheStorage : public Singleton<LocalCacheStorage> {
+public:
+    /// Returns the size in bytes of the files of the given study. If it isn't known yet, it's measured now.
+    qint64 getStudySize(const QString &studyInstanceUID);
+
+    /// Measures again in the background the size of the given study, because its files have changed.
+    void updateStudySize(const QString &studyInstanceUID);
+    /// Forgets the size of the given study, whose files have been deleted.
+    void removeStudySize(const QString &studyInstanceUID);
+
+    /// Returns the sum of the sizes of the studies whose size is known, in bytes.
+    qint64 getKnownCacheSize();
+
+    /// Returns the estimated free space in bytes on the disk of the local cache, counting the files being deleted as free. The free space is measured on
+    /// disk only if it hasn't been measured recently, and it's updated with the changes in the size of the cache since the last measurement.
+    qint64 getFreeSpace();
+    /// Measures the free space on disk now, so that the next estimates also include the changes made by other applications.
+    void measureFreeSpace();
+
+    /// Deletes the directory of the given study in the background. Its size is counted as pending deletion until the files have been removed.
+    void deleteStudyFiles(const QString &studyInstanceUID);
+    /// Returns the number of bytes of the studies whose files are being deleted.
+    qint64 getBytesPendingDeletion() const;
+    /// Waits until the files of the given study have been deleted, if they are being deleted.
+    void waitForStudyFilesDeleted(const QString &studyInstanceUID);
+
+    /// Waits until all the measurements and deletions have finished.
+    void waitForDone();
+
+protected:
+    friend class Singleton<LocalCacheStorage>;
+    LocalCacheStorage();
+    virtual ~LocalCacheStorage();
+
+    /// Returns the size in bytes of the files of the given study measured on disk.
+    virtual qint64 measureStudyDirectorySize(const QString &studyInstanceUID);
+    /// Deletes the directory of the given study. Returns true if successful and false otherwise.
+    virtual bool removeStudyDirectory(const QString &studyInstanceUID);
+    /// Returns the free space in bytes on the disk of the local cache.
+    virtual qint64 measureDiskFreeSpace();
+
+    /// Returns the sizes of all the studies saved in the database, with -1 for those that haven't been measured yet.
+    virtual QHash<QString, qint64> querySavedStudySizes();
+    /// Saves the size of the given study in the database.
+    virtual void saveStudySize(const QString &studyInstanceUID, qint64 size);
+
+private:
+    class StudySizeMeasurer;
+    class StudyFilesDeleter;
+
+    /// Loads the sizes of the studies from the database the first time it's called, and measures in the background those that aren't known.
+    void loadStudySizes();
+
+    /// Queues a background measurement of the given study that replaces the previous ones. filesHaveChanged must be false if the files were already on
+    /// disk when the free space was last measured. m_mutex must be locked.
+    void enqueueMeasurement(const QString &studyInstanceUID, bool filesHaveChanged);
+    /// Measures the size of the given study and saves it if it's still its latest measurement. It's run in the thread pool.
+    void measureStudySize(const QString &studyInstanceUID, int measurementNumber, bool filesHaveChanged);
+    /// Sets the size of the given study. If its files haven't changed, the size doesn't change the estimated free space. m_mutex must be locked.
+    void setStudySize(const QString &studyInstanceUID, qint64 size, bool filesHaveChanged);
+    /// Deletes the directory of the given study, which had the given size. It's run in the thread pool.
+    void deleteStudyDirectory(const QString &studyInstanceUID, qint64 size);
+
+    /// Measures the free space on disk. m_mutex must be locked.
+    void measureFreeSpaceLocked();
+
+private:
+    /// Protects all the members except the ones used to load the study sizes.
+    mutable QMutex m_mutex;
+    /// Signaled each time the files of a study have been deleted.
+    QWaitCondition m_studyFilesDeleted;
+
+    /// Ensures that the study sizes are loaded only once.
+    QMutex m_loadStudySizesMutex;
+    bool m_studySizesAreLoaded;
+
+    /// Size in bytes of each study whose size is known.
+    QHash<QString, qint64> m_studySizes;
+    /// Sum of m_studySizes.
+    qint64 m_knownCacheSize;
+    /// Number of the latest background measurement of each study with pending measurements. Older measurements, and those of studies removed from
+    /// here before finishing, are discarded.
+    QHash<QString, int> m_pendingMeasurements;
+    /// Number given to the last queued measurement.
+    int m_lastMeasurementNumber;
+
+    /// Studies whose files are being deleted.
+    QSet<QString> m_studiesBeingDeleted;
+    /// Sum of the sizes of m_studiesBeingDeleted.
+    qint64 m_bytesPendingDeletion;
+
+    /// Free space on disk when it was last measured.
+    qint64 m_measuredFreeSpace;
+    /// Known size of the cache, including the files being deleted, when the free space was last measured, updated with the studies measured since then
+    /// whose files were already there. The difference with the current known size is the space used or freed up since the measurement.
+    qint64 m_cacheSizeAtFreeSpaceMeasurement;
+    /// Time since the free space was last measured. It's invalid if it hasn't been measured yet.
+    QElapsedTimer m_freeSpaceMeasurementTimer;
+
+    /// Threads that measure and delete the study directories.
+    QThreadPool m_threadPool;
+};
+
+} // namespace udg
+
+#endif // UDG_LOCALCACHESTORAGE_H
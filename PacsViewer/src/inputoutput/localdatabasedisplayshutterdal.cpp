@@ -141,6 +141,43 @@ bool LocalDatabaseDisplayShutterDAL::update(const QList<DisplayShutter> &shutter
     return true;
 }
 
+bool LocalDatabaseDisplayShutterDAL::replace(const QList<Image*> &images)
+{
+    // The same prepared statements are reused for all the images
+    QSqlQuery deleteQuery = getNewQuery();
+    deleteQuery.prepare("DELETE FROM DisplayShutter WHERE ImageInstanceUID = :imageInstanceUID AND ImageFrameNumber = :imageFrameNumber");
+    QSqlQuery insertQuery = getNewQuery();
+    insertQuery.prepare("INSERT INTO DisplayShutter (Shape, ShutterValue, PointsList, ImageInstanceUID, ImageFrameNumber) "
+                        "VALUES (:shape, :shutterValue, :pointsList, :imageInstanceUID, :imageFrameNumber)");
+
+    foreach (const Image *image, images)
+    {
+        deleteQuery.bindValue(":imageInstanceUID", image->getSOPInstanceUID());
+        deleteQuery.bindValue(":imageFrameNumber", image->getFrameNumber());
+
+        if (!executeQueryAndLogError(deleteQuery))
+        {
+            return false;
+        }
+
+        foreach (const DisplayShutter &shutter, image->getDisplayShutters())
+        {
+            insertQuery.bindValue(":shape", shutter.getShapeAsDICOMString());
+            insertQuery.bindValue(":shutterValue", shutter.getShutterValue());
+            insertQuery.bindValue(":pointsList", shutter.getPointsAsString());
+            insertQuery.bindValue(":imageInstanceUID", image->getSOPInstanceUID());
+            insertQuery.bindValue(":imageFrameNumber", image->getFrameNumber());
+
+            if (!executeQueryAndLogError(insertQuery))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 bool LocalDatabaseDisplayShutterDAL::del(const DicomMask &mask)
 {
     QSqlQuery query = getNewQuery();
@@ -165,4 +202,22 @@ QList<DisplayShutter> LocalDatabaseDisplayShutterDAL::query(const DicomMask &mas
     return shutterList;
 }
 
+QHash<QPair<QString, int>, QList<DisplayShutter> > LocalDatabaseDisplayShutterDAL::queryGroupedByImage(const DicomMask &mask)
+{
+    QSqlQuery query = getNewQuery();
+    prepareQueryWithMask(query, mask, "SELECT Shape, ShutterValue, PointsList, ImageInstanceUID, ImageFrameNumber FROM DisplayShutter");
+    QHash<QPair<QString, int>, QList<DisplayShutter> > shuttersByImage;
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            QPair<QString, int> image(query.value("ImageInstanceUID").toString(), query.value("ImageFrameNumber").toInt());
+            shuttersByImage[image] << getDisplayShutter(query);
+        }
+    }
+
+    return shuttersByImage;
+}
+
 }
@@ -17,6 +17,9 @@
 
 #include "localdatabasebasedal.h"
 
+#include <QHash>
+#include <QPair>
+
 namespace udg {
 
 class DicomMask;
@@ -38,12 +41,20 @@ public:
     /// The existing shutters are deleted and the given ones are inserted. Returns true if successful and false otherwise.
     bool update(const QList<DisplayShutter> &shuttersList, const Image *shuttersImage);
 
+    /// Replaces the display shutters in the database of each one of the given images with the ones that the image has now. The statements are prepared
+    /// only once for all the images, so it's much faster than updating them image by image. Returns true if successful and false otherwise.
+    bool replace(const QList<Image*> &images);
+
     /// Deletes from the database the display shutters that match the given mask. Returns true if successful and false otherwise.
     bool del(const DicomMask &mask);
 
     /// Retrieves from the database the display shutters that match the given mask and returns them in a list.
     QList<DisplayShutter> query(const DicomMask &mask);
 
+    /// Retrieves from the database with a single query the display shutters that match the given mask and returns them grouped by image.
+    /// The key of each group is the SOP Instance UID and the frame number of the image.
+    QHash<QPair<QString, int>, QList<DisplayShutter> > queryGroupedByImage(const DicomMask &mask);
+
 };
 
 } // End namespace udg
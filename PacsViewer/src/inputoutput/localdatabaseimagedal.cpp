@@ -35,6 +35,20 @@ namespace udg {
 
 namespace {
 
+// Columns and values of the statements that insert an image.
+const QString ImageColumnsAndValues("(SOPInstanceUID, FrameNumber, StudyInstanceUID, SeriesInstanceUID, InstanceNumber, ImageOrientationPatient, "
+                                    "PatientOrientation, PixelSpacing, SliceThickness, PatientPosition, SamplesPerPixel, Rows, Columns, BitsAllocated, "
+                                    "BitsStored, PixelRepresentation, RescaleSlope, WindowLevelWidth, WindowLevelCenter, WindowLevelExplanations, "
+                                    "SliceLocation, RescaleIntercept, PhotometricInterpretation, ImageType, ViewPosition, ImageLaterality, ViewCodeMeaning, "
+                                    "PhaseNumber, ImageTime, VolumeNumberInSeries, OrderNumberInVolume, RetrievedDate, RetrievedTime, State, "
+                                    "NumberOfOverlays, RetrievedPACSID, ImagerPixelSpacing, EstimatedRadiographicMagnificationFactor, TransferSyntaxUID) "
+                                    "VALUES (:sopInstanceUID, :frameNumber, :studyInstanceUID, :seriesInstanceUID, :instanceNumber, :imageOrientationPatient, "
+                                    ":patientOrientation, :pixelSpacing, :sliceThickness, :patientPosition, :samplesPerPixel, :rows, :columns, :bitsAllocated, "
+                                    ":bitsStored, :pixelRepresentation, :rescaleSlope, :windowLevelWidth, :windowLevelCenter, :windowLevelExplanations, "
+                                    ":sliceLocation, :rescaleIntercept, :photometricInterpretation, :imageType, :viewPosition, :imageLaterality, :viewCodeMeaning, "
+                                    ":phaseNumber, :imageTime, :volumeNumberInSeries, :orderNumberInVolume, :retrievedDate, :retrievedTime, :state, "
+                                    ":numberOfOverlays, :retrievedPacsId, :imagerPixelSpacing, :estimatedRadiographicMagnificationFactor, :transferSyntaxUID)");
+
 // Returns pixel spacing formatted as a DICOM string, with values separated by "\\".
 QString pixelSpacingToDicomString(const PixelSpacing2D &pixelSpacing)
 {
@@ -164,18 +178,7 @@ LocalDatabaseImageDAL::LocalDatabaseImageDAL(DatabaseConnection &databaseConnect
 bool LocalDatabaseImageDAL::insert(const Image *image)
 {
     QSqlQuery query = getNewQuery();
-    query.prepare("INSERT INTO Image (SOPInstanceUID, FrameNumber, StudyInstanceUID, SeriesInstanceUID, InstanceNumber, ImageOrientationPatient, "
-                                     "PatientOrientation, PixelSpacing, SliceThickness, PatientPosition, SamplesPerPixel, Rows, Columns, BitsAllocated, "
-                                     "BitsStored, PixelRepresentation, RescaleSlope, WindowLevelWidth, WindowLevelCenter, WindowLevelExplanations, "
-                                     "SliceLocation, RescaleIntercept, PhotometricInterpretation, ImageType, ViewPosition, ImageLaterality, ViewCodeMeaning, "
-                                     "PhaseNumber, ImageTime, VolumeNumberInSeries, OrderNumberInVolume, RetrievedDate, RetrievedTime, State, "
-                                     "NumberOfOverlays, RetrievedPACSID, ImagerPixelSpacing, EstimatedRadiographicMagnificationFactor, TransferSyntaxUID) "
-                  "VALUES (:sopInstanceUID, :frameNumber, :studyInstanceUID, :seriesInstanceUID, :instanceNumber, :imageOrientationPatient, "
-                          ":patientOrientation, :pixelSpacing, :sliceThickness, :patientPosition, :samplesPerPixel, :rows, :columns, :bitsAllocated, "
-                          ":bitsStored, :pixelRepresentation, :rescaleSlope, :windowLevelWidth, :windowLevelCenter, :windowLevelExplanations, "
-                          ":sliceLocation, :rescaleIntercept, :photometricInterpretation, :imageType, :viewPosition, :imageLaterality, :viewCodeMeaning, "
-                          ":phaseNumber, :imageTime, :volumeNumberInSeries, :orderNumberInVolume, :retrievedDate, :retrievedTime, :state, "
-                          ":numberOfOverlays, :retrievedPacsId, :imagerPixelSpacing, :estimatedRadiographicMagnificationFactor, :transferSyntaxUID)");
+    query.prepare("INSERT INTO Image " + ImageColumnsAndValues);
     bindValues(query, image);
     return executeQueryAndLogError(query);
 }
@@ -202,6 +205,25 @@ bool LocalDatabaseImageDAL::update(const Image *image)
     return executeQueryAndLogError(query);
 }
 
+bool LocalDatabaseImageDAL::insertOrReplace(const QList<Image*> &images)
+{
+    // The same prepared statement is reused for all the images
+    QSqlQuery query = getNewQuery();
+    query.prepare("INSERT OR REPLACE INTO Image " + ImageColumnsAndValues);
+
+    foreach (const Image *image, images)
+    {
+        bindValues(query, image);
+
+        if (!executeQueryAndLogError(query))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool LocalDatabaseImageDAL::del(const DicomMask &mask)
 {
     QSqlQuery query = getNewQuery();
@@ -225,33 +247,58 @@ QList<Image*> LocalDatabaseImageDAL::query(const DicomMask &mask)
 
     if (executeQueryAndLogError(query))
     {
+        while (query.next())
+        {
+            imageList << getImage(query);
+        }
+    }
+
+    if (!imageList.isEmpty())
+    {
+        // The display shutters and VOI LUTs of all the images are retrieved with one query each instead of two queries for each image.
+        // Only the UIDs of the mask are considered, like in the query of the images, since the other DALs would also filter by image number.
+        DicomMask imagesMask;
+        imagesMask.setStudyInstanceUID(mask.getStudyInstanceUID());
+        imagesMask.setSeriesInstanceUID(mask.getSeriesInstanceUID());
+        imagesMask.setSOPInstanceUID(mask.getSOPInstanceUID());
+
         LocalDatabaseDisplayShutterDAL shutterDAL(m_databaseConnection);
+        QHash<QPair<QString, int>, QList<DisplayShutter> > shuttersByImage = shutterDAL.queryGroupedByImage(imagesMask);
         LocalDatabaseVoiLutDAL voiLutDAL(m_databaseConnection);
+        QHash<QPair<QString, int>, QList<VoiLut> > voiLutsByImage = voiLutDAL.queryGroupedByImage(imagesMask);
 
-        while (query.next())
+        foreach (Image *image, imageList)
         {
-            Image *image = getImage(query);
+            QPair<QString, int> key(image->getSOPInstanceUID(), image->getFrameNumber());
+            image->setDisplayShutters(shuttersByImage.value(key));
 
-            // Get display shutters
-            DicomMask mask;
-            mask.setSOPInstanceUID(image->getSOPInstanceUID());
-            mask.setImageNumber(QString::number(image->getFrameNumber()));
-            image->setDisplayShutters(shutterDAL.query(mask));
-
-            // Get VOI LUTs
-            QList<VoiLut> voiLuts = voiLutDAL.query(mask);
-            foreach (const VoiLut &voiLut, voiLuts)
+            foreach (const VoiLut &voiLut, voiLutsByImage.value(key))
             {
                 image->addVoiLut(voiLut);
             }
-
-            imageList << image;
         }
     }
 
     return imageList;
 }
 
+QStringList LocalDatabaseImageDAL::querySOPInstanceUIDs(const DicomMask &mask)
+{
+    QSqlQuery query = getNewQuery();
+    prepareQueryWithMask(query, mask, "SELECT DISTINCT SOPInstanceUID FROM Image");
+    QStringList sopInstanceUIDs;
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            sopInstanceUIDs << query.value(0).toString();
+        }
+    }
+
+    return sopInstanceUIDs;
+}
+
 int LocalDatabaseImageDAL::count(const DicomMask &mask)
 {
     QSqlQuery query = getNewQuery();
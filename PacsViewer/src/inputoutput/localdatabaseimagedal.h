@@ -18,6 +18,7 @@
 #include "localdatabasebasedal.h"
 
 #include <QHash>
+#include <QStringList>
 
 class QVector2D;
 
@@ -42,6 +43,10 @@ public:
     /// Updates in the database the given image. Returns true if successful and false otherwise.
     bool update(const Image *image);
 
+    /// Inserts to the database the given images, replacing the ones that already exist. The statement is prepared only once for all the images, so it's
+    /// much faster than inserting or updating them one by one, specially inside a transaction. Returns true if successful and false otherwise.
+    bool insertOrReplace(const QList<Image*> &images);
+
     /// Deletes from the database the images that match the given mask (only StudyUID, SeriesUID and SOPInstanceUID are considered).
     /// Returns true if successful and false otherwise.
     bool del(const DicomMask &mask);
@@ -50,6 +55,10 @@ public:
     /// and returns them in a list.
     QList<Image*> query(const DicomMask &mask);
 
+    /// Returns the SOP Instance UIDs of the images that match the given mask (only StudyUID, SeriesUID and SOPInstanceUID are considered),
+    /// without the cost of retrieving the whole images. Returns an empty list in case of error.
+    QStringList querySOPInstanceUIDs(const DicomMask &mask);
+
     /// Counts and returns the number of images that match the given mask (only StudyUID, SeriesUID and SOPInstanceUID are considered).
     /// Returns -1 in case of error.
     int count(const DicomMask &mask);
@@ -17,9 +17,9 @@
 #include "databaseconnection.h"
 #include "dicommask.h"
 #include "directoryutilities.h"
-#include "harddiskinformation.h"
 #include "image.h"
 #include "inputoutputsettings.h"
+#include "localcachestorage.h"
 #include "localdatabasedisplayshutterdal.h"
 #include "localdatabaseencapsulateddocumentdal.h"
 #include "localdatabaseimagedal.h"
@@ -28,47 +28,28 @@
 #include "localdatabasestudydal.h"
 #include "localdatabaseutildal.h"
 #include "localdatabasevoilutdal.h"
+#include "logging.h"
 #include "patient.h"
+#include "relatedstudiesquerycache.h"
+#include "thumbnailcache.h"
 #include "thumbnailcreator.h"
 
 #include <QDir>
+#include <QElapsedTimer>
+#include <QMutex>
 
 namespace udg {
 
 namespace {
 
-// Saves all the display shutters in the given list from the given image to the database.
-void insertDisplayShutters(DatabaseConnection &databaseConnection, const QList<DisplayShutter> &shuttersList, const Image *image)
-{
-    LocalDatabaseDisplayShutterDAL displayShutterDAL(databaseConnection);
-
-    foreach (const DisplayShutter &shutter, shuttersList)
-    {
-        if (!displayShutterDAL.insert(shutter, image))
-        {
-            throw displayShutterDAL.getLastError();
-        }
-    }
-}
+// Protects the setting with the studies being retrieved, since several retrieves can run at the same time
+QMutex studiesBeingRetrievedMutex;
 
-// Inserts to the database all the VOI LUTs that are LUTs in the given image.
-void insertVoiLuts(DatabaseConnection &databaseConnection, const Image *image)
-{
-    LocalDatabaseVoiLutDAL voiLutDAL(databaseConnection);
+// Number of studies deleted from the database in each transaction when deleting old studies or freeing up space
+const int StudiesDeletionBatchSize = 100;
 
-    for (int i = 0; i < image->getNumberOfVoiLuts(); i++)
-    {
-        const VoiLut &voiLut = image->getVoiLut(i);
-
-        if (voiLut.isLut())
-        {
-            if (!voiLutDAL.insert(voiLut, image))
-            {
-                throw voiLutDAL.getLastError();
-            }
-        }
-    }
-}
+// Resolution of the thumbnails of the series saved in the study directories
+const int SeriesThumbnailResolution = 96;
 
 // Deletes from the database all the VOI LUTs that match the given mask.
 void deleteVoiLuts(DatabaseConnection &databaseConnection, const DicomMask &mask)
@@ -81,60 +62,48 @@ void deleteVoiLuts(DatabaseConnection &databaseConnection, const DicomMask &mask
     }
 }
 
-// Deletes from the database all the VOI LUTs from the given image.
-void deleteVoiLuts(DatabaseConnection &databaseConnection, const Image *image)
+// Saves the images in the given list to the database with their display shutters and VOI LUTs, inserting or replacing them as necessary.
+// Each statement is prepared only once for all the images, which is much faster than saving them one by one when there are thousands of them.
+void saveImages(DatabaseConnection &databaseConnection, const QList<Image*> &imageList, const QDate &currentDate, const QTime &currentTime)
 {
-    DicomMask mask;
-    mask.setSOPInstanceUID(image->getSOPInstanceUID());
-    mask.setImageNumber(QString::number(image->getFrameNumber()));
-    deleteVoiLuts(databaseConnection, mask);
-}
+    if (imageList.isEmpty())
+    {
+        return;
+    }
 
-// Saves to the database the given image and its display shutters and VOI LUTs, doing an insert or an update as necessary.
-void saveImage(DatabaseConnection &databaseConnection, const Image *image)
-{
-    LocalDatabaseImageDAL imageDAL(databaseConnection);
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
 
-    if (!imageDAL.insert(image))
+    foreach (Image *image, imageList)
     {
-        if (imageDAL.getLastError().nativeErrorCode().toInt() == DatabaseConnection::SqliteConstraint)
-        {
-            // The image already exists, let's update it
-            if (!imageDAL.update(image))
-            {
-                throw imageDAL.getLastError();
-            }
+        image->setRetrievedDate(currentDate);
+        image->setRetrievedTime(currentTime);
+    }
 
-            // Update shutters
-            LocalDatabaseDisplayShutterDAL shutterDAL(databaseConnection);
+    LocalDatabaseImageDAL imageDAL(databaseConnection);
 
-            if (!shutterDAL.update(image->getDisplayShutters(), image))
-            {
-                throw shutterDAL.getLastError();
-            }
+    if (!imageDAL.insertOrReplace(imageList))
+    {
+        throw imageDAL.getLastError();
+    }
 
-            // Delete existing VOI LUTs from the image. The new ones (or the same ones) are inserted below.
-            deleteVoiLuts(databaseConnection, image);
-        }
-        else
-        {
-            throw imageDAL.getLastError();
-        }
+    LocalDatabaseDisplayShutterDAL shutterDAL(databaseConnection);
+
+    if (!shutterDAL.replace(imageList))
+    {
+        throw shutterDAL.getLastError();
     }
 
-    insertDisplayShutters(databaseConnection, image->getDisplayShutters(), image);
-    insertVoiLuts(databaseConnection, image);
-}
+    LocalDatabaseVoiLutDAL voiLutDAL(databaseConnection);
 
-// Saves the images in the given list to the database, inserting or updating them as necessary.
-void saveImages(DatabaseConnection &databaseConnection, const QList<Image*> &imageList, const QDate &currentDate, const QTime &currentTime)
-{
-    foreach (Image *image, imageList)
+    if (!voiLutDAL.replace(imageList))
     {
-        image->setRetrievedDate(currentDate);
-        image->setRetrievedTime(currentTime);
-        saveImage(databaseConnection, image);
+        throw voiLutDAL.getLastError();
     }
+
+    qint64 elapsedTime = qMax(Q_INT64_C(1), elapsedTimer.elapsed());
+    INFO_LOG(QString("Saved %1 images to the database in %2 ms (%3 images/s)").arg(imageList.size()).arg(elapsedTime)
+             .arg(imageList.size() * 1000 / elapsedTime));
 }
 
 // Saves to the database the given encapsulated document, doing an insert or an update as necessary.
@@ -356,6 +325,24 @@ void deleteEncapsulatedDocumentsFromDatabase(DatabaseConnection &databaseConnect
     }
 }
 
+// Returns the SOP Instance UIDs of the images in the database from the series with the given SeriesInstanceUID from the study with the given
+// StudyInstanceUID, or from the whole study if SeriesInstanceUID is empty.
+QStringList querySOPInstanceUIDs(DatabaseConnection &databaseConnection, const QString &studyInstanceUID, const QString &seriesIntanceUID)
+{
+    DicomMask mask;
+    mask.setStudyInstanceUID(studyInstanceUID);
+    mask.setSeriesInstanceUID(seriesIntanceUID);
+    LocalDatabaseImageDAL imageDAL(databaseConnection);
+    QStringList sopInstanceUIDs = imageDAL.querySOPInstanceUIDs(mask);
+
+    if (imageDAL.getLastError().isValid())
+    {
+        throw imageDAL.getLastError();
+    }
+
+    return sopInstanceUIDs;
+}
+
 // Deletes from the database the series with the given SeriesInstanceUID from the study with the given StudyInstanceUID.
 // If SeriesInstanceUID is empty, deletes all series from the study with the given StudyInstanceUID, but not the study itself.
 void deleteSeriesStructureFromDatabase(DatabaseConnection &databaseConnection, const QString &studyInstanceUID, const QString &seriesIntanceUID)
@@ -435,13 +422,27 @@ void createSeriesThumbnail(const Series *series)
     //if (!QFileInfo(thumbnailFilePath).exists())
     if (!QFileInfo::exists(thumbnailFilePath))
     {
-        ThumbnailCreator().getThumbnail(series).save(thumbnailFilePath, "PNG");
+        ThumbnailCreator().getThumbnail(series, SeriesThumbnailResolution).save(thumbnailFilePath, "PNG");
     }
 }
 
 // Creates and saves a thumbnail for each series in the given study.
 void createStudyThumbnails(const Study *study)
 {
+    // The thumbnails of the images used by the series thumbnails are created concurrently first, so that then each series thumbnail is read from
+    // the thumbnail cache
+    QList<Image*> seriesThumbnailImages;
+
+    foreach (Series *series, study->getSeries())
+    {
+        if (series->isViewable() && !QFileInfo::exists(getSeriesThumbnailPath(study->getInstanceUID(), series)))
+        {
+            seriesThumbnailImages << series->getImages().at(series->getImages().size() / 2);
+        }
+    }
+
+    ThumbnailCache::instance()->getThumbnails(seriesThumbnailImages, SeriesThumbnailResolution);
+
     foreach (Series *series, study->getSeries())
     {
         createSeriesThumbnail(series);
@@ -527,6 +528,7 @@ void LocalDatabaseManager::save(Series *series)
         databaseConnection.commitTransaction();
 
         createSeriesThumbnail(series);
+        LocalCacheStorage::instance()->updateStudySize(study->getInstanceUID());
 
         m_lastError = Ok;
     }
@@ -718,10 +720,13 @@ void LocalDatabaseManager::deleteStudy(const QString &studyInstanceUID)
     {
         DatabaseConnection databaseConnection;
         databaseConnection.beginTransaction();
+        QStringList sopInstanceUIDs = querySOPInstanceUIDs(databaseConnection, studyInstanceUID, QString());
         deleteStudyStructureFromDatabase(databaseConnection, studyInstanceUID);
         databaseConnection.commitTransaction();
 
         deleteStudyFromHardDisk(studyInstanceUID);
+        LocalCacheStorage::instance()->removeStudySize(studyInstanceUID);
+        ThumbnailCache::instance()->removeThumbnails(sopInstanceUIDs);
 
         m_lastError = Ok;
     }
@@ -754,10 +759,13 @@ void LocalDatabaseManager::deleteSeries(const QString &studyInstanceUID, const Q
         {
             DatabaseConnection databaseConnection;
             databaseConnection.beginTransaction();
+            QStringList sopInstanceUIDs = querySOPInstanceUIDs(databaseConnection, studyInstanceUID, seriesInstanceUID);
             deleteSeriesStructureFromDatabase(databaseConnection, studyInstanceUID, seriesInstanceUID);
             databaseConnection.commitTransaction();
 
             deleteSeriesFromHardDisk(studyInstanceUID, seriesInstanceUID);
+            LocalCacheStorage::instance()->updateStudySize(studyInstanceUID);
+            ThumbnailCache::instance()->removeThumbnails(sopInstanceUIDs);
 
             m_lastError = Ok;
         }
@@ -796,11 +804,20 @@ void LocalDatabaseManager::deleteOldStudies()
         INFO_LOG("No studies to delete.");
     }
 
+    QStringList studyInstanceUIDs;
+
     foreach (Study *study, studiesToDelete)
     {
-        deleteStudy(study->getInstanceUID());
+        studyInstanceUIDs << study->getInstanceUID();
         delete study;
     }
+
+    deleteStudies(studyInstanceUIDs);
+}
+
+void LocalDatabaseManager::cancelStudiesDeletion()
+{
+    m_studiesDeletionCancelled.storeRelease(1);
 }
 
 void LocalDatabaseManager::compact()
@@ -832,8 +849,9 @@ bool LocalDatabaseManager::thereIsAvailableSpaceOnHardDisk()
 {
     m_lastError = Ok;
 
-    HardDiskInformation hardDiskInformation;
-    quint64 freeSpaceInHardDisk = hardDiskInformation.getNumberOfFreeMBytes(getCachePath());
+    // The free space is estimated from the changes in the size of the cache, which also counts the files still being deleted as free space
+    LocalCacheStorage *localCacheStorage = LocalCacheStorage::instance();
+    quint64 freeSpaceInHardDisk = qMax(Q_INT64_C(0), localCacheStorage->getFreeSpace()) / 1024 / 1024;
     Settings settings;
     quint64 minimumSpaceRequired = quint64(settings.getValue(InputOutputSettings::MinimumFreeGigaBytesForCache).toULongLong() * 1024);
 
@@ -842,8 +860,17 @@ bool LocalDatabaseManager::thereIsAvailableSpaceOnHardDisk()
         return true;
     }
 
-    INFO_LOG(QString("Not enough free space in disk to download studies. Free space: %1 MiB. Required: %2 MiB.").arg(freeSpaceInHardDisk)
-                                                                                                                .arg(minimumSpaceRequired));
+    // Before deleting studies the disk is asked again, because other applications could have freed up space since the last measurement
+    localCacheStorage->measureFreeSpace();
+    freeSpaceInHardDisk = qMax(Q_INT64_C(0), localCacheStorage->getFreeSpace()) / 1024 / 1024;
+
+    if (freeSpaceInHardDisk >= minimumSpaceRequired)
+    {
+        return true;
+    }
+
+    INFO_LOG(QString("Not enough free space in disk to download studies. Free space: %1 MiB. Required: %2 MiB. Local cache size: %3 MiB.")
+             .arg(freeSpaceInHardDisk).arg(minimumSpaceRequired).arg(localCacheStorage->getKnownCacheSize() / 1024 / 1024));
 
     // Check if we should try to free up space. If not, return false
     if (!settings.getValue(InputOutputSettings::DeleteLeastRecentlyUsedStudiesNoFreeSpaceCriteria).toBool())
@@ -865,8 +892,8 @@ bool LocalDatabaseManager::thereIsAvailableSpaceOnHardDisk()
         return false;
     }
 
-    // Finally check free space again
-    freeSpaceInHardDisk = hardDiskInformation.getNumberOfFreeMBytes(getCachePath());
+    // Finally check free space again. The estimate already counts the studies just deleted, so the disk doesn't have to be asked
+    freeSpaceInHardDisk = qMax(Q_INT64_C(0), localCacheStorage->getFreeSpace()) / 1024 / 1024;
 
     if (freeSpaceInHardDisk >= minimumSpaceRequired)
     {
@@ -882,12 +909,33 @@ bool LocalDatabaseManager::thereIsAvailableSpaceOnHardDisk()
 
 void LocalDatabaseManager::setStudyBeingRetrieved(const QString &studyInstanceUID)
 {
-    Settings().setValue(InputOutputSettings::RetrievingStudy, studyInstanceUID);
+    QMutexLocker locker(&studiesBeingRetrievedMutex);
+
+    Settings settings;
+    QStringList studiesBeingRetrieved = settings.getValue(InputOutputSettings::RetrievingStudy).toStringList();
+    if (!studiesBeingRetrieved.contains(studyInstanceUID))
+    {
+        studiesBeingRetrieved << studyInstanceUID;
+    }
+    settings.setValue(InputOutputSettings::RetrievingStudy, studiesBeingRetrieved);
 }
 
-void LocalDatabaseManager::setNoStudyBeingRetrieved()
+void LocalDatabaseManager::setNoStudyBeingRetrieved(const QString &studyInstanceUID)
 {
-    Settings().remove(InputOutputSettings::RetrievingStudy);
+    QMutexLocker locker(&studiesBeingRetrievedMutex);
+
+    Settings settings;
+    QStringList studiesBeingRetrieved = settings.getValue(InputOutputSettings::RetrievingStudy).toStringList();
+    studiesBeingRetrieved.removeAll(studyInstanceUID);
+
+    if (studiesBeingRetrieved.isEmpty())
+    {
+        settings.remove(InputOutputSettings::RetrievingStudy);
+    }
+    else
+    {
+        settings.setValue(InputOutputSettings::RetrievingStudy, studiesBeingRetrieved);
+    }
 }
 
 bool LocalDatabaseManager::isAStudyBeingRetrieved() const
@@ -899,11 +947,12 @@ void LocalDatabaseManager::deleteStudyBeingRetrieved()
 {
     m_lastError = Ok;
 
-    if (isAStudyBeingRetrieved())
-    {
-        Settings settings;
-        QString studyInstanceUID = settings.getValue(InputOutputSettings::RetrievingStudy).toString();
+    Settings settings;
+    // Before several studies could be retrieved at the same time the setting was a single UID, which is read as a list with one element
+    QStringList studiesBeingRetrieved = settings.getValue(InputOutputSettings::RetrievingStudy).toStringList();
 
+    foreach (const QString &studyInstanceUID, studiesBeingRetrieved)
+    {
         INFO_LOG(QString("Study %1 was being downloaded when Starviewer finished. Its images will be deleted to maintain local cache integrity.")
                  .arg(studyInstanceUID));
 
@@ -922,7 +971,7 @@ void LocalDatabaseManager::deleteStudyBeingRetrieved()
             }
         }
 
-        setNoStudyBeingRetrieved();
+        setNoStudyBeingRetrieved(studyInstanceUID);
     }
 }
 
@@ -958,8 +1007,12 @@ void LocalDatabaseManager::save(Patient *patient)
         foreach (Study *study, patient->getStudies())
         {
             createStudyThumbnails(study);
+            LocalCacheStorage::instance()->updateStudySize(study->getInstanceUID());
         }
 
+        // The patient has new studies, so the related studies found before can be outdated. The cache is created in the main thread at startup
+        RelatedStudiesQueryCache::instance()->invalidatePatient(patient->getID(), patient->getFullName());
+
         m_lastError = Ok;
     }
     catch (const QSqlError &error)
@@ -978,27 +1031,29 @@ void LocalDatabaseManager::freeUpSpaceDeletingStudies(quint64 megabytesToFreeUp)
         return;
     }
 
-    quint64 megabytesErased = 0;
-
-    while (!studyList.isEmpty() && megabytesErased < megabytesToFreeUp)
+    // The files of the studies being retrieved are being written, so they can't be deleted
+    QStringList studiesBeingRetrieved;
     {
-        Study *study = studyList.takeFirst();
-        emit studyWillBeDeleted(study->getInstanceUID());
-        megabytesErased += HardDiskInformation::getDirectorySizeInBytes(getCachePath() + study->getInstanceUID()) / 1024 / 1024;
-        deleteStudy(study->getInstanceUID());
-        delete study;
-
-        if (getLastError() != Ok)
-        {
-            break;
-        }
+        QMutexLocker locker(&studiesBeingRetrievedMutex);
+        studiesBeingRetrieved = Settings().getValue(InputOutputSettings::RetrievingStudy).toStringList();
     }
 
-    // Delete remaining studies (in case of error)
+    // The least recently used studies are chosen according to their known sizes, so that only the ones not measured yet have to be measured
+    QStringList studyInstanceUIDs;
+    quint64 megabytesToErase = 0;
+
     foreach (Study *study, studyList)
     {
+        if (megabytesToErase < megabytesToFreeUp && !studiesBeingRetrieved.contains(study->getInstanceUID()))
+        {
+            studyInstanceUIDs << study->getInstanceUID();
+            megabytesToErase += LocalCacheStorage::instance()->getStudySize(study->getInstanceUID()) / 1024 / 1024;
+        }
+
         delete study;
     }
+
+    deleteStudies(studyInstanceUIDs);
 }
 
 QList<Study*> LocalDatabaseManager::getAllStudiesOrderedByLastAccessDate()
@@ -1010,6 +1065,68 @@ QList<Study*> LocalDatabaseManager::getAllStudiesOrderedByLastAccessDate()
     return studyList;
 }
 
+void LocalDatabaseManager::deleteStudies(const QStringList &studyInstanceUIDs)
+{
+    m_lastError = Ok;
+
+    QElapsedTimer timer;
+    timer.start();
+    int numberOfDeletedStudies = 0;
+
+    while (numberOfDeletedStudies < studyInstanceUIDs.size())
+    {
+        if (m_studiesDeletionCancelled.loadAcquire())
+        {
+            INFO_LOG(QString("Studies deletion cancelled after deleting %1 of %2 studies").arg(numberOfDeletedStudies).arg(studyInstanceUIDs.size()));
+            break;
+        }
+
+        QStringList batch = studyInstanceUIDs.mid(numberOfDeletedStudies, StudiesDeletionBatchSize);
+
+        foreach (const QString &studyInstanceUID, batch)
+        {
+            emit studyWillBeDeleted(studyInstanceUID);
+        }
+
+        QStringList sopInstanceUIDs;
+
+        try
+        {
+            DatabaseConnection databaseConnection;
+            databaseConnection.beginTransaction();
+
+            foreach (const QString &studyInstanceUID, batch)
+            {
+                sopInstanceUIDs << querySOPInstanceUIDs(databaseConnection, studyInstanceUID, QString());
+                deleteStudyStructureFromDatabase(databaseConnection, studyInstanceUID);
+            }
+
+            databaseConnection.commitTransaction();
+        }
+        catch (const QSqlError &error)
+        {
+            setLastError(error);
+            break;
+        }
+
+        // Once the studies are no longer in the database their files can be deleted while the next batch is deleted from the database
+        foreach (const QString &studyInstanceUID, batch)
+        {
+            LocalCacheStorage::instance()->deleteStudyFiles(studyInstanceUID);
+        }
+
+        ThumbnailCache::instance()->removeThumbnails(sopInstanceUIDs);
+
+        numberOfDeletedStudies += batch.size();
+    }
+
+    if (numberOfDeletedStudies > 0)
+    {
+        INFO_LOG(QString("Deleted %1 studies from the local database in %2 ms, their files are being deleted in the background")
+                 .arg(numberOfDeletedStudies).arg(timer.elapsed()));
+    }
+}
+
 void LocalDatabaseManager::deleteStudyFromHardDisk(const QString &studyInstanceUID)
 {
     if (DirectoryUtilities().deleteDirectory(getStudyPath(studyInstanceUID), true))
@@ -15,7 +15,9 @@
 #ifndef UDGLOCALDATABASEMANAGER_H
 #define UDGLOCALDATABASEMANAGER_H
 
+#include <QAtomicInt>
 #include <QObject>
+#include <QStringList>
 
 class QSqlError;
 
@@ -89,7 +91,11 @@ public:
 
     /// Deletes studies that have not been open in a number of days specified in settings,
     /// as long as the setting to delete old studies is set to true, otherwise it does nothing.
+    /// The studies are deleted in batches and their files are deleted in the background.
     void deleteOldStudies();
+    /// Stops deleting studies in deleteOldStudies() or while freeing up space after the current batch, and prevents this instance from deleting
+    /// more studies that way. It can be called from any thread.
+    void cancelStudiesDeletion();
 
     /// Compacts the database.
     void compact();
@@ -101,23 +107,24 @@ public:
 
     /// Checks if there is enough space on the hard disk to download studies, according to settings.
     /// If there's not enough space it will (if enabled in settings) delete old studies to free up space.
+    /// The free space is estimated by LocalCacheStorage from the size of the cache, counting the files still being deleted in the background as free space.
     /// Returns true if at the end there's enough space and false otherwise.
     bool thereIsAvailableSpaceOnHardDisk();
 
     /// Saves a setting to know that a study with the given UID is being retrieved.
     /// This is saved in order to delete a half-downloaded study in case the
     /// application crashes in the middle of a download.
-    /// Note: only one study at a time can be marked as being retrieved.
+    /// Several studies can be marked as being retrieved at the same time.
     /// TODO should this really be here?
     void setStudyBeingRetrieved(const QString &studyInstanceUID);
-    /// Clears the setting set in the above method to indicated that no study is being retrieved.
+    /// Clears the mark set in the above method to indicate that the study with the given UID is no longer being retrieved.
     /// TODO should this really be here?
-    void setNoStudyBeingRetrieved();
+    void setNoStudyBeingRetrieved(const QString &studyInstanceUID);
     /// Return true if a study is being retrieved.
     /// TODO should this really be here?
     bool isAStudyBeingRetrieved() const;
-    /// If there is a study marked as being retrieved,
-    /// this method will delete its images and leave the database in a consistent state. This method is intended
+    /// If there are studies marked as being retrieved,
+    /// this method will delete their images and leave the database in a consistent state. This method is intended
     /// to delete a half-downloaded study in case the
     /// application crashes in the middle of a download. It should be called at the start of the application.
     /// TODO should this really be here?
@@ -133,7 +140,7 @@ public slots:
 
 signals:
     /// This signal is emitted before a study is deleted from
-    /// the local database and the disk to free up space.
+    /// the local database and the disk by deleteOldStudies() or to free up space.
     void studyWillBeDeleted(const QString &studyInstanceUID);
 
 private:
@@ -143,6 +150,10 @@ private:
     /// Returns all the studies sorted by last access date.
     QList<Study*> getAllStudiesOrderedByLastAccessDate();
 
+    /// Deletes the studies with the given UIDs from the database in batches, each one in a transaction, and deletes their files in the background.
+    /// Stops at the first error or when cancelStudiesDeletion() is called.
+    void deleteStudies(const QStringList &studyInstanceUIDs);
+
     /// Deletes the study with the given UID from the disk.
     void deleteStudyFromHardDisk(const QString &studyInstanceUID);
     /// Deletes the series with the given UID from the study with the given UID from the disk.
@@ -160,6 +171,9 @@ private:
     /// Last error encountered.
     LastError m_lastError;
 
+    /// Set by cancelStudiesDeletion() to stop deleting studies.
+    QAtomicInt m_studiesDeletionCancelled;
+
 };
 
 }
@@ -64,7 +64,7 @@ bool LocalDatabasePatientDAL::insert(Patient *patient)
     if (executeQueryAndLogError(query))
     {
         patient->setDatabaseID(query.lastInsertId().toLongLong());
-        return true;
+        return updateNameIndex(patient);
     }
     else
     {
@@ -78,7 +78,7 @@ bool LocalDatabasePatientDAL::update(const Patient *patient)
     query.prepare("UPDATE Patient SET DICOMPatientId = :dicomPatientId, Name = :name, BirthDate = :birthDate, Sex = :sex WHERE ID = :id");
     bindValues(query, patient);
     query.bindValue(":id", patient->getDatabaseID());
-    return executeQueryAndLogError(query);
+    return executeQueryAndLogError(query) && updateNameIndex(patient);
 }
 
 bool LocalDatabasePatientDAL::del(qlonglong patientID)
@@ -86,7 +86,16 @@ bool LocalDatabasePatientDAL::del(qlonglong patientID)
     QSqlQuery query = getNewQuery();
     query.prepare("DELETE FROM Patient WHERE ID = :id");
     query.bindValue(":id", patientID);
-    return executeQueryAndLogError(query);
+
+    if (!executeQueryAndLogError(query))
+    {
+        return false;
+    }
+
+    QSqlQuery nameIndexQuery = getNewQuery();
+    nameIndexQuery.prepare("DELETE FROM PatientNameIndex WHERE docid = :id");
+    nameIndexQuery.bindValue(":id", patientID);
+    return executeQueryAndLogError(nameIndexQuery);
 }
 
 QList<Patient*> LocalDatabasePatientDAL::query(const DicomMask &mask)
@@ -112,4 +121,93 @@ QList<Patient*> LocalDatabasePatientDAL::query(const DicomMask &mask)
     return patientList;
 }
 
+bool LocalDatabasePatientDAL::isNameIndexUpToDate()
+{
+    QSqlQuery query = getNewQuery();
+    query.prepare("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'PatientNameIndex'");
+
+    if (!executeQueryAndLogError(query) || !query.next() || query.value(0).toInt() == 0)
+    {
+        return false;
+    }
+
+    query.prepare("SELECT (SELECT count(*) FROM Patient) = (SELECT count(*) FROM PatientNameIndex)");
+
+    return executeQueryAndLogError(query) && query.next() && query.value(0).toBool();
+}
+
+bool LocalDatabasePatientDAL::rebuildNameIndex()
+{
+    if (!executeSql("CREATE VIRTUAL TABLE IF NOT EXISTS PatientNameIndex USING fts4(Name, prefix=\"2,3\")")
+        || !executeSql("DELETE FROM PatientNameIndex"))
+    {
+        return false;
+    }
+
+    QSqlQuery selectQuery = getNewQuery();
+    selectQuery.prepare("SELECT ID, Name FROM Patient");
+
+    if (!executeQueryAndLogError(selectQuery))
+    {
+        return false;
+    }
+
+    QSqlQuery insertQuery = getNewQuery();
+    insertQuery.prepare("INSERT INTO PatientNameIndex (docid, Name) VALUES (:id, :name)");
+
+    while (selectQuery.next())
+    {
+        insertQuery.bindValue(":id", selectQuery.value("ID").toLongLong());
+        insertQuery.bindValue(":name", getNormalizedName(convertToQString(selectQuery.value("Name"))));
+
+        if (!executeQueryAndLogError(insertQuery))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QString LocalDatabasePatientDAL::getNormalizedName(const QString &name)
+{
+    // In the canonical decomposition accents are separate characters that can be skipped
+    QString decomposedName = name.normalized(QString::NormalizationForm_D);
+    QString normalizedName;
+    normalizedName.reserve(decomposedName.size());
+
+    foreach (const QChar &character, decomposedName)
+    {
+        if (character.isLetterOrNumber())
+        {
+            normalizedName += character.toLower();
+        }
+        else if (character.category() != QChar::Mark_NonSpacing)
+        {
+            // Component separators (^ and =) and any other symbol
+            normalizedName += ' ';
+        }
+    }
+
+    return normalizedName.simplified();
+}
+
+bool LocalDatabasePatientDAL::updateNameIndex(const Patient *patient)
+{
+    QSqlQuery deleteQuery = getNewQuery();
+    deleteQuery.prepare("DELETE FROM PatientNameIndex WHERE docid = :id");
+    deleteQuery.bindValue(":id", patient->getDatabaseID());
+
+    if (!executeQueryAndLogError(deleteQuery))
+    {
+        return false;
+    }
+
+    QSqlQuery insertQuery = getNewQuery();
+    insertQuery.prepare("INSERT INTO PatientNameIndex (docid, Name) VALUES (:id, :name)");
+    insertQuery.bindValue(":id", patient->getDatabaseID());
+    insertQuery.bindValue(":name", getNormalizedName(patient->getFullName()));
+    return executeQueryAndLogError(insertQuery);
+}
+
 }
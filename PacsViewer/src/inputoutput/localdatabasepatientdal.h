@@ -42,6 +42,21 @@ public:
     /// Retrieves from the database the patients that match the given mask (only PatientId is considered) and returns them in a list.
     QList<Patient*> query(const DicomMask &mask);
 
+    /// Returns true if the full-text index of patient names exists and has an entry for each patient, and false otherwise.
+    bool isNameIndexUpToDate();
+
+    /// Creates the full-text index of patient names if it doesn't exist and fills it again with the names of all the patients.
+    /// It should be called inside a transaction. Returns true if successful and false otherwise.
+    bool rebuildNameIndex();
+
+    /// Returns the given patient name normalized as it's stored in the full-text index: only lowercase letters without accents and digits,
+    /// with each name component separated by a space. E.g. "MUÑOZ^JOSÉ MARÍA" is normalized to "munoz jose maria".
+    static QString getNormalizedName(const QString &name);
+
+private:
+    /// Replaces the entry of the given patient in the full-text index of patient names. Returns true if successful and false otherwise.
+    bool updateNameIndex(const Patient *patient);
+
 };
 
 }
@@ -15,6 +15,7 @@
 #include "localdatabasestudydal.h"
 
 #include "dicommask.h"
+#include "localdatabasepatientdal.h"
 #include "patient.h"
 #include "study.h"
 
@@ -103,6 +104,11 @@ void prepareSelectFromStudyPatient(QSqlQuery &query, const DicomMask &mask, cons
                           "Patient.ID AS Patient_ID, Patient.DICOMPatientId AS Patient_DICOMPatientId, Patient.Name AS Patient_Name, "
                           "Patient.BirthDate AS Patient_BirthDate, Patient.Sex AS Patient_Sex "
                    "FROM Study, Patient");
+    // Each word of the name must be the prefix of a word of the patient name
+    QStringList nameWords = LocalDatabasePatientDAL::getNormalizedName(mask.getPatientName()).split(' ', QString::SkipEmptyParts);
+    QString nameMatchExpression = nameWords.isEmpty() ? QString() : nameWords.join("* ") + "*";
+
+    // Patient id and name are searched in subqueries so that the indexes of the patient table can be used to find the studies
     QString where(" WHERE PatientID = Patient_ID");
     if (!mask.getStudyInstanceUID().isEmpty())
     {
@@ -110,11 +116,11 @@ void prepareSelectFromStudyPatient(QSqlQuery &query, const DicomMask &mask, cons
     }
     if (!mask.getPatientID().isEmpty() && mask.getPatientID() != "*")
     {
-        where += " AND Patient_DICOMPatientId LIKE :patient_dicomPatientId";
+        where += " AND PatientID IN (SELECT ID FROM Patient WHERE DICOMPatientId LIKE :patient_dicomPatientId)";
     }
-    if (!mask.getPatientName().isEmpty() && mask.getPatientName() != "*")
+    if (!nameMatchExpression.isEmpty())
     {
-        where += " AND Patient_Name LIKE :patient_patientName";
+        where += " AND PatientID IN (SELECT docid FROM PatientNameIndex WHERE PatientNameIndex MATCH :patient_patientName)";
     }
     if (mask.getStudyDateMinimum().isValid())
     {
@@ -148,9 +154,9 @@ void prepareSelectFromStudyPatient(QSqlQuery &query, const DicomMask &mask, cons
     {
         query.bindValue(":patient_dicomPatientId", QString("%1").arg(mask.getPatientID().replace("*", "%")));
     }
-    if (!mask.getPatientName().isEmpty() && mask.getPatientName() != "*")
+    if (!nameMatchExpression.isEmpty())
     {
-        query.bindValue(":patient_patientName", QString("%%1%").arg(mask.getPatientName().replace("*", "")));
+        query.bindValue(":patient_patientName", nameMatchExpression);
     }
     if (mask.getStudyDateMinimum().isValid())
     {
@@ -277,6 +283,56 @@ qlonglong LocalDatabaseStudyDAL::getPatientIDFromStudyInstanceUID(const QString
     }
 }
 
+bool LocalDatabaseStudyDAL::updateSize(const QString &studyInstanceUID, qint64 size)
+{
+    QSqlQuery query = getNewQuery();
+    query.prepare("UPDATE Study SET Size = :size WHERE InstanceUID = :instanceUID");
+    query.bindValue(":size", size);
+    query.bindValue(":instanceUID", studyInstanceUID);
+    return executeQueryAndLogError(query);
+}
+
+QHash<QString, qint64> LocalDatabaseStudyDAL::querySizes()
+{
+    QSqlQuery query = getNewQuery();
+    query.prepare("SELECT InstanceUID, Size FROM Study");
+    QHash<QString, qint64> sizes;
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            sizes.insert(query.value(0).toString(), query.value(1).isNull() ? -1 : query.value(1).toLongLong());
+        }
+    }
+
+    return sizes;
+}
+
+bool LocalDatabaseStudyDAL::hasSizeColumn()
+{
+    QSqlQuery query = getNewQuery();
+    query.prepare("PRAGMA table_info(Study)");
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            if (query.value("name").toString() == "Size")
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool LocalDatabaseStudyDAL::addSizeColumn()
+{
+    return executeSql("ALTER TABLE Study ADD COLUMN Size INTEGER");
+}
+
 Study* LocalDatabaseStudyDAL::getStudy(const QSqlQuery &query)
 {
     Study *study = new Study();
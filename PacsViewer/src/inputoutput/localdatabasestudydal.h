@@ -18,6 +18,7 @@
 #include "localdatabasebasedal.h"
 
 #include <QDate>
+#include <QHash>
 
 namespace udg {
 
@@ -53,6 +54,7 @@ public:
     /// Retrieves from the database the patients that contain studies that match the given mask (patient id, patient name, study date, study instance UID and
     /// modalities are considered) and whose last access date is in the range (\a accessedBefore, \a accessedAfter], and returns the patients in a list.
     /// For each matching study a Patient object with one Study object will be returned, so there may be multiple Patient objects representing the same patient.
+    /// A patient name matches if each one of its words is the beginning of a word of the name of the patient, ignoring case and accents.
     QList<Patient*> queryPatientStudy(const DicomMask &mask, const QDate &accessedBefore = QDate(), const QDate &accessedAfter = QDate());
 
     /// Returns true if there's a study with the given UID in the database, and false otherwise.
@@ -62,6 +64,19 @@ public:
     /// If there is no such study, returns -1.
     qlonglong getPatientIDFromStudyInstanceUID(const QString &studyInstanceUID);
 
+    /// Saves the given size in bytes of the files of the study with the given UID. Returns true if successful and false otherwise.
+    bool updateSize(const QString &studyInstanceUID, qint64 size);
+
+    /// Returns the size in bytes of the files of every study in the database, indexed by StudyInstanceUID. The size of the studies that haven't been
+    /// measured yet is -1.
+    QHash<QString, qint64> querySizes();
+
+    /// Returns true if the Study table has the Size column, and false otherwise. Databases created before revision 9596 don't have it.
+    bool hasSizeColumn();
+
+    /// Adds the Size column to the Study table. Returns true if successful and false otherwise.
+    bool addSizeColumn();
+
 private:
     /// Creates and returns a study with the information of the current row of the given query.
     static Study* getStudy(const QSqlQuery &query);
@@ -98,6 +98,46 @@ bool LocalDatabaseVoiLutDAL::insert(const VoiLut &voiLut, const Image *image)
     return executeQueryAndLogError(query);
 }
 
+bool LocalDatabaseVoiLutDAL::replace(const QList<Image*> &images)
+{
+    // The same prepared statements are reused for all the images
+    QSqlQuery deleteQuery = getNewQuery();
+    deleteQuery.prepare("DELETE FROM VoiLut WHERE ImageInstanceUID = :imageInstanceUID AND ImageFrameNumber = :imageFrameNumber");
+    QSqlQuery insertQuery = getNewQuery();
+    insertQuery.prepare("INSERT INTO VoiLut (Lut, ImageInstanceUID, ImageFrameNumber) VALUES (:lut, :imageInstanceUID, :imageFrameNumber)");
+
+    foreach (const Image *image, images)
+    {
+        deleteQuery.bindValue(":imageInstanceUID", image->getSOPInstanceUID());
+        deleteQuery.bindValue(":imageFrameNumber", image->getFrameNumber());
+
+        if (!executeQueryAndLogError(deleteQuery))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < image->getNumberOfVoiLuts(); i++)
+        {
+            const VoiLut &voiLut = image->getVoiLut(i);
+
+            // Only actual LUTs are stored in this table, window levels are stored with the image
+            if (voiLut.isLut())
+            {
+                insertQuery.bindValue(":lut", getByteArray(voiLut));
+                insertQuery.bindValue(":imageInstanceUID", image->getSOPInstanceUID());
+                insertQuery.bindValue(":imageFrameNumber", image->getFrameNumber());
+
+                if (!executeQueryAndLogError(insertQuery))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 bool LocalDatabaseVoiLutDAL::del(const DicomMask &mask)
 {
     QSqlQuery query = getNewQuery();
@@ -122,4 +162,22 @@ QList<VoiLut> LocalDatabaseVoiLutDAL::query(const DicomMask &mask)
     return voiLutList;
 }
 
+QHash<QPair<QString, int>, QList<VoiLut> > LocalDatabaseVoiLutDAL::queryGroupedByImage(const DicomMask &mask)
+{
+    QSqlQuery query = getNewQuery();
+    prepareQueryWithMask(query, mask, "SELECT Lut, ImageInstanceUID, ImageFrameNumber FROM VoiLut");
+    QHash<QPair<QString, int>, QList<VoiLut> > voiLutsByImage;
+
+    if (executeQueryAndLogError(query))
+    {
+        while (query.next())
+        {
+            QPair<QString, int> image(query.value("ImageInstanceUID").toString(), query.value("ImageFrameNumber").toInt());
+            voiLutsByImage[image].append(getVoiLut(query.value("Lut").toByteArray()));
+        }
+    }
+
+    return voiLutsByImage;
+}
+
 } // namespace udg
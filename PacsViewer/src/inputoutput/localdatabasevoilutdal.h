@@ -17,6 +17,9 @@
 
 #include "localdatabasebasedal.h"
 
+#include <QHash>
+#include <QPair>
+
 namespace udg {
 
 class DicomMask;
@@ -34,12 +37,20 @@ public:
     /// Inserts to the database the given VOI LUT from the given image. Returns true if successful and false otherwise.
     bool insert(const VoiLut &voiLut, const Image *image);
 
+    /// Replaces the VOI LUTs in the database of each one of the given images with the ones that are LUTs in the image now. The statements are prepared
+    /// only once for all the images, so it's much faster than replacing them image by image. Returns true if successful and false otherwise.
+    bool replace(const QList<Image*> &images);
+
     /// Deletes from the database the VOI LUTs that match the given mask. Returns true if successful and false otherwise.
     bool del(const DicomMask &mask);
 
     /// Retrieves from the database the VOI LUTs that match the given mask and returns them in a list.
     QList<VoiLut> query(const DicomMask &mask);
 
+    /// Retrieves from the database with a single query the VOI LUTs that match the given mask and returns them grouped by image.
+    /// The key of each group is the SOP Instance UID and the frame number of the image.
+    QHash<QPair<QString, int>, QList<VoiLut> > queryGroupedByImage(const DicomMask &mask);
+
 };
 
 } // namespace udg
@@ -78,10 +78,20 @@ OFCondition PACSConnection::configureMove()
                                       transferSyntaxes, DIM_OF(transferSyntaxes) /*number of TransferSyntaxes*/);
 }
 
+void PACSConnection::setTransferSyntaxesToSend(const QHash<QString, QSet<QString> > &transferSyntaxesBySOPClass)
+{
+    m_transferSyntaxesToSendBySOPClass = transferSyntaxesBySOPClass;
+}
+
 /// TODO Study if the best default transferSyntax is
 /// UID_LittleEndianExplicitTransferSyntax or as the case of move is JPegLossLess
 OFCondition PACSConnection::configureStore()
 {
+    if (!m_transferSyntaxesToSendBySOPClass.isEmpty())
+    {
+        return configureStoreWithTransferSyntaxesToSend();
+    }
+
     /// Each SOP Class will be proposed in two presentation contexts
     /// (unless the opt_combineProposedTransferSyntaxes global variable is true).
     /// The command line specified a preferred transfer syntax to use.
@@ -194,6 +204,65 @@ OFCondition PACSConnection::configureStore()
     return condition;
 }
 
+OFCondition PACSConnection::configureStoreWithTransferSyntaxesToSend()
+{
+    QSet<QString> uncompressedSyntaxes;
+    uncompressedSyntaxes << UID_LittleEndianExplicitTransferSyntax << UID_BigEndianExplicitTransferSyntax << UID_LittleEndianImplicitTransferSyntax;
+
+    QList<const char*> fallbackSyntaxes;
+    fallbackSyntaxes.append(UID_LittleEndianExplicitTransferSyntax);
+    fallbackSyntaxes.append(UID_BigEndianExplicitTransferSyntax);
+    fallbackSyntaxes.append(UID_LittleEndianImplicitTransferSyntax);
+
+    // Each SOP class is proposed in a presentation context for each of the encapsulated transfer syntaxes of its files, so that the PACS can
+    // accept them separately, and in a presentation context with the uncompressed ones, which is used for the rest of files and for the ones
+    // whose transfer syntax is not accepted. An empty transfer syntax stands for the uncompressed ones.
+    QList<QPair<QString, QByteArray> > presentationContexts;
+
+    for (QHash<QString, QSet<QString> >::const_iterator it = m_transferSyntaxesToSendBySOPClass.constBegin();
+         it != m_transferSyntaxesToSendBySOPClass.constEnd(); ++it)
+    {
+        foreach (const QString &transferSyntax, it.value())
+        {
+            if (!uncompressedSyntaxes.contains(transferSyntax))
+            {
+                presentationContexts << qMakePair(it.key(), transferSyntax.toLatin1());
+            }
+        }
+
+        presentationContexts << qMakePair(it.key(), QByteArray());
+    }
+
+    // There can be no more than 128 presentation contexts, since their id's must be odd and not greater than 255
+    if (presentationContexts.size() > 128)
+    {
+        INFO_LOG(QString("The files to send need %1 presentation contexts, the default ones will be proposed").arg(presentationContexts.size()));
+        m_transferSyntaxesToSendBySOPClass.clear();
+        return configureStore();
+    }
+
+    OFCondition condition = EC_Normal;
+    int presentationContextID = 1;
+
+    for (int i = 0; i < presentationContexts.size() && condition.good(); i++)
+    {
+        if (presentationContexts.at(i).second.isEmpty())
+        {
+            condition = addPresentationContext(presentationContextID, presentationContexts.at(i).first, fallbackSyntaxes);
+        }
+        else
+        {
+            condition = addPresentationContext(presentationContextID, presentationContexts.at(i).first,
+                                               QList<const char*>() << presentationContexts.at(i).second.constData());
+        }
+
+        // Only odd presentation context id's
+        presentationContextID += 2;
+    }
+
+    return condition;
+}
+
 OFCondition PACSConnection::addPresentationContext(int presentationContextId, const QString &abstractSyntax, QList<const char*> transferSyntaxList)
 {
     // Create an array of supported/possible transfer syntaxes
@@ -266,7 +335,7 @@ bool PACSConnection::connectToPACS(PACSServiceToRequest pacsServiceToRequest)
 
     /// Inicialitzem l'objecte network però la connexió no s'obre fins
     /// a l'invocacació del mètode ASC_requestAssociation
-    m_associationNetwork = initializeAssociationNetwork(pacsServiceToRequest);
+    m_associationNetwork = initializeAssociationNetwork();
 
     if (m_associationNetwork == NULL)
     {
@@ -295,15 +364,6 @@ bool PACSConnection::connectToPACS(PACSServiceToRequest pacsServiceToRequest)
                   + m_pacs.getAETitle() + ", adress: " +
                   constructPacsServerAddress(pacsServiceToRequest, m_pacs) + ". Descripcio error: " + QString(condition.text()));
 
-        /// If we have not been able to connect to the PACS and it is a download we will have opened the
-        /// port to receive DICOM incoming connections, of course we can download
-        /// images because we were unable to connect to the PACS alone ·
-        /// bid for the download, we close the local port waiting for incoming connections.
-        if (pacsServiceToRequest == RetrieveDICOMFiles)
-        {
-            disconnect();
-        }
-
         return false;
     }
 
@@ -371,16 +431,15 @@ QString PACSConnection::constructPacsServerAddress(PACSServiceToRequest pacsServ
     return pacsServerAddress;
 }
 
-T_ASC_Network* PACSConnection::initializeAssociationNetwork(PACSServiceToRequest pacsServiceToRequest)
+T_ASC_Network* PACSConnection::initializeAssociationNetwork()
 {
     Settings settings;
-    // If it is not a download we indicate port0
-    int networkPort = pacsServiceToRequest == RetrieveDICOMFiles ? settings.getValue(InputOutputSettings::IncomingDICOMConnectionsPort).toInt() : 0;
+    // We only request associations. The files of a download are received through the incoming DICOM connections port, which is opened by
+    // IncomingDICOMConnectionsDispatcher for all the downloads
     int timeout = settings.getValue(InputOutputSettings::PACSConnectionTimeout).toInt();
-    T_ASC_NetworkRole networkRole = pacsServiceToRequest == RetrieveDICOMFiles ? NET_ACCEPTORREQUESTOR : NET_REQUESTOR;
     T_ASC_Network *associationNetwork;
 
-    OFCondition condition = ASC_initializeNetwork(networkRole, networkPort, timeout, &associationNetwork);
+    OFCondition condition = ASC_initializeNetwork(NET_REQUESTOR, 0, timeout, &associationNetwork);
     if (!condition.good())
     {
         ERROR_LOG("Could not initialize network object, despripcio error" + QString(condition.text()));
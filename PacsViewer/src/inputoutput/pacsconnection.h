@@ -17,6 +17,9 @@
 
 #include "pacsdevice.h"
 
+#include <QHash>
+#include <QSet>
+
 struct T_ASC_Network;
 struct T_ASC_Parameters;
 struct T_ASC_Association;
@@ -46,6 +49,11 @@ public:
     /// @return returns the status of the connection
     virtual bool connectToPACS(PACSServiceToRequest pacsServiceToRequest);
 
+    /// Sets the transfer syntaxes of the files that will be sent, grouped by SOP class. When connecting to send files, only these SOP classes are
+    /// proposed, each one with its transfer syntaxes so that the files can be sent without transcoding them, and with the uncompressed ones as
+    /// fallback. If it's empty, or there are too many presentation contexts, the default SOP classes and transfer syntaxes are proposed.
+    void setTransferSyntaxesToSend(const QHash<QString, QSet<QString> > &transferSyntaxesBySOPClass);
+
     /// Returns the PACS parameters
     /// @return Pacs parameters
     PacsDevice getPacs();
@@ -84,6 +92,10 @@ private:
     /// @return returns the status of the configuration
     OFCondition configureStore();
 
+    /// Configures the connection to save in the pacs files with the SOP classes and transfer syntaxes set with setTransferSyntaxesToSend().
+    /// @return returns the status of the configuration
+    OFCondition configureStoreWithTransferSyntaxesToSend();
+
     /// Construct the server address in ip: port format, to connect to the PACS
     /// @param server address
     /// @param server port
@@ -101,7 +113,7 @@ private:
     /// simply initializes the object with the data needed to be able to
     /// open connection, who opens the connection is by invoking the method
     /// from dcmtk ASC_requestAssociation within the connect connect () method;
-    T_ASC_Network* initializeAssociationNetwork(PACSServiceToRequest modality);
+    T_ASC_Network* initializeAssociationNetwork();
 
     /// Fill the array passed by parameters with the syntax transfer to
     /// use for connections to make FIND or Move
@@ -119,6 +131,8 @@ private:
     /// The association is the communication channel used for the exchange
     /// of information between DICOM devices (it is the connection with the PACS)
     T_ASC_Association *m_dicomAssociation;
+    /// Transfer syntaxes of the files to send by SOP class
+    QHash<QString, QSet<QString> > m_transferSyntaxesToSendBySOPClass;
 };
 };
 #endif
@@ -23,6 +23,7 @@
 #include "querypacsjob.h"
 #include "pacsjob.h"
 #include "inputoutputsettings.h"
+#include "retrievedicomfilesfrompacsqueuepolicy.h"
 
 namespace udg {
 
@@ -46,9 +47,14 @@ PacsManager::PacsManager()
     m_sendDICOMFilesToPACSQueue = new ThreadWeaver::Queue();
     m_sendDICOMFilesToPACSQueue->setMaximumNumberOfThreads(settings.getValue(InputOutputSettings::MaximumPACSConnections).toInt());
 
+    // Several studies can be retrieved at the same time, since the files are received through the incoming DICOM connections port shared by all the
+    // retrieves. Besides the global limit, the policy limits the retrieves from each PACS and doesn't let the same study be retrieved twice at a time
     m_retrieveDICOMFilesFromPACSQueue = new ThreadWeaver::Queue();
-    // Només podem descarregar un estudi a la vegada del PACS, per això com a número màxim de threads especifiquem 1
-    m_retrieveDICOMFilesFromPACSQueue ->setMaximumNumberOfThreads(1);
+    m_retrieveDICOMFilesFromPACSQueue->setMaximumNumberOfThreads(qMax(1, settings.getValue(InputOutputSettings::MaximumConcurrentRetrieves).toInt()));
+
+    m_retrieveDICOMFilesFromPACSQueuePolicy = new RetrieveDICOMFilesFromPACSQueuePolicy();
+    m_retrieveDICOMFilesFromPACSQueuePolicy->setMaximumNumberOfConcurrentRetrievesPerPACS(
+                settings.getValue(InputOutputSettings::MaximumConcurrentRetrievesPerPACS).toInt());
 }
 
 void PacsManager::enqueuePACSJob(PACSJobPointer pacsJob)
@@ -61,6 +67,7 @@ void PacsManager::enqueuePACSJob(PACSJobPointer pacsJob)
             m_sendDICOMFilesToPACSQueue->enqueue(pacsJob);
             break;
         case PACSJob::RetrieveDICOMFilesFromPACSJobType:
+            pacsJob->assignQueuePolicy(m_retrieveDICOMFilesFromPACSQueuePolicy);
             m_retrieveDICOMFilesFromPACSQueue->enqueue(pacsJob);
             break;
         case PACSJob::QueryPACS:
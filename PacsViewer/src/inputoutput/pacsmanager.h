@@ -27,6 +27,7 @@
 namespace udg {
 
 class DicomMask;
+class RetrieveDICOMFilesFromPACSQueuePolicy;
 
 /**
     Classe manager que ens permet comunicar-nos amb el PACS
@@ -81,6 +82,8 @@ private:
     ThreadWeaver::Queue *m_queryQueue;
     ThreadWeaver::Queue *m_sendDICOMFilesToPACSQueue;
     ThreadWeaver::Queue *m_retrieveDICOMFilesFromPACSQueue;
+    /// Limits the concurrent retrieves from each PACS and of each study
+    RetrieveDICOMFilesFromPACSQueuePolicy *m_retrieveDICOMFilesFromPACSQueuePolicy;
 };
 
 };  //  end  namespace udg
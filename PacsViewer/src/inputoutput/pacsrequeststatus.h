@@ -36,9 +36,11 @@ public:
     /// MoveDestinationAETileUnknownStatus: PACS does not have our AETitle registered to allow you to download
     /// MoveWarningStatus: Failed to download any of the requested files
     /// RetrieveIncomingDICOMConnectionsPortInUse: The port to receive incoming connections to receive files is in use
+    /// RetrieveStudyAlreadyBeingRetrieved: Another download of the same study is in progress
     enum RetrieveRequestStatus { RetrieveOk, RetrieveDatabaseError, RetrieveCanNotConnectToPACS, RetrieveNoEnoughSpace, RetrieveErrorFreeingSpace,
                                  RetrievePatientInconsistent, RetrieveDestinationAETileUnknown, RetrieveIncomingDICOMConnectionsPortInUse,
-                                 RetrieveFailureOrRefused, RetrieveSomeDICOMFilesFailed, RetrieveCancelled, RetrieveUnknowStatus };
+                                 RetrieveFailureOrRefused, RetrieveSomeDICOMFilesFailed, RetrieveCancelled, RetrieveStudyAlreadyBeingRetrieved,
+                                 RetrieveUnknowStatus };
 
     ///Errors that can occur when doing Queries in PACS
     enum QueryRequestStatus { QueryOk, QueryCanNotConnectToPACS, QueryFailedOrRefused, QueryCancelled, QueryUnknowStatus };
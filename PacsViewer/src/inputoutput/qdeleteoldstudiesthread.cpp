@@ -29,6 +29,11 @@ void QDeleteOldStudiesThread::deleteOldStudies()
     start();
 }
 
+void QDeleteOldStudiesThread::cancel()
+{
+    m_localDatabaseManager.cancelStudiesDeletion();
+}
+
 LocalDatabaseManager::LastError QDeleteOldStudiesThread::getLastError()
 {
     return m_lastError;
@@ -36,11 +41,9 @@ LocalDatabaseManager::LastError QDeleteOldStudiesThread::getLastError()
 
 void QDeleteOldStudiesThread::run()
 {
-    LocalDatabaseManager localDatabaseManager;
-
-    localDatabaseManager.deleteOldStudies();
+    m_localDatabaseManager.deleteOldStudies();
 
-    m_lastError = localDatabaseManager.getLastError();
+    m_lastError = m_localDatabaseManager.getLastError();
 
     emit finished();
 }
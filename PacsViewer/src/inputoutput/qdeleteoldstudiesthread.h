@@ -35,6 +35,9 @@ public:
     ///Delete old studies by starting a thread
     void deleteOldStudies();
 
+    /// Stops deleting old studies after the current batch. The files of the studies already deleted from the database are still deleted.
+    void cancel();
+
     /// Returns the status of the operation to delete old studies
     LocalDatabaseManager::LastError getLastError();
 
@@ -48,6 +51,9 @@ private:
 
     LocalDatabaseManager::LastError m_lastError;
 
+    /// Used from the thread to delete the old studies
+    LocalDatabaseManager m_localDatabaseManager;
+
 };
 
 }
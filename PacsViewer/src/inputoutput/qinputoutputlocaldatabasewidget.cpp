@@ -76,6 +76,9 @@ QInputOutputLocalDatabaseWidget::~QInputOutputLocalDatabaseWidget()
     settings.setValue(InputOutputSettings::LocalDatabaseStudyListSortByColumn, m_studyTreeWidget->getSortColumn());
     settings.setValue(InputOutputSettings::LocalDatabaseStudyListSortOrder, m_studyTreeWidget->getSortOrderColumn());
 
+    // The thread can't be destroyed while it's running
+    m_qdeleteOldStudiesThread.cancel();
+    m_qdeleteOldStudiesThread.wait();
 }
 
 void QInputOutputLocalDatabaseWidget::createConnections()
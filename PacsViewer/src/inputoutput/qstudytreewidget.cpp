@@ -64,6 +64,8 @@ QStudyTreeWidget::QStudyTreeWidget(QWidget *parent)
     createConnections();
 
     m_studyTreeView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    // All the rows have the same height, so the view doesn't have to measure every item to lay out the visible ones
+    m_studyTreeView->setUniformRowHeights(true);
 
     /// We indicate that the maximum level at which the
     /// Study / Series / Image tree can be issued by default is up to Image level
@@ -97,11 +99,17 @@ void QStudyTreeWidget::insertPatientList(QList<Patient*> patientList)
 {
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
 
+    // Sorting is disabled while inserting, so that the items are sorted once at the end instead of placing each one in its sorted position
+    bool sortingEnabled = m_studyTreeView->isSortingEnabled();
+    m_studyTreeView->setSortingEnabled(false);
+
     foreach (Patient *patient, patientList)
     {
         insertPatient(patient);
     }
 
+    m_studyTreeView->setSortingEnabled(sortingEnabled);
+
     QApplication::restoreOverrideCursor();
 }
 
@@ -109,9 +117,15 @@ void QStudyTreeWidget::insertPatient(Patient *patient)
 {
     if (patient->getNumberOfStudies() > 0)
     {
-        m_studyTreeView->addTopLevelItems(fillPatient(patient));
+        QList<QTreeWidgetItem*> studyItems = fillPatient(patient);
+        m_studyTreeView->addTopLevelItems(studyItems);
         m_studyTreeView->clearSelection();
 
+        foreach (QTreeWidgetItem *studyItem, studyItems)
+        {
+            m_studyItemsByUID[studyItem->text(UID)].append(studyItem);
+        }
+
         /// There are studies that can share the same patient object,
         /// for example in DICOMDIR where the same patient has more than one study
         m_addedPatients.append(patient);
@@ -127,9 +141,13 @@ void QStudyTreeWidget::insertSeriesList(const QString &studyInstanceUID, QList<S
         return;
     }
 
+    QHash<QString, QTreeWidgetItem*> &seriesItemsByUID = m_seriesItemsByStudyItem[studyItem];
+
     foreach (Series *series, seriesList)
     {
-        studyItem->addChild(fillSeries(series));
+        QTreeWidgetItem *seriesItem = fillSeries(series);
+        studyItem->addChild(seriesItem);
+        seriesItemsByUID.insert(series->getInstanceUID(), seriesItem);
         /// FIXME: The Series object inherits from QObject, when a setParentStudy is done to it,
         /// as a parent of the Series QObject it is assigned the study object
         /// this assignment fails if series and study have been created in different
@@ -178,7 +196,7 @@ void QStudyTreeWidget::removeStudy(const QString &studyInstanceUIDToRemove, cons
 
     if (studyItem)
     {
-        delete studyItem;
+        deleteStudyItem(studyItem);
     }
 
     m_studyTreeView->clearSelection();
@@ -199,7 +217,7 @@ void QStudyTreeWidget::removeSeries(const QString &studyInstanceUID, const QStri
         }
         else
         {
-            delete seriesItem;
+            deleteSeriesItem(seriesItem);
         }
     }
 
@@ -353,6 +371,8 @@ void QStudyTreeWidget::setCurrentSeries(const QString &studyInstanceUID, const Q
 void QStudyTreeWidget::clear()
 {
     m_studyTreeView->clear();
+    m_studyItemsByUID.clear();
+    m_seriesItemsByStudyItem.clear();
 
     qDeleteAll(m_addedImagesByDICOMItemID);
     qDeleteAll(m_adddSeriesByDICOMItemID);
@@ -380,13 +400,9 @@ void QStudyTreeWidget::initialize()
 
 QTreeWidgetItem* QStudyTreeWidget::getStudyQTreeWidgetItem(const QString &studyUID, const DICOMSource &studyDICOMSource)
 {
-    QList<QTreeWidgetItem*> qTreeWidgetItemsStudy(m_studyTreeView->findItems(studyUID, Qt::MatchExactly, UID));
-
-    foreach(QTreeWidgetItem *studyItem, qTreeWidgetItemsStudy)
+    foreach (QTreeWidgetItem *studyItem, m_studyItemsByUID.value(studyUID))
     {
-        if (isItemStudy(studyItem) && (getStudyByDICOMItemID(
-                                           studyItem->text(DICOMItemID).toInt())->getDICOMSource() == studyDICOMSource
-                                       || !m_useDICOMSourceToDiscriminateStudies))
+        if (!m_useDICOMSourceToDiscriminateStudies || getStudyByDICOMItemID(studyItem->text(DICOMItemID).toInt())->getDICOMSource() == studyDICOMSource)
         {
             return studyItem;
         }
@@ -405,15 +421,27 @@ QTreeWidgetItem* QStudyTreeWidget::getSeriesQTreeWidgetItem(const QString &study
         return NULL;
     }
 
-    for (int index = 0; index < studyItem->childCount(); index++)
+    return m_seriesItemsByStudyItem.value(studyItem).value(seriesInstanceUID);
+}
+
+void QStudyTreeWidget::deleteStudyItem(QTreeWidgetItem *studyItem)
+{
+    QList<QTreeWidgetItem*> &studyItemsWithSameUID = m_studyItemsByUID[studyItem->text(UID)];
+    studyItemsWithSameUID.removeOne(studyItem);
+
+    if (studyItemsWithSameUID.isEmpty())
     {
-        if (studyItem->child(index)->text(UID) == seriesInstanceUID)
-        {
-            return studyItem->child(index);
-        }
+        m_studyItemsByUID.remove(studyItem->text(UID));
     }
 
-    return NULL;
+    m_seriesItemsByStudyItem.remove(studyItem);
+    delete studyItem;
+}
+
+void QStudyTreeWidget::deleteSeriesItem(QTreeWidgetItem *seriesItem)
+{
+    m_seriesItemsByStudyItem[seriesItem->parent()].remove(seriesItem->text(UID));
+    delete seriesItem;
 }
 
 bool QStudyTreeWidget::isItemStudy(QTreeWidgetItem *item)
@@ -438,7 +466,7 @@ QList<QTreeWidgetItem*> QStudyTreeWidget::fillPatient(Patient *patient)
     foreach (Study *studyToInsert, patient->getStudies())
     {
         //// If the study already exists in StudyTreeView we delete it
-        removeStudy(patient->getStudies().at(0)->getInstanceUID(), patient->getStudies().at(0)->getDICOMSource());
+        removeStudy(studyToInsert->getInstanceUID(), studyToInsert->getDICOMSource());
 
         // We insert the study in the list of studies
         m_addedStudiesByDICOMItemID[m_nextIDICOMItemIDOfStudy] = studyToInsert;
@@ -703,6 +731,7 @@ void QStudyTreeWidget::itemExpanded(QTreeWidgetItem *itemExpanded)
 
         if (isItemStudy(itemExpanded))
         {
+            m_seriesItemsByStudyItem.remove(itemExpanded);
             itemExpanded->setIcon(ObjectName, m_iconOpenStudy);
             emit (requestedSeriesOfStudy(getStudyByDICOMItemID(itemExpanded->text(DICOMItemID).toInt())));
         }
@@ -17,6 +17,7 @@
 
 #include "ui_qstudytreewidgetbase.h"
 
+#include <QHash>
 #include <QMenu>
 #include <QList>
 
@@ -49,6 +50,8 @@ which allows us to establish whether studies should be discriminated apart from
 by DICOMSource as well. Depending on what is established, studies with
 the same UID but different DICOMSource will be considered as the same study (duplicates) or will be considered
 as different studies.
+
+Study and series items are indexed by UID, so that finding, inserting and removing them doesn't depend on the number of items in the tree.
 */
 class QStudyTreeWidget : public QWidget, private Ui::QStudyTreeWidgetBase {
     Q_OBJECT
@@ -192,6 +195,11 @@ private:
     ///Returns the QTtreeWidgeItem Object that is from the studio and series
     QTreeWidgetItem* getSeriesQTreeWidgetItem(const QString &studyUID, const QString &seriesUID, const DICOMSource &seriesDICOMSource);
 
+    /// Deletes the given study item with its children and removes them from the indexes
+    void deleteStudyItem(QTreeWidgetItem *studyItem);
+    /// Deletes the given series item with its children and removes it from the index of series of its study
+    void deleteSeriesItem(QTreeWidgetItem *seriesItem);
+
     /// Tells us if the last item is a Study / Series / Image
     bool isItemStudy(QTreeWidgetItem *);
     bool isItemSeries(QTreeWidgetItem *);
@@ -260,6 +268,11 @@ private:
     QHash<int, Series*> m_adddSeriesByDICOMItemID;
     QHash<int, Image*> m_addedImagesByDICOMItemID;
 
+    /// Study items indexed by Study Instance UID. There can be more than one item with the same UID if they come from different DICOM sources
+    QHash<QString, QList<QTreeWidgetItem*> > m_studyItemsByUID;
+    /// Series items of each study item indexed by Series Instance UID
+    QHash<QTreeWidgetItem*, QHash<QString, QTreeWidgetItem*> > m_seriesItemsByStudyItem;
+
     /// Menu contextual
     QMenu *m_contextMenu;
 
@@ -17,21 +17,24 @@
 #include "study.h"
 #include "dicommask.h"
 #include "patient.h"
-#include "pacsmanager.h"
+#include "localdatabasemanager.h"
 #include "queryscreen.h"
 #include "singleton.h"
 #include "pacsdevicemanager.h"
 #include "logging.h"
-#include "querypacsjob.h"
+#include "relatedstudiesquerycache.h"
 #include "inputoutputsettings.h"
 
 namespace udg {
 
 RelatedStudiesManager::RelatedStudiesManager()
 {
-    m_pacsManager = new PacsManager();
     m_studyInstanceUIDOfStudyToFindRelated = "invalid";
 
+    RelatedStudiesQueryCache *queryCache = RelatedStudiesQueryCache::instance();
+    connect(queryCache, SIGNAL(queryFinished(int)), SLOT(queryRequestFinished(int)));
+    connect(queryCache, SIGNAL(queryFailed(int, PacsDevice)), SLOT(errorQueringPACS(int, PacsDevice)));
+
     Settings settings;
     m_searchRelatedStudiesByName = settings.getValue(InputOutputSettings::SearchRelatedStudiesByName).toBool();
 }
@@ -95,7 +98,7 @@ void RelatedStudiesManager::makeAsynchronousStudiesQuery(Patient *patient, QDate
         {
             foreach (DicomMask queryDicomMask, queryDicomMasksList)
             {
-                enqueueQueryPACSJobToPACSManagerAndConnectSignals(PACSJobPointer(new QueryPacsJob(pacsDevice, queryDicomMask, QueryPacsJob::study)));
+                requestQuery(pacsDevice, queryDicomMask);
             }
         }
     }
@@ -150,89 +153,50 @@ void RelatedStudiesManager::initializeQuery()
     m_pacsDeviceIDErrorEmited.clear();
 }
 
-void RelatedStudiesManager::enqueueQueryPACSJobToPACSManagerAndConnectSignals(PACSJobPointer queryPACSJob)
+void RelatedStudiesManager::requestQuery(const PacsDevice &pacsDevice, const DicomMask &mask)
 {
-    connect(queryPACSJob.data(), SIGNAL(PACSJobFinished(PACSJobPointer)), SLOT(queryPACSJobFinished(PACSJobPointer)));
-    connect(queryPACSJob.data(), SIGNAL(PACSJobCancelled(PACSJobPointer)), SLOT(queryPACSJobCancelled(PACSJobPointer)));
-
-    m_pacsManager->enqueuePACSJob(queryPACSJob);
-    m_queryPACSJobPendingExecuteOrExecuting.insert(queryPACSJob->getPACSJobID(), queryPACSJob);
+    m_pendingQueryRequestIDs.insert(RelatedStudiesQueryCache::instance()->query(pacsDevice, mask));
 }
 
 void RelatedStudiesManager::cancelCurrentQuery()
 {
-    foreach (PACSJobPointer queryPACSJob, m_queryPACSJobPendingExecuteOrExecuting)
+    // Other managers can be waiting for the same queries, so the cache only cancels them in the PACS when nobody else needs them
+    foreach (int requestID, m_pendingQueryRequestIDs)
     {
-        m_pacsManager->requestCancelPACSJob(queryPACSJob);
-        m_queryPACSJobPendingExecuteOrExecuting.remove(queryPACSJob->getPACSJobID());
+        RelatedStudiesQueryCache::instance()->cancelQuery(requestID);
     }
+    m_pendingQueryRequestIDs.clear();
 
     m_studyInstanceUIDOfStudyToFindRelated = "invalid";
 }
 
 bool RelatedStudiesManager::isExecutingQueries()
 {
-    return !m_queryPACSJobPendingExecuteOrExecuting.isEmpty();
+    return !m_pendingQueryRequestIDs.isEmpty();
 }
 
-void RelatedStudiesManager::queryPACSJobCancelled(PACSJobPointer pacsJob)
+void RelatedStudiesManager::queryRequestFinished(int requestID)
 {
-    // This slot is also used in case any other class cancels a PACSJob of ours for us to find out
-    QSharedPointer<QueryPacsJob> queryPACSJob = pacsJob.objectCast<QueryPacsJob>();
-
-    if (queryPACSJob.isNull())
+    // The query cache notifies the requests of all the managers
+    if (!m_pendingQueryRequestIDs.remove(requestID))
     {
-        ERROR_LOG("The canceled PACSJob is not a QueryPACSJob");
-    }
-    else
-    {
-        m_queryPACSJobPendingExecuteOrExecuting.remove(queryPACSJob->getPACSJobID());
-
-        if (m_queryPACSJobPendingExecuteOrExecuting.isEmpty())
-        {
-            queryFinished();
-        }
+        return;
     }
-}
 
-void RelatedStudiesManager::queryPACSJobFinished(PACSJobPointer pacsJob)
-{
-    QSharedPointer<QueryPacsJob> queryPACSJob = pacsJob.objectCast<QueryPacsJob>();
+    mergeFoundStudiesInQuery(RelatedStudiesQueryCache::instance()->takeResults(requestID));
 
-    if (queryPACSJob.isNull())
+    if (m_pendingQueryRequestIDs.isEmpty())
     {
-        ERROR_LOG("The completed PACSJob is not a QueryPACSJob");
-    }
-    else
-    {
-        if (queryPACSJob->getStatus() == PACSRequestStatus::QueryOk)
-        {
-            mergeFoundStudiesInQuery(pacsJob);
-        }
-        else if (queryPACSJob->getStatus() != PACSRequestStatus::QueryCancelled)
-        {
-            errorQueringPACS(pacsJob);
-        }
-
-        m_queryPACSJobPendingExecuteOrExecuting.remove(queryPACSJob->getPACSJobID());
-
-        if (m_queryPACSJobPendingExecuteOrExecuting.isEmpty())
-        {
-            queryFinished();
-        }
+        queryFinished();
     }
 }
 
-void RelatedStudiesManager::mergeFoundStudiesInQuery(PACSJobPointer queryPACSJob)
+void RelatedStudiesManager::mergeFoundStudiesInQuery(const QList<Patient*> &patients)
 {
-    if (queryPACSJob.objectCast<QueryPacsJob>()->getQueryLevel() != QueryPacsJob::study)
+    foreach (Patient *patient, patients)
     {
-        /// If the consultation was not of studies we are not interested, we only look for studies
-        return;
-    }
+        bool hasMergedStudies = false;
 
-    foreach (Patient *patient, queryPACSJob.objectCast<QueryPacsJob>()->getPatientStudyList())
-    {
         foreach (Study *study, patient->getStudies())
         {
             if (!isStudyInMergedStudyList(study) && !isMainStudy(study))
@@ -240,25 +204,32 @@ void RelatedStudiesManager::mergeFoundStudiesInQuery(PACSJobPointer queryPACSJob
                 // If the study is not already on the list of added studies and it is not the same study for which we have been asked to
                 // previous we add it
                 m_mergedStudyList.append(study);
+                hasMergedStudies = true;
             }
         }
+
+        if (!hasMergedStudies)
+        {
+            delete patient;
+        }
     }
 }
 
-void RelatedStudiesManager::errorQueringPACS(PACSJobPointer queryPACSJob)
+void RelatedStudiesManager::errorQueringPACS(int requestID, PacsDevice pacsDevice)
 {
-    if (queryPACSJob.objectCast<QueryPacsJob>()->getStatus() != PACSRequestStatus::QueryOk &&
-            queryPACSJob.objectCast<QueryPacsJob>()->getStatus() != PACSRequestStatus::QueryCancelled)
+    if (!m_pendingQueryRequestIDs.contains(requestID))
     {
-        // Since we do two searches on the same pacs if one fails, the other will probably also fail to avoid sending
-        // two error signals if both fail, since from the outside the number of queries must be transparent
-        // which is done in the PACS, and they should receive a single error we check if we have the PACS ID in the signal list
-        // of errors in issued PACS
-        if (!m_pacsDeviceIDErrorEmited.contains(queryPACSJob->getPacsDevice().getID()))
-        {
-            m_pacsDeviceIDErrorEmited.append(queryPACSJob->getPacsDevice().getID());
-            emit errorQueryingStudies(queryPACSJob->getPacsDevice());
-        }
+        return;
+    }
+
+    // Since we do two searches on the same pacs if one fails, the other will probably also fail to avoid sending
+    // two error signals if both fail, since from the outside the number of queries must be transparent
+    // which is done in the PACS, and they should receive a single error we check if we have the PACS ID in the signal list
+    // of errors in issued PACS
+    if (!m_pacsDeviceIDErrorEmited.contains(pacsDevice.getID()))
+    {
+        m_pacsDeviceIDErrorEmited.append(pacsDevice.getID());
+        emit errorQueryingStudies(pacsDevice);
     }
 }
 
@@ -16,25 +16,25 @@
 #define UDGRELATEDSTUDIESMANAGER_H
 
 #include <QObject>
-#include <QHash>
+#include <QSet>
 #include <QStringList>
 #include <QDate>
 
 #include "pacsdevice.h"
-#include "pacsjob.h"
 
 namespace udg {
 
 class Patient;
 class Study;
 class DicomMask;
-class PacsManager;
-class QueryPacsJob;
 
 /**
     Aquesta classe donat un Study demana els estudis relacionats o previs en els PACS configurats per defecte, degut a que
     ara actualment en el PACS podem tenir pacients que són el mateix però amb PatientID diferents, també a part de cercar estudis
     que coincideixin amb el PatientID també es farà una altre cerca per Patient Name.
+
+    Queries are made through RelatedStudiesQueryCache, so that the ones repeated within a short time or identical to a running one don't reach the PACS
+    again.
   */
 /* TODO: En teoria amb la implantació del SAP els problemes de que un Pacient té diversos Patient ID o que té el nom
    escrit de maneres diferents haurien de desapareixer, per tant d'aquí un temps quan la majoria d'estudis del PACS
@@ -111,16 +111,12 @@ private:
     /// Inicialitza les variables per realitzar una nova consulta
     void initializeQuery();
 
-    /// Ens encua el QueryPACSJob al PACSManager i ens connecta amb els seus signals per poder processar els resultats. També afegeix el Job en una taula
-    /// de hash on es guarden tots els QueryPACSJobs demanats per aquesta classe que estant pendents d'executar-se o s'estan executant
-    void enqueueQueryPACSJobToPACSManagerAndConnectSignals(PACSJobPointer queryPACSJob);
-
-    /// Ens afegeix els estudis trobats en una llista, si algun dels estudis ja existeix a la llista perquè s'ha trobat en algun altre PACS no
-    /// se li afegeix
-    void mergeFoundStudiesInQuery(PACSJobPointer queryPACSJob);
+    /// Requests the study query with the given mask to the given PACS to the query cache and keeps the request to process its results
+    void requestQuery(const PacsDevice &pacsDevice, const DicomMask &mask);
 
-    /// Emet signal indicant que la consulta a un PACS ha fallat
-    void errorQueringPACS(PACSJobPointer queryPACSJob);
+    /// Adds the found studies to the merged list, except the ones already in it because they have been found in another PACS.
+    /// The patients and studies that are not added are deleted.
+    void mergeFoundStudiesInQuery(const QList<Patient*> &patients);
 
     /// Emet signal indicant la la consulta ha acabat
     void queryFinished();
@@ -143,14 +139,13 @@ private:
     QList<DicomMask> getDicomMasks(Patient *patient);
 
 private slots:
-    /// Slot que s'activa quan finalitza un job de consulta al PACS
-    void queryPACSJobFinished(PACSJobPointer pacsJob);
+    /// Called when a request made to the query cache finishes, also if it has been cancelled
+    void queryRequestFinished(int requestID);
 
-    /// Slot que s'activa quan un job de consulta al PACS és cancel·lat
-    void queryPACSJobCancelled(PACSJobPointer pacsJob);
+    /// Emet signal indicant que la consulta a un PACS ha fallat
+    void errorQueringPACS(int requestID, PacsDevice pacsDevice);
 
 private:
-    PacsManager *m_pacsManager;
     QList<Study*> m_mergedStudyList;
 
     /// Study instance UID de l'estudi a partir del qual hem de trobar estudis relacionats
@@ -160,8 +155,8 @@ private:
     /// en aquesta llista registrarem l'ID dels Pacs pel quals hem emés el signal d'error i si rebem un segon error
     /// com ja el tindrem aquesta llista ja no en farem signal
     QStringList m_pacsDeviceIDErrorEmited;
-    /// Hash que ens guarda tots els QueryPACSJob pendent d'executar o que s'estan executant llançats des d'aquesta classe
-    QHash<int, PACSJobPointer> m_queryPACSJobPendingExecuteOrExecuting;
+    /// Requests made by this class to the query cache that haven't finished yet
+    QSet<int> m_pendingQueryRequestIDs;
     /// Boolea per saber si s'ha de cercar estudis relacionats a partir del nom del pacient.
     bool m_searchRelatedStudiesByName;
 };
@@ -0,0 +1,430 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "relatedstudiesquerycache.h"
+
+#include "dicommask.h"
+#include "inputoutputsettings.h"
+#include "logging.h"
+#include "pacsmanager.h"
+#include "patient.h"
+#include "querypacsjob.h"
+#include "study.h"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QThread>
+
+namespace udg {
+
+RelatedStudiesQueryCache::RelatedStudiesQueryCache()
+    : m_invalidationCount(0), m_lastRequestID(0)
+{
+    // The results of the queries are received in the thread where it's created
+    Q_ASSERT(QThread::currentThread() == QCoreApplication::instance()->thread());
+
+    m_pacsManager = new PacsManager();
+
+    // It's destroyed after the application, so the jobs are cancelled before
+    connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), SLOT(cancelRunningQueryPACSJobs()));
+}
+
+RelatedStudiesQueryCache::~RelatedStudiesQueryCache()
+{
+    delete m_pacsManager;
+
+    clear();
+
+    foreach (const QList<Patient*> &patients, m_finishedRequestsResults)
+    {
+        deletePatientsAndStudies(patients);
+    }
+}
+
+int RelatedStudiesQueryCache::query(const PacsDevice &pacsDevice, const DicomMask &mask)
+{
+    int requestID = ++m_lastRequestID;
+    QString key = getQueryKey(pacsDevice, mask);
+    QList<Patient*> cachedPatients;
+
+    if (getCachedResults(key, cachedPatients))
+    {
+        INFO_LOG(QString("Related studies of PACS %1 taken from the cache").arg(pacsDevice.getAETitle()));
+
+        // The results are notified later so that the requester receives them after knowing the request ID, like the ones of the running queries
+        m_finishedRequestsResults.insert(requestID, cachedPatients);
+        QMetaObject::invokeMethod(this, "notifyCachedResults", Qt::QueuedConnection, Q_ARG(int, requestID));
+    }
+    else if (m_runningQueryIDsByKey.contains(key))
+    {
+        m_runningQueries[m_runningQueryIDsByKey.value(key)].requestIDs.append(requestID);
+        m_keysByRequestID.insert(requestID, key);
+    }
+    else
+    {
+        RunningQuery runningQuery;
+        runningQuery.key = key;
+        runningQuery.pacsDevice = pacsDevice;
+        runningQuery.patientID = mask.getPatientID().trimmed();
+        runningQuery.patientName = mask.getPatientName().simplified();
+        runningQuery.requestIDs.append(requestID);
+        runningQuery.invalidationCount = m_invalidationCount.loadAcquire();
+        runningQuery.queryID = startRunningQuery(pacsDevice, mask);
+
+        m_runningQueries.insert(runningQuery.queryID, runningQuery);
+        m_runningQueryIDsByKey.insert(key, runningQuery.queryID);
+        m_keysByRequestID.insert(requestID, key);
+    }
+
+    return requestID;
+}
+
+void RelatedStudiesQueryCache::cancelQuery(int requestID)
+{
+    if (m_finishedRequestsResults.contains(requestID))
+    {
+        deletePatientsAndStudies(m_finishedRequestsResults.take(requestID));
+        return;
+    }
+
+    if (!m_keysByRequestID.contains(requestID))
+    {
+        return;
+    }
+
+    int queryID = m_runningQueryIDsByKey.value(m_keysByRequestID.take(requestID));
+    RunningQuery &runningQuery = m_runningQueries[queryID];
+    runningQuery.requestIDs.removeAll(requestID);
+
+    if (runningQuery.requestIDs.isEmpty())
+    {
+        // Nobody else is waiting for it. Once cancelled, it's forgotten so that a new identical request starts a new query
+        m_runningQueryIDsByKey.remove(runningQuery.key);
+        m_runningQueries.remove(queryID);
+        requestCancelRunningQuery(queryID);
+    }
+}
+
+QList<Patient*> RelatedStudiesQueryCache::takeResults(int requestID)
+{
+    return m_finishedRequestsResults.take(requestID);
+}
+
+void RelatedStudiesQueryCache::invalidatePatient(const QString &patientID, const QString &patientName)
+{
+    QString simplifiedPatientName = patientName.simplified();
+    QList<Patient*> patientsToDelete;
+
+    m_invalidationCount.ref();
+
+    QMutexLocker locker(&m_mutex);
+
+    QMutableHashIterator<QString, CachedQuery> iterator(m_cachedQueries);
+    while (iterator.hasNext())
+    {
+        const CachedQuery &cachedQuery = iterator.next().value();
+
+        bool hasPatientCriteria = !cachedQuery.patientID.isEmpty() || !cachedQuery.patientName.isEmpty();
+        bool matchesPatientID = !cachedQuery.patientID.isEmpty() && cachedQuery.patientID == patientID;
+        bool matchesPatientName = !cachedQuery.patientName.isEmpty() && cachedQuery.patientName == simplifiedPatientName;
+
+        if (!hasPatientCriteria || matchesPatientID || matchesPatientName)
+        {
+            patientsToDelete << cachedQuery.patients;
+            iterator.remove();
+        }
+    }
+
+    locker.unlock();
+
+    deletePatientsAndStudies(patientsToDelete);
+}
+
+void RelatedStudiesQueryCache::clear()
+{
+    QList<Patient*> patientsToDelete;
+
+    m_invalidationCount.ref();
+
+    QMutexLocker locker(&m_mutex);
+
+    foreach (const CachedQuery &cachedQuery, m_cachedQueries)
+    {
+        patientsToDelete << cachedQuery.patients;
+    }
+    m_cachedQueries.clear();
+
+    locker.unlock();
+
+    deletePatientsAndStudies(patientsToDelete);
+}
+
+QString RelatedStudiesQueryCache::getQueryKey(const PacsDevice &pacsDevice, const DicomMask &mask)
+{
+    // Only the matching keys of the study level are taken into account. Surrounding spaces and repeated spaces in the name don't change the results
+    QStringList keyFields;
+    keyFields << pacsDevice.getID() << mask.getPatientID().trimmed() << mask.getPatientName().simplified() << mask.getPatientBirthRangeAsDICOMFormat()
+              << mask.getPatientSex() << mask.getPatientAge() << mask.getStudyID() << mask.getStudyDateRangeAsDICOMFormat()
+              << mask.getStudyTimeRangeAsDICOMFormat() << mask.getStudyDescription() << mask.getStudyModality() << mask.getAccessionNumber()
+              << mask.getReferringPhysiciansName() << mask.getStudyInstanceUID();
+
+    return keyFields.join("\\");
+}
+
+QList<Patient*> RelatedStudiesQueryCache::copyPatientsAndStudies(const QList<Patient*> &patients)
+{
+    QList<Patient*> copies;
+
+    foreach (Patient *patient, patients)
+    {
+        Patient *patientCopy = new Patient();
+        patientCopy->copyPatientInformation(patient);
+
+        // Copies the attributes filled by the study queries
+        foreach (Study *study, patient->getStudies())
+        {
+            Study *studyCopy = new Study();
+            studyCopy->setInstanceUID(study->getInstanceUID());
+            studyCopy->setID(study->getID());
+            studyCopy->setDate(study->getDate());
+            studyCopy->setTime(study->getTime());
+            studyCopy->setAccessionNumber(study->getAccessionNumber());
+            studyCopy->setDescription(study->getDescription());
+            studyCopy->setPatientAge(study->getPatientAge());
+            studyCopy->setHeight(study->getHeight());
+            studyCopy->setWeight(study->getWeight());
+            studyCopy->setReferringPhysiciansName(study->getReferringPhysiciansName());
+            studyCopy->setInstitutionName(study->getInstitutionName());
+            studyCopy->setDICOMSource(study->getDICOMSource());
+
+            foreach (const QString &modality, study->getModalities())
+            {
+                studyCopy->addModality(modality);
+            }
+
+            patientCopy->addStudy(studyCopy);
+        }
+
+        copies << patientCopy;
+    }
+
+    return copies;
+}
+
+void RelatedStudiesQueryCache::deletePatientsAndStudies(const QList<Patient*> &patients)
+{
+    // Studies are children of their patient
+    qDeleteAll(patients);
+}
+
+int RelatedStudiesQueryCache::getTimeToLive() const
+{
+    QScopedPointer<SettingsInterface> settings(getSettings());
+    return qMax(0, settings->getValue(InputOutputSettings::RelatedStudiesQueryCacheTimeToLive).toInt());
+}
+
+bool RelatedStudiesQueryCache::getCachedResults(const QString &key, QList<Patient*> &patients)
+{
+    int timeToLive = getTimeToLive();
+    QDateTime now = getCurrentDateTime();
+    QList<Patient*> patientsToDelete;
+    bool found = false;
+
+    QMutexLocker locker(&m_mutex);
+
+    QMutableHashIterator<QString, CachedQuery> iterator(m_cachedQueries);
+    while (iterator.hasNext())
+    {
+        const CachedQuery &cachedQuery = iterator.next().value();
+
+        if (cachedQuery.queryDateTime.secsTo(now) >= timeToLive)
+        {
+            patientsToDelete << cachedQuery.patients;
+            iterator.remove();
+        }
+        else if (iterator.key() == key)
+        {
+            patients = copyPatientsAndStudies(cachedQuery.patients);
+            found = true;
+        }
+    }
+
+    locker.unlock();
+
+    deletePatientsAndStudies(patientsToDelete);
+
+    return found;
+}
+
+void RelatedStudiesQueryCache::addToCache(const RunningQuery &runningQuery, const QList<Patient*> &patients)
+{
+    CachedQuery cachedQuery;
+    cachedQuery.patients = patients;
+    cachedQuery.queryDateTime = getCurrentDateTime();
+    cachedQuery.patientID = runningQuery.patientID;
+    cachedQuery.patientName = runningQuery.patientName;
+
+    QList<Patient*> patientsToDelete;
+
+    QMutexLocker locker(&m_mutex);
+
+    // Checked with the lock held, so that an invalidation can't happen between the check and the insertion
+    if (getTimeToLive() > 0 && m_invalidationCount.loadAcquire() == runningQuery.invalidationCount)
+    {
+        if (m_cachedQueries.contains(runningQuery.key))
+        {
+            patientsToDelete << m_cachedQueries.value(runningQuery.key).patients;
+        }
+        m_cachedQueries.insert(runningQuery.key, cachedQuery);
+    }
+    else
+    {
+        patientsToDelete << patients;
+    }
+
+    locker.unlock();
+
+    deletePatientsAndStudies(patientsToDelete);
+}
+
+void RelatedStudiesQueryCache::finishRunningQuery(const RunningQuery &runningQuery, const QList<Patient*> &patients, bool failed)
+{
+    m_runningQueries.remove(runningQuery.queryID);
+    if (m_runningQueryIDsByKey.value(runningQuery.key) == runningQuery.queryID)
+    {
+        m_runningQueryIDsByKey.remove(runningQuery.key);
+    }
+
+    foreach (int requestID, runningQuery.requestIDs)
+    {
+        m_keysByRequestID.remove(requestID);
+        m_finishedRequestsResults.insert(requestID, copyPatientsAndStudies(patients));
+    }
+
+    // A requester can cancel other requests when notified
+    foreach (int requestID, runningQuery.requestIDs)
+    {
+        if (m_finishedRequestsResults.contains(requestID))
+        {
+            if (failed)
+            {
+                emit queryFailed(requestID, runningQuery.pacsDevice);
+            }
+            emit queryFinished(requestID);
+        }
+    }
+}
+
+void RelatedStudiesQueryCache::notifyCachedResults(int requestID)
+{
+    if (m_finishedRequestsResults.contains(requestID))
+    {
+        emit queryFinished(requestID);
+    }
+}
+
+void RelatedStudiesQueryCache::queryPACSJobFinished(PACSJobPointer pacsJob)
+{
+    QSharedPointer<QueryPacsJob> queryPACSJob = pacsJob.objectCast<QueryPacsJob>();
+
+    if (queryPACSJob.isNull())
+    {
+        ERROR_LOG("The completed PACSJob is not a QueryPACSJob");
+        return;
+    }
+
+    m_queryPACSJobs.remove(queryPACSJob->getPACSJobID());
+
+    // The results belong to whoever asks for them
+    QList<Patient*> patients;
+    if (queryPACSJob->getStatus() == PACSRequestStatus::QueryOk)
+    {
+        patients = queryPACSJob->getPatientStudyList();
+    }
+
+    runningQueryFinished(queryPACSJob->getPACSJobID(), patients, queryPACSJob->getStatus());
+}
+
+void RelatedStudiesQueryCache::queryPACSJobCancelled(PACSJobPointer pacsJob)
+{
+    // Also called when another class cancels one of our jobs, e.g. when all the PACS jobs are cancelled
+    m_queryPACSJobs.remove(pacsJob->getPACSJobID());
+    runningQueryFinished(pacsJob->getPACSJobID(), QList<Patient*>(), PACSRequestStatus::QueryCancelled);
+}
+
+void RelatedStudiesQueryCache::cancelRunningQueryPACSJobs()
+{
+    foreach (const PACSJobPointer &queryPACSJob, m_queryPACSJobs)
+    {
+        m_pacsManager->requestCancelPACSJob(queryPACSJob);
+    }
+}
+
+int RelatedStudiesQueryCache::startRunningQuery(const PacsDevice &pacsDevice, const DicomMask &mask)
+{
+    PACSJobPointer queryPACSJob(new QueryPacsJob(pacsDevice, mask, QueryPacsJob::study));
+    connect(queryPACSJob.data(), SIGNAL(PACSJobFinished(PACSJobPointer)), SLOT(queryPACSJobFinished(PACSJobPointer)));
+    connect(queryPACSJob.data(), SIGNAL(PACSJobCancelled(PACSJobPointer)), SLOT(queryPACSJobCancelled(PACSJobPointer)));
+
+    m_queryPACSJobs.insert(queryPACSJob->getPACSJobID(), queryPACSJob);
+    m_pacsManager->enqueuePACSJob(queryPACSJob);
+
+    return queryPACSJob->getPACSJobID();
+}
+
+void RelatedStudiesQueryCache::requestCancelRunningQuery(int queryID)
+{
+    if (m_queryPACSJobs.contains(queryID))
+    {
+        m_pacsManager->requestCancelPACSJob(m_queryPACSJobs.value(queryID));
+    }
+}
+
+void RelatedStudiesQueryCache::runningQueryFinished(int queryID, const QList<Patient*> &patients, PACSRequestStatus::QueryRequestStatus status)
+{
+    if (!m_runningQueries.contains(queryID))
+    {
+        // All its requests have been cancelled
+        deletePatientsAndStudies(patients);
+        return;
+    }
+
+    RunningQuery runningQuery = m_runningQueries.value(queryID);
+    bool failed = status != PACSRequestStatus::QueryOk && status != PACSRequestStatus::QueryCancelled;
+
+    finishRunningQuery(runningQuery, patients, failed);
+
+    if (status == PACSRequestStatus::QueryOk)
+    {
+        addToCache(runningQuery, patients);
+    }
+    else
+    {
+        deletePatientsAndStudies(patients);
+    }
+}
+
+SettingsInterface* RelatedStudiesQueryCache::getSettings() const
+{
+    return new Settings();
+}
+
+QDateTime RelatedStudiesQueryCache::getCurrentDateTime() const
+{
+    return QDateTime::currentDateTime();
+}
+
+}
@@ -0,0 +1,188 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDGRELATEDSTUDIESQUERYCACHE_H
+#define UDGRELATEDSTUDIESQUERYCACHE_H
+
+#include "singleton.h"
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+
+#include "pacsdevice.h"
+#include "pacsjob.h"
+#include "pacsrequeststatus.h"
+
+namespace udg {
+
+class DicomMask;
+class PacsManager;
+class Patient;
+class SettingsInterface;
+
+/**
+    Shared cache of the study queries made to the PACS to find related studies, so that the same query repeated within a short time doesn't reach the
+    PACS again. This happens when a patient is opened, since the hanging protocols and the related studies widget ask for the same studies.
+
+    - The results of each query are kept, by PACS and mask, for the time set in InputOutputSettings::RelatedStudiesQueryCacheTimeToLive.
+    - Identical queries requested while one is running are merged into a single QueryPacsJob. The job is only cancelled when all its requesters have
+      cancelled their request.
+    - The results of a patient are invalidated when studies of the patient are saved to the local database, e.g. when a retrieve finishes.
+
+    Each request gets an identifier. When it finishes, queryFinished() is emitted and the requester takes its own copy of the results with takeResults().
+    It must be created and used from the main thread, except invalidatePatient(), which can be called from any thread. The running queries are cancelled
+    when the application is about to quit.
+  */
+class RelatedStudiesQueryCache : public QObject, public Singleton<RelatedStudiesQueryCache> {
+Q_OBJECT
+public:
+    /// Requests a study query to the given PACS with the given mask and returns the identifier of the request.
+    /// The masks must ask for the same return keys, since they are not taken into account to tell whether two queries are the same.
+    int query(const PacsDevice &pacsDevice, const DicomMask &mask);
+
+    /// Cancels the given request. Its results won't be notified.
+    void cancelQuery(int requestID);
+
+    /// Returns the patients found by the given finished request, each one with one study. The caller becomes the owner of the returned objects.
+    QList<Patient*> takeResults(int requestID);
+
+    /// Discards the cached results that can contain studies of the patient with the given ID or name, and the ones of the queries already running.
+    void invalidatePatient(const QString &patientID, const QString &patientName);
+
+    /// Discards all the cached results.
+    void clear();
+
+    /// Returns the key that identifies the query with the given PACS and mask in the cache.
+    static QString getQueryKey(const PacsDevice &pacsDevice, const DicomMask &mask);
+
+signals:
+    /// Emitted when the given request has finished, also if it has been cancelled from outside. Its results can be taken with takeResults().
+    void queryFinished(int requestID);
+
+    /// Emitted when the query of the given request has failed in the given PACS.
+    void queryFailed(int requestID, PacsDevice pacsDevice);
+
+protected:
+    friend class Singleton<RelatedStudiesQueryCache>;
+    RelatedStudiesQueryCache();
+    ~RelatedStudiesQueryCache();
+
+    /// Starts a study query to the given PACS with the given mask and returns its identifier. When it finishes runningQueryFinished() has to be called.
+    virtual int startRunningQuery(const PacsDevice &pacsDevice, const DicomMask &mask);
+
+    /// Requests to cancel the given running query.
+    virtual void requestCancelRunningQuery(int queryID);
+
+    /// Notifies the requests of the given running query that it has finished with the given status and caches its results.
+    /// The cache becomes the owner of the given patients.
+    void runningQueryFinished(int queryID, const QList<Patient*> &patients, PACSRequestStatus::QueryRequestStatus status);
+
+    /// Returns the settings to use. The caller takes ownership of the returned object.
+    virtual SettingsInterface* getSettings() const;
+
+    /// Returns the current date and time, with which the age of the cached results is computed.
+    virtual QDateTime getCurrentDateTime() const;
+
+private:
+    /// Results of a query kept in the cache.
+    struct CachedQuery
+    {
+        /// Patients found, owned by the cache.
+        QList<Patient*> patients;
+        /// When the query was made.
+        QDateTime queryDateTime;
+        /// Patient ID and name of the mask, to know which results have to be invalidated.
+        QString patientID;
+        QString patientName;
+    };
+
+    /// Query being executed on behalf of one or more requests.
+    struct RunningQuery
+    {
+        int queryID;
+        QString key;
+        PacsDevice pacsDevice;
+        /// Patient ID and name of the mask, for the cached results.
+        QString patientID;
+        QString patientName;
+        /// Requests waiting for the results.
+        QList<int> requestIDs;
+        /// Value of m_invalidationCount when the query was started.
+        int invalidationCount;
+    };
+
+    /// Returns copies of the given patients and their studies.
+    static QList<Patient*> copyPatientsAndStudies(const QList<Patient*> &patients);
+
+    /// Deletes the given patients and their studies.
+    static void deletePatientsAndStudies(const QList<Patient*> &patients);
+
+    /// Returns the time to live of the cached results in seconds, 0 if the cache is disabled.
+    int getTimeToLive() const;
+
+    /// Puts in patients copies of the valid results cached with the given key and returns true, or returns false if there aren't. Expired results are
+    /// discarded.
+    bool getCachedResults(const QString &key, QList<Patient*> &patients);
+
+    /// Adds the results of the given finished query to the cache, unless they have been invalidated while it was running.
+    void addToCache(const RunningQuery &runningQuery, const QList<Patient*> &patients);
+
+    /// Gives copies of the given results to the requests of the given query and notifies them, also that the query has failed if it's the case.
+    void finishRunningQuery(const RunningQuery &runningQuery, const QList<Patient*> &patients, bool failed);
+
+private slots:
+    /// Notifies the given request served from the cache, if it hasn't been cancelled.
+    void notifyCachedResults(int requestID);
+
+    /// Called when a query job finishes, also when it's cancelled while running.
+    void queryPACSJobFinished(PACSJobPointer pacsJob);
+
+    /// Called when a query job is cancelled before running.
+    void queryPACSJobCancelled(PACSJobPointer pacsJob);
+
+    /// Cancels the running query jobs. Called when the application is about to quit, since the PACS jobs can't be cancelled after that.
+    void cancelRunningQueryPACSJobs();
+
+private:
+    PacsManager *m_pacsManager;
+    /// Query jobs that haven't finished yet by job ID, which is the identifier of their running query.
+    QHash<int, PACSJobPointer> m_queryPACSJobs;
+
+    /// Protects m_cachedQueries, since invalidatePatient() can be called from other threads.
+    QMutex m_mutex;
+    /// Results cached by query key.
+    QHash<QString, CachedQuery> m_cachedQueries;
+    /// Incremented each time results are invalidated, to avoid caching results of queries that were running at that moment.
+    QAtomicInt m_invalidationCount;
+
+    /// Running queries by ID, and the ID of the running query of each key.
+    QHash<int, RunningQuery> m_runningQueries;
+    QHash<QString, int> m_runningQueryIDsByKey;
+    /// Key of the running query of each request waiting for results.
+    QHash<int, QString> m_keysByRequestID;
+
+    /// Results of the finished requests that haven't been taken yet.
+    QHash<int, QList<Patient*> > m_finishedRequestsResults;
+
+    /// Identifier of the last request.
+    int m_lastRequestID;
+};
+
+}
+
+#endif // UDGRELATEDSTUDIESQUERYCACHE_H
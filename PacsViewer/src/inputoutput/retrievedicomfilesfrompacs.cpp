@@ -23,7 +23,9 @@
 #include <dcdeftag.h>
 
 #include <QDir>
+#include <QRunnable>
 #include <QString>
+#include <QThread>
 
 #include "localdatabasemanager.h"
 #include "dicommask.h"
@@ -31,106 +33,51 @@
 #include "dicomtagreader.h"
 #include "pacsconnection.h"
 #include "pacsdevice.h"
+#include "incomingdicomconnectionsdispatcher.h"
 
 namespace udg {
 
 // Constant that will contain which Abanstract Syntax of Move we use among the various that we use
 static const char *MoveAbstractSyntax = UID_MOVEStudyRootQueryRetrieveInformationModel;
 
-RetrieveDICOMFilesFromPACS::RetrieveDICOMFilesFromPACS(PacsDevice pacs)
-    : DIMSECService()
-{
-    m_pacs = pacs;
-    m_abortIsRequested = false;
-
-    this->setUpAsCMove();
-}
+namespace {
 
-OFCondition RetrieveDICOMFilesFromPACS::acceptSubAssociation(T_ASC_Network *associationNetwork, T_ASC_Association **association)
-{
-    const char *knownAbstractSyntaxes[] = { UID_VerificationSOPClass };
-    const char *transferSyntaxes[] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-                                       NULL, NULL, NULL , NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
-    int numTransferSyntaxes;
+// Maximum number of received files waiting to be saved or processed. With big CT images it's a few hundreds of MB at most
+const int MaximumNumberOfPendingFiles = 64;
+// Maximum number of threads saving received files. More threads don't make the writing faster, they only make the disk seek more
+const int MaximumNumberOfWriterThreads = 4;
 
-    OFCondition condition = ASC_receiveAssociation(associationNetwork, association, ASC_DEFAULTMAXPDU);
+}
 
-    if (condition.good())
+class RetrieveDICOMFilesFromPACS::DICOMFileWriter : public QRunnable {
+public:
+    DICOMFileWriter(RetrieveDICOMFilesFromPACS *retrieveDICOMFilesFromPACS, DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath)
+        : m_retrieveDICOMFilesFromPACS(retrieveDICOMFilesFromPACS), m_fileRetrieved(fileRetrieved), m_dicomFileAbsolutePath(dicomFileAbsolutePath)
     {
-#ifndef DISABLE_COMPRESSION_EXTENSION
-        // If we have compression we ask for it, and we can speed up the download time considerably
-        // For now we ask for the lossless compression that every PACS that supports compression has
-        // to provide: JPEGLossless: Non-Hierarchical-1stOrderPrediction
-        transferSyntaxes[0] = UID_JPEGProcess14SV1TransferSyntax;//UID_LittleEndianImplicitTransferSyntax;//
-        transferSyntaxes[1] = UID_LittleEndianExplicitTransferSyntax;
-        transferSyntaxes[2] = UID_BigEndianExplicitTransferSyntax;
-        transferSyntaxes[3] = UID_LittleEndianImplicitTransferSyntax;//UID_JPEGProcess14SV1TransferSyntax;//
-        transferSyntaxes[4] = UID_JPEGLSLosslessTransferSyntax;
-        transferSyntaxes[5] = UID_JPEG2000LosslessOnlyTransferSyntax;
-        transferSyntaxes[6] = UID_JPEG2000TransferSyntax;
-        transferSyntaxes[7] = UID_JPEGProcess2_4TransferSyntax;
-        transferSyntaxes[8] = UID_JPEGProcess1TransferSyntax;
-        transferSyntaxes[9] = UID_JPEGLSLossyTransferSyntax;
-        numTransferSyntaxes = 10;
-
-        //  transferSyntaxes ??? ---> query ASC_acceptContextsWithPreferredTransferSyntaxes
-
-#else
-        // Defined in dcxfer.h
-        if (gLocalByteOrder == EBO_LittleEndian)
-        {
-            transferSyntaxes[0] = UID_LittleEndianExplicitTransferSyntax;
-            transferSyntaxes[1] = UID_BigEndianExplicitTransferSyntax;
-        }
-        else
-        {
-            transferSyntaxes[0] = UID_BigEndianExplicitTransferSyntax;
-            transferSyntaxes[1] = UID_LittleEndianExplicitTransferSyntax;
-        }
-        transferSyntaxes[2] = UID_LittleEndianImplicitTransferSyntax;
-        numTransferSyntaxes = 3;
-#endif
-
-        // Accept the Verification SOP Class if presented
-        condition = ASC_acceptContextsWithPreferredTransferSyntaxes(
-                    (*association)->params, knownAbstractSyntaxes, DIM_OF(knownAbstractSyntaxes),
-                    transferSyntaxes, numTransferSyntaxes);
-
-        if (condition.good())
-        {
-#ifdef  PACKAGE_VERSION_NUMBER
-
-#if PACKAGE_VERSION_NUMBER == 361
-            // The array of Storage SOP Class UIDs comes from dcuid.h
-            condition = ASC_acceptContextsWithPreferredTransferSyntaxes(
-                        (*association)->params, dcmAllStorageSOPClassUIDs, numberOfAllDcmStorageSOPClassUIDs,
-                        transferSyntaxes, numTransferSyntaxes);
-#else //if  PACKAGE_VERSION_NUMBER  >= 363
-
-            condition = ASC_acceptContextsWithPreferredTransferSyntaxes(
-                        (*association)->params, dcmAllStorageSOPClassUIDs, numberOfDcmAllStorageSOPClassUIDs,
-                        transferSyntaxes, numTransferSyntaxes);
-
-#endif
-
-#endif
-        }
-        else
-        {
-            ERROR_LOG("acceptSubAssociation ASC_acceptContextsWithPreferredTransferSyntaxes error!" + QString(condition.text()));
-        }
     }
 
-    if (condition.good())
-    {
-        condition = ASC_acknowledgeAssociation(*association);
-    }
-    else
+    virtual void run()
     {
-        ASC_dropAssociation(*association);
-        ASC_destroyAssociation(association);
+        m_retrieveDICOMFilesFromPACS->writeRetrievedDICOMFile(m_fileRetrieved, m_dicomFileAbsolutePath);
     }
-    return condition;
+
+private:
+    RetrieveDICOMFilesFromPACS *m_retrieveDICOMFilesFromPACS;
+    DcmFileFormat *m_fileRetrieved;
+    QString m_dicomFileAbsolutePath;
+};
+
+RetrieveDICOMFilesFromPACS::RetrieveDICOMFilesFromPACS(PacsDevice pacs)
+    : DIMSECService(), m_pendingFilesSemaphore(MaximumNumberOfPendingFiles)
+{
+    m_pacs = pacs;
+    m_abortIsRequested.store(0);
+    m_moveInProgress = false;
+    m_numberOfImagesRetrieved = 0;
+    m_numberOfFilesFailedToSave = 0;
+    m_writersThreadPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, MaximumNumberOfWriterThreads));
+
+    this->setUpAsCMove();
 }
 
 void RetrieveDICOMFilesFromPACS::moveCallback(void *callbackData, T_DIMSE_C_MoveRQ *request, int responseCount, T_DIMSE_C_MoveRSP *response)
@@ -141,12 +88,13 @@ void RetrieveDICOMFilesFromPACS::moveCallback(void *callbackData, T_DIMSE_C_Move
     Q_UNUSED(callbackData);
 
     /// This in theory is the code to cancel a download but
-    /// the PACS of the UDIAT does not support the requestCancel, therefore the only way
-    /// to do so is as done in the subOperationSCP method which aborts the connection to the PACS.
+    /// the PACS of the UDIAT does not support the requestCancel, therefore the connection to the PACS is also aborted.
+    /// It's done here because this callback runs in the retrieve thread, the only one that can use the association of the C-MOVE.
+    /// If the PACS doesn't send pending responses, the files it sends are refused once the download is cancelled, so it ends the C-MOVE anyway.
 
     MoveSCPCallbackData *moveSCPCallbackData = (MoveSCPCallbackData*) callbackData;
 
-    if (moveSCPCallbackData->retrieveDICOMFilesFromPACS->m_abortIsRequested)
+    if (moveSCPCallbackData->retrieveDICOMFilesFromPACS->m_abortIsRequested.load())
     {
         OFCondition condition = DIMSE_sendCancelRequest(
                     moveSCPCallbackData->association, moveSCPCallbackData->presentationContextId, request->MessageID);
@@ -159,250 +107,151 @@ void RetrieveDICOMFilesFromPACS::moveCallback(void *callbackData, T_DIMSE_C_Move
         {
             ERROR_LOG("Error trying to cancel download. Description error: " + QString(condition.text()));
         }
-    }
-}
 
-OFCondition RetrieveDICOMFilesFromPACS::echoSCP(T_ASC_Association *association, T_DIMSE_Message *dimseMessage,
-                                                T_ASC_PresentationContextID presentationContextID)
-{
-    // The echo succeeded
-    OFCondition condition = DIMSE_sendEchoResponse(association,
-                                                   presentationContextID, &dimseMessage->msg.CEchoRQ, STATUS_Success, NULL);
-    if (condition.bad())
-    {
-        ERROR_LOG("The PACS requested an echo during the download but the response to this failed");
+        INFO_LOG("We will abort the connections with the PACS, because they have requested to cancel the download");
+        moveSCPCallbackData->retrieveDICOMFilesFromPACS->abortMoveAssociation();
     }
-
-    return condition;
 }
 
-void RetrieveDICOMFilesFromPACS::storeSCPCallback(void *callbackData, T_DIMSE_StoreProgress *progress, T_DIMSE_C_StoreRQ *storeRequest, char *imageFileName,
-                                                  DcmDataset **imageDataSet, T_DIMSE_C_StoreRSP *storeResponse, DcmDataset **statusDetail)
+bool RetrieveDICOMFilesFromPACS::storeRetrievedDICOMFile(DcmFileFormat *fileRetrieved, T_DIMSE_C_StoreRQ *storeRequest, DcmDataset **imageDataSet,
+                                                         T_DIMSE_C_StoreRSP *storeResponse)
 {
-    // Input parameters: callbackData, progress, storeRequest, imageFileName, imageDataSet
-    // Output parameters: storeResponse, statusDetail
-    Q_UNUSED(imageFileName);
+    DIC_UI sopClass, sopInstance;
+    OFBool correctUIDPadding = OFFalse;
+    QString fileName = storeRequest->AffectedSOPInstanceUID;
+    QString dicomFileAbsolutePath;
 
-    // If the package is at the end of an image we must save it
-    if (progress->state == DIMSE_StoreEnd)
     {
-        // No status detail
-        *statusDetail = NULL;
+        // Files of the same series can be received through several associations at the same time, and all of them create its directory if it's missing
+        QMutexLocker locker(&m_storeMutex);
+        dicomFileAbsolutePath = getAbsoluteFilePathCompositeInstance(*imageDataSet, fileName);
+    }
 
-        if ((imageDataSet) && (*imageDataSet))
-        {
-            DIC_UI sopClass, sopInstance;
-            OFBool correctUIDPadding = OFFalse;
-            StoreSCPCallbackData *storeSCPCallbackData = (StoreSCPCallbackData*)callbackData;
-            RetrieveDICOMFilesFromPACS *retrieveDICOMFilesFromPACS = storeSCPCallbackData->retrieveDICOMFilesFromPACS;
-            QString dicomFileAbsolutePath = retrieveDICOMFilesFromPACS->getAbsoluteFilePathCompositeInstance(*imageDataSet, storeSCPCallbackData->fileName);
-
-            //Let's save the image
-            OFCondition stateSaveImage = retrieveDICOMFilesFromPACS->save(storeSCPCallbackData->dcmFileFormat, dicomFileAbsolutePath);
-
-            if (stateSaveImage.bad())
-            {
-                storeResponse->DimseStatus = STATUS_STORE_Refused_OutOfResources;
-                DEBUG_LOG("The downloaded image could not be saved [" + dicomFileAbsolutePath + "], error: " + stateSaveImage.text());
-                ERROR_LOG("The downloaded image could not be saved [" + dicomFileAbsolutePath + "], error: " + stateSaveImage.text());
-                if (!QFile::remove(dicomFileAbsolutePath))
-                {
-                    DEBUG_LOG ("Failed to delete file" + dicomFileAbsolutePath + "previously failed to save.");
-                    ERROR_LOG ("Failed to delete file" + dicomFileAbsolutePath + "previously failed to save.");
-                }
-            }
-            else
-            {
-                // Should really check the image to make sure it is consistent, that its
-                // sopClass and sopInstance correspond with those in the request.
-                if (storeResponse->DimseStatus == STATUS_Success)
-                {
-                    // Which SOP class and SOP instance?
-                    //if (!DU_findSOPClassAndInstanceInDataSet(*imageDataSet, sopClass, sopInstance, correctUIDPadding))
+    // Should really check the image to make sure it is consistent, that its
+    // sopClass and sopInstance correspond with those in the request.
+    if (storeResponse->DimseStatus == STATUS_Success)
+    {
+        // Which SOP class and SOP instance?
+        //if (!DU_findSOPClassAndInstanceInDataSet(*imageDataSet, sopClass, sopInstance, correctUIDPadding))
 #ifdef  PACKAGE_VERSION_NUMBER
 #if PACKAGE_VERSION_NUMBER < 365
-                    if (!DU_findSOPClassAndInstanceInDataSet(*imageDataSet, sopClass, sopInstance, correctUIDPadding))
+        if (!DU_findSOPClassAndInstanceInDataSet(*imageDataSet, sopClass, sopInstance, correctUIDPadding))
 #else if  PACKAGE_VERSION_NUMBER == 365
-                    if (!DU_findSOPClassAndInstanceInDataSet(*imageDataSet, sopClass,sizeof(sopClass), sopInstance, sizeof(sopInstance)))
+        if (!DU_findSOPClassAndInstanceInDataSet(*imageDataSet, sopClass,sizeof(sopClass), sopInstance, sizeof(sopInstance)))
 #endif
 #endif
-                    {
-                        storeResponse->DimseStatus = STATUS_STORE_Error_CannotUnderstand;
-                        ERROR_LOG(QString("Sop class and sop instance not found for image %1").arg(storeSCPCallbackData->fileName));
-                    }
-                    else if (strcmp(sopClass, storeRequest->AffectedSOPClassUID) != 0)
-                    {
-                        storeResponse->DimseStatus = STATUS_STORE_Error_DataSetDoesNotMatchSOPClass;
-                        ERROR_LOG(QString("The sop class received does not match the one requested by the image%1").arg(storeSCPCallbackData->fileName));
-                    }
-                    else if (strcmp(sopInstance, storeRequest->AffectedSOPInstanceUID) != 0)
-                    {
-                        QString sopinst = sopInstance;
-                        QString affSopInst = storeRequest->AffectedSOPInstanceUID;
-                        ERROR_LOG("sopInstance != storeRequest->AffectedSOPInstanceUID:" + sopinst + "!=" + affSopInst);
-                        storeResponse->DimseStatus = STATUS_STORE_Error_DataSetDoesNotMatchSOPClass;
-                        ERROR_LOG(QString("It does not match the received instance with the one requested by the image %1").arg(storeSCPCallbackData->fileName));
-                    }
-                }
-
-                // TODO:You have to process the file if any of the above checks failed ?
-                retrieveDICOMFilesFromPACS->m_numberOfImagesRetrieved++;
-                DICOMTagReader *dicomTagReader = new DICOMTagReader(dicomFileAbsolutePath, storeSCPCallbackData->dcmFileFormat->getAndRemoveDataset());
-                emit retrieveDICOMFilesFromPACS->DICOMFileRetrieved(dicomTagReader, retrieveDICOMFilesFromPACS->m_numberOfImagesRetrieved);
-            }
+        {
+            storeResponse->DimseStatus = STATUS_STORE_Error_CannotUnderstand;
+            ERROR_LOG(QString("Sop class and sop instance not found for image %1").arg(fileName));
+        }
+        else if (strcmp(sopClass, storeRequest->AffectedSOPClassUID) != 0)
+        {
+            storeResponse->DimseStatus = STATUS_STORE_Error_DataSetDoesNotMatchSOPClass;
+            ERROR_LOG(QString("The sop class received does not match the one requested by the image%1").arg(fileName));
+        }
+        else if (strcmp(sopInstance, storeRequest->AffectedSOPInstanceUID) != 0)
+        {
+            QString sopinst = sopInstance;
+            QString affSopInst = storeRequest->AffectedSOPInstanceUID;
+            ERROR_LOG("sopInstance != storeRequest->AffectedSOPInstanceUID:" + sopinst + "!=" + affSopInst);
+            storeResponse->DimseStatus = STATUS_STORE_Error_DataSetDoesNotMatchSOPClass;
+            ERROR_LOG(QString("It does not match the received instance with the one requested by the image %1").arg(fileName));
         }
     }
-}
-
-OFCondition RetrieveDICOMFilesFromPACS::save(DcmFileFormat *fileRetrieved, QString dicomFileAbsolutePath)
-{
-    //We indicate that we do not use meta-header
-    E_FileWriteMode writeMode = EWM_fileformat;
-    E_EncodingType sequenceType = EET_ExplicitLength;
-    E_GrpLenEncoding groupLength = EGL_recalcGL;
-    E_PaddingEncoding paddingType = EPD_withoutPadding;
-    Uint32 filePadding = 0, itemPadding = 0;
-    E_TransferSyntax transferSyntaxFile = fileRetrieved->getDataset()->getOriginalXfer();
-
-    return fileRetrieved->saveFile(qPrintable(QDir::toNativeSeparators(dicomFileAbsolutePath)), transferSyntaxFile, sequenceType, groupLength, paddingType,
-                                   filePadding, itemPadding, writeMode);
-}
-
-OFCondition RetrieveDICOMFilesFromPACS::storeSCP(T_ASC_Association *association, T_DIMSE_Message *msg, T_ASC_PresentationContextID presentationContextID)
-{
-    T_DIMSE_C_StoreRQ *storeRequest = &msg->msg.CStoreRQ;
-    OFBool useMetaheader = OFTrue;
-    StoreSCPCallbackData storeSCPCallbackData;
-    DcmFileFormat retrievedFile;
-    DcmDataset *retrievedDataset = retrievedFile.getDataset();
 
-    storeSCPCallbackData.dcmFileFormat = &retrievedFile;
-    storeSCPCallbackData.retrieveDICOMFilesFromPACS = this;
-    storeSCPCallbackData.fileName = storeRequest->AffectedSOPInstanceUID;
+    // TODO:You have to process the file if any of the above checks failed ?
+    // The slot is released once the receiver of DICOMFileRetrieved has processed the file, or by the writer if the file can't be saved
+    m_pendingFilesSemaphore.acquire();
+    m_writersThreadPool.start(new DICOMFileWriter(this, fileRetrieved, dicomFileAbsolutePath));
 
-    OFCondition condition = DIMSE_storeProvider(association, presentationContextID, storeRequest, NULL, useMetaheader, &retrievedDataset, storeSCPCallback,
-                                                (void*) &storeSCPCallbackData, DIMSE_BLOCKING, 0);
-
-    if (condition.bad())
+    if (m_abortIsRequested.load())
     {
-        // Remove file
-        ERROR_LOG("Occurred while processing a download request from a file, description error " + QString(condition.text()));
-        unlink(qPrintable(storeSCPCallbackData.fileName));
+        // The connection used to receive the file is aborted by the dispatcher, and the one of the C-MOVE by the retrieve thread
+        INFO_LOG("No more files will be received, because they have requested to cancel the download");
+        return false;
     }
 
-    return condition;
+    return true;
 }
 
-OFCondition RetrieveDICOMFilesFromPACS::subOperationSCP(T_ASC_Association **subAssociation)
+void RetrieveDICOMFilesFromPACS::writeRetrievedDICOMFile(DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath)
 {
-    /// We become like a service. The PACS makes us requests that we must respond,
-    /// you can ask us to download an image or do an echo
-    T_DIMSE_Message dimseMessage;
-    T_ASC_PresentationContextID presentationContextID;
-
-    if (!ASC_dataWaiting(*subAssociation, 0))
-    {
-        return DIMSE_NODATAAVAILABLE;
-    }
+    //Let's save the image
+    OFCondition stateSaveImage = save(fileRetrieved, dicomFileAbsolutePath);
 
-    OFCondition condition = DIMSE_receiveCommand(*subAssociation, DIMSE_BLOCKING, 0, &presentationContextID, &dimseMessage, NULL);
-
-    if (condition == EC_Normal)
+    if (stateSaveImage.bad())
     {
-        switch (dimseMessage.CommandField)
+        DEBUG_LOG("The downloaded image could not be saved [" + dicomFileAbsolutePath + "], error: " + stateSaveImage.text());
+        ERROR_LOG("The downloaded image could not be saved [" + dicomFileAbsolutePath + "], error: " + stateSaveImage.text());
+        if (!QFile::remove(dicomFileAbsolutePath))
         {
-        case DIMSE_C_STORE_RQ:
-            condition = storeSCP(*subAssociation, &dimseMessage, presentationContextID);
-            break;
-
-        case DIMSE_C_ECHO_RQ:
-            condition = echoSCP(*subAssociation, &dimseMessage, presentationContextID);
-            break;
-
-        default:
-            ERROR_LOG("The PACS has requested an invalid type of operation");
-            condition = DIMSE_BADCOMMANDTYPE;
-            break;
+            DEBUG_LOG ("Failed to delete file" + dicomFileAbsolutePath + "previously failed to save.");
+            ERROR_LOG ("Failed to delete file" + dicomFileAbsolutePath + "previously failed to save.");
         }
+
+        QMutexLocker locker(&m_writtenFilesMutex);
+        m_numberOfFilesFailedToSave++;
+        m_pendingFilesSemaphore.release();
     }
-    // Clean up on association termination
-    if (condition == DUL_PEERREQUESTEDRELEASE)
-    {
-        INFO_LOG("The PACS requests to close the connection through which it sent us the files");
-        condition = ASC_acknowledgeRelease(*subAssociation);
-        ASC_dropSCPAssociation(*subAssociation);
-        ASC_destroyAssociation(subAssociation);
-        return condition;
-    }
-    else if (condition == DUL_PEERABORTEDASSOCIATION)
-    {
-        INFO_LOG("PACS aborted connection");
-    }
-    else if (condition != EC_Normal)
-    {
-        ERROR_LOG("An error occurred while receiving a suboperation request, error description: " + QString(condition.text()));
-        condition = ASC_abortAssociation(*subAssociation);
-    }
-    else if (m_abortIsRequested)
+    else
     {
-        INFO_LOG("We will abort the connections with the PACS, because they have requested to cancel the download");
-        condition = ASC_abortAssociation(*subAssociation);
-        if (!condition.good())
-        {
-            ERROR_LOG("Error aborting the connection for which we received the images" + QString(condition.text()));
-        }
+        DICOMTagReader *dicomTagReader = new DICOMTagReader(dicomFileAbsolutePath, fileRetrieved->getAndRemoveDataset());
 
-        /// We close the connection with the PACS because according to the DICOM documentation in PS 3.4
-        ///(Baseline Behavior of SCP) C.4.2.3.1 if we abort
-        /// the connection through which we receive the images, the behavior of the PACS is unknown,
-        /// for example DCM4CHEE closes the connection with the PACS, but
-        /// RAIM_Server does not close it and keeps it from ever leaving this class.
-        ///  Because it is not possible to know in this situation how they will act
-        /// the PACS closes the connection to the PACS here.
-        condition = ASC_abortAssociation(m_pacsConnection->getConnection());
-        if (!condition.good())
-        {
-            ERROR_LOG("Error aborting connection to PACS" + QString(condition.text()));
-        }
-        else
-        {
-            INFO_LOG("Aborted connection to PACS");
-        }
+        // The receivers expect the files one at a time
+        QMutexLocker locker(&m_writtenFilesMutex);
+        m_numberOfImagesRetrieved++;
+        emit DICOMFileRetrieved(dicomTagReader, m_numberOfImagesRetrieved);
     }
 
-    if (condition != EC_Normal)
-    {
-        ASC_dropAssociation(*subAssociation);
-        ASC_destroyAssociation(subAssociation);
-    }
-    return condition;
+    delete fileRetrieved;
+}
+
+void RetrieveDICOMFilesFromPACS::DICOMFileProcessed()
+{
+    m_pendingFilesSemaphore.release();
 }
 
-void RetrieveDICOMFilesFromPACS::subOperationCallback(void *subOperationCallbackData, T_ASC_Network *associationNetwork, T_ASC_Association **subAssociation)
+void RetrieveDICOMFilesFromPACS::abortMoveAssociation()
 {
-    RetrieveDICOMFilesFromPACS *retrieveDICOMFilesFromPACS = (RetrieveDICOMFilesFromPACS*)subOperationCallbackData;
-    if (associationNetwork == NULL)
+    if (!m_moveInProgress)
     {
-        // Help no net !
         return;
     }
 
-    if (*subAssociation == NULL)
+    /// We close the connection with the PACS because according to the DICOM documentation in PS 3.4
+    ///(Baseline Behavior of SCP) C.4.2.3.1 if we abort
+    /// the connection through which we receive the images, the behavior of the PACS is unknown,
+    /// for example DCM4CHEE closes the connection with the PACS, but
+    /// RAIM_Server does not close it and keeps it from ever leaving this class.
+    ///  Because it is not possible to know in this situation how they will act
+    /// the PACS closes the connection to the PACS here.
+    OFCondition condition = ASC_abortAssociation(m_pacsConnection->getConnection());
+    if (!condition.good())
     {
-        OFCondition condition = retrieveDICOMFilesFromPACS->acceptSubAssociation(associationNetwork, subAssociation);
-        if (!condition.good())
-        {
-            ERROR_LOG("An error occurred while negotiating the association of the incoming DICOM connection, description error: " + QString(condition.text()));
-        }
-        else
-        {
-            INFO_LOG("Connection request received by the incoming DICOM connection port of the PACS.");
-        }
+        ERROR_LOG("Error aborting connection to PACS" + QString(condition.text()));
     }
     else
     {
-        retrieveDICOMFilesFromPACS->subOperationSCP(subAssociation);
+        INFO_LOG("Aborted connection to PACS");
     }
+
+    m_moveInProgress = false;
+}
+
+OFCondition RetrieveDICOMFilesFromPACS::save(DcmFileFormat *fileRetrieved, QString dicomFileAbsolutePath)
+{
+    //We indicate that we do not use meta-header
+    E_FileWriteMode writeMode = EWM_fileformat;
+    // The dataset is written as it has been received, in its original transfer syntax. Sequences with undefined length and group lengths left as
+    // they are avoid traversing the whole dataset to recalculate lengths before writing it
+    E_EncodingType sequenceType = EET_UndefinedLength;
+    E_GrpLenEncoding groupLength = EGL_noChange;
+    E_PaddingEncoding paddingType = EPD_withoutPadding;
+    Uint32 filePadding = 0, itemPadding = 0;
+    E_TransferSyntax transferSyntaxFile = fileRetrieved->getDataset()->getOriginalXfer();
+
+    return fileRetrieved->saveFile(qPrintable(QDir::toNativeSeparators(dicomFileAbsolutePath)), transferSyntaxFile, sequenceType, groupLength, paddingType,
+                                   filePadding, itemPadding, writeMode);
 }
 
 PACSRequestStatus::RetrieveRequestStatus RetrieveDICOMFilesFromPACS::
@@ -416,11 +265,22 @@ retrieve(const QString &studyInstanceUID, const QString &seriesInstanceUID, cons
     MoveSCPCallbackData moveSCPCallbackData;
     DcmDataset *dcmDatasetToRetrieve = getDcmDatasetOfImagesToRetrieve(studyInstanceUID, seriesInstanceUID, sopInstanceUID);
     m_numberOfImagesRetrieved = 0;
+    m_numberOfFilesFailedToSave = 0;
+
+    // The files sent by the PACS are received through the incoming DICOM connections port, shared with the other running retrieves
+    PACSRequestStatus::RetrieveRequestStatus registrationStatus = IncomingDICOMConnectionsDispatcher::instance()->registerRetrieve(this, studyInstanceUID);
+    if (registrationStatus != PACSRequestStatus::RetrieveOk)
+    {
+        delete dcmDatasetToRetrieve;
+        return registrationStatus;
+    }
 
     // TODO It should be checked that it is a PACS with the retrieve service configured
     if (!m_pacsConnection->connectToPACS(PACSConnection::RetrieveDICOMFiles))
     {
         ERROR_LOG("An error occurred while trying to connect to the PACS for a retrieve. AE Title: " + m_pacs.getAETitle());
+        IncomingDICOMConnectionsDispatcher::instance()->unregisterRetrieve(this);
+        delete dcmDatasetToRetrieve;
         return PACSRequestStatus::RetrieveCanNotConnectToPACS;
     }
 
@@ -430,6 +290,9 @@ retrieve(const QString &studyInstanceUID, const QString &seriesInstanceUID, cons
     if (presentationContextID == 0)
     {
         ERROR_LOG("No valid presentation context found");
+        m_pacsConnection->disconnect();
+        IncomingDICOMConnectionsDispatcher::instance()->unregisterRetrieve(this);
+        delete dcmDatasetToRetrieve;
         return PACSRequestStatus::RetrieveFailureOrRefused;
     }
 
@@ -446,9 +309,12 @@ retrieve(const QString &studyInstanceUID, const QString &seriesInstanceUID, cons
     ASC_getAPTitles(association->params, moveRequest.MoveDestination, sizeof(moveRequest.MoveDestination), NULL, 0, NULL, 0);
 #endif
 #endif
+
+    m_moveInProgress = true;
+
+    // The sub-operations are not served here but by IncomingDICOMConnectionsDispatcher, so no network is given to accept them
     OFCondition condition = DIMSE_moveUser(association, presentationContextID, &moveRequest, dcmDatasetToRetrieve, moveCallback, &moveSCPCallbackData,
-                                           DIMSE_BLOCKING, 0, m_pacsConnection->getNetwork(), subOperationCallback, this, &moveResponse, &statusDetail,
-                                           NULL /*responseIdentifiers*/);
+                                           DIMSE_BLOCKING, 0, NULL, NULL, NULL, &moveResponse, &statusDetail, NULL /*responseIdentifiers*/);
 
     if (condition.bad())
     {
@@ -457,9 +323,21 @@ retrieve(const QString &studyInstanceUID, const QString &seriesInstanceUID, cons
                   .arg(condition.text()));
     }
 
+    m_moveInProgress = false;
+
+    IncomingDICOMConnectionsDispatcher::instance()->unregisterRetrieve(this);
     m_pacsConnection->disconnect();
 
+    // All the received files must have been saved and notified before the download is considered finished
+    m_writersThreadPool.waitForDone();
+
     retrieveRequestStatus = getDIMSEStatusCodeAsRetrieveRequestStatus(moveResponse.DimseStatus);
+    if (retrieveRequestStatus == PACSRequestStatus::RetrieveOk && m_numberOfFilesFailedToSave > 0)
+    {
+        // The PACS was told that these files were stored, but they couldn't be written to disk
+        ERROR_LOG(QString("%1 downloaded files could not be saved").arg(m_numberOfFilesFailedToSave));
+        retrieveRequestStatus = PACSRequestStatus::RetrieveSomeDICOMFilesFailed;
+    }
     processServiceClassProviderResponseStatus(moveResponse.DimseStatus, statusDetail);
     
     // Dump status detail information if there is some
@@ -475,7 +353,7 @@ retrieve(const QString &studyInstanceUID, const QString &seriesInstanceUID, cons
 
 void RetrieveDICOMFilesFromPACS::requestCancel()
 {
-    m_abortIsRequested = true;
+    m_abortIsRequested.store(1);
     INFO_LOG("You have been asked to cancel the download");
 }
 
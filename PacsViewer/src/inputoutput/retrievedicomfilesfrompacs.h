@@ -15,7 +15,11 @@
 #ifndef RETRIEVEDICOMFILESFROMPACS_H
 #define RETRIEVEDICOMFILESFROMPACS_H
 
+#include <QAtomicInt>
+#include <QMutex>
 #include <QObject>
+#include <QSemaphore>
+#include <QThreadPool>
 #include <ofcond.h>
 #include <assoc.h>
 
@@ -26,9 +30,7 @@
 struct T_DIMSE_C_MoveRQ;
 struct T_DIMSE_C_MoveRSP;
 struct T_DIMSE_C_StoreRQ;
-struct T_DIMSE_StoreProgress;
 struct T_DIMSE_C_StoreRSP;
-struct T_DIMSE_Message;
 
 class DcmDataset;
 class DcmFileFormat;
@@ -40,7 +42,9 @@ class DICOMTagReader;
 class PACSConnection;
 
 /**
-    This class is responsible for interacting with PACS, responding to move and store services
+    This class is responsible for interacting with PACS, responding to move and store services.
+    The files sent by the PACS through the C-STORE sub-operations are received by IncomingDICOMConnectionsDispatcher, which delivers them to
+    the retrieve of their study, so several retrieves can run at the same time.
 */
 class RetrieveDICOMFilesFromPACS : public QObject, public DIMSECService {
     Q_OBJECT
@@ -58,23 +62,33 @@ public:
     ///Returns the number of downloaded images
     int getNumberOfDICOMFilesRetrieved();
 
+    /// Validates a file received from the PACS against the store request, filling the store response, and queues it to be saved.
+    /// It's called by IncomingDICOMConnectionsDispatcher from the thread that serves the association through which the file has been received.
+    /// The file is saved by a writer thread, so that the disk doesn't slow down the reception of the next files, and it's deleted once saved.
+    /// If too many files are waiting to be saved or processed it blocks until there is room for one more.
+    /// Returns false if the download has been cancelled and the PACS must not send more files.
+    bool storeRetrievedDICOMFile(DcmFileFormat *fileRetrieved, T_DIMSE_C_StoreRQ *storeRequest, DcmDataset **imageDataSet,
+                                 T_DIMSE_C_StoreRSP *storeResponse);
+
+public slots:
+    /// Must be called once the DICOMTagReader of each DICOMFileRetrieved signal has been processed, so that more files can be received.
+    /// It can be called from any thread.
+    void DICOMFileProcessed();
+
 signals:
-    /// Signal indicating that a file has been downloaded
+    /// Signal indicating that a file has been downloaded. The receiver must call DICOMFileProcessed() once it has processed the file, because
+    /// each DICOMTagReader holds the whole dataset and only a limited number of them can be waiting to be processed.
     void DICOMFileRetrieved(DICOMTagReader *dicomTagReader, int numberOfImagesRetrieved);
 
 private:
-    /// In this function we accept the connection that is requested to us to transmit images to us,
-    /// and indicate which transfer syntax we support
-    OFCondition acceptSubAssociation(T_ASC_Network *associationNetwork, T_ASC_Association **association);
-
-    ///We respond to an echo request
-    OFCondition echoSCP(T_ASC_Association *association, T_DIMSE_Message *dimseMessage, T_ASC_PresentationContextID presentationContextID);
+    class DICOMFileWriter;
 
-    /// We respond to a request to save an image
-    OFCondition storeSCP(T_ASC_Association *association, T_DIMSE_Message *messagge, T_ASC_PresentationContextID presentationContextID);
+    /// Aborts the connection with the PACS through which the C-MOVE has been requested, if it's still open.
+    /// DCMTK associations are not thread-safe, so it must only be called from the retrieve thread, i.e. from moveCallback.
+    void abortMoveAssociation();
 
-    ///Accept the connection that the PACS makes to us, to become a scp
-    OFCondition subOperationSCP(T_ASC_Association **subAssociation);
+    /// Saves the given file in the given path and emits DICOMFileRetrieved. It's run in the writer threads
+    void writeRetrievedDICOMFile(DcmFileFormat *fileRetrieved, const QString &dicomFileAbsolutePath);
 
     /// Guarda una composite instance descarregada
     OFCondition save(DcmFileFormat *fileRetrieved, QString dicomFileAbsolutePath);
@@ -96,21 +110,7 @@ private:
     ///Callback from move, it would seem to run every time an image has been downloaded
     static void moveCallback(void *callbackData, T_DIMSE_C_MoveRQ *moveRequest, int responseCount, T_DIMSE_C_MoveRSP *moveResponse);
 
-    /// This function is responsible for saving each DICOM frame we receive
-    static void storeSCPCallback(void *callbackData, T_DIMSE_StoreProgress *progress, T_DIMSE_C_StoreRQ *storeRequest, char *imageFileName,
-                                 DcmDataset **imageDataSet, T_DIMSE_C_StoreRSP *storeResponse, DcmDataset **statusDetail);
-
-    /// Callback that was executed when an image download suboperation was started
-    static void subOperationCallback(void *subOperationCallbackData, T_ASC_Network *associationNetwork, T_ASC_Association **subAssociation);
-
 private:
-    struct StoreSCPCallbackData
-    {
-        DcmFileFormat *dcmFileFormat;
-        RetrieveDICOMFilesFromPACS *retrieveDICOMFilesFromPACS;
-        QString fileName;
-    };
-
     struct MoveSCPCallbackData
     {
         T_ASC_Association *association;
@@ -124,7 +124,23 @@ private:
 
     int m_numberOfImagesRetrieved;
 
-    bool m_abortIsRequested;
+    /// Set when the download is cancelled. It's read from the retrieve thread and from the threads that receive the files
+    QAtomicInt m_abortIsRequested;
+
+    /// Serializes the creation of the directories of the files received through different associations
+    QMutex m_storeMutex;
+    /// Indicates if the C-MOVE is in progress, i.e. if the connection with the PACS can be aborted. Only used from the retrieve thread
+    bool m_moveInProgress;
+
+    /// Threads that save the received files
+    QThreadPool m_writersThreadPool;
+    /// Limits the number of received files waiting to be saved or processed, so that they don't fill the memory when the disk or the patient filler
+    /// are slower than the network
+    QSemaphore m_pendingFilesSemaphore;
+    /// Serializes the notification of the saved files and protects the counters of saved files
+    QMutex m_writtenFilesMutex;
+    /// Number of received files that couldn't be saved
+    int m_numberOfFilesFailedToSave;
 
 };
 
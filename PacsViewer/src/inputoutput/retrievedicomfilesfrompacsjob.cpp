@@ -25,13 +25,13 @@
 #include "starviewerapplication.h"
 #include "retrievedicomfilesfrompacs.h"
 #include "dicommask.h"
+#include "localcachestorage.h"
 #include "localdatabasemanager.h"
 #include "patientfiller.h"
 #include "directoryutilities.h"
 #include "harddiskinformation.h"
 #include "inputoutputsettings.h"
 #include "dicomtagreader.h"
-#include "portinuse.h"
 #include "dicomsource.h"
 #include "usermessage.h"
 
@@ -91,88 +91,84 @@ void RetrieveDICOMFilesFromPACSJob::run(ThreadWeaver::JobPointer self, ThreadWea
         return;
     }
 
-    int localPort = settings.getValue(InputOutputSettings::IncomingDICOMConnectionsPort).toInt();
+    // If the study has been deleted from the cache recently its old files could still be being deleted in the background
+    LocalCacheStorage::instance()->waitForStudyFilesDeleted(m_studyToRetrieveDICOMFiles->getInstanceUID());
 
-    if (PortInUse().isPortInUse(localPort))
-    {
-        m_retrieveRequestStatus = PACSRequestStatus::RetrieveIncomingDICOMConnectionsPortInUse;
-        ERROR_LOG("The port " + QString::number(localPort) + " for incoming PACS connections, it is in use, the study cannot be downloaded");
-    }
-    else
+    PatientFiller patientFiller(getDICOMSourceRetrieveFiles());
+    QThread fillersThread;
+    patientFiller.moveToThread(&fillersThread);
+    LocalDatabaseManager localDatabaseManager;
+
+    /// Must be specified as DirectConnection, because otherwise this
+    /// signal it to the person who created the Job, which is the interface, therefore
+    /// would not be attended to until the interface is free,
+    /// causing incorrect behaviors
+    connect(m_retrieveDICOMFilesFromPACS, SIGNAL(DICOMFileRetrieved(DICOMTagReader*, int)), this, SLOT(DICOMFileRetrieved(DICOMTagReader*, int)),
+            Qt::DirectConnection);
+    ///We connect to the patientFiller signals to process the downloaded files
+    connect(this, &RetrieveDICOMFilesFromPACSJob::DICOMTagReaderReadyForProcess, &patientFiller, &PatientFiller::processDICOMFile);
+    /// Each processed file makes room for another received file. It must be a Qt::DirectConnection, because the receiving threads can be waiting
+    /// for it while the thread of m_retrieveDICOMFilesFromPACS is busy
+    connect(&patientFiller, SIGNAL(progress(int)), m_retrieveDICOMFilesFromPACS, SLOT(DICOMFileProcessed()), Qt::DirectConnection);
+    connect(this, SIGNAL(DICOMFilesRetrieveFinished()), &patientFiller, SLOT(finishDICOMFilesProcess()));
+    /// Connection between the processing of DICOM files and the insertion in the BD,
+    /// it is important that this signal is a Qt: DirectConnection so that the
+    /// is processed by the child threads, thus the thread
+    /// download that is waiting in fillersThread.wait () when it exits
+    /// hence because the fillers are already finished the patient has already been inserted into the database.
+    connect(&patientFiller, SIGNAL(patientProcessed(Patient*)), &localDatabaseManager, SLOT(save(Patient*)), Qt::DirectConnection);
+    ///Connections to end threads
+    connect(&patientFiller, SIGNAL(patientProcessed(Patient*)), &fillersThread, SLOT(quit()), Qt::DirectConnection);
+
+    localDatabaseManager.setStudyBeingRetrieved(m_studyToRetrieveDICOMFiles->getInstanceUID());
+    fillersThread.start();
+
+    m_retrieveRequestStatus = m_retrieveDICOMFilesFromPACS->retrieve(m_studyToRetrieveDICOMFiles->getInstanceUID(), m_seriesInstanceUIDToRetrieve,
+                                                                     m_SOPInstanceUIDToRetrieve);
+
+    if ((m_retrieveRequestStatus == PACSRequestStatus::RetrieveOk || m_retrieveRequestStatus == PACSRequestStatus::RetrieveSomeDICOMFilesFailed) &&
+            !this->isAbortRequested())
     {
-        PatientFiller patientFiller(getDICOMSourceRetrieveFiles());
-        QThread fillersThread;
-        patientFiller.moveToThread(&fillersThread);
-        LocalDatabaseManager localDatabaseManager;
-
-        /// Must be specified as DirectConnection, because otherwise this
-        /// signal it to the person who created the Job, which is the interface, therefore
-        /// would not be attended to until the interface is free,
-        /// causing incorrect behaviors
-        connect(m_retrieveDICOMFilesFromPACS, SIGNAL(DICOMFileRetrieved(DICOMTagReader*, int)), this, SLOT(DICOMFileRetrieved(DICOMTagReader*, int)),
-                Qt::DirectConnection);
-        ///We connect to the patientFiller signals to process the downloaded files
-        connect(this, &RetrieveDICOMFilesFromPACSJob::DICOMTagReaderReadyForProcess, &patientFiller, &PatientFiller::processDICOMFile);
-        connect(this, SIGNAL(DICOMFilesRetrieveFinished()), &patientFiller, SLOT(finishDICOMFilesProcess()));
-        /// Connection between the processing of DICOM files and the insertion in the BD,
-        /// it is important that this signal is a Qt: DirectConnection so that the
-        /// is processed by the child threads, thus the thread
-        /// download that is waiting in fillersThread.wait () when it exits
-        /// hence because the fillers are already finished the patient has already been inserted into the database.
-        connect(&patientFiller, SIGNAL(patientProcessed(Patient*)), &localDatabaseManager, SLOT(save(Patient*)), Qt::DirectConnection);
-        ///Connections to end threads
-        connect(&patientFiller, SIGNAL(patientProcessed(Patient*)), &fillersThread, SLOT(quit()), Qt::DirectConnection);
-
-        localDatabaseManager.setStudyBeingRetrieved(m_studyToRetrieveDICOMFiles->getInstanceUID());
-        fillersThread.start();
-
-        m_retrieveRequestStatus = m_retrieveDICOMFilesFromPACS->retrieve(m_studyToRetrieveDICOMFiles->getInstanceUID(), m_seriesInstanceUIDToRetrieve,
-                                                                         m_SOPInstanceUIDToRetrieve);
-
-        if ((m_retrieveRequestStatus == PACSRequestStatus::RetrieveOk || m_retrieveRequestStatus == PACSRequestStatus::RetrieveSomeDICOMFilesFailed) &&
-                !this->isAbortRequested())
-        {
-            INFO_LOG(QString("PACS %2 study %1 has finished downloading, %3 files have been downloaded")
-                     .arg(m_studyToRetrieveDICOMFiles->getInstanceUID(), getPacsDevice().getAETitle())
-                     .arg(m_retrieveDICOMFilesFromPACS->getNumberOfDICOMFilesRetrieved()));
+        INFO_LOG(QString("PACS %2 study %1 has finished downloading, %3 files have been downloaded")
+                 .arg(m_studyToRetrieveDICOMFiles->getInstanceUID(), getPacsDevice().getAETitle())
+                 .arg(m_retrieveDICOMFilesFromPACS->getNumberOfDICOMFilesRetrieved()));
 
-            //We indicate that the download process is complete
-            emit DICOMFilesRetrieveFinished();
+        //We indicate that the download process is complete
+        emit DICOMFilesRetrieveFinished();
 
-            // We expect the processing and insertion into the database to complete
-            fillersThread.wait();
+        // We expect the processing and insertion into the database to complete
+        fillersThread.wait();
 
-            if (localDatabaseManager.getLastError() != LocalDatabaseManager::Ok)
+        if (localDatabaseManager.getLastError() != LocalDatabaseManager::Ok)
+        {
+            if (localDatabaseManager.getLastError() == LocalDatabaseManager::PatientInconsistent)
             {
-                if (localDatabaseManager.getLastError() == LocalDatabaseManager::PatientInconsistent)
-                {
-                    /// Could not insert patient, because patientfiller
-                    /// could not fill in the patient information correctly
-                    m_retrieveRequestStatus = PACSRequestStatus::RetrievePatientInconsistent;
-                }
-                else
-                {
-                    m_retrieveRequestStatus = PACSRequestStatus::RetrieveDatabaseError;
-                }
+                /// Could not insert patient, because patientfiller
+                /// could not fill in the patient information correctly
+                m_retrieveRequestStatus = PACSRequestStatus::RetrievePatientInconsistent;
+            }
+            else
+            {
+                m_retrieveRequestStatus = PACSRequestStatus::RetrieveDatabaseError;
             }
         }
-        else
-        {
-            fillersThread.quit();
-            /// We hope that the thread ends, because from what is interpreted from the documentation,
-            /// it seems that quitting the thread is not done until it returns
-            /// in eventLoop, this causes for example in the cases that we have canceled
-            /// lat the download of a study, if we do not wait for the thread to be dead
-            /// we can delete images that the fillers are processing on that one
-            /// moment while they're still running and ask for the Starviewer, because
-            /// the Slot quit of the thread has not been addressed, so we hope this
-            /// is dead deleting downloaded images.
-            fillersThread.wait();
-            deleteRetrievedDICOMFilesIfStudyNotExistInDatabase();
-        }
-
-        localDatabaseManager.setNoStudyBeingRetrieved();
     }
+    else
+    {
+        fillersThread.quit();
+        /// We hope that the thread ends, because from what is interpreted from the documentation,
+        /// it seems that quitting the thread is not done until it returns
+        /// in eventLoop, this causes for example in the cases that we have canceled
+        /// lat the download of a study, if we do not wait for the thread to be dead
+        /// we can delete images that the fillers are processing on that one
+        /// moment while they're still running and ask for the Starviewer, because
+        /// the Slot quit of the thread has not been addressed, so we hope this
+        /// is dead deleting downloaded images.
+        fillersThread.wait();
+        deleteRetrievedDICOMFilesIfStudyNotExistInDatabase();
+    }
+
+    localDatabaseManager.setNoStudyBeingRetrieved(m_studyToRetrieveDICOMFiles->getInstanceUID());
 }
 
 void RetrieveDICOMFilesFromPACSJob::requestCancelJob()
@@ -352,6 +348,12 @@ QString RetrieveDICOMFilesFromPACSJob::getStatusDescription()
                      "by another application.")
                 .arg(studyID, patientName, settings.getValue(InputOutputSettings::IncomingDICOMConnectionsPort).toString());
         break;
+    case PACSRequestStatus::RetrieveStudyAlreadyBeingRetrieved:
+        message = tr("Cannot retrieve images from study %1 of patient %2 from PACS %3 because the study is already being retrieved.")
+                .arg(studyID, patientName, pacsAETitle);
+        message += "\n\n";
+        message += tr("Wait until the current retrieve finishes and try again.");
+        break;
     case PACSRequestStatus::RetrieveSomeDICOMFilesFailed:
         message = tr("Unable to retrieve some images from study %1 of patient %2 from PACS %3. Maybe those images are missing or corrupted in PACS.")
                 .arg(studyID, patientName, pacsAETitle);
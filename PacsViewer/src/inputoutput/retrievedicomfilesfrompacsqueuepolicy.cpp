@@ -0,0 +1,106 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#include "retrievedicomfilesfrompacsqueuepolicy.h"
+
+#include "retrievedicomfilesfrompacsjob.h"
+#include "study.h"
+
+namespace udg {
+
+RetrieveDICOMFilesFromPACSQueuePolicy::RetrieveDICOMFilesFromPACSQueuePolicy()
+    : m_maximumNumberOfConcurrentRetrievesPerPACS(1)
+{
+}
+
+RetrieveDICOMFilesFromPACSQueuePolicy::~RetrieveDICOMFilesFromPACSQueuePolicy()
+{
+}
+
+void RetrieveDICOMFilesFromPACSQueuePolicy::setMaximumNumberOfConcurrentRetrievesPerPACS(int maximum)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maximumNumberOfConcurrentRetrievesPerPACS = qMax(1, maximum);
+}
+
+int RetrieveDICOMFilesFromPACSQueuePolicy::getMaximumNumberOfConcurrentRetrievesPerPACS() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maximumNumberOfConcurrentRetrievesPerPACS;
+}
+
+bool RetrieveDICOMFilesFromPACSQueuePolicy::canRun(ThreadWeaver::JobPointer job)
+{
+    QSharedPointer<RetrieveDICOMFilesFromPACSJob> retrieveJob = job.dynamicCast<RetrieveDICOMFilesFromPACSJob>();
+
+    if (!retrieveJob)
+    {
+        return true;
+    }
+
+    RunningRetrieve retrieve;
+    retrieve.pacsKey = retrieveJob->getPacsDevice().getKeyName();
+    retrieve.studyInstanceUID = retrieveJob->getStudyToRetrieveDICOMFiles()->getInstanceUID();
+
+    QMutexLocker locker(&m_mutex);
+
+    if (m_studiesBeingRetrieved.contains(retrieve.studyInstanceUID))
+    {
+        return false;
+    }
+
+    if (m_numberOfRunningRetrievesPerPACS.value(retrieve.pacsKey) >= m_maximumNumberOfConcurrentRetrievesPerPACS)
+    {
+        return false;
+    }
+
+    m_runningRetrieves.insert(job.data(), retrieve);
+    m_numberOfRunningRetrievesPerPACS[retrieve.pacsKey]++;
+    m_studiesBeingRetrieved.insert(retrieve.studyInstanceUID);
+
+    return true;
+}
+
+void RetrieveDICOMFilesFromPACSQueuePolicy::free(ThreadWeaver::JobPointer job)
+{
+    removeRunningJob(job.data());
+}
+
+void RetrieveDICOMFilesFromPACSQueuePolicy::release(ThreadWeaver::JobPointer job)
+{
+    removeRunningJob(job.data());
+}
+
+void RetrieveDICOMFilesFromPACSQueuePolicy::destructed(ThreadWeaver::JobInterface *job)
+{
+    removeRunningJob(job);
+}
+
+void RetrieveDICOMFilesFromPACSQueuePolicy::removeRunningJob(ThreadWeaver::JobInterface *job)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_runningRetrieves.contains(job))
+    {
+        RunningRetrieve retrieve = m_runningRetrieves.take(job);
+
+        if (--m_numberOfRunningRetrievesPerPACS[retrieve.pacsKey] <= 0)
+        {
+            m_numberOfRunningRetrievesPerPACS.remove(retrieve.pacsKey);
+        }
+        m_studiesBeingRetrieved.remove(retrieve.studyInstanceUID);
+    }
+}
+
+} // namespace udg
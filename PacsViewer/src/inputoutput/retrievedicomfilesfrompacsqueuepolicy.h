@@ -0,0 +1,80 @@
+/*************************************************************************************
+  Copyright (C) 2014 Laboratori de Gràfics i Imatge, Universitat de Girona &
+  Institut de Diagnòstic per la Imatge.
+  Girona 2014. All rights reserved.
+  http://starviewer.udg.edu
+
+  This file is part of the Starviewer (Medical Imaging Software) open source project.
+  It is subject to the license terms in the LICENSE file found in the top-level
+  directory of this distribution and at http://starviewer.udg.edu/license. No part of
+  the Starviewer (Medical Imaging Software) open source project, including this file,
+  may be copied, modified, propagated, or distributed except according to the
+  terms contained in the LICENSE file.
+ *************************************************************************************/
+
+#ifndef UDG_RETRIEVEDICOMFILESFROMPACSQUEUEPOLICY_H
+#define UDG_RETRIEVEDICOMFILESFROMPACSQUEUEPOLICY_H
+
+#include <ThreadWeaver/QueuePolicy>
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+namespace udg {
+
+/**
+    ThreadWeaver queue policy that decides which retrieve jobs can run concurrently.
+
+    The global number of concurrent retrieves is limited by the number of threads of the queue, and this policy adds two more restrictions:
+    - Only a maximum number of retrieves from the same PACS can run concurrently, so that a single PACS is not flooded with C-MOVE requests.
+    - Only one retrieve of each study can run at a time. This way the files received through the incoming DICOM connections can be delivered to
+      their retrieve by Study Instance UID, and a failed retrieve never deletes files that another retrieve of the same study is receiving.
+
+    Jobs that are not RetrieveDICOMFilesFromPACSJob are always admitted. This class can be used concurrently from the ThreadWeaver threads.
+ */
+class RetrieveDICOMFilesFromPACSQueuePolicy : public ThreadWeaver::QueuePolicy {
+public:
+    RetrieveDICOMFilesFromPACSQueuePolicy();
+    virtual ~RetrieveDICOMFilesFromPACSQueuePolicy();
+
+    /// Sets the maximum number of retrieves from the same PACS that can run concurrently. It must be at least 1.
+    void setMaximumNumberOfConcurrentRetrievesPerPACS(int maximum);
+    /// Returns the maximum number of retrieves from the same PACS that can run concurrently.
+    int getMaximumNumberOfConcurrentRetrievesPerPACS() const;
+
+    virtual bool canRun(ThreadWeaver::JobPointer job);
+    virtual void free(ThreadWeaver::JobPointer job);
+    virtual void release(ThreadWeaver::JobPointer job);
+    virtual void destructed(ThreadWeaver::JobInterface *job);
+
+private:
+    /// Removes the given job from the running jobs.
+    void removeRunningJob(ThreadWeaver::JobInterface *job);
+
+private:
+    /// PACS and study of a running retrieve.
+    struct RunningRetrieve
+    {
+        QString pacsKey;
+        QString studyInstanceUID;
+    };
+
+    /// Protects all the members, since the policy is used from the ThreadWeaver threads.
+    mutable QMutex m_mutex;
+
+    /// Running retrieves.
+    QHash<ThreadWeaver::JobInterface*, RunningRetrieve> m_runningRetrieves;
+    /// Number of running retrieves from each PACS, indexed by PACS key name.
+    QHash<QString, int> m_numberOfRunningRetrievesPerPACS;
+    /// Studies being retrieved.
+    QSet<QString> m_studiesBeingRetrieved;
+
+    /// Maximum number of concurrent retrieves from the same PACS.
+    int m_maximumNumberOfConcurrentRetrievesPerPACS;
+};
+
+} // namespace udg
+
+#endif // UDG_RETRIEVEDICOMFILESFROMPACSQUEUEPOLICY_H
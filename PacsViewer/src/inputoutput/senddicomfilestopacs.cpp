@@ -21,7 +21,9 @@
 #include <dcdeftag.h>
 
 #include <QDir>
+#include <QRunnable>
 #include <QSet>
+#include <QThreadPool>
 
 #include "logging.h"
 #include "image.h"
@@ -31,6 +33,22 @@
 
 namespace udg {
 
+class SendDICOMFilesToPACS::AssociationSender : public QRunnable {
+public:
+    AssociationSender(SendDICOMFilesToPACS *sendDICOMFilesToPACS)
+        : m_sendDICOMFilesToPACS(sendDICOMFilesToPACS)
+    {
+    }
+
+    virtual void run()
+    {
+        m_sendDICOMFilesToPACS->sendThroughNewAssociation();
+    }
+
+private:
+    SendDICOMFilesToPACS *m_sendDICOMFilesToPACS;
+};
+
 SendDICOMFilesToPACS::SendDICOMFilesToPACS(PacsDevice pacsDevice)
     : DIMSECService()
 {
@@ -47,39 +65,138 @@ PacsDevice SendDICOMFilesToPACS::getPacs()
 
 PACSRequestStatus::SendRequestStatus SendDICOMFilesToPACS::send(QList<Image*> imageListToSend)
 {
-    QScopedPointer<PACSConnection> pacsConnection(createPACSConnection(m_pacs));
+    removeDuplicateFiles(imageListToSend);
+    initialitzeDICOMFilesCounters(imageListToSend.count());
+
+    m_imagesToSend = imageListToSend;
+    m_nextImageToSendIndex = 0;
+    m_imagesToSendAgain.clear();
+    m_numberOfImagesBeingSent = 0;
+    m_numberOfOpenedAssociations = 0;
+    m_numberOfLostAssociations = 0;
+
+    QScopedPointer<SettingsInterface> settings(getSettings());
+    m_transferSyntaxesBySOPClass.clear();
+    if (settings->getValue(InputOutputSettings::ProposeTransferSyntaxesOfDICOMFilesToSend).toBool())
+    {
+        m_transferSyntaxesBySOPClass = getTransferSyntaxesBySOPClass(imageListToSend);
+    }
+
+    // There's no point in opening more associations than files
+    int numberOfAssociations = qBound(1, settings->getValue(InputOutputSettings::SendDICOMFilesAssociationsPerPACS).toInt(),
+                                      qMax(1, imageListToSend.count()));
+
+    // The first association is used from this thread and the rest from the threads of the pool
+    QThreadPool associationsThreadPool;
+    associationsThreadPool.setMaxThreadCount(qMax(1, numberOfAssociations - 1));
+
+    for (int i = 1; i < numberOfAssociations; i++)
+    {
+        associationsThreadPool.start(new AssociationSender(this));
+    }
+
+    sendThroughNewAssociation();
+    associationsThreadPool.waitForDone();
+
+    m_imagesToSend.clear();
+    m_imagesToSendAgain.clear();
+
     // TODO: S'hauria de comprovar que es tracti d'un PACS amb el servei d'store configurat
-    if (!pacsConnection->connectToPACS(PACSConnection::SendDICOMFiles))
+    if (m_numberOfOpenedAssociations.load() == 0)
     {
         ERROR_LOG(" S'ha produit un error al intentar connectar al PACS per fer un send. AE Title: " + m_pacs.getAETitle());
         return PACSRequestStatus::SendCanNotConnectToPACS;
     }
 
-    removeDuplicateFiles(imageListToSend);
-    initialitzeDICOMFilesCounters(imageListToSend.count());
+    return getStatusStoreSCU();
+}
 
-    foreach (Image *imageToStore, imageListToSend)
+void SendDICOMFilesToPACS::sendThroughNewAssociation()
+{
+    QScopedPointer<PACSConnection> pacsConnection(createPACSConnection(m_pacs));
+    pacsConnection->setTransferSyntaxesToSend(m_transferSyntaxesBySOPClass);
+
+    if (!pacsConnection->connectToPACS(PACSConnection::SendDICOMFiles))
     {
-        if (m_abortIsRequested)
+        // The files are sent through the rest of associations, if any could be opened
+        ERROR_LOG("Could not open an association with the PACS to send files. AE Title: " + m_pacs.getAETitle());
+        return;
+    }
+
+    m_numberOfOpenedAssociations.ref();
+
+    bool associationLost = false;
+
+    while (!associationLost)
+    {
+        Image *imageToStore = takeNextImageToSend();
+        if (!imageToStore)
         {
             break;
         }
 
         INFO_LOG(QString("S'enviara al PACS %1 el fitxer %2").arg(m_pacs.getAETitle(), imageToStore->getPath()));
-        if (storeSCU(pacsConnection->getConnection(), qPrintable(imageToStore->getPath())))
+        if (storeSCU(pacsConnection->getConnection(), imageToStore->getPath(), associationLost))
         {
+            QMutexLocker locker(&m_responsesMutex);
             emit DICOMFileSent(imageToStore, getNumberOfDICOMFilesSentSuccesfully() + this->getNumberOfDICOMFilesSentWarning());
         }
-        else if (m_lastOFCondition == DIMSE_SENDFAILED)
+
+        finishImageSending(imageToStore, associationLost);
+    }
+
+    if (associationLost)
+    {
+        // The file that was being sent and the ones not sent yet are sent through the rest of associations
+        ERROR_LOG("Lost an association with the PACS while sending files. AE Title: " + m_pacs.getAETitle());
+        m_numberOfLostAssociations.ref();
+    }
+
+    pacsConnection->disconnect();
+}
+
+Image* SendDICOMFilesToPACS::takeNextImageToSend()
+{
+    QMutexLocker locker(&m_imagesToSendMutex);
+
+    while (!m_abortIsRequested)
+    {
+        if (!m_imagesToSendAgain.isEmpty())
+        {
+            m_numberOfImagesBeingSent++;
+            return m_imagesToSendAgain.takeFirst();
+        }
+
+        if (m_nextImageToSendIndex < m_imagesToSend.count())
+        {
+            m_numberOfImagesBeingSent++;
+            return m_imagesToSend.at(m_nextImageToSendIndex++);
+        }
+
+        if (m_numberOfImagesBeingSent == 0)
         {
-            // Si se'ns retorna un OFCondition == DIMSE_SENDFAILED, indica que s'ha perdut la connexió amb el PACS
             break;
         }
+
+        // Another association could be lost, its file would have to be sent through this one
+        m_imagesToSendCondition.wait(&m_imagesToSendMutex);
     }
 
-    pacsConnection->disconnect();
+    return NULL;
+}
 
-    return getStatusStoreSCU();
+void SendDICOMFilesToPACS::finishImageSending(Image *image, bool associationLost)
+{
+    QMutexLocker locker(&m_imagesToSendMutex);
+
+    m_numberOfImagesBeingSent--;
+    if (associationLost)
+    {
+        // If there isn't any other association left it will be counted as failed
+        m_imagesToSendAgain.append(image);
+    }
+
+    m_imagesToSendCondition.wakeAll();
 }
 
 void SendDICOMFilesToPACS::requestCancel()
@@ -93,6 +210,11 @@ PACSConnection* SendDICOMFilesToPACS::createPACSConnection(const PacsDevice &pac
     return new PACSConnection(pacsDevice);
 }
 
+SettingsInterface* SendDICOMFilesToPACS::getSettings() const
+{
+    return new Settings();
+}
+
 void SendDICOMFilesToPACS::removeDuplicateFiles(QList<Image*> &imageList) const
 {
     QSet<QString> paths;
@@ -121,6 +243,31 @@ void SendDICOMFilesToPACS::initialitzeDICOMFilesCounters(int numberOfDICOMFilesT
     m_numberOfDICOMFilesToSend = numberOfDICOMFilesToSend;
 }
 
+QHash<QString, QSet<QString> > SendDICOMFilesToPACS::getTransferSyntaxesBySOPClass(const QList<Image*> &imageList) const
+{
+    QHash<QString, QSet<QString> > transferSyntaxesBySOPClass;
+
+    foreach (Image *image, imageList)
+    {
+        // Only the meta header is read, which is at the beginning of the file
+        DcmFileFormat dcmff;
+        OFString sopClass;
+        OFString transferSyntax;
+
+        if (dcmff.loadFile(qPrintable(QDir::toNativeSeparators(image->getPath())), EXS_Unknown, EGL_noChange, DCM_MaxReadLength, ERM_metaOnly).bad() ||
+            dcmff.getMetaInfo()->findAndGetOFString(DCM_MediaStorageSOPClassUID, sopClass).bad() ||
+            dcmff.getMetaInfo()->findAndGetOFString(DCM_TransferSyntaxUID, transferSyntax).bad())
+        {
+            INFO_LOG("Could not read the meta header of the file " + image->getPath() + ", the default transfer syntaxes will be proposed");
+            return QHash<QString, QSet<QString> >();
+        }
+
+        transferSyntaxesBySOPClass[sopClass.c_str()].insert(transferSyntax.c_str());
+    }
+
+    return transferSyntaxesBySOPClass;
+}
+
 // This function will read all the information from the given file,
 // figure out a corresponding presentation context which will be used
 // to transmit the information over the network to the SCP, and it
@@ -129,8 +276,11 @@ void SendDICOMFilesToPACS::initialitzeDICOMFilesCounters(int numberOfDICOMFilesT
 // Parameters:
 //   association - [in] The associationiation (network connection to another DICOM application).
 //   filepathToStore - [in] Name of the file which shall be processed.
-bool SendDICOMFilesToPACS::storeSCU(T_ASC_Association *association, QString filepathToStore)
+//   associationLost - [out] Whether the association has been lost.
+bool SendDICOMFilesToPACS::storeSCU(T_ASC_Association *association, QString filepathToStore, bool &associationLost)
 {
+    associationLost = false;
+
     DIC_US msgId = association->nextMsgID++;
     T_ASC_PresentationContextID presentationContextID;
     T_DIMSE_C_StoreRQ request;
@@ -140,10 +290,10 @@ bool SendDICOMFilesToPACS::storeSCU(T_ASC_Association *association, QString file
     DcmDataset *statusDetail = NULL;
     DcmFileFormat dcmff;
 
-    m_lastOFCondition = dcmff.loadFile(qPrintable(QDir::toNativeSeparators(filepathToStore)));
+    OFCondition condition = dcmff.loadFile(qPrintable(QDir::toNativeSeparators(filepathToStore)));
 
     // Figure out if an error occured while the file was read
-    if (m_lastOFCondition.bad())
+    if (condition.bad())
     {
         ERROR_LOG("Could not open file " + filepathToStore);
         return false;
@@ -204,25 +354,37 @@ bool SendDICOMFilesToPACS::storeSCU(T_ASC_Association *association, QString file
         request.DataSetType = DIMSE_DATASET_PRESENT;
         request.Priority = DIMSE_PRIORITY_LOW;
 
-        m_lastOFCondition = DIMSE_storeUser(association, presentationContextID, &request, NULL /*imageFileName*/, dcmff.getDataset(),
+        condition = DIMSE_storeUser(association, presentationContextID, &request, NULL /*imageFileName*/, dcmff.getDataset(),
                                             NULL /*progressCallback*/, NULL /*callbackData */, DIMSE_NONBLOCKING,
                                             Settings().getValue(InputOutputSettings::PACSConnectionTimeout).toInt(), &response, &statusDetail,
                                             NULL /*check for cancel parameters*/, OFStandard::getFileSize(qPrintable(filepathToStore)));
 
-        if (m_lastOFCondition.bad())
+        if (condition.bad())
         {
-            ERROR_LOG("There was an error storing the image" + filepathToStore + ", error description" + QString(m_lastOFCondition.text()));
+            ERROR_LOG("There was an error storing the image" + filepathToStore + ", error description" + QString(condition.text()));
+        }
+
+        // Si se'ns retorna un OFCondition == DIMSE_SENDFAILED, indica que s'ha perdut la connexió amb el PACS
+        associationLost = condition == DIMSE_SENDFAILED;
+
+        if (associationLost)
+        {
+            // No response has been received, the file will be sent again through another association
+            delete statusDetail;
+            return false;
         }
 
+        m_responsesMutex.lock();
         processResponseFromStoreSCP(response.DimseStatus, filepathToStore);
         processServiceClassProviderResponseStatus(response.DimseStatus, statusDetail);
+        m_responsesMutex.unlock();
 
         if (statusDetail != NULL)
         {
             delete statusDetail;
         }
 
-        return m_lastOFCondition.good() && response.DimseStatus == STATUS_Success;
+        return condition.good() && response.DimseStatus == STATUS_Success;
     }
 }
 
@@ -240,7 +402,7 @@ void SendDICOMFilesToPACS::processResponseFromStoreSCP(unsigned int dimseStatusC
     if (dimseStatusCode == STATUS_Success)
     {
         // Image sent successfully
-        m_numberOfDICOMFilesSentSuccessfully++;
+        m_numberOfDICOMFilesSentSuccessfully.ref();
         return;
     }
 
@@ -272,7 +434,7 @@ void SendDICOMFilesToPACS::processResponseFromStoreSCP(unsigned int dimseStatusC
     case STATUS_STORE_Warning_ElementsDiscarded:
         // 0xB006
         ERROR_LOG(messageErrorLog + QString(DU_cstoreStatusString(dimseStatusCode)));
-        m_numberOfDICOMFilesSentWithWarning++;
+        m_numberOfDICOMFilesSentWithWarning.ref();
         break;
         
     default:
@@ -294,8 +456,9 @@ PACSRequestStatus::SendRequestStatus SendDICOMFilesToPACS::getStatusStoreSCU()
         INFO_LOG("Sending images to PACS aborted");
         return PACSRequestStatus::SendCancelled;
     }
-    else if (m_lastOFCondition == DIMSE_SENDFAILED)
+    else if (m_numberOfLostAssociations.load() == m_numberOfOpenedAssociations.load())
     {
+        // When only some of the associations are lost the rest send the files left
         ERROR_LOG("Lost connection to PACS while sending files");
         return PACSRequestStatus::SendPACSConnectionBroken;
     }
@@ -328,17 +491,17 @@ PACSRequestStatus::SendRequestStatus SendDICOMFilesToPACS::getStatusStoreSCU()
 
 int SendDICOMFilesToPACS::getNumberOfDICOMFilesSentSuccesfully()
 {
-    return m_numberOfDICOMFilesSentSuccessfully;
+    return m_numberOfDICOMFilesSentSuccessfully.load();
 }
 
 int SendDICOMFilesToPACS::getNumberOfDICOMFilesSentFailed()
 {
-    return m_numberOfDICOMFilesToSend - m_numberOfDICOMFilesSentSuccessfully - m_numberOfDICOMFilesSentWithWarning;
+    return m_numberOfDICOMFilesToSend - getNumberOfDICOMFilesSentSuccesfully() - getNumberOfDICOMFilesSentWarning();
 }
 
 int SendDICOMFilesToPACS::getNumberOfDICOMFilesSentWarning()
 {
-    return m_numberOfDICOMFilesSentWithWarning;
+    return m_numberOfDICOMFilesSentWithWarning.load();
 }
 
 }
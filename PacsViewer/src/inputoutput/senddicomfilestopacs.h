@@ -15,8 +15,13 @@
 #ifndef UDGSENDDICOMFILESTOPACS_H
 #define UDGSENDDICOMFILESTOPACS_H
 
+#include <QAtomicInt>
+#include <QHash>
 #include <QList>
+#include <QMutex>
 #include <QObject>
+#include <QSet>
+#include <QWaitCondition>
 #include <ofcond.h>
 
 #include "pacsdevice.h"
@@ -32,7 +37,13 @@ namespace udg {
 
 class Image;
 class PACSConnection;
+class SettingsInterface;
 
+/**
+    Sends DICOM files to a PACS with C-STORE operations. The files are sent through several associations at the same time, as many as set in
+    InputOutputSettings::SendDICOMFilesAssociationsPerPACS, each one sending the next file not sent yet. The transfer syntaxes of the files can be
+    proposed to the PACS when the associations are negotiated so that they are sent as they are, without transcoding them.
+  */
 class SendDICOMFilesToPACS : public QObject, public DIMSECService {
     Q_OBJECT
 public:
@@ -65,15 +76,21 @@ public:
 
 signals:
     /// Signal indicating that the past image has been sent
-    /// per parameter in the PACS, and the number of images that are sent
+    /// per parameter in the PACS, and the number of images that are sent.
+    /// It's emitted from the threads of the associations, but never from two of them at the same time
     void DICOMFileSent(Image *image, int numberOfDICOMFilesSent);
 
 protected:
 
     /// Number of files that have been sent successfully.
-    int m_numberOfDICOMFilesSentSuccessfully;
+    QAtomicInt m_numberOfDICOMFilesSentSuccessfully;
 
 private:
+    /// Sends files through a new association from a thread of a pool.
+    class AssociationSender;
+
+    /// Returns the settings to use. The caller takes ownership of the returned object.
+    virtual SettingsInterface* getSettings() const;
 
     /// Creates and returns a PACS connection to the given PACS device.
     virtual PACSConnection* createPACSConnection(const PacsDevice &pacsDevice) const;
@@ -85,12 +102,30 @@ private:
     /// Initialize image counters to control how many failed / were sent ....
     void initialitzeDICOMFilesCounters(int numberOfDICOMFilesToSend);
 
+    /// Returns the transfer syntaxes of the given files grouped by SOP class, read from their meta header.
+    /// Returns an empty hash if the meta header of any of the files can't be read.
+    QHash<QString, QSet<QString> > getTransferSyntaxesBySOPClass(const QList<Image*> &imageList) const;
+
+    /// Opens a new association with the PACS and sends through it the next files not sent yet until all have been sent,
+    /// the sending is cancelled or the association is lost
+    void sendThroughNewAssociation();
+
+    /// Returns the next file that has to be sent, giving priority to the ones whose association has been lost while they were being sent.
+    /// When there are no files left but others are still being sent it waits for them, because they could have to be sent again.
+    /// Returns null when all the files have been sent or the sending is cancelled
+    Image* takeNextImageToSend();
+
+    /// Notifies that the sending of the given file taken with takeNextImageToSend() has finished. If the association has been lost
+    /// the file is queued again to be sent through the rest of associations
+    void finishImageSending(Image *image, bool associationLost);
+
     /// Process a Store SCP response that did not have Successfull Status
     void processResponseFromStoreSCP(unsigned int dimseStatusCode, QString filePathDicomObjectStoredFailed);
 
     /// Send an image to the PACS with the association passed by parameter,
-    /// returns if the image was sent successfully
-    virtual bool storeSCU(T_ASC_Association *association, QString filePathToStore);
+    /// returns if the image was sent successfully. associationLost is set to true if the association has been lost.
+    /// It's called from the threads of all the associations at the same time
+    virtual bool storeSCU(T_ASC_Association *association, QString filePathToStore, bool &associationLost);
 
     /// Returns a Status indicating how the C-Store operation ended
     PACSRequestStatus::SendRequestStatus getStatusStoreSCU();
@@ -98,12 +133,29 @@ private:
 private:
 
     /// Number of files that have been sent but with a warning.
-    int m_numberOfDICOMFilesSentWithWarning;
+    QAtomicInt m_numberOfDICOMFilesSentWithWarning;
     /// Total number of files that had to be sent.
     int m_numberOfDICOMFilesToSend;
     PacsDevice m_pacs;
     bool m_abortIsRequested;
-    OFCondition m_lastOFCondition;
+
+    /// Files being sent and index of the next one that has to be sent by the first association that is free.
+    QList<Image*> m_imagesToSend;
+    int m_nextImageToSendIndex;
+    /// Files whose association was lost while they were being sent, which have to be sent again before the rest.
+    QList<Image*> m_imagesToSendAgain;
+    /// Number of files that are being sent through the associations right now.
+    int m_numberOfImagesBeingSent;
+    /// Protects the files to send and wakes up the associations waiting for files that could have to be sent again.
+    QMutex m_imagesToSendMutex;
+    QWaitCondition m_imagesToSendCondition;
+    /// Transfer syntaxes to propose by SOP class. If it's empty the default ones are proposed.
+    QHash<QString, QSet<QString> > m_transferSyntaxesBySOPClass;
+    /// Number of associations that could be opened and of associations that have been lost while sending.
+    QAtomicInt m_numberOfOpenedAssociations;
+    QAtomicInt m_numberOfLostAssociations;
+    /// Serializes the processing of the responses of the associations and the DICOMFileSent() signals.
+    QMutex m_responsesMutex;
 
 };
 
@@ -53,7 +53,7 @@ void SendDICOMFilesToPACSJob::run(ThreadWeaver::JobPointer self, ThreadWeaver::T
     Q_UNUSED(self)
     Q_UNUSED(thread)
 
-    m_lastDICOMFileSeriesInstanceUID = "";
+    m_seriesInstanceUIDsWithDICOMFilesSent.clear();
     m_numberOfSeriesSent = 0;
 
     if (m_imagesToSend.count() > 0)
@@ -175,13 +175,15 @@ void SendDICOMFilesToPACSJob::DICOMFileSent(Image *imageSent, int numberOfDICOMF
     /// of those that have actually been sent
     emit DICOMFileSent(m_selfPointer.toStrongRef(), numberOfDICOMFilesSent);
 
-    if (imageSent->getParentSeries()->getInstanceUID() != m_lastDICOMFileSeriesInstanceUID && !m_lastDICOMFileSeriesInstanceUID.isEmpty())
+    QString seriesInstanceUID = imageSent->getParentSeries()->getInstanceUID();
+
+    if (!m_seriesInstanceUIDsWithDICOMFilesSent.contains(seriesInstanceUID) && !m_seriesInstanceUIDsWithDICOMFilesSent.isEmpty())
     {
         m_numberOfSeriesSent++;
         emit DICOMSeriesSent(m_selfPointer.toStrongRef(), m_numberOfSeriesSent);
     }
 
-    m_lastDICOMFileSeriesInstanceUID = imageSent->getParentSeries()->getInstanceUID();
+    m_seriesInstanceUIDsWithDICOMFilesSent.insert(seriesInstanceUID);
 }
 
 };
@@ -16,6 +16,7 @@
 #define UDGSENDDICOMFILESTOPACSJOB_H
 
 #include <QObject>
+#include <QSet>
 
 #include "pacsjob.h"
 #include "pacsdevice.h"
@@ -77,7 +78,9 @@ private:
     PACSRequestStatus::SendRequestStatus m_sendRequestStatus;
     SendDICOMFilesToPACS *m_sendDICOMFilesToPACS;
     int m_numberOfSeriesSent;
-    QString m_lastDICOMFileSeriesInstanceUID;
+    /// Series of which some file has been sent. The files are sent through several associations, so the last files of a series can be sent after
+    /// the first ones of the next series.
+    QSet<QString> m_seriesInstanceUIDsWithDICOMFilesSent;
 };
 
 };
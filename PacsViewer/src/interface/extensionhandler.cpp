@@ -38,6 +38,7 @@
 // PACS --------------------------------------------
 #include "queryscreen.h"
 #include "patientfiller.h"
+#include "dicomtagreader.h"
 
 /// httpserver
 #include "httpclient.h"
@@ -82,6 +83,7 @@ ExtensionHandler::ExtensionHandler(QApplicationMainWindow *mainApp, QObject *par
 
     ///-----------20201207---------
     m_httpclient = NULL;
+    m_httpPatientFiller = NULL;
 #ifndef Q_OS_MAC
     m_localserver =  new QLocalServer(this);
     connect(m_localserver, SIGNAL(newConnection()), this, SLOT(newClientConnection()));
@@ -382,6 +384,11 @@ void ExtensionHandler::processInput(const QStringList &inputFiles)
 
     progressDialog.close();
 
+    processFilledPatients(patientsList);
+}
+
+void ExtensionHandler::processFilledPatients(const QList<Patient*> &patientsList)
+{
     int numberOfPatients = patientsList.size();
 
     if (numberOfPatients == 0)
@@ -595,7 +602,7 @@ void ExtensionHandler::generatePatientVolumes(Patient *patient, const QString &d
                 volume->setImages(imageList);
                 volume->setNumberOfPhases(numberOfPhases);
                 volume->setNumberOfSlicesPerPhase(numberOfSlicesPerPhase);
-                volume->setThumbnail(imageList.at(imageList.count() / 2)->getThumbnail(true));
+                volume->setThumbnail(imageList.at(imageList.count() / 2)->getThumbnail());
                 series->addVolume(volume);
             }
         }
@@ -719,12 +726,33 @@ void  ExtensionHandler::newClientConnection()
 
 }
 
+void ExtensionHandler::httpServerDownDcm(const QString &fileName)
+{
+    if (!m_httpPatientFiller)
+    {
+        m_httpPatientFiller = new PatientFiller(DICOMSource(), this);
+        // The download can contain studies of several patients, so all the generated patients are loaded
+        connect(m_httpPatientFiller, SIGNAL(patientsProcessed(QList<Patient*>)), SLOT(processFilledPatients(QList<Patient*>)));
+    }
+
+    // The DICOMTagReader is deleted by the patient filler
+    m_httpPatientFiller->processDICOMFile(new DICOMTagReader(fileName));
+}
+
 void ExtensionHandler::httpServerDownAllDcm()
 {
-    if (m_httpclient)
+    if (m_httpPatientFiller)
+    {
+        // The files have already been processed as they were downloaded, only the second stage of the patient filler is left
+        PatientFiller *patientFiller = m_httpPatientFiller;
+        m_httpPatientFiller = NULL;
+        patientFiller->finishDICOMFilesProcess();
+        patientFiller->deleteLater();
+    }
+    else
     {
-        QStringList list = *m_httpclient->getListStudyUID();
-        httpServerInput(list);
+        // None of the files could be downloaded
+        processFilledPatients(QList<Patient*>());
     }
 }
 
@@ -768,6 +796,7 @@ void ExtensionHandler::fromClientNotify()
         {
             m_httpclient = new HttpClient(NULL,DownDir/*"F:/log/down"*/);
             connect(m_httpclient, SIGNAL(allFilesFinished()), this,  SLOT(httpServerDownAllDcm()));
+            connect(m_httpclient, SIGNAL(fileDownloaded(QString)), this, SLOT(httpServerDownDcm(QString)));
         }
         m_httpclient->setHttpServerHost(HttpServerHost/*"http://127.0.0.1:8080"*/);
         m_httpclient->getStudyImageFile(QUrl(HttpServerHost/*m_httpclient->getHttpServerHost()*/), Studyuid/*msg*/, "", "");
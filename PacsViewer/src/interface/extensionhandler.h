@@ -37,6 +37,7 @@ namespace udg
 {
 // Fordward Declarations
 class QApplicationMainWindow;
+class PatientFiller;
 
 /**
    Manager of mini-applications and services of the main application
@@ -87,12 +88,17 @@ private slots:
     /// @param inputFiles Files to process, which may or may not be supported by the application
     void httpServerInput(const QStringList &inputFiles);
     void httpServerDownAllDcm();
+    /// Processes with the patient filler of the download the given file, as soon as it has been downloaded from the httpServer
+    void httpServerDownDcm(const QString &fileName);
 
     /// Processes a set of input files and processes them to decide what to do with them, such as
     /// create new patient, open windows, add data to current patient, etc
     /// @param inputFiles Files to process, which may or may not be supported by the application
     void processInput(const QStringList &inputFiles);
 
+    /// Checks the patients generated by the patient filler from a set of input files and loads the ones that are correct
+    void processFilledPatients(const QList<Patient*> &patientsList);
+
     /// Given a list of inpatients, he is in charge of setting up
     /// these and assign them the appropriate window, deciding whether to open new windows
     /// and / or merge or mash the current patient in this window.
@@ -133,6 +139,8 @@ private:
     QLocalServer *m_localserver;
     QLocalSocket *m_clientSocket;
     HttpClient *m_httpclient;
+    /// Patient filler that processes the files of the current httpServer download as they are downloaded
+    PatientFiller *m_httpPatientFiller;
     //-----------------------------------------------
 
 private:
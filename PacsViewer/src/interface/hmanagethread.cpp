@@ -1,26 +1,24 @@
 #include "hmanagethread.h"
 
+#include "interfacesettings.h"
+#include "settings.h"
+
 ///------------------------------------------------
 HManageThread::HManageThread()
 {
-    for (int i=0; i<Max_thread_size; i++)
-    {
-        worker[i] = new HThreadObject;
-        worker[i]->moveToThread(&workerThread[i]);
-        connect(&workerThread[i], &QThread::finished, worker[i], &QObject::deleteLater);
-        connect(this, &HManageThread::operate, worker[i], &HThreadObject::work);
-        connect(worker[i], &HThreadObject::notifyResult, this, &HManageThread::handleResults);
-        workerThread[i].start();
-    }
+    worker = new HThreadObject;
+    worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &HManageThread::operate, worker, &HThreadObject::work);
+    connect(worker, &HThreadObject::notifyResult, this, &HManageThread::handleResults);
+    connect(worker, &HThreadObject::fileDownloaded, this, &HManageThread::fileDownloaded);
+    workerThread.start();
 }
 
 HManageThread::~HManageThread()
 {
-    for (int i=0; i<Max_thread_size; i++)
-    {
-        workerThread[i].quit();
-        workerThread[i].wait();
-    }
+    workerThread.quit();
+    workerThread.wait();
 }
 
 void HManageThread::start(QList<HttpInfo> httpInfo)
@@ -28,30 +26,14 @@ void HManageThread::start(QList<HttpInfo> httpInfo)
     int size = httpInfo.size();
     m_total = size;
     m_remainder = size;
-    m_fileinfo = "Total "+ QString("%1").arg(m_total) + " files save ok!";
-    int averg = size/Max_thread_size;
-    int mod = size%Max_thread_size;
-    int index = 0;
-    for (int i=0; i<Max_thread_size; i++)
+    if (size == 0)
     {
-        number[i] = averg;
-        if(mod>0)
-        {
-            number[i]++;
-            mod --;
-        }
-        QList<HttpInfo> temp;
-        int max = averg*(i+1);
-        if (max > size)
-        {
-            max = size;
-        }
-        for (; number[i]>0&&index<size; number[i]--)
-        {
-            temp.push_back(httpInfo[index++]);
-        }
-        worker[i]->setInput(temp);
+        emit allFinished();
+        return;
     }
+    m_fileinfo = "Total "+ QString("%1").arg(m_total) + " files save ok!";
+    worker->setMaximumConcurrentRequests(udg::Settings().getValue(udg::InterfaceSettings::MaximumConcurrentWADODownloads).toInt());
+    worker->setInput(httpInfo);
     QUrl url = httpInfo[0].url;
     QString host = url.host();
     QString  port = ":"+QString("%1").arg(url.port());
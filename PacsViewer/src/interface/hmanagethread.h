@@ -8,13 +8,13 @@
 
 ///--------------------------------------------------------------------------------------------
 
-#define  Max_thread_size 3
+/// Downloads the files in a worker thread that keeps several requests in flight, as many as set in
+/// InterfaceSettings::MaximumConcurrentWADODownloads, instead of splitting them between several threads that download one file at a time.
 class HManageThread : public QObject
 {
     Q_OBJECT
-    QThread workerThread[Max_thread_size];
-    HThreadObject *worker[Max_thread_size];
-    int number[Max_thread_size];
+    QThread workerThread;
+    HThreadObject *worker;
 
 public:
     HManageThread();
@@ -31,6 +31,8 @@ signals:
     void ProgressInfo(QString text);
     void readfiles(qint64 bytesRead);
     void allFinished();
+    /// Emitted as soon as each file has been completely downloaded, so it can be processed while the rest are being downloaded.
+    void fileDownloaded(const QString &fileName);
 
 private:
     int m_total,m_remainder;
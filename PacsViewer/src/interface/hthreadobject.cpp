@@ -6,29 +6,56 @@
 #include <QNetworkAccessManager>
 #include <QWidget>
 
+namespace {
+
+// The files are written with this suffix until they have been completely downloaded
+const QString PartialFileSuffix(".part");
+// Maximum amount of data received that each reply keeps in memory before it's written to its file
+const qint64 ReadBufferSize = 1024 * 1024;
+// Size of the chunks copied from the replies to the files
+const int WriteChunkSize = 64 * 1024;
+
+}
+
 ///--------------------------------------------------------------
 HThreadObject::HThreadObject(QObject *parent) : QObject(parent)
 {
-    m_file = NULL;
     m_networkmanager = NULL;
+    m_taskIndex = 0;
+    m_maximumConcurrentRequests = 1;
 }
 
 
 HThreadObject::~HThreadObject()
 {
-
+    foreach (const Download &download, m_downloads)
+    {
+        download.file->remove();
+        delete download.file;
+    }
 }
 
 void HThreadObject::ReadyRead()
 {
-    if (m_file && m_networkreply)
+    QNetworkReply *networkreply = qobject_cast<QNetworkReply*>(sender());
+    if (networkreply && m_downloads.contains(networkreply))
+    {
+        writeAvailableData(networkreply, m_downloads.value(networkreply).file);
+    }
+}
+
+void HThreadObject::writeAvailableData(QNetworkReply *networkReply, QFile *file)
+{
+    char buffer[WriteChunkSize];
+    qint64 bytesRead;
+    while ((bytesRead = networkReply->read(buffer, WriteChunkSize)) > 0)
     {
-        m_file->write(m_networkreply->readAll());
+        file->write(buffer, bytesRead);
     }
 }
 
 #ifndef QT_NO_SSL
-void HThreadObject::sslErrors(QNetworkReply *, const QList<QSslError> &errors)
+void HThreadObject::sslErrors(QNetworkReply *networkreply, const QList<QSslError> &errors)
 {
     QString errorString;
     for (const QSslError &error : errors)
@@ -41,70 +68,122 @@ void HThreadObject::sslErrors(QNetworkReply *, const QList<QSslError> &errors)
     }
     //qDebug() <<errorString;
     ERROR_LOG(errorString);
-    m_networkreply->ignoreSslErrors();
+    networkreply->ignoreSslErrors();
 }
 #endif
 
 void HThreadObject::Finished()
 {
-    if (m_file)
+    QNetworkReply *networkreply = qobject_cast<QNetworkReply*>(sender());
+    if (!networkreply || !m_downloads.contains(networkreply))
     {
-        if (m_file->isOpen())
+        return;
+    }
+
+    Download download = m_downloads.take(networkreply);
+    int result = Download_Fail;
+
+    if (networkreply->error() == QNetworkReply::NoError)
+    {
+        writeAvailableData(networkreply, download.file);
+        download.file->close();
+
+        if (download.file->error() == QFile::NoError)
         {
-            QFileInfo fileinfo;
-            fileinfo.setFile(m_file->fileName());
-            m_file->close();
-            delete  m_file;
-            m_file = NULL;
+            QFile::remove(download.fullpathfilename);
+            if (download.file->rename(download.fullpathfilename))
+            {
+                result = SaveFile_Ok;
+            }
         }
+
+        if (result != SaveFile_Ok)
+        {
+            ERROR_LOG("Can't save the downloaded file " + download.fullpathfilename + ": " + download.file->errorString());
+        }
+    }
+    else
+    {
+        ERROR_LOG("Can't download " + networkreply->url().toString() + ": " + networkreply->errorString());
+    }
+
+    if (result != SaveFile_Ok)
+    {
+        download.file->remove();
     }
-    emit notifyResult(SaveFile_Ok);
-    m_networkreply->deleteLater();
-    m_networkreply = NULL;
+    delete download.file;
+
+    networkreply->deleteLater();
+
+    if (result == SaveFile_Ok)
+    {
+        emit fileDownloaded(download.fullpathfilename);
+    }
+    emit notifyResult(result);
+
     startNetwork();
 }
 
 void HThreadObject::setInput(QList<HttpInfo> httpInfo)
 {
+    QMutexLocker locker(&m_mutex);
     m_httpInfo.clear();
     m_httpInfo.append(httpInfo);
 }
 
+void HThreadObject::setMaximumConcurrentRequests(int maximumConcurrentRequests)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maximumConcurrentRequests = qMax(1, maximumConcurrentRequests);
+}
+
 void HThreadObject::startNetwork()
 {
-    int size = m_httpInfo.size();
-    if (m_taskIndex >= size)
+    QMutexLocker locker(&m_mutex);
+
+    while (m_downloads.size() < m_maximumConcurrentRequests && m_taskIndex < m_httpInfo.size())
     {
-        return;
-    }
+        const HttpInfo &httpInfo = m_httpInfo.at(m_taskIndex);
+        m_taskIndex++;
 
-    QString filename = m_httpInfo[m_taskIndex].fullpathfilename;
-    m_file = new QFile(filename);
+        Download download;
+        download.fullpathfilename = httpInfo.fullpathfilename;
+        download.file = new QFile(httpInfo.fullpathfilename + PartialFileSuffix);
 
-    if (!m_file->open(QFile::WriteOnly | QIODevice::Truncate))
-    {
-        m_file->close();
-        delete m_file;
-        m_file = NULL;
-        notifyResult(OpenFile_Fail);
-        return ;
-    }
-    m_networkreply = m_networkmanager->get(QNetworkRequest(m_httpInfo[m_taskIndex].url));
-    connect(m_networkreply, &QIODevice::readyRead, this, &HThreadObject::ReadyRead);
-    connect(m_networkreply, &QNetworkReply::finished, this, &HThreadObject::Finished);
-#ifndef QT_NO_SSL
-    connect(m_networkmanager, &QNetworkAccessManager::sslErrors, this, &HThreadObject::sslErrors);
-#endif
+        if (!download.file->open(QFile::WriteOnly | QIODevice::Truncate))
+        {
+            ERROR_LOG("Can't open the file " + download.file->fileName() + ": " + download.file->errorString());
+            delete download.file;
+            emit notifyResult(OpenFile_Fail);
+            continue;
+        }
 
-    m_taskIndex++;
+        QNetworkRequest request(httpInfo.url);
+        // The server may answer several requests sent through the same persistent connection without waiting for each one to finish
+        request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+
+        QNetworkReply *networkreply = m_networkmanager->get(request);
+        // Bounds the memory used by each reply, the data is written to the file as it arrives
+        networkreply->setReadBufferSize(ReadBufferSize);
+        m_downloads.insert(networkreply, download);
+
+        connect(networkreply, &QIODevice::readyRead, this, &HThreadObject::ReadyRead);
+        connect(networkreply, &QNetworkReply::finished, this, &HThreadObject::Finished);
+    }
 }
 
 void HThreadObject::work()
 {
+    m_mutex.lock();
     m_taskIndex = 0;
+    m_mutex.unlock();
+
     if (!m_networkmanager)
     {
         m_networkmanager = new QNetworkAccessManager(this);
+#ifndef QT_NO_SSL
+        connect(m_networkmanager, &QNetworkAccessManager::sslErrors, this, &HThreadObject::sslErrors);
+#endif
     }
     if (m_networkmanager)
     {
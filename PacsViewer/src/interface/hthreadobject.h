@@ -9,6 +9,7 @@
 #include <QThread>
 #include <QUrl>
 #include <QList>
+#include <QHash>
 #include <QMessageBox>
 #include <QSslError>
 
@@ -19,6 +20,7 @@ class QNetworkAccessManager;
 #define  OpenFile_Fail -1
 #define  SaveFile_Ok 1
 #define  Finished_All 2
+#define  Download_Fail -2
 
 
 
@@ -30,6 +32,9 @@ struct HttpInfo
 };
 
 ///--------------------------
+/// Downloads the given files keeping several requests in flight at the same time. The requests share the persistent connections that
+/// QNetworkAccessManager keeps to each host, and are pipelined when the server allows it. The data received is written to the files as it
+/// arrives, and each file is renamed to its final name only when it has been completely downloaded.
 class HThreadObject : public QObject
 {
     Q_OBJECT
@@ -38,6 +43,9 @@ public:
     ~HThreadObject();
     void setInput(QList<HttpInfo> httpInfo);
 
+    /// Sets the maximum number of requests in flight at the same time.
+    void setMaximumConcurrentRequests(int maximumConcurrentRequests);
+
 public slots:
     void work();
     void ReadyRead();
@@ -48,17 +56,34 @@ public slots:
 #endif
 
 signals:
+    /// Emitted once for each file of the input with SaveFile_Ok, OpenFile_Fail or Download_Fail.
     void notifyResult(const int &state);
 
+    /// Emitted when the given file has been completely downloaded and saved.
+    void fileDownloaded(const QString &fileName);
+
 private:
+    /// Starts downloading the next files until the maximum number of requests in flight is reached.
     void startNetwork();
 
+    /// Writes to the given file the data of the reply received so far.
+    void writeAvailableData(QNetworkReply *networkReply, QFile *file);
+
 private:
-    QNetworkReply *m_networkreply;
+    /// File being written by a request in flight.
+    struct Download
+    {
+        QFile *file;
+        QString fullpathfilename;
+    };
+
     QNetworkAccessManager *m_networkmanager;
-    QFile *m_file;
+    QHash<QNetworkReply*, Download> m_downloads;
     int m_taskIndex;
+    int m_maximumConcurrentRequests;
     QList<HttpInfo> m_httpInfo;
+    /// Protects the input, which is set from the thread of the manager.
+    QMutex m_mutex;
 };
 
 
@@ -163,6 +163,7 @@ void HttpClient::ParseDwonData()
             {
                 m_managethread = new HManageThread();
                 connect(m_managethread, SIGNAL(allFinished()), this,  SLOT(allFilesThreadFinished()));
+                connect(m_managethread, SIGNAL(fileDownloaded(QString)), this, SIGNAL(fileDownloaded(QString)));
                 //allFilesThreadFinished
             }
             m_managethread->start(httpinfo);
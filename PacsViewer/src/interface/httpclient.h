@@ -114,6 +114,8 @@ public:
 signals:
     void parseDataFinished();
     void allFilesFinished();
+    /// Emitted as soon as each DICOM file of the study has been downloaded, before allFilesFinished().
+    void fileDownloaded(const QString &fileName);
 
 public slots:
     void allFilesThreadFinished();
@@ -31,6 +31,9 @@ const QString ExtensionsBase("Extensions/");
 const QString InterfaceSettings::AllowMultipleInstancesPerExtension(ExtensionsBase + "allowMultipleExtensionInstances");
 const QString InterfaceSettings::DefaultExtension(ExtensionsBase + "defaultExtension");
 
+const QString WADOBase("WADO/");
+const QString InterfaceSettings::MaximumConcurrentWADODownloads(WADOBase + "maximumConcurrentDownloads");
+
 InterfaceSettings::InterfaceSettings()
 {
 }
@@ -47,6 +50,7 @@ void InterfaceSettings::init()
     settingsRegistry->addSetting(OpenFileLastFileExtension, "MetaIO Image (*.mhd)");
     settingsRegistry->addSetting(AllowMultipleInstancesPerExtension, false);
     settingsRegistry->addSetting(DefaultExtension, "Q2DViewerExtension");
+    settingsRegistry->addSetting(MaximumConcurrentWADODownloads, 12);
 }
 
 } // end namespace udg
@@ -35,6 +35,8 @@ public:
     static const QString AllowMultipleInstancesPerExtension;
     // Defines which extension will open by default
     static const QString DefaultExtension;
+    // Maximum number of files of a study downloaded at the same time from the WADO server
+    static const QString MaximumConcurrentWADODownloads;
 };
 
 } // end namespace udg
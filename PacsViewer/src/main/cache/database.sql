@@ -12,7 +12,7 @@ CREATE TABLE DatabaseRevision
 -- IMPORTANT !!! The revision number must be changed to a higher one each time a change is made to this file and if necessary
 -- that the database is updated
 
-INSERT INTO DatabaseRevision (Revision) VALUES ('9593');
+INSERT INTO DatabaseRevision (Revision) VALUES ('9596');
 
 CREATE TABLE PACSRetrievedImages
 (
@@ -33,6 +33,11 @@ CREATE TABLE Patient
   Sex                           TEXT
 );
 
+CREATE INDEX  IndexPatient_DICOMPatientId ON Patient (DICOMPatientId COLLATE NOCASE);
+
+-- Full-text index of the patient names normalized by LocalDatabasePatientDAL, with the ID of the patient as docid
+CREATE VIRTUAL TABLE PatientNameIndex USING fts4(Name, prefix="2,3");
+
 
 CREATE TABLE Study
 (
@@ -51,9 +56,14 @@ CREATE TABLE Study
   LastAccessDate                TEXT,
   RetrievedDate                 TEXT,
   RetrievedTime                 TEXT,
-  State                         INTEGER
+  State                         INTEGER,
+  -- Size in bytes of the files of the study, NULL if it hasn't been measured yet
+  Size                          INTEGER
 );
 
+CREATE INDEX  IndexStudy_PatientID ON Study (PatientID);
+CREATE INDEX  IndexStudy_Date ON Study (Date);
+
 CREATE TABLE Series
 (
   InstanceUID                   TEXT PRIMARY KEY,
@@ -136,6 +146,7 @@ CREATE TABLE DisplayShutter
 --TODO:Check if the IndexImage_StudyInstanceUIDSeriesInstanceUID index will be used after changes made to the database
 CREATE INDEX  IndexImage_StudyInstanceUIDSeriesInstanceUID ON Image (StudyInstanceUID,SeriesInstanceUID); 
 CREATE INDEX  IndexImage_SOPInstanceUIDOrderNumberInVolume ON Image (SOPInstanceUID, OrderNumberInVolume); 
+CREATE INDEX  IndexDisplayShutter_ImageInstanceUIDImageFrameNumber ON DisplayShutter (ImageInstanceUID, ImageFrameNumber);
 
 CREATE TABLE VoiLut
 (
@@ -145,6 +156,7 @@ CREATE TABLE VoiLut
     ImageFrameNumber    INTEGER,
     FOREIGN KEY (ImageInstanceUID, ImageFrameNumber) REFERENCES Image (SOPInstanceUID, FrameNumber)
 );
+CREATE INDEX  IndexVoiLut_ImageInstanceUIDImageFrameNumber ON VoiLut (ImageInstanceUID, ImageFrameNumber);
 
 CREATE TABLE EncapsulatedDocument
 (
@@ -38,6 +38,7 @@ INITIALIZE_EASYLOGGINGPP
 
 #include "coresettings.h"
 #include "inputoutputsettings.h"
+#include "relatedstudiesquerycache.h"
 #include "interfacesettings.h"
 #include "shortcuts.h"
 #include "starviewerapplicationcommandline.h"
@@ -329,6 +330,9 @@ int main(int argc, char *argv[])
         // Main instance, no more running
         try
         {
+            // It must be created in the main thread, before any retrieve can invalidate its results from another thread
+            udg::RelatedStudiesQueryCache::instance();
+
             udg::QApplicationMainWindow *mainWin = new udg::QApplicationMainWindow;
             //We connect to receive arguments from other instances
 			if (commandLineDicomDirflag)
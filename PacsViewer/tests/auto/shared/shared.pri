@@ -21,6 +21,9 @@ SOURCES += $$PWD/pacsdevicetesthelper.cpp \
            $$PWD/testingdicomtagreader.cpp \
            $$PWD/testingpacsconnection.cpp \
            $$PWD/testingsenddicomfilestopacs.cpp \
+           $$PWD/testingrelatedstudiesquerycache.cpp \
+           $$PWD/testingthumbnailcache.cpp \
+           $$PWD/testinglocalcachestorage.cpp \
            $$PWD/testingsettings.cpp \
            $$PWD/testingmammographyimagehelper.cpp \
            $$PWD/testingdecaycorrectionfactorformulacalculator.cpp \
@@ -49,6 +52,9 @@ HEADERS += $$PWD/autotest.h \
            $$PWD/testingdicomtagreader.h \
            $$PWD/testingpacsconnection.h \
            $$PWD/testingsenddicomfilestopacs.h \
+           $$PWD/testingrelatedstudiesquerycache.h \
+           $$PWD/testingthumbnailcache.h \
+           $$PWD/testinglocalcachestorage.h \
            $$PWD/testingsettings.h \
            $$PWD/testingmammographyimagehelper.h \
            $$PWD/testingdecaycorrectionfactorformulacalculator.h \
@@ -0,0 +1,90 @@
+#include "testinglocalcachestorage.h"
+
+#include <QMutexLocker>
+
+namespace testing {
+
+TestingLocalCacheStorage::TestingLocalCacheStorage() :
+    m_diskFreeSpace(0), m_numberOfDiskFreeSpaceMeasurements(0), m_studyDirectoryRemovalIsBlocked(false)
+{
+}
+
+TestingLocalCacheStorage::~TestingLocalCacheStorage()
+{
+    // The background tasks use the overridden methods, so they must finish before this part of the object is destroyed
+    unblockStudyDirectoryRemoval();
+    waitForDone();
+}
+
+QHash<QString, qint64> TestingLocalCacheStorage::getSavedStudySizes()
+{
+    QMutexLocker locker(&m_testingMutex);
+    return m_savedStudySizes;
+}
+
+QStringList TestingLocalCacheStorage::getMeasuredStudies()
+{
+    QMutexLocker locker(&m_testingMutex);
+    return m_measuredStudies;
+}
+
+QStringList TestingLocalCacheStorage::getRemovedStudies()
+{
+    QMutexLocker locker(&m_testingMutex);
+    return m_removedStudies;
+}
+
+void TestingLocalCacheStorage::blockStudyDirectoryRemoval()
+{
+    QMutexLocker locker(&m_testingMutex);
+    m_studyDirectoryRemovalIsBlocked = true;
+}
+
+void TestingLocalCacheStorage::unblockStudyDirectoryRemoval()
+{
+    QMutexLocker locker(&m_testingMutex);
+    m_studyDirectoryRemovalIsBlocked = false;
+    m_studyDirectoryRemovalUnblocked.wakeAll();
+}
+
+qint64 TestingLocalCacheStorage::measureStudyDirectorySize(const QString &studyInstanceUID)
+{
+    QMutexLocker locker(&m_testingMutex);
+    m_measuredStudies << studyInstanceUID;
+    return m_studyDirectorySizes.value(studyInstanceUID);
+}
+
+bool TestingLocalCacheStorage::removeStudyDirectory(const QString &studyInstanceUID)
+{
+    QMutexLocker locker(&m_testingMutex);
+
+    while (m_studyDirectoryRemovalIsBlocked)
+    {
+        m_studyDirectoryRemovalUnblocked.wait(&m_testingMutex);
+    }
+
+    m_removedStudies << studyInstanceUID;
+    m_diskFreeSpace += m_studyDirectorySizes.take(studyInstanceUID);
+    return true;
+}
+
+qint64 TestingLocalCacheStorage::measureDiskFreeSpace()
+{
+    QMutexLocker locker(&m_testingMutex);
+    m_numberOfDiskFreeSpaceMeasurements++;
+    return m_diskFreeSpace;
+}
+
+QHash<QString, qint64> TestingLocalCacheStorage::querySavedStudySizes()
+{
+    QMutexLocker locker(&m_testingMutex);
+    return m_savedStudySizes;
+}
+
+void TestingLocalCacheStorage::saveStudySize(const QString &studyInstanceUID, qint64 size)
+{
+    QMutexLocker locker(&m_testingMutex);
+    m_savedStudySizes.insert(studyInstanceUID, size);
+}
+
+}
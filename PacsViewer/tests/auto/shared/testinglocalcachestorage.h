@@ -0,0 +1,63 @@
+#ifndef TESTINGLOCALCACHESTORAGE_H
+#define TESTINGLOCALCACHESTORAGE_H
+
+#include "localcachestorage.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+using namespace udg;
+
+namespace testing {
+
+/**
+ * LocalCacheStorage that doesn't access the disk nor the database. The sizes of the study directories, the free space on disk and the saved sizes are
+ * set by the test, and the measurements and removals are recorded. The removal of study directories can be blocked to check the state while it's pending.
+ */
+class TestingLocalCacheStorage : public LocalCacheStorage {
+
+public:
+
+    TestingLocalCacheStorage();
+    virtual ~TestingLocalCacheStorage();
+
+    /// Returns a copy of the sizes saved in the database, which are written from the background threads.
+    QHash<QString, qint64> getSavedStudySizes();
+    /// Returns the studies whose directory has been measured, in order.
+    QStringList getMeasuredStudies();
+    /// Returns the studies whose directory has been removed.
+    QStringList getRemovedStudies();
+
+    /// Makes the removals of study directories wait until unblockStudyDirectoryRemoval() is called.
+    void blockStudyDirectoryRemoval();
+    void unblockStudyDirectoryRemoval();
+
+    /// Sizes of the study directories on disk.
+    QHash<QString, qint64> m_studyDirectorySizes;
+    /// Sizes of the studies in the database. Saved sizes are written here.
+    QHash<QString, qint64> m_savedStudySizes;
+    qint64 m_diskFreeSpace;
+    int m_numberOfDiskFreeSpaceMeasurements;
+
+private:
+
+    virtual qint64 measureStudyDirectorySize(const QString &studyInstanceUID);
+    virtual bool removeStudyDirectory(const QString &studyInstanceUID);
+    virtual qint64 measureDiskFreeSpace();
+    virtual QHash<QString, qint64> querySavedStudySizes();
+    virtual void saveStudySize(const QString &studyInstanceUID, qint64 size);
+
+private:
+
+    /// Protects the members used from the background threads.
+    QMutex m_testingMutex;
+    QStringList m_measuredStudies;
+    QStringList m_removedStudies;
+    bool m_studyDirectoryRemovalIsBlocked;
+    QWaitCondition m_studyDirectoryRemovalUnblocked;
+
+};
+
+}
+
+#endif // TESTINGLOCALCACHESTORAGE_H
@@ -0,0 +1,39 @@
+#include "testingrelatedstudiesquerycache.h"
+
+namespace testing {
+
+TestingRelatedStudiesQueryCache::TestingRelatedStudiesQueryCache() :
+    m_currentDateTime(QDate(2014, 5, 20), QTime(10, 0))
+{
+}
+
+void TestingRelatedStudiesQueryCache::finishQuery(int queryID, const QList<Patient*> &patients, PACSRequestStatus::QueryRequestStatus status)
+{
+    runningQueryFinished(queryID, patients, status);
+}
+
+int TestingRelatedStudiesQueryCache::startRunningQuery(const PacsDevice &pacsDevice, const DicomMask &mask)
+{
+    Q_UNUSED(pacsDevice)
+    Q_UNUSED(mask)
+
+    m_startedQueryIDs.append(m_startedQueryIDs.size() + 1);
+    return m_startedQueryIDs.last();
+}
+
+void TestingRelatedStudiesQueryCache::requestCancelRunningQuery(int queryID)
+{
+    m_cancelledQueryIDs.append(queryID);
+}
+
+SettingsInterface* TestingRelatedStudiesQueryCache::getSettings() const
+{
+    return new TestingSettings(m_testingSettings);
+}
+
+QDateTime TestingRelatedStudiesQueryCache::getCurrentDateTime() const
+{
+    return m_currentDateTime;
+}
+
+}
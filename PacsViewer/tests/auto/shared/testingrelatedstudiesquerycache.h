@@ -0,0 +1,42 @@
+#ifndef TESTINGRELATEDSTUDIESQUERYCACHE_H
+#define TESTINGRELATEDSTUDIESQUERYCACHE_H
+
+#include "relatedstudiesquerycache.h"
+
+#include "testingsettings.h"
+
+using namespace udg;
+
+namespace testing {
+
+/**
+ * RelatedStudiesQueryCache that doesn't query any PACS. The started queries are recorded and the test finishes them with finishQuery().
+ */
+class TestingRelatedStudiesQueryCache : public RelatedStudiesQueryCache {
+
+public:
+
+    TestingRelatedStudiesQueryCache();
+
+    /// Finishes the given started query with the given results, which become owned by the cache.
+    void finishQuery(int queryID, const QList<Patient*> &patients, PACSRequestStatus::QueryRequestStatus status = PACSRequestStatus::QueryOk);
+
+    TestingSettings m_testingSettings;
+    /// Date and time returned as the current one.
+    QDateTime m_currentDateTime;
+    /// Identifiers of the queries started and of the ones whose cancellation has been requested.
+    QList<int> m_startedQueryIDs;
+    QList<int> m_cancelledQueryIDs;
+
+private:
+
+    virtual int startRunningQuery(const PacsDevice &pacsDevice, const DicomMask &mask);
+    virtual void requestCancelRunningQuery(int queryID);
+    virtual SettingsInterface* getSettings() const;
+    virtual QDateTime getCurrentDateTime() const;
+
+};
+
+}
+
+#endif // TESTINGRELATEDSTUDIESQUERYCACHE_H
@@ -15,11 +15,24 @@ PACSConnection* TestingSendDICOMFilesToPACS::createPACSConnection(const PacsDevi
     return new TestingPACSConnection();
 }
 
-bool TestingSendDICOMFilesToPACS::storeSCU(T_ASC_Association *association, QString filePathToStore)
+SettingsInterface* TestingSendDICOMFilesToPACS::getSettings() const
+{
+    return new TestingSettings(m_testingSettings);
+}
+
+bool TestingSendDICOMFilesToPACS::storeSCU(T_ASC_Association *association, QString filePathToStore, bool &associationLost)
 {
     Q_UNUSED(association)
-    Q_UNUSED(filePathToStore)
-    m_numberOfDICOMFilesSentSuccessfully++;
+
+    QMutexLocker locker(&m_storeSCUMutex);
+    associationLost = !filePathToStore.isEmpty() && filePathToStore == m_pathOfFileThatLosesAssociation;
+    if (associationLost)
+    {
+        m_pathOfFileThatLosesAssociation.clear();
+        return false;
+    }
+
+    m_numberOfDICOMFilesSentSuccessfully.ref();
     return true;
 }
 
@@ -3,6 +3,10 @@
 
 #include "senddicomfilestopacs.h"
 
+#include "testingsettings.h"
+
+#include <QMutex>
+
 using namespace udg;
 
 namespace testing {
@@ -13,10 +17,17 @@ public:
 
     TestingSendDICOMFilesToPACS(const PacsDevice &pacsDevice);
 
+    TestingSettings m_testingSettings;
+    /// The association through which the file with this path is sent is lost the first time it's sent.
+    QString m_pathOfFileThatLosesAssociation;
+
 private:
 
     virtual PACSConnection* createPACSConnection(const PacsDevice &pacsDevice) const;
-    virtual bool storeSCU(T_ASC_Association *association, QString filePathToStore);
+    virtual SettingsInterface* getSettings() const;
+    virtual bool storeSCU(T_ASC_Association *association, QString filePathToStore, bool &associationLost);
+
+    QMutex m_storeSCUMutex;
 
 };
 
@@ -0,0 +1,35 @@
+#include "testingthumbnailcache.h"
+
+#include "coresettings.h"
+
+namespace testing {
+
+TestingThumbnailCache::TestingThumbnailCache(const QString &cachePath) :
+    m_maximumCacheSize(1024 * 1024), m_createdThumbnailsAreValid(true), m_numberOfCreatedThumbnails(0)
+{
+    m_testingSettings.setValue(CoreSettings::ThumbnailCachePath, cachePath);
+}
+
+QImage TestingThumbnailCache::createThumbnail(const Image *image, int resolution, bool &isValid)
+{
+    Q_UNUSED(image)
+
+    m_numberOfCreatedThumbnails++;
+    isValid = m_createdThumbnailsAreValid;
+
+    QImage thumbnail(resolution, resolution, QImage::Format_RGB32);
+    thumbnail.fill(Qt::gray);
+    return thumbnail;
+}
+
+qint64 TestingThumbnailCache::getMaximumCacheSize() const
+{
+    return m_maximumCacheSize;
+}
+
+SettingsInterface* TestingThumbnailCache::getSettings() const
+{
+    return new TestingSettings(m_testingSettings);
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef TESTINGTHUMBNAILCACHE_H
+#define TESTINGTHUMBNAILCACHE_H
+
+#include "thumbnailcache.h"
+
+#include "testingsettings.h"
+
+using namespace udg;
+
+namespace testing {
+
+/**
+ * ThumbnailCache that caches the thumbnails in the given directory and creates them without reading any file. The created thumbnails are counted.
+ */
+class TestingThumbnailCache : public ThumbnailCache {
+
+public:
+
+    TestingThumbnailCache(const QString &cachePath);
+
+    TestingSettings m_testingSettings;
+    /// Maximum size in bytes of the cache.
+    qint64 m_maximumCacheSize;
+    /// Whether the created thumbnails are valid ones or placeholders.
+    bool m_createdThumbnailsAreValid;
+    int m_numberOfCreatedThumbnails;
+
+private:
+
+    virtual QImage createThumbnail(const Image *image, int resolution, bool &isValid);
+    virtual qint64 getMaximumCacheSize() const;
+    virtual SettingsInterface* getSettings() const;
+
+};
+
+}
+
+#endif // TESTINGTHUMBNAILCACHE_H
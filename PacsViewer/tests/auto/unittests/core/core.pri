@@ -89,7 +89,15 @@ SOURCES += $$PWD/test_image.cpp \
            $$PWD/test_externalapplication.cpp \
            $$PWD/test_sliceorientedvolumepixeldata.cpp \
            $$PWD/test_applicationversionchecker.cpp \
-           $$PWD/test_systemrequirementstest.cpp
+           $$PWD/test_systemrequirementstest.cpp \
+           $$PWD/test_volumerepository.cpp \
+           $$PWD/test_volumeloadscheduler.cpp \
+           $$PWD/test_orderimagesfillerstep.cpp \
+           $$PWD/test_thickslabfilter.cpp \
+           $$PWD/test_renderscheduler.cpp \
+           $$PWD/test_slicegeometryindex.cpp \
+           $$PWD/test_thumbnailcache.cpp \
+           $$PWD/test_patientfiller.cpp
 
 win32 {
     SOURCES += $$PWD/test_windowsfirewallaccess.cpp \
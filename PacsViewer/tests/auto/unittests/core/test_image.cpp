@@ -6,6 +6,8 @@
 #include "series.h"
 #include "mathtools.h"
 
+#include <QSet>
+
 #include <vtkImageData.h>
 
 using namespace udg;
@@ -43,6 +45,19 @@ private slots:
 
     void distance_ReturnsExpectedValues_data();
     void distance_ReturnsExpectedValues();
+
+    void getPath_ShouldReturnTheAssignedPath_data();
+    void getPath_ShouldReturnTheAssignedPath();
+
+    void setters_ShouldShareRepeatedValuesBetweenImages();
+
+    void benchmarkStringMemory_50000ImagesStudy();
+
+private:
+    /// Creates an image of a large study with the values as they are read from each file, without sharing any string with the other images.
+    Image* createImageOfLargeStudy(int seriesNumber, int imageNumber);
+    /// Returns the bytes taken by the buffers of the given strings. If countSharedBuffersOnce is true, the strings that share a buffer are counted once.
+    qint64 getStringBytes(const QList<QString> &strings, bool countSharedBuffersOnce);
 };
 
 Q_DECLARE_METATYPE(QList<DisplayShutter>)
@@ -435,6 +450,118 @@ void test_Image::distance_ReturnsExpectedValues()
     QVERIFY(FuzzyCompareTestHelper::fuzzyCompare(Image::distance(image), expectedDistance, 0.0001));
 }
 
+void test_Image::getPath_ShouldReturnTheAssignedPath_data()
+{
+    QTest::addColumn<QString>("path");
+
+    QTest::newRow("empty") << "";
+    QTest::newRow("absolute") << "/home/user/dicom/1.2.3/1.2.3.4/1.2.3.4.5.dcm";
+    QTest::newRow("windows") << "C:/Users/user/dicom/1.2.3.4.5";
+    QTest::newRow("without directory") << "1.2.3.4.5.dcm";
+    QTest::newRow("directory") << "/home/user/dicom/";
+}
+
+void test_Image::getPath_ShouldReturnTheAssignedPath()
+{
+    QFETCH(QString, path);
+
+    Image image;
+    image.setPath(path);
+
+    QCOMPARE(image.getPath(), path);
+}
+
+void test_Image::setters_ShouldShareRepeatedValuesBetweenImages()
+{
+    QScopedPointer<Image> image(createImageOfLargeStudy(1, 1));
+    QScopedPointer<Image> otherImage(createImageOfLargeStudy(1, 2));
+
+    QCOMPARE(image->getTransferSyntaxUID(), otherImage->getTransferSyntaxUID());
+    QCOMPARE(image->getTransferSyntaxUID().constData(), otherImage->getTransferSyntaxUID().constData());
+    QCOMPARE(image->getImageType().constData(), otherImage->getImageType().constData());
+    QCOMPARE(image->getAcquisitionNumber().constData(), otherImage->getAcquisitionNumber().constData());
+    QCOMPARE(image->getPathDirectory().constData(), otherImage->getPathDirectory().constData());
+    QVERIFY(image->getPath() != otherImage->getPath());
+}
+
+void test_Image::benchmarkStringMemory_50000ImagesStudy()
+{
+    // Like a 4D CT of 20 phases of 2500 slices, each phase in a different series
+    const int numberOfSeries = 20;
+    const int numberOfImagesPerSeries = 2500;
+
+    QList<Image*> images;
+    for (int series = 0; series < numberOfSeries; series++)
+    {
+        for (int i = 0; i < numberOfImagesPerSeries; i++)
+        {
+            images << createImageOfLargeStudy(series, i);
+        }
+    }
+
+    // The getters return copies that share the buffers kept by the images
+    QList<QString> storedStrings;
+    QList<QString> readStrings;
+
+    foreach (Image *image, images)
+    {
+        storedStrings << image->getSOPInstanceUID() << image->getInstanceNumber() << image->getImageType() << image->getTransferSyntaxUID()
+                      << image->getAcquisitionNumber() << image->getDICOMKVP() << image->getXRayTubeCurrent()
+                      << image->getPathDirectory() << image->getPathFileName();
+
+        // Without sharing, each image would keep its own copy of each value, with the whole path
+        readStrings << image->getSOPInstanceUID() << image->getInstanceNumber() << image->getImageType() << image->getTransferSyntaxUID()
+                    << image->getAcquisitionNumber() << image->getDICOMKVP() << image->getXRayTubeCurrent() << image->getPath();
+    }
+
+    qint64 bytesPerImage = getStringBytes(storedStrings, true) / images.size();
+    qint64 bytesPerImageWithoutSharing = getStringBytes(readStrings, false) / images.size();
+
+    qDeleteAll(images);
+
+    QTest::setBenchmarkResult(bytesPerImage, QTest::BytesAllocated);
+    QVERIFY(bytesPerImage < bytesPerImageWithoutSharing / 2);
+}
+
+Image* test_Image::createImageOfLargeStudy(int seriesNumber, int imageNumber)
+{
+    // Each value is a different QString, like the ones read from the files or the database
+    QString studyInstanceUID = "1.2.826.0.1.3680043.8.1055.1.20141010101010000.123456789";
+    QString seriesInstanceUID = QString("%1.%2").arg(studyInstanceUID).arg(seriesNumber);
+
+    Image *image = new Image();
+    image->setSOPInstanceUID(QString("%1.%2").arg(seriesInstanceUID).arg(imageNumber));
+    image->setInstanceNumber(QString::number(imageNumber + 1));
+    image->setImageType(QString("ORIGINAL\\PRIMARY\\AXIAL"));
+    image->setTransferSyntaxUID(QString("1.2.840.10008.1.2.4.70"));
+    image->setAcquisitionNumber(QString::number(seriesNumber + 1));
+    image->setDICOMKVP(QString("120"));
+    image->setXRayTubeCurrent(QString("350"));
+    image->setPath(QString("/home/user/.local/share/Starviewer/dicom/%1/%2/%2.%3").arg(studyInstanceUID).arg(seriesInstanceUID).arg(imageNumber));
+
+    return image;
+}
+
+qint64 test_Image::getStringBytes(const QList<QString> &strings, bool countSharedBuffersOnce)
+{
+    QSet<const QChar*> countedBuffers;
+    qint64 bytes = 0;
+
+    foreach (const QString &string, strings)
+    {
+        if (string.isEmpty() || (countSharedBuffersOnce && countedBuffers.contains(string.constData())))
+        {
+            continue;
+        }
+
+        countedBuffers.insert(string.constData());
+        // Header of the shared data plus the characters and the null terminator
+        bytes += sizeof(QStringData) + (string.size() + 1) * sizeof(QChar);
+    }
+
+    return bytes;
+}
+
 DECLARE_TEST(test_Image)
 
 #include "test_image.moc"
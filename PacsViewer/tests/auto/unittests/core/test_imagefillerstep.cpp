@@ -35,6 +35,10 @@ private slots:
     void fillIndividually_ShouldFillEstimatedRadiographicMagnificationFactorForTheAppropiateModalities_data();
     void fillIndividually_ShouldFillEstimatedRadiographicMagnificationFactorForTheAppropiateModalities();
 
+    void fillIndividually_ShouldAddPreparedImagesInsteadOfCreatingThem();
+
+    void createImages_ShouldNotAddImagesToCurrentSeries();
+
 private:
 
     static TestingDICOMTagReader* createReader(int i, const QString &modality = "CT", const QString &SOPClassUID = UIDCTImageStorage);
@@ -856,6 +860,53 @@ void test_ImageFillerStep::fillIndividually_ShouldFillEstimatedRadiographicMagni
     QCOMPARE(image->getEstimatedRadiographicMagnificationFactor(), expectedValue);
 }
 
+void test_ImageFillerStep::fillIndividually_ShouldAddPreparedImagesInsteadOfCreatingThem()
+{
+    Series *series = new Series(this);
+    PatientFillerInput *input = new PatientFillerInput();
+    input->setCurrentSeries(series);
+    ImageFillerStep step;
+    step.setInput(input);
+    input->setDICOMFile(createReader(1));
+
+    QList<Image*> preparedImages = step.createImages(input->getDICOMFile());
+    QCOMPARE(preparedImages.size(), 1);
+    input->setPreparedImages(preparedImages);
+
+    QCOMPARE(step.fillIndividually(), true);
+    QCOMPARE(series->getNumberOfImages(), 1);
+    QCOMPARE(series->getImageByIndex(0), preparedImages.first());
+    QCOMPARE(input->getCurrentImages(), preparedImages);
+    QVERIFY(!input->hasPreparedImages());
+
+    delete input;
+}
+
+void test_ImageFillerStep::createImages_ShouldNotAddImagesToCurrentSeries()
+{
+    Series *series = new Series(this);
+    PatientFillerInput *input = new PatientFillerInput();
+    input->setCurrentSeries(series);
+    ImageFillerStep step;
+    step.setInput(input);
+
+    TestingDICOMTagReader *reader = createReader(1);
+    reader->addTag(DICOMNumberOfFrames, 3);
+    QList<Image*> images = step.createImages(reader);
+
+    QCOMPARE(images.size(), 3);
+    for (int i = 0; i < images.size(); i++)
+    {
+        QCOMPARE(images.at(i)->getFrameNumber(), i);
+        QCOMPARE(images.at(i)->getParentSeries(), static_cast<Series*>(NULL));
+    }
+    QCOMPARE(series->getNumberOfImages(), 0);
+
+    qDeleteAll(images);
+    delete reader;
+    delete input;
+}
+
 TestingDICOMTagReader* test_ImageFillerStep::createReader(int i, const QString &modality, const QString &SOPClassUID)
 {
     TestingDICOMTagReader *reader = new TestingDICOMTagReader();
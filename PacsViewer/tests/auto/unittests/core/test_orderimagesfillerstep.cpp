@@ -0,0 +1,205 @@
+#include "autotest.h"
+#include "orderimagesfillerstep.h"
+
+#include "image.h"
+#include "imageorientation.h"
+#include "patientfillerinput.h"
+#include "series.h"
+
+using namespace udg;
+
+class test_OrderImagesFillerStep : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void postProcessing_ShouldOrderImagesOfAStackByDistance();
+
+    void postProcessing_ShouldOrderStacksByDistanceAndKeepImagesOfEachStackTogether();
+
+    void postProcessing_ShouldOrderByInstanceNumberIfAcquisitionNumbersAreDifferent();
+
+    void postProcessing_ShouldOrderEachVolumeSeparately();
+
+    void benchmarkPostProcessing_50000ImagesSeries();
+
+private:
+    /// Creates an image with the given instance number, acquisition number and orientation (axial by default), placed at distance z along its normal.
+    Image* createImage(double z, int instanceNumber, const QString &acquisitionNumber = "1", const QVector3D &rowVector = QVector3D(1, 0, 0),
+                       const QVector3D &columnVector = QVector3D(0, 1, 0));
+    /// Processes the given images as if each one came from a different file of the given volume.
+    void fillIndividually(OrderImagesFillerStep &step, PatientFillerInput &input, Series *series, const QList<Image*> &images, int volumeNumber = 1);
+    /// Returns the instance numbers of the given images.
+    QStringList getInstanceNumbers(const QList<Image*> &images);
+
+private:
+    QList<Image*> m_images;
+};
+
+void test_OrderImagesFillerStep::cleanup()
+{
+    qDeleteAll(m_images);
+    m_images.clear();
+}
+
+void test_OrderImagesFillerStep::postProcessing_ShouldOrderImagesOfAStackByDistance()
+{
+    Series series;
+    QList<Image*> images;
+    images << createImage(20.0, 1) << createImage(0.0, 2) << createImage(10.0, 3) << createImage(5.0, 4);
+
+    OrderImagesFillerStep step;
+    PatientFillerInput input;
+    fillIndividually(step, input, &series, images);
+    step.postProcessing();
+
+    QCOMPARE(getInstanceNumbers(series.getImages()), QStringList() << "2" << "4" << "3" << "1");
+
+    for (int i = 0; i < series.getImages().size(); i++)
+    {
+        QCOMPARE(series.getImages().at(i)->getOrderNumberInVolume(), i);
+        QCOMPARE(series.getImages().at(i)->getVolumeNumberInSeries(), 1);
+    }
+}
+
+void test_OrderImagesFillerStep::postProcessing_ShouldOrderStacksByDistanceAndKeepImagesOfEachStackTogether()
+{
+    // An axial and a coronal stack, interleaved
+    QVector3D coronalRowVector(1, 0, 0);
+    QVector3D coronalColumnVector(0, 0, 1);
+
+    Series series;
+    QList<Image*> images;
+    images << createImage(30.0, 1, "1", coronalRowVector, coronalColumnVector) << createImage(10.0, 2)
+           << createImage(-10.0, 3, "1", coronalRowVector, coronalColumnVector) << createImage(0.0, 4) << createImage(20.0, 5);
+
+    OrderImagesFillerStep step;
+    PatientFillerInput input;
+    fillIndividually(step, input, &series, images);
+    step.postProcessing();
+
+    QCOMPARE(getInstanceNumbers(series.getImages()), QStringList() << "3" << "1" << "4" << "2" << "5");
+}
+
+void test_OrderImagesFillerStep::postProcessing_ShouldOrderByInstanceNumberIfAcquisitionNumbersAreDifferent()
+{
+    Series series;
+    QList<Image*> images;
+    images << createImage(0.0, 3, "1") << createImage(10.0, 1, "2") << createImage(5.0, 2, "3");
+
+    OrderImagesFillerStep step;
+    PatientFillerInput input;
+    fillIndividually(step, input, &series, images);
+    step.postProcessing();
+
+    QCOMPARE(getInstanceNumbers(series.getImages()), QStringList() << "1" << "2" << "3");
+}
+
+void test_OrderImagesFillerStep::postProcessing_ShouldOrderEachVolumeSeparately()
+{
+    Series series;
+    QList<Image*> firstVolumeImages;
+    firstVolumeImages << createImage(10.0, 1) << createImage(0.0, 2);
+    QList<Image*> secondVolumeImages;
+    secondVolumeImages << createImage(5.0, 3) << createImage(-5.0, 4);
+
+    OrderImagesFillerStep step;
+    PatientFillerInput input;
+    fillIndividually(step, input, &series, secondVolumeImages, 2);
+    fillIndividually(step, input, &series, firstVolumeImages, 1);
+    step.postProcessing();
+
+    QCOMPARE(getInstanceNumbers(series.getImages()), QStringList() << "2" << "1" << "4" << "3");
+    QCOMPARE(series.getImages().at(2)->getVolumeNumberInSeries(), 2);
+    QCOMPARE(series.getImages().at(2)->getOrderNumberInVolume(), 0);
+}
+
+void test_OrderImagesFillerStep::benchmarkPostProcessing_50000ImagesSeries()
+{
+    // Like a 4D cardiac CT: 20 phases of 2500 slices, received in a scrambled order
+    const int numberOfPhases = 20;
+    const int numberOfSlices = 2500;
+
+    QList<Image*> images;
+    for (int phase = 0; phase < numberOfPhases; phase++)
+    {
+        for (int slice = 0; slice < numberOfSlices; slice++)
+        {
+            images << createImage(slice * 0.5, phase * numberOfSlices + slice + 1);
+        }
+    }
+
+    for (int i = images.size() - 1; i > 0; i--)
+    {
+        images.swap(i, qrand() % (i + 1));
+    }
+
+    Series series;
+
+    QBENCHMARK
+    {
+        OrderImagesFillerStep step;
+        PatientFillerInput input;
+        fillIndividually(step, input, &series, images);
+        step.postProcessing();
+    }
+
+    QCOMPARE(series.getImages().size(), images.size());
+
+    for (int i = 1; i < series.getImages().size(); i++)
+    {
+        QVERIFY(Image::distance(series.getImages().at(i - 1)) <= Image::distance(series.getImages().at(i)));
+    }
+}
+
+Image* test_OrderImagesFillerStep::createImage(double z, int instanceNumber, const QString &acquisitionNumber, const QVector3D &rowVector,
+                                               const QVector3D &columnVector)
+{
+    Image *image = new Image();
+    image->setSOPInstanceUID(QString::number(instanceNumber));
+    image->setInstanceNumber(QString::number(instanceNumber));
+    image->setAcquisitionNumber(acquisitionNumber);
+
+    image->setImageOrientationPatient(ImageOrientation(rowVector, columnVector));
+
+    // Place the origin so that its distance along the normal is z
+    QVector3D position = image->getImageOrientationPatient().getNormalVector() * z;
+    double imagePositionPatient[3] = { position.x(), position.y(), position.z() };
+    image->setImagePositionPatient(imagePositionPatient);
+
+    m_images << image;
+
+    return image;
+}
+
+void test_OrderImagesFillerStep::fillIndividually(OrderImagesFillerStep &step, PatientFillerInput &input, Series *series, const QList<Image*> &images,
+                                                  int volumeNumber)
+{
+    step.setInput(&input);
+    input.setCurrentSeries(series);
+    input.setCurrentVolumeNumber(volumeNumber);
+
+    foreach (Image *image, images)
+    {
+        input.setCurrentImages(QList<Image*>() << image);
+        QVERIFY(step.fillIndividually());
+    }
+}
+
+QStringList test_OrderImagesFillerStep::getInstanceNumbers(const QList<Image*> &images)
+{
+    QStringList instanceNumbers;
+
+    foreach (Image *image, images)
+    {
+        instanceNumbers << image->getInstanceNumber();
+    }
+
+    return instanceNumbers;
+}
+
+DECLARE_TEST(test_OrderImagesFillerStep)
+
+#include "test_orderimagesfillerstep.moc"
@@ -0,0 +1,168 @@
+#include "autotest.h"
+#include "patientfiller.h"
+
+#include "dicomtagreader.h"
+#include "patient.h"
+#include "series.h"
+#include "study.h"
+
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <dcdeftag.h>
+#include <dcfilefo.h>
+#include <dcuid.h>
+
+using namespace udg;
+
+class test_PatientFiller : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void processFiles_FilesOfSeveralPatients_ShouldReturnAllThePatients();
+    void processFiles_FilesOfTheSamePatient_ShouldReturnOnePatientWithAllItsStudies();
+    void processFiles_ShouldEmitProgressForEachFile();
+
+    void finishDICOMFilesProcess_FilesOfSeveralPatientsProcessedOneByOne_ShouldEmitAllThePatients();
+
+private:
+    /// Writes in the given directory a DICOM file with one image of the given patient, study and series, and returns its path.
+    QString writeDICOMFile(const QTemporaryDir &directory, const QString &patientID, const QString &studyInstanceUID, const QString &seriesInstanceUID);
+
+private:
+    /// Number of files written, used to give each one a different SOP Instance UID.
+    int m_numberOfWrittenFiles;
+};
+
+void test_PatientFiller::init()
+{
+    m_numberOfWrittenFiles = 0;
+}
+
+void test_PatientFiller::processFiles_FilesOfSeveralPatients_ShouldReturnAllThePatients()
+{
+    QTemporaryDir directory;
+    QStringList files;
+    files << writeDICOMFile(directory, "P1", "1.1", "1.1.1") << writeDICOMFile(directory, "P2", "2.1", "2.1.1")
+          << writeDICOMFile(directory, "P1", "1.1", "1.1.1") << writeDICOMFile(directory, "P3", "3.1", "3.1.1");
+
+    PatientFiller patientFiller;
+    QList<Patient*> patients = patientFiller.processFiles(files);
+
+    QStringList patientIDs;
+
+    foreach (Patient *patient, patients)
+    {
+        patientIDs << patient->getID();
+    }
+
+    QCOMPARE(patientIDs, QStringList() << "P1" << "P2" << "P3");
+
+    qDeleteAll(patients);
+}
+
+void test_PatientFiller::processFiles_FilesOfTheSamePatient_ShouldReturnOnePatientWithAllItsStudies()
+{
+    QTemporaryDir directory;
+    QStringList files;
+    files << writeDICOMFile(directory, "P1", "1.1", "1.1.1") << writeDICOMFile(directory, "P1", "1.2", "1.2.1")
+          << writeDICOMFile(directory, "P1", "1.1", "1.1.2");
+
+    PatientFiller patientFiller;
+    QList<Patient*> patients = patientFiller.processFiles(files);
+
+    QCOMPARE(patients.size(), 1);
+    QCOMPARE(patients.first()->getNumberOfStudies(), 2);
+    QCOMPARE(patients.first()->getStudy("1.1")->getNumberOfSeries(), 2);
+    QCOMPARE(patients.first()->getStudy("1.2")->getNumberOfSeries(), 1);
+
+    qDeleteAll(patients);
+}
+
+void test_PatientFiller::processFiles_ShouldEmitProgressForEachFile()
+{
+    QTemporaryDir directory;
+    QStringList files;
+    files << writeDICOMFile(directory, "P1", "1.1", "1.1.1") << writeDICOMFile(directory, "P1", "1.1", "1.1.1")
+          << writeDICOMFile(directory, "P2", "2.1", "2.1.1");
+
+    PatientFiller patientFiller;
+    QSignalSpy progressSpy(&patientFiller, SIGNAL(progress(int)));
+    QList<Patient*> patients = patientFiller.processFiles(files);
+
+    QCOMPARE(progressSpy.count(), files.size());
+    QCOMPARE(progressSpy.last().first().toInt(), files.size());
+
+    qDeleteAll(patients);
+}
+
+void test_PatientFiller::finishDICOMFilesProcess_FilesOfSeveralPatientsProcessedOneByOne_ShouldEmitAllThePatients()
+{
+    QTemporaryDir directory;
+    QStringList files;
+    files << writeDICOMFile(directory, "P1", "1.1", "1.1.1") << writeDICOMFile(directory, "P2", "2.1", "2.1.1")
+          << writeDICOMFile(directory, "P1", "1.1", "1.1.1");
+
+    PatientFiller patientFiller;
+    QList<Patient*> patients;
+    connect(&patientFiller, &PatientFiller::patientsProcessed, [&patients](const QList<Patient*> &processedPatients) { patients = processedPatients; });
+
+    // Like the files downloaded from the HTTP server, which are processed as they arrive
+    foreach (const QString &file, files)
+    {
+        // The DICOMTagReader is deleted by the patient filler
+        patientFiller.processDICOMFile(new DICOMTagReader(file));
+    }
+
+    patientFiller.finishDICOMFilesProcess();
+
+    QCOMPARE(patients.size(), 2);
+    QCOMPARE(patients.at(0)->getID(), QString("P1"));
+    QCOMPARE(patients.at(1)->getID(), QString("P2"));
+    QCOMPARE(patients.at(0)->getStudy("1.1")->getSeries().first()->getImages().size(), 2);
+
+    qDeleteAll(patients);
+}
+
+QString test_PatientFiller::writeDICOMFile(const QTemporaryDir &directory, const QString &patientID, const QString &studyInstanceUID,
+                                           const QString &seriesInstanceUID)
+{
+    m_numberOfWrittenFiles++;
+    QString sopInstanceUID = QString("%1.%2").arg(seriesInstanceUID).arg(m_numberOfWrittenFiles);
+    QString filePath = directory.filePath(QString("%1.dcm").arg(m_numberOfWrittenFiles));
+
+    DcmFileFormat fileFormat;
+    DcmDataset *dataset = fileFormat.getDataset();
+    dataset->putAndInsertString(DCM_SOPClassUID, UID_SecondaryCaptureImageStorage);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, qPrintable(sopInstanceUID));
+    dataset->putAndInsertString(DCM_PatientID, qPrintable(patientID));
+    dataset->putAndInsertString(DCM_PatientName, qPrintable("PATIENT^" + patientID));
+    dataset->putAndInsertString(DCM_StudyInstanceUID, qPrintable(studyInstanceUID));
+    dataset->putAndInsertString(DCM_SeriesInstanceUID, qPrintable(seriesInstanceUID));
+    dataset->putAndInsertString(DCM_Modality, "OT");
+    dataset->putAndInsertString(DCM_InstanceNumber, qPrintable(QString::number(m_numberOfWrittenFiles)));
+    dataset->putAndInsertUint16(DCM_SamplesPerPixel, 1);
+    dataset->putAndInsertString(DCM_PhotometricInterpretation, "MONOCHROME2");
+    dataset->putAndInsertUint16(DCM_Rows, 2);
+    dataset->putAndInsertUint16(DCM_Columns, 2);
+    dataset->putAndInsertUint16(DCM_BitsAllocated, 8);
+    dataset->putAndInsertUint16(DCM_BitsStored, 8);
+    dataset->putAndInsertUint16(DCM_HighBit, 7);
+    dataset->putAndInsertUint16(DCM_PixelRepresentation, 0);
+    Uint8 pixels[4] = { 0, 64, 128, 255 };
+    dataset->putAndInsertUint8Array(DCM_PixelData, pixels, 4);
+
+    if (fileFormat.saveFile(qPrintable(filePath), EXS_LittleEndianExplicit).bad())
+    {
+        qWarning("Could not write the DICOM file %s", qPrintable(filePath));
+    }
+
+    return filePath;
+}
+
+DECLARE_TEST(test_PatientFiller)
+
+#include "test_patientfiller.moc"
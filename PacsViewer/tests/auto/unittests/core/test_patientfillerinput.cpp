@@ -4,6 +4,8 @@
 #include "image.h"
 #include "patient.h"
 
+#include <QPointer>
+
 using namespace udg;
 
 class test_PatientFillerInput : public QObject {
@@ -21,6 +23,10 @@ private slots:
 
     void setCurrentImages_ShouldProperlyUpdateMultiframeInfo();
 
+    void takePreparedImages_ShouldReturnPreparedImagesOnlyOnce();
+
+    void setDICOMFile_ShouldDeletePreparedImagesNotTaken();
+
 };
 
 void test_PatientFillerInput::addPatient_ShouldAddPatientIfNotNull()
@@ -98,6 +104,40 @@ void test_PatientFillerInput::setCurrentImages_ShouldProperlyUpdateMultiframeInf
     QVERIFY(input.currentSeriesContainsMultiframeImages());
 }
 
+void test_PatientFillerInput::takePreparedImages_ShouldReturnPreparedImagesOnlyOnce()
+{
+    Image *image = new Image();
+    PatientFillerInput input;
+
+    QVERIFY(!input.hasPreparedImages());
+
+    input.setPreparedImages(QList<Image*>() << image);
+
+    QVERIFY(input.hasPreparedImages());
+    QCOMPARE(input.takePreparedImages(), QList<Image*>() << image);
+    QVERIFY(!input.hasPreparedImages());
+    QVERIFY(input.takePreparedImages().isEmpty());
+
+    delete image;
+}
+
+void test_PatientFillerInput::setDICOMFile_ShouldDeletePreparedImagesNotTaken()
+{
+    QPointer<Image> image = new Image();
+    PatientFillerInput input;
+    input.setPreparedImages(QList<Image*>() << image);
+
+    input.setDICOMFile(nullptr);
+
+    QVERIFY(!input.hasPreparedImages());
+    QVERIFY(image.isNull());
+
+    // An empty list of prepared images is also a valid result, e.g. for files without pixel data
+    input.setPreparedImages(QList<Image*>());
+
+    QVERIFY(input.hasPreparedImages());
+}
+
 DECLARE_TEST(test_PatientFillerInput)
 
 #include "test_patientfillerinput.moc"
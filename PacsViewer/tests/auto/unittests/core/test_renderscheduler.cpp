@@ -0,0 +1,156 @@
+#include "autotest.h"
+#include "renderscheduler.h"
+
+#include <QThread>
+
+using namespace udg;
+
+namespace {
+
+// Records the renders instead of rendering, so the viewers are only used as identifiers and don't need to exist
+class TestingRenderScheduler : public RenderScheduler {
+public:
+    TestingRenderScheduler()
+     : m_renderDuration(0), m_viewerToRequestWhileRendering(0)
+    {
+        setFrameInterval(10);
+    }
+
+public:
+    QList<QViewer*> m_renderedViewers;
+    /// Time that each render takes in milliseconds.
+    int m_renderDuration;
+    /// Viewer whose render is requested while rendering.
+    QViewer *m_viewerToRequestWhileRendering;
+
+protected:
+    virtual void renderViewer(QViewer *viewer)
+    {
+        m_renderedViewers << viewer;
+        QThread::msleep(m_renderDuration);
+
+        if (m_viewerToRequestWhileRendering)
+        {
+            requestRender(m_viewerToRequestWhileRendering);
+            m_viewerToRequestWhileRendering = 0;
+        }
+    }
+};
+
+QViewer* getViewer(int number)
+{
+    return reinterpret_cast<QViewer*>(static_cast<quintptr>(number) * 16);
+}
+
+}
+
+class test_RenderScheduler : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void requestRender_SeveralTimes_ShouldRenderEachViewerOnceInTheNextFrame();
+
+    void requestRender_WhileRendering_ShouldRenderTheViewerInTheFollowingFrame();
+
+    void requestRender_ShouldRenderInAFrameStartedByTheEventLoop();
+
+    void cancelRender_ShouldNotRenderTheViewer();
+
+    void renderPendingViewers_LongerThanTheFrameInterval_ShouldCountDroppedFrames();
+};
+
+void test_RenderScheduler::requestRender_SeveralTimes_ShouldRenderEachViewerOnceInTheNextFrame()
+{
+    TestingRenderScheduler scheduler;
+
+    // Like a sync action applied to all the viewers of a layout, which makes each one request a render more than once
+    for (int i = 0; i < 3; i++)
+    {
+        for (int viewer = 1; viewer <= 16; viewer++)
+        {
+            scheduler.requestRender(getViewer(viewer));
+        }
+    }
+
+    QVERIFY(scheduler.isRenderPending(getViewer(1)));
+    QVERIFY(scheduler.m_renderedViewers.isEmpty());
+
+    scheduler.renderPendingViewers();
+
+    QCOMPARE(scheduler.m_renderedViewers.size(), 16);
+    QCOMPARE(scheduler.m_renderedViewers.first(), getViewer(1));
+    QCOMPARE(scheduler.m_renderedViewers.last(), getViewer(16));
+    QVERIFY(!scheduler.isRenderPending(getViewer(1)));
+    QCOMPARE(scheduler.getNumberOfFramesRendered(), 1);
+    QCOMPARE(scheduler.getNumberOfViewerRenders(), 16);
+    QCOMPARE(scheduler.getNumberOfCoalescedRenders(), 32);
+}
+
+void test_RenderScheduler::requestRender_WhileRendering_ShouldRenderTheViewerInTheFollowingFrame()
+{
+    TestingRenderScheduler scheduler;
+    scheduler.m_viewerToRequestWhileRendering = getViewer(1);
+
+    scheduler.requestRender(getViewer(1));
+    scheduler.renderPendingViewers();
+
+    QCOMPARE(scheduler.m_renderedViewers, QList<QViewer*>() << getViewer(1));
+    QVERIFY(scheduler.isRenderPending(getViewer(1)));
+
+    scheduler.renderPendingViewers();
+
+    QCOMPARE(scheduler.m_renderedViewers, QList<QViewer*>() << getViewer(1) << getViewer(1));
+    QCOMPARE(scheduler.getNumberOfFramesRendered(), 2);
+}
+
+void test_RenderScheduler::requestRender_ShouldRenderInAFrameStartedByTheEventLoop()
+{
+    TestingRenderScheduler scheduler;
+
+    scheduler.requestRender(getViewer(1));
+    scheduler.requestRender(getViewer(2));
+
+    QTRY_COMPARE(scheduler.getNumberOfFramesRendered(), 1);
+    QCOMPARE(scheduler.m_renderedViewers, QList<QViewer*>() << getViewer(1) << getViewer(2));
+
+    // The next frame waits for the frame interval
+    scheduler.requestRender(getViewer(1));
+
+    QTRY_COMPARE(scheduler.getNumberOfFramesRendered(), 2);
+    QCOMPARE(scheduler.m_renderedViewers.size(), 3);
+}
+
+void test_RenderScheduler::cancelRender_ShouldNotRenderTheViewer()
+{
+    TestingRenderScheduler scheduler;
+
+    scheduler.requestRender(getViewer(1));
+    scheduler.requestRender(getViewer(2));
+    scheduler.cancelRender(getViewer(1));
+    scheduler.renderPendingViewers();
+
+    QCOMPARE(scheduler.m_renderedViewers, QList<QViewer*>() << getViewer(2));
+}
+
+void test_RenderScheduler::renderPendingViewers_LongerThanTheFrameInterval_ShouldCountDroppedFrames()
+{
+    TestingRenderScheduler scheduler;
+    scheduler.m_renderDuration = 15;
+
+    scheduler.requestRender(getViewer(1));
+    scheduler.requestRender(getViewer(2));
+    scheduler.renderPendingViewers();
+
+    // 2 renders of 15 ms with a frame interval of 10 ms
+    QVERIFY(scheduler.getNumberOfDroppedFrames() >= 3);
+
+    scheduler.resetStatistics();
+
+    QCOMPARE(scheduler.getNumberOfFramesRendered(), 0);
+    QCOMPARE(scheduler.getNumberOfDroppedFrames(), 0);
+}
+
+DECLARE_TEST(test_RenderScheduler)
+
+#include "test_renderscheduler.moc"
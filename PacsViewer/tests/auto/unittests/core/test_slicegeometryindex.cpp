@@ -0,0 +1,178 @@
+#include "autotest.h"
+#include "slicegeometryindex.h"
+
+#include "image.h"
+#include "imageplane.h"
+#include "volume.h"
+#include "volumetesthelper.h"
+
+#include <QVector3D>
+
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+using namespace udg;
+using namespace testing;
+
+class test_SliceGeometryIndex : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void getNearestSlice_ParallelSlices_ShouldReturnTheNearestSliceAndItsDistance_data();
+    void getNearestSlice_ParallelSlices_ShouldReturnTheNearestSliceAndItsDistance();
+
+    void getNearestSlice_NonParallelSlices_ShouldReturnTheNearestSliceAndItsDistance();
+
+    void getImagePlane_ShouldReturnThePlaneOfTheSlice();
+
+    void getSliceGeometryIndex_AfterChangingThePixelData_ShouldReturnANewIndex();
+
+private:
+    /// Returns a new axial volume with a slice at each one of the given z positions.
+    Volume* createVolume(const QList<double> &slicePositions);
+};
+
+Q_DECLARE_METATYPE(QList<double>)
+
+void test_SliceGeometryIndex::getNearestSlice_ParallelSlices_ShouldReturnTheNearestSliceAndItsDistance_data()
+{
+    QTest::addColumn<QList<double> >("slicePositions");
+    QTest::addColumn<double>("pointZ");
+    QTest::addColumn<int>("expectedSlice");
+    QTest::addColumn<double>("expectedDistance");
+
+    QList<double> ascendingPositions;
+    ascendingPositions << 0.0 << 2.5 << 5.0 << 7.5 << 10.0;
+    QList<double> descendingPositions;
+    descendingPositions << 10.0 << 7.5 << 5.0 << 2.5 << 0.0;
+    QList<double> repeatedPositions;
+    repeatedPositions << 0.0 << 5.0 << 5.0 << 10.0;
+
+    QTest::newRow("on a slice") << ascendingPositions << 5.0 << 2 << 0.0;
+    QTest::newRow("between slices") << ascendingPositions << 6.5 << 3 << 1.0;
+    QTest::newRow("before the first slice") << ascendingPositions << -3.0 << 0 << 3.0;
+    QTest::newRow("after the last slice") << ascendingPositions << 12.0 << 4 << 2.0;
+    QTest::newRow("descending positions") << descendingPositions << 1.5 << 3 << 1.0;
+    QTest::newRow("halfway takes the lowest slice") << ascendingPositions << 6.25 << 2 << 1.25;
+    QTest::newRow("halfway takes the lowest slice with descending positions") << descendingPositions << 6.25 << 1 << 1.25;
+    QTest::newRow("repeated position takes the lowest slice") << repeatedPositions << 5.5 << 1 << 0.5;
+}
+
+void test_SliceGeometryIndex::getNearestSlice_ParallelSlices_ShouldReturnTheNearestSliceAndItsDistance()
+{
+    QFETCH(QList<double>, slicePositions);
+    QFETCH(double, pointZ);
+    QFETCH(int, expectedSlice);
+    QFETCH(double, expectedDistance);
+
+    Volume *volume = createVolume(slicePositions);
+    SliceGeometryIndex index;
+    index.build(volume, OrthogonalPlane::XYPlane);
+
+    double point[3] = { 3.0, -4.0, pointZ };
+    double distance = -1.0;
+
+    QVERIFY(index.areSlicesParallel());
+    QCOMPARE(index.getNearestSlice(point, distance), expectedSlice);
+    QCOMPARE(distance, expectedDistance);
+
+    VolumeTestHelper::cleanUp(volume);
+}
+
+void test_SliceGeometryIndex::getNearestSlice_NonParallelSlices_ShouldReturnTheNearestSliceAndItsDistance()
+{
+    QList<double> slicePositions;
+    slicePositions << 0.0 << 5.0 << 10.0;
+    Volume *volume = createVolume(slicePositions);
+    // Tilt the last slice 90 degrees around the x axis
+    volume->getImage(2)->setImageOrientationPatient(ImageOrientation(QVector3D(1.0, 0.0, 0.0), QVector3D(0.0, 0.0, 1.0)));
+
+    SliceGeometryIndex index;
+    index.build(volume, OrthogonalPlane::XYPlane);
+
+    // 4 from the first slice, 1 from the second one and 1 from the tilted one, whose plane is y = 0
+    double point[3] = { 0.0, 1.0, 4.0 };
+    double distance = -1.0;
+
+    QVERIFY(!index.areSlicesParallel());
+    QCOMPARE(index.getNearestSlice(point, distance), 1);
+    QCOMPARE(distance, 1.0);
+
+    VolumeTestHelper::cleanUp(volume);
+}
+
+void test_SliceGeometryIndex::getImagePlane_ShouldReturnThePlaneOfTheSlice()
+{
+    QList<double> slicePositions;
+    slicePositions << 0.0 << 5.0 << 10.0;
+    Volume *volume = createVolume(slicePositions);
+
+    SliceGeometryIndex index;
+    index.build(volume, OrthogonalPlane::XYPlane);
+
+    QCOMPARE(index.getNumberOfSlices(), 3);
+
+    for (int slice = 0; slice < 3; slice++)
+    {
+        ImagePlane *expectedPlane = volume->getImagePlane(slice, OrthogonalPlane::XYPlane);
+        QVERIFY(index.getImagePlane(slice));
+        QVERIFY(*index.getImagePlane(slice) == *expectedPlane);
+        delete expectedPlane;
+    }
+
+    QVERIFY(!index.getImagePlane(-1));
+    QVERIFY(!index.getImagePlane(3));
+
+    VolumeTestHelper::cleanUp(volume);
+}
+
+void test_SliceGeometryIndex::getSliceGeometryIndex_AfterChangingThePixelData_ShouldReturnANewIndex()
+{
+    QList<double> slicePositions;
+    slicePositions << 0.0 << 5.0 << 10.0;
+    Volume *volume = createVolume(slicePositions);
+
+    const SliceGeometryIndex *index = volume->getSliceGeometryIndex(OrthogonalPlane::XYPlane);
+    double point[3] = { 0.0, 0.0, 9.0 };
+    double distance;
+
+    QCOMPARE(volume->getSliceGeometryIndex(OrthogonalPlane::XYPlane), index);
+    QCOMPARE(index->getNearestSlice(point, distance), 2);
+
+    // Reverse the order of the slices
+    for (int slice = 0; slice < slicePositions.size(); slice++)
+    {
+        double position[3] = { 0.0, 0.0, slicePositions.at(slicePositions.size() - 1 - slice) };
+        volume->getImage(slice)->setImagePositionPatient(position);
+    }
+
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetExtent(volume->getExtent());
+    volume->setData(imageData);
+
+    QCOMPARE(volume->getSliceGeometryIndex(OrthogonalPlane::XYPlane)->getNearestSlice(point, distance), 0);
+
+    VolumeTestHelper::cleanUp(volume);
+}
+
+Volume* test_SliceGeometryIndex::createVolume(const QList<double> &slicePositions)
+{
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    int extent[6] = { 0, 9, 0, 9, 0, slicePositions.size() - 1 };
+    Volume *volume = VolumeTestHelper::createVolumeWithParameters(slicePositions.size(), 1, slicePositions.size(), origin, spacing, extent);
+
+    for (int slice = 0; slice < slicePositions.size(); slice++)
+    {
+        double position[3] = { 0.0, 0.0, slicePositions.at(slice) };
+        volume->getImage(slice)->setImageOrientationPatient(ImageOrientation(QVector3D(1.0, 0.0, 0.0), QVector3D(0.0, 1.0, 0.0)));
+        volume->getImage(slice)->setImagePositionPatient(position);
+    }
+
+    return volume;
+}
+
+DECLARE_TEST(test_SliceGeometryIndex)
+
+#include "test_slicegeometryindex.moc"
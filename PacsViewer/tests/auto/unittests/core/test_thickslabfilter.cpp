@@ -0,0 +1,219 @@
+#include "autotest.h"
+#include "thickslabfilter.h"
+
+#include "filteroutput.h"
+
+#include <vtkImageData.h>
+
+using namespace udg;
+
+typedef AccumulatorFactory::AccumulatorType AccumulatorType;
+
+Q_DECLARE_METATYPE(AccumulatorType)
+Q_DECLARE_METATYPE(OrthogonalPlane)
+
+class test_ThickSlabFilter : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void update_ShouldProjectLikeTheAccumulators_data();
+    void update_ShouldProjectLikeTheAccumulators();
+
+    void benchmarkUpdate_512x512x128VolumeWith64SlicesSlab_data();
+    void benchmarkUpdate_512x512x128VolumeWith64SlicesSlab();
+
+private:
+    /// Returns a new image of shorts with the given dimensions and pseudo-random values.
+    vtkImageData* createImage(int dimensionX, int dimensionY, int dimensionZ);
+    /// Returns the projection of the given image computed with the accumulators, value by value, the way the filter did it before.
+    /// The caller becomes the owner of the returned image.
+    vtkImageData* projectWithAccumulators(vtkImageData *image, const OrthogonalPlane &axis, int firstSlice, int slabThickness, int stride,
+                                          AccumulatorType accumulatorType);
+};
+
+void test_ThickSlabFilter::update_ShouldProjectLikeTheAccumulators_data()
+{
+    QTest::addColumn<OrthogonalPlane>("axis");
+    QTest::addColumn<int>("firstSlice");
+    QTest::addColumn<int>("slabThickness");
+    QTest::addColumn<int>("stride");
+    QTest::addColumn<AccumulatorType>("accumulatorType");
+    QTest::addColumn<int>("maximumDifference");
+
+    // The average sums all the values before dividing, so it can round differently than the average accumulator by one
+    QTest::newRow("axial maximum") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 2 << 5 << 1 << AccumulatorFactory::Maximum << 0;
+    QTest::newRow("axial minimum") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 0 << 9 << 1 << AccumulatorFactory::Minimum << 0;
+    QTest::newRow("axial average") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 1 << 4 << 1 << AccumulatorFactory::Average << 1;
+    QTest::newRow("axial maximum with stride") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 1 << 3 << 3 << AccumulatorFactory::Maximum << 0;
+    QTest::newRow("sagittal maximum") << OrthogonalPlane(OrthogonalPlane::YZPlane) << 3 << 6 << 1 << AccumulatorFactory::Maximum << 0;
+    QTest::newRow("sagittal minimum with stride") << OrthogonalPlane(OrthogonalPlane::YZPlane) << 0 << 4 << 2 << AccumulatorFactory::Minimum << 0;
+    QTest::newRow("sagittal average") << OrthogonalPlane(OrthogonalPlane::YZPlane) << 0 << 11 << 1 << AccumulatorFactory::Average << 1;
+    QTest::newRow("coronal maximum") << OrthogonalPlane(OrthogonalPlane::XZPlane) << 0 << 7 << 1 << AccumulatorFactory::Maximum << 0;
+    QTest::newRow("coronal minimum") << OrthogonalPlane(OrthogonalPlane::XZPlane) << 4 << 3 << 1 << AccumulatorFactory::Minimum << 0;
+    QTest::newRow("coronal average with stride") << OrthogonalPlane(OrthogonalPlane::XZPlane) << 1 << 3 << 2 << AccumulatorFactory::Average << 1;
+    QTest::newRow("one slice") << OrthogonalPlane(OrthogonalPlane::XYPlane) << 4 << 1 << 1 << AccumulatorFactory::Average << 0;
+}
+
+void test_ThickSlabFilter::update_ShouldProjectLikeTheAccumulators()
+{
+    QFETCH(OrthogonalPlane, axis);
+    QFETCH(int, firstSlice);
+    QFETCH(int, slabThickness);
+    QFETCH(int, stride);
+    QFETCH(AccumulatorType, accumulatorType);
+    QFETCH(int, maximumDifference);
+
+    vtkImageData *image = createImage(13, 12, 11);
+
+    ThickSlabFilter filter;
+    filter.setInput(image);
+    filter.setProjectionAxis(axis);
+    filter.setFirstSlice(firstSlice);
+    filter.setSlabThickness(slabThickness);
+    filter.setStride(stride);
+    filter.setAccumulatorType(accumulatorType);
+    filter.update();
+
+    vtkImageData *output = filter.getOutput().getVtkImageData();
+    vtkImageData *expectedOutput = projectWithAccumulators(image, axis, firstSlice, slabThickness, stride, accumulatorType);
+
+    int dimensions[3], expectedDimensions[3];
+    output->GetDimensions(dimensions);
+    expectedOutput->GetDimensions(expectedDimensions);
+
+    for (int i = 0; i < 3; i++)
+    {
+        QCOMPARE(dimensions[i], expectedDimensions[i]);
+    }
+
+    short *outputPointer = static_cast<short*>(output->GetScalarPointer());
+    short *expectedOutputPointer = static_cast<short*>(expectedOutput->GetScalarPointer());
+
+    for (vtkIdType i = 0; i < expectedOutput->GetNumberOfPoints(); i++)
+    {
+        QVERIFY2(qAbs(outputPointer[i] - expectedOutputPointer[i]) <= maximumDifference,
+                 qPrintable(QString("Value %1: %2, expected %3").arg(i).arg(outputPointer[i]).arg(expectedOutputPointer[i])));
+    }
+
+    expectedOutput->Delete();
+    image->Delete();
+}
+
+void test_ThickSlabFilter::benchmarkUpdate_512x512x128VolumeWith64SlicesSlab_data()
+{
+    QTest::addColumn<bool>("withAccumulators");
+
+    // Compares the filter with the projection value by value through the accumulators that it did before
+    QTest::newRow("filter") << false;
+    QTest::newRow("accumulators") << true;
+}
+
+void test_ThickSlabFilter::benchmarkUpdate_512x512x128VolumeWith64SlicesSlab()
+{
+    QFETCH(bool, withAccumulators);
+
+    vtkImageData *image = createImage(512, 512, 128);
+    OrthogonalPlane axis(OrthogonalPlane::XYPlane);
+
+    if (withAccumulators)
+    {
+        QBENCHMARK
+        {
+            projectWithAccumulators(image, axis, 32, 64, 1, AccumulatorFactory::Maximum)->Delete();
+        }
+    }
+    else
+    {
+        ThickSlabFilter filter;
+        filter.setInput(image);
+        filter.setProjectionAxis(axis);
+        filter.setFirstSlice(32);
+        filter.setSlabThickness(64);
+        filter.setStride(1);
+        filter.setAccumulatorType(AccumulatorFactory::Maximum);
+
+        QBENCHMARK
+        {
+            // Changing the thickness forces the filter to execute again
+            filter.setSlabThickness(63);
+            filter.setSlabThickness(64);
+            filter.update();
+        }
+    }
+
+    image->Delete();
+}
+
+vtkImageData* test_ThickSlabFilter::createImage(int dimensionX, int dimensionY, int dimensionZ)
+{
+    vtkImageData *image = vtkImageData::New();
+    image->SetDimensions(dimensionX, dimensionY, dimensionZ);
+    image->AllocateScalars(VTK_SHORT, 1);
+
+    short *pointer = static_cast<short*>(image->GetScalarPointer());
+    vtkIdType size = image->GetNumberOfPoints();
+    unsigned int value = 12345;
+
+    for (vtkIdType i = 0; i < size; i++)
+    {
+        // Linear congruential generator, to get the same values on every run
+        value = value * 1103515245 + 12345;
+        pointer[i] = static_cast<short>((value >> 16) % 4096) - 1024;
+    }
+
+    return image;
+}
+
+vtkImageData* test_ThickSlabFilter::projectWithAccumulators(vtkImageData *image, const OrthogonalPlane &axis, int firstSlice, int slabThickness,
+                                                            int stride, AccumulatorType accumulatorType)
+{
+    int projectionDimension = axis;
+    int dimensions[3];
+    image->GetDimensions(dimensions);
+
+    int outputDimensions[3] = { dimensions[0], dimensions[1], dimensions[2] };
+    outputDimensions[projectionDimension] = 1;
+
+    vtkImageData *output = vtkImageData::New();
+    output->SetDimensions(outputDimensions);
+    output->AllocateScalars(VTK_SHORT, 1);
+
+    vtkIdType increments[3];
+    image->GetIncrements(increments);
+    short *inputPointer = static_cast<short*>(image->GetScalarPointer());
+    short *outputPointer = static_cast<short*>(output->GetScalarPointer());
+
+    Accumulator<short> *accumulator = AccumulatorFactory::getAccumulator<short>(accumulatorType, slabThickness);
+
+    for (int z = 0; z < outputDimensions[2]; z++)
+    {
+        for (int y = 0; y < outputDimensions[1]; y++)
+        {
+            for (int x = 0; x < outputDimensions[0]; x++)
+            {
+                int index[3] = { x, y, z };
+                index[projectionDimension] = firstSlice;
+                short *slicePointer = inputPointer + index[0] * increments[0] + index[1] * increments[1] + index[2] * increments[2];
+
+                accumulator->initialize();
+
+                for (int slice = 0; slice < slabThickness; slice++)
+                {
+                    accumulator->accumulate(*slicePointer);
+                    slicePointer += stride * increments[projectionDimension];
+                }
+
+                *outputPointer++ = accumulator->getValue();
+            }
+        }
+    }
+
+    delete accumulator;
+
+    return output;
+}
+
+DECLARE_TEST(test_ThickSlabFilter)
+
+#include "test_thickslabfilter.moc"
@@ -0,0 +1,174 @@
+#include "autotest.h"
+#include "thumbnailcache.h"
+
+#include "image.h"
+#include "testingthumbnailcache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+using namespace udg;
+using namespace testing;
+
+class test_ThumbnailCache : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void getThumbnail_ThumbnailNotCached_ShouldCreateAndCacheIt();
+    void getThumbnail_ThumbnailCached_ShouldReadItWithoutCreatingIt();
+    void getThumbnail_InvalidThumbnail_ShouldNotCacheIt();
+    void getThumbnail_ImageWithoutSOPInstanceUID_ShouldNotCacheIt();
+
+    void removeThumbnails_ShouldRemoveAllResolutionsOfTheGivenImagesOnly();
+
+    void getThumbnail_CacheExceedsMaximumSize_ShouldRemoveLeastRecentlyUsedThumbnails();
+
+private:
+    /// Returns a new image with the given SOP Instance UID.
+    Image* createImage(const QString &sopInstanceUID);
+};
+
+void test_ThumbnailCache::getThumbnail_ThumbnailNotCached_ShouldCreateAndCacheIt()
+{
+    QTemporaryDir cacheDirectory;
+    TestingThumbnailCache cache(cacheDirectory.path());
+    Image *image = createImage("1.2.3");
+
+    QImage thumbnail = cache.getThumbnail(image, 16);
+
+    QCOMPARE(cache.m_numberOfCreatedThumbnails, 1);
+    QCOMPARE(thumbnail.size(), QSize(16, 16));
+    QVERIFY(QFile::exists(cache.getThumbnailFilePath("1.2.3", 16)));
+    QVERIFY(cache.getThumbnailFilePath("1.2.3", 16).startsWith(cacheDirectory.path()));
+
+    delete image;
+}
+
+void test_ThumbnailCache::getThumbnail_ThumbnailCached_ShouldReadItWithoutCreatingIt()
+{
+    QTemporaryDir cacheDirectory;
+    TestingThumbnailCache cache(cacheDirectory.path());
+    Image *image = createImage("1.2.3");
+
+    QImage createdThumbnail = cache.getThumbnail(image, 16);
+    QImage cachedThumbnail = cache.getThumbnail(image, 16);
+
+    QCOMPARE(cache.m_numberOfCreatedThumbnails, 1);
+    QCOMPARE(cachedThumbnail.size(), createdThumbnail.size());
+    QCOMPARE(cachedThumbnail.pixel(0, 0), createdThumbnail.pixel(0, 0));
+
+    // Another resolution is another thumbnail
+    cache.getThumbnail(image, 32);
+
+    QCOMPARE(cache.m_numberOfCreatedThumbnails, 2);
+
+    delete image;
+}
+
+void test_ThumbnailCache::getThumbnail_InvalidThumbnail_ShouldNotCacheIt()
+{
+    QTemporaryDir cacheDirectory;
+    TestingThumbnailCache cache(cacheDirectory.path());
+    cache.m_createdThumbnailsAreValid = false;
+    Image *image = createImage("1.2.3");
+
+    cache.getThumbnail(image, 16);
+    cache.getThumbnail(image, 16);
+
+    QCOMPARE(cache.m_numberOfCreatedThumbnails, 2);
+    QVERIFY(!QFile::exists(cache.getThumbnailFilePath("1.2.3", 16)));
+
+    delete image;
+}
+
+void test_ThumbnailCache::getThumbnail_ImageWithoutSOPInstanceUID_ShouldNotCacheIt()
+{
+    QTemporaryDir cacheDirectory;
+    TestingThumbnailCache cache(cacheDirectory.path());
+    Image *image = createImage(QString());
+
+    cache.getThumbnail(image, 16);
+    cache.getThumbnail(image, 16);
+
+    QCOMPARE(cache.m_numberOfCreatedThumbnails, 2);
+    QVERIFY(QDir(cacheDirectory.path()).entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty());
+
+    delete image;
+}
+
+void test_ThumbnailCache::removeThumbnails_ShouldRemoveAllResolutionsOfTheGivenImagesOnly()
+{
+    QTemporaryDir cacheDirectory;
+    TestingThumbnailCache cache(cacheDirectory.path());
+    Image *removedImage = createImage("1.2.3");
+    Image *keptImage = createImage("1.2.4");
+
+    cache.getThumbnail(removedImage, 16);
+    cache.getThumbnail(removedImage, 32);
+    cache.getThumbnail(keptImage, 16);
+
+    cache.removeThumbnails(QStringList() << "1.2.3");
+
+    QVERIFY(!QFile::exists(cache.getThumbnailFilePath("1.2.3", 16)));
+    QVERIFY(!QFile::exists(cache.getThumbnailFilePath("1.2.3", 32)));
+    QVERIFY(QFile::exists(cache.getThumbnailFilePath("1.2.4", 16)));
+
+    // Removed thumbnails are created again
+    cache.getThumbnail(removedImage, 16);
+    cache.getThumbnail(keptImage, 16);
+
+    QCOMPARE(cache.m_numberOfCreatedThumbnails, 4);
+
+    delete removedImage;
+    delete keptImage;
+}
+
+void test_ThumbnailCache::getThumbnail_CacheExceedsMaximumSize_ShouldRemoveLeastRecentlyUsedThumbnails()
+{
+    QTemporaryDir cacheDirectory;
+    TestingThumbnailCache cache(cacheDirectory.path());
+    Image *oldestImage = createImage("1.2.3");
+    Image *recentImage = createImage("1.2.4");
+    Image *newImage = createImage("1.2.5");
+
+    cache.getThumbnail(oldestImage, 16);
+    cache.getThumbnail(recentImage, 16);
+
+    // All the thumbnails are equal, so they have the same size
+    qint64 thumbnailSize = QFileInfo(cache.getThumbnailFilePath("1.2.3", 16)).size();
+    QVERIFY(thumbnailSize > 0);
+
+    QFile oldestThumbnailFile(cache.getThumbnailFilePath("1.2.3", 16));
+    QVERIFY(oldestThumbnailFile.open(QIODevice::Append));
+    QVERIFY(oldestThumbnailFile.setFileTime(QDateTime::currentDateTime().addDays(-10), QFileDevice::FileModificationTime));
+    oldestThumbnailFile.close();
+
+    // There's room for two and a half thumbnails
+    cache.m_maximumCacheSize = thumbnailSize * 5 / 2;
+    cache.getThumbnail(newImage, 16);
+
+    QVERIFY(!QFile::exists(cache.getThumbnailFilePath("1.2.3", 16)));
+    QVERIFY(QFile::exists(cache.getThumbnailFilePath("1.2.4", 16)));
+    QVERIFY(QFile::exists(cache.getThumbnailFilePath("1.2.5", 16)));
+
+    delete oldestImage;
+    delete recentImage;
+    delete newImage;
+}
+
+Image* test_ThumbnailCache::createImage(const QString &sopInstanceUID)
+{
+    Image *image = new Image();
+    image->setSOPInstanceUID(sopInstanceUID);
+    image->setPath("nonexistent.dcm");
+
+    return image;
+}
+
+DECLARE_TEST(test_ThumbnailCache)
+
+#include "test_thumbnailcache.moc"
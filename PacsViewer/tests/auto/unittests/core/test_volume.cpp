@@ -61,6 +61,9 @@ private slots:
     void getPhaseImages_ShouldReturnExpectedPhaseImages_data();
     void getPhaseImages_ShouldReturnExpectedPhaseImages();
 
+    void getPhaseVolume_ShouldReturnAVolumeWithThePixelDataOfThePhase_data();
+    void getPhaseVolume_ShouldReturnAVolumeWithThePixelDataOfThePhase();
+
     void getOrigin_ShouldReturnExpectedOrigin_data();
     void getOrigin_ShouldReturnExpectedOrigin();
 
@@ -759,6 +762,47 @@ void test_Volume::getPhaseImages_ShouldReturnExpectedPhaseImages()
     VolumeTestHelper::cleanUp(volume);
 }
 
+void test_Volume::getPhaseVolume_ShouldReturnAVolumeWithThePixelDataOfThePhase_data()
+{
+    QTest::addColumn<int>("numberOfSlices");
+    QTest::addColumn<bool>("expectedPixelDataLoaded");
+
+    QTest::newRow("slices arranged by phase") << 6 << true;
+    // The slices can't be arranged, so the images of the phase will be read again
+    QTest::newRow("slices not arranged by phase") << 5 << false;
+}
+
+void test_Volume::getPhaseVolume_ShouldReturnAVolumeWithThePixelDataOfThePhase()
+{
+    QFETCH(int, numberOfSlices);
+    QFETCH(bool, expectedPixelDataLoaded);
+
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    int extent[6] = { 0, 1, 0, 1, 0, numberOfSlices - 1 };
+    Volume *volume = VolumeTestHelper::createVolumeWithParameters(6, 2, 3, origin, spacing, extent, true);
+    // Set the phases again so that they are set to the pixel data too
+    volume->setNumberOfPhases(2);
+    volume->getPixelData()->arrangeSlicesByPhase();
+
+    Volume *phaseVolume = volume->getPhaseVolume(1);
+
+    QCOMPARE(phaseVolume->getImages(), volume->getPhaseImages(1));
+    QCOMPARE(phaseVolume->isPixelDataLoaded(), expectedPixelDataLoaded);
+
+    if (expectedPixelDataLoaded)
+    {
+        int phaseExtent[6];
+        phaseVolume->getExtent(phaseExtent);
+        QCOMPARE(phaseExtent[5] - phaseExtent[4] + 1, 3);
+        // Without copying the data
+        QCOMPARE(phaseVolume->getScalarPointer(0, 0, phaseExtent[4]), volume->getScalarPointer(0, 0, 3));
+    }
+
+    delete phaseVolume;
+    VolumeTestHelper::cleanUp(volume);
+}
+
 void test_Volume::getOrigin_ShouldReturnExpectedOrigin_data()
 {
      QTest::addColumn<Volume*>("volume");
@@ -0,0 +1,147 @@
+#include "autotest.h"
+#include "volumeloadscheduler.h"
+
+#include <ThreadWeaver/Job>
+
+using namespace udg;
+
+namespace {
+
+/// Job that does nothing, used to check the admission of jobs.
+class TestingJob : public ThreadWeaver::Job {
+protected:
+    virtual void run(ThreadWeaver::JobPointer, ThreadWeaver::Thread*)
+    {
+    }
+};
+
+VolumeLoadScheduler::LoadCost createLoadCost(qint64 memory, qint64 decoding, VolumeLoadScheduler::StorageType storageType)
+{
+    VolumeLoadScheduler::LoadCost cost;
+    cost.memory = memory;
+    cost.decoding = decoding;
+    cost.storageType = storageType;
+    return cost;
+}
+
+}
+
+class test_VolumeLoadScheduler : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void getDecodingCostFactor_ReturnsExpectedValues_data();
+    void getDecodingCostFactor_ReturnsExpectedValues();
+
+    void canRun_AlwaysAdmitsAJobWhenNoneIsRunning();
+    void canRun_RespectsMaximumNumberOfConcurrentJobs();
+    void canRun_RespectsAvailableMemory();
+    void canRun_AdmitsOnlyOneJobFromRotationalStorageByDefault();
+    void free_AllowsWaitingJobsToRun();
+};
+
+void test_VolumeLoadScheduler::getDecodingCostFactor_ReturnsExpectedValues_data()
+{
+    QTest::addColumn<QString>("transferSyntaxUID");
+    QTest::addColumn<int>("expectedFactor");
+
+    QTest::newRow("unknown") << "" << 1;
+    QTest::newRow("implicit VR little endian") << "1.2.840.10008.1.2" << 1;
+    QTest::newRow("explicit VR little endian") << "1.2.840.10008.1.2.1" << 1;
+    QTest::newRow("RLE lossless") << "1.2.840.10008.1.2.5" << 2;
+    QTest::newRow("JPEG baseline") << "1.2.840.10008.1.2.4.50" << 4;
+    QTest::newRow("JPEG lossless") << "1.2.840.10008.1.2.4.70" << 4;
+    QTest::newRow("JPEG-LS lossless") << "1.2.840.10008.1.2.4.80" << 6;
+    QTest::newRow("JPEG 2000 lossless") << "1.2.840.10008.1.2.4.90" << 10;
+    QTest::newRow("JPEG 2000") << "1.2.840.10008.1.2.4.91" << 10;
+}
+
+void test_VolumeLoadScheduler::getDecodingCostFactor_ReturnsExpectedValues()
+{
+    QFETCH(QString, transferSyntaxUID);
+    QFETCH(int, expectedFactor);
+
+    QCOMPARE(VolumeLoadScheduler::getDecodingCostFactor(transferSyntaxUID), expectedFactor);
+}
+
+void test_VolumeLoadScheduler::canRun_AlwaysAdmitsAJobWhenNoneIsRunning()
+{
+    VolumeLoadScheduler scheduler;
+    scheduler.setAvailableMemory(1);
+
+    ThreadWeaver::JobPointer hugeJob(new TestingJob());
+    scheduler.addJob(hugeJob.data(), createLoadCost(Q_INT64_C(1) << 40, Q_INT64_C(1) << 40, VolumeLoadScheduler::RotationalStorage));
+
+    QVERIFY(scheduler.canRun(hugeJob));
+}
+
+void test_VolumeLoadScheduler::canRun_RespectsMaximumNumberOfConcurrentJobs()
+{
+    VolumeLoadScheduler scheduler;
+    scheduler.setMaximumNumberOfConcurrentJobs(2);
+
+    QList<ThreadWeaver::JobPointer> jobs;
+    for (int i = 0; i < 3; i++)
+    {
+        jobs << ThreadWeaver::JobPointer(new TestingJob());
+        scheduler.addJob(jobs.last().data(), createLoadCost(1, 1, VolumeLoadScheduler::SolidStateStorage));
+    }
+
+    QVERIFY(scheduler.canRun(jobs[0]));
+    QVERIFY(scheduler.canRun(jobs[1]));
+    QVERIFY(!scheduler.canRun(jobs[2]));
+}
+
+void test_VolumeLoadScheduler::canRun_RespectsAvailableMemory()
+{
+    VolumeLoadScheduler scheduler;
+    scheduler.setMaximumNumberOfConcurrentJobs(10);
+    scheduler.setAvailableMemory(100);
+
+    ThreadWeaver::JobPointer firstJob(new TestingJob());
+    ThreadWeaver::JobPointer fittingJob(new TestingJob());
+    ThreadWeaver::JobPointer notFittingJob(new TestingJob());
+    scheduler.addJob(firstJob.data(), createLoadCost(60, 1, VolumeLoadScheduler::SolidStateStorage));
+    scheduler.addJob(fittingJob.data(), createLoadCost(40, 1, VolumeLoadScheduler::SolidStateStorage));
+    scheduler.addJob(notFittingJob.data(), createLoadCost(1, 1, VolumeLoadScheduler::SolidStateStorage));
+
+    QVERIFY(scheduler.canRun(firstJob));
+    QVERIFY(scheduler.canRun(fittingJob));
+    QVERIFY(!scheduler.canRun(notFittingJob));
+}
+
+void test_VolumeLoadScheduler::canRun_AdmitsOnlyOneJobFromRotationalStorageByDefault()
+{
+    VolumeLoadScheduler scheduler;
+
+    ThreadWeaver::JobPointer firstJob(new TestingJob());
+    ThreadWeaver::JobPointer secondJob(new TestingJob());
+    scheduler.addJob(firstJob.data(), createLoadCost(1, 1, VolumeLoadScheduler::RotationalStorage));
+    scheduler.addJob(secondJob.data(), createLoadCost(1, 1, VolumeLoadScheduler::RotationalStorage));
+
+    QVERIFY(scheduler.canRun(firstJob));
+    QVERIFY(!scheduler.canRun(secondJob));
+}
+
+void test_VolumeLoadScheduler::free_AllowsWaitingJobsToRun()
+{
+    VolumeLoadScheduler scheduler;
+    scheduler.setMaximumNumberOfConcurrentJobs(1);
+
+    ThreadWeaver::JobPointer firstJob(new TestingJob());
+    ThreadWeaver::JobPointer secondJob(new TestingJob());
+    scheduler.addJob(firstJob.data(), createLoadCost(1, 1, VolumeLoadScheduler::SolidStateStorage));
+    scheduler.addJob(secondJob.data(), createLoadCost(1, 1, VolumeLoadScheduler::SolidStateStorage));
+
+    QVERIFY(scheduler.canRun(firstJob));
+    QVERIFY(!scheduler.canRun(secondJob));
+
+    scheduler.free(firstJob);
+
+    QVERIFY(scheduler.canRun(secondJob));
+}
+
+DECLARE_TEST(test_VolumeLoadScheduler)
+
+#include "test_volumeloadscheduler.moc"
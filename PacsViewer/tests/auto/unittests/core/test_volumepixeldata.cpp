@@ -37,6 +37,25 @@ private slots:
 
     void getVoxelValue_IndexVariant_ShouldReturnExpectedSingleComponentValue_data();
     void getVoxelValue_IndexVariant_ShouldReturnExpectedSingleComponentValue();
+
+    void arrangeSlicesByPhase_ShouldPutTheSlicesOfEachPhaseTogether();
+    void arrangeSlicesByPhase_WhenTheSlicesCantBeSplitInPhases_ShouldLeaveThemAsTheyAre();
+
+    void setNumberOfPhases_SlicesArrangedInAnotherNumberOfPhases_ShouldArrangeThemInTheNewOne();
+
+    void setData_DataArrangedByPhase_ShouldKeepTheArrangement();
+
+    void getPhaseData_ShouldReturnAViewOverTheSlicesOfThePhase();
+    void getPhaseData_SlicesNotArrangedByPhase_ShouldReturnACopyOfTheSlicesOfThePhase();
+
+    void computeCoordinateIndex_WithPhase_ShouldReturnIndexInThePhaseSlices();
+
+private:
+    /// Returns a pixel data of 2x2 pixels with the given number of slices, already loaded with the given number of phases.
+    /// The value of each pixel is its position in the data. The caller becomes the owner of the returned object.
+    VolumePixelData* createPixelDataWithPhases(int numberOfSlices, int numberOfPhases);
+    /// Returns the original slice of each slice of the given pixel data, according to the values given by createPixelDataWithPhases().
+    QList<int> getOriginalSlices(VolumePixelData *volumePixelData);
 };
 
 Q_DECLARE_METATYPE(unsigned char*)
@@ -405,6 +424,174 @@ void test_VolumePixelData::getVoxelValue_IndexVariant_ShouldReturnExpectedSingle
     }
 }
 
+void test_VolumePixelData::arrangeSlicesByPhase_ShouldPutTheSlicesOfEachPhaseTogether()
+{
+    VolumePixelData *volumePixelData = createPixelDataWithPhases(6, 3);
+
+    volumePixelData->arrangeSlicesByPhase();
+
+    QCOMPARE(getOriginalSlices(volumePixelData), QList<int>() << 0 << 3 << 1 << 4 << 2 << 5);
+    QVERIFY(volumePixelData->areSlicesArrangedByPhase());
+
+    delete volumePixelData;
+}
+
+void test_VolumePixelData::arrangeSlicesByPhase_WhenTheSlicesCantBeSplitInPhases_ShouldLeaveThemAsTheyAre()
+{
+    VolumePixelData *volumePixelData = createPixelDataWithPhases(5, 2);
+
+    volumePixelData->arrangeSlicesByPhase();
+
+    QCOMPARE(getOriginalSlices(volumePixelData), QList<int>() << 0 << 1 << 2 << 3 << 4);
+    QVERIFY(!volumePixelData->areSlicesArrangedByPhase());
+
+    delete volumePixelData;
+}
+
+void test_VolumePixelData::setNumberOfPhases_SlicesArrangedInAnotherNumberOfPhases_ShouldArrangeThemInTheNewOne()
+{
+    VolumePixelData *volumePixelData = createPixelDataWithPhases(6, 3);
+    volumePixelData->arrangeSlicesByPhase();
+
+    volumePixelData->setNumberOfPhases(2);
+
+    QCOMPARE(getOriginalSlices(volumePixelData), QList<int>() << 0 << 2 << 4 << 1 << 3 << 5);
+    QVERIFY(volumePixelData->areSlicesArrangedByPhase());
+
+    // With one phase the slices are in the order of the images
+    volumePixelData->setNumberOfPhases(1);
+
+    QCOMPARE(getOriginalSlices(volumePixelData), QList<int>() << 0 << 1 << 2 << 3 << 4 << 5);
+    QVERIFY(!volumePixelData->areSlicesArrangedByPhase());
+
+    delete volumePixelData;
+}
+
+void test_VolumePixelData::setData_DataArrangedByPhase_ShouldKeepTheArrangement()
+{
+    VolumePixelData *arrangedPixelData = createPixelDataWithPhases(6, 3);
+    arrangedPixelData->arrangeSlicesByPhase();
+
+    // Like a volume created from the data of another one
+    VolumePixelData volumePixelData;
+    volumePixelData.setData(arrangedPixelData->getVtkData());
+    volumePixelData.setNumberOfPhases(3);
+
+    QVERIFY(volumePixelData.areSlicesArrangedByPhase());
+    QCOMPARE(getOriginalSlices(&volumePixelData), QList<int>() << 0 << 3 << 1 << 4 << 2 << 5);
+
+    double coordinate[3] = { 1.0, 0.0, 1.0 };
+    int index[3];
+    QVERIFY(volumePixelData.computeCoordinateIndex(coordinate, index, 2));
+    QCOMPARE(index[2], 5);
+
+    VolumePixelData phasePixelData;
+    phasePixelData.setData(volumePixelData.getPhaseData(2));
+    QCOMPARE(getOriginalSlices(&phasePixelData), QList<int>() << 2 << 5);
+
+    delete arrangedPixelData;
+}
+
+void test_VolumePixelData::getPhaseData_ShouldReturnAViewOverTheSlicesOfThePhase()
+{
+    VolumePixelData *volumePixelData = createPixelDataWithPhases(8, 2);
+    volumePixelData->arrangeSlicesByPhase();
+
+    vtkSmartPointer<vtkImageData> phaseData = volumePixelData->getPhaseData(1);
+
+    int *dimensions = phaseData->GetDimensions();
+    QCOMPARE(dimensions[0], 2);
+    QCOMPARE(dimensions[1], 2);
+    QCOMPARE(dimensions[2], 4);
+    // Without copying the data
+    QCOMPARE(phaseData->GetScalarPointer(), volumePixelData->getScalarPointer(0, 0, 4));
+
+    VolumePixelData phasePixelData;
+    phasePixelData.setData(phaseData);
+    QCOMPARE(getOriginalSlices(&phasePixelData), QList<int>() << 1 << 3 << 5 << 7);
+
+    // The view remains valid when the original data is released
+    delete volumePixelData;
+    QCOMPARE(getOriginalSlices(&phasePixelData), QList<int>() << 1 << 3 << 5 << 7);
+}
+
+void test_VolumePixelData::getPhaseData_SlicesNotArrangedByPhase_ShouldReturnACopyOfTheSlicesOfThePhase()
+{
+    VolumePixelData *volumePixelData = createPixelDataWithPhases(8, 2);
+
+    vtkSmartPointer<vtkImageData> phaseData = volumePixelData->getPhaseData(1);
+
+    QCOMPARE(phaseData->GetDimensions()[2], 4);
+
+    VolumePixelData phasePixelData;
+    phasePixelData.setData(phaseData);
+    QCOMPARE(getOriginalSlices(&phasePixelData), QList<int>() << 1 << 3 << 5 << 7);
+
+    // The index of a coordinate in the phase is the one of its slice in the order of the images
+    double coordinate[3] = { 0.0, 0.0, 2.0 };
+    int index[3];
+    QVERIFY(volumePixelData->computeCoordinateIndex(coordinate, index, 1));
+    QCOMPARE(index[2], 5);
+
+    delete volumePixelData;
+}
+
+void test_VolumePixelData::computeCoordinateIndex_WithPhase_ShouldReturnIndexInThePhaseSlices()
+{
+    VolumePixelData *volumePixelData = createPixelDataWithPhases(6, 3);
+    volumePixelData->arrangeSlicesByPhase();
+
+    double coordinate[3] = { 1.0, 0.0, 1.0 };
+    int index[3];
+    QVERIFY(volumePixelData->computeCoordinateIndex(coordinate, index, 2));
+    QCOMPARE(index[0], 1);
+    QCOMPARE(index[1], 0);
+    QCOMPARE(index[2], 5);
+
+    // Beyond the last slice of the phase
+    coordinate[2] = 2.0;
+    QVERIFY(!volumePixelData->computeCoordinateIndex(coordinate, index, 0));
+
+    delete volumePixelData;
+}
+
+VolumePixelData* test_VolumePixelData::createPixelDataWithPhases(int numberOfSlices, int numberOfPhases)
+{
+    int dimensions[3] = { 2, 2, numberOfSlices };
+    int extent[6] = { 0, 1, 0, 1, 0, numberOfSlices - 1 };
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    VolumePixelData *volumePixelData = VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin);
+    volumePixelData->setNumberOfPhases(numberOfPhases);
+
+    return volumePixelData;
+}
+
+QList<int> test_VolumePixelData::getOriginalSlices(VolumePixelData *volumePixelData)
+{
+    QList<int> originalSlices;
+    int extent[6];
+    volumePixelData->getExtent(extent);
+
+    for (int z = extent[4]; z <= extent[5]; z++)
+    {
+        short *slice = static_cast<short*>(volumePixelData->getScalarPointer(0, 0, z));
+
+        for (int i = 0; i < 4; i++)
+        {
+            // The values of a slice must stay together
+            if (slice[i] != slice[0] + i)
+            {
+                return QList<int>();
+            }
+        }
+
+        originalSlices << slice[0] / 4;
+    }
+
+    return originalSlices;
+}
+
 DECLARE_TEST(test_VolumePixelData)
 
 #include "test_volumepixeldata.moc"
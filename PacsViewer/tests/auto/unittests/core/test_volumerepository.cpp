@@ -0,0 +1,192 @@
+#include "autotest.h"
+#include "volumerepository.h"
+
+#include "volume.h"
+#include "volumepixeldata.h"
+#include "volumepixeldatatesthelper.h"
+
+#include <vtkImageData.h>
+
+using namespace udg;
+using namespace testing;
+
+class test_VolumeRepository : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void enforceMemoryBudget_EvictsLeastRecentlyUsedVolumesNotInUse();
+    void enforceMemoryBudget_DoesNothingIfThereIsNoBudget();
+    void enforceMemoryBudget_DoesNotEvictVolumesNotLoadedFromFiles();
+
+    void setVolumesInUse_CountsHitsAndMisses();
+    void setVolumesInUse_ReleasingAllVolumesMakesThemEvictable();
+
+    void volumePixelDataLoaded_AfterEviction_CountsReload();
+
+private:
+    /// Creates a volume with pixel data, adds it to the repository and, if it's said so, notifies that its pixel data has been loaded.
+    Volume* createLoadedVolume(bool notifyLoaded = true);
+    /// Returns the memory used by the pixel data of the given volume, in bytes.
+    qint64 getPixelDataSize(Volume *volume);
+
+private:
+    QList<Volume*> m_volumes;
+    VolumeRepository::CacheStatistics m_initialStatistics;
+};
+
+void test_VolumeRepository::init()
+{
+    VolumeRepository::getRepository()->setMemoryBudget(0);
+    m_initialStatistics = VolumeRepository::getRepository()->getCacheStatistics();
+}
+
+void test_VolumeRepository::cleanup()
+{
+    VolumeRepository::getRepository()->setVolumesInUse(this, QList<Volume*>());
+
+    foreach (Volume *volume, m_volumes)
+    {
+        VolumeRepository::getRepository()->deleteVolume(volume->getIdentifier());
+    }
+
+    m_volumes.clear();
+    VolumeRepository::getRepository()->setMemoryBudget(0);
+}
+
+void test_VolumeRepository::enforceMemoryBudget_EvictsLeastRecentlyUsedVolumesNotInUse()
+{
+    Volume *leastRecentlyUsedVolume = createLoadedVolume();
+    Volume *volumeInUse = createLoadedVolume();
+    Volume *mostRecentlyUsedVolume = createLoadedVolume();
+
+    VolumeRepository *repository = VolumeRepository::getRepository();
+    repository->setVolumesInUse(this, QList<Volume*>() << volumeInUse);
+    // Room for all the loaded pixel data except one of the volumes
+    repository->setMemoryBudget(repository->getResidentBytes() - getPixelDataSize(volumeInUse));
+    repository->enforceMemoryBudget();
+
+    QVERIFY(!leastRecentlyUsedVolume->isPixelDataLoaded());
+    QVERIFY(volumeInUse->isPixelDataLoaded());
+    QVERIFY(mostRecentlyUsedVolume->isPixelDataLoaded());
+    QCOMPARE(repository->getCacheStatistics().evictions, m_initialStatistics.evictions + 1);
+
+    // No room for any volume: the volume in use must be kept anyway
+    repository->setMemoryBudget(1);
+    repository->enforceMemoryBudget();
+
+    QVERIFY(volumeInUse->isPixelDataLoaded());
+    QVERIFY(!mostRecentlyUsedVolume->isPixelDataLoaded());
+    QCOMPARE(repository->getCacheStatistics().evictions, m_initialStatistics.evictions + 2);
+}
+
+void test_VolumeRepository::enforceMemoryBudget_DoesNothingIfThereIsNoBudget()
+{
+    Volume *volume = createLoadedVolume();
+
+    VolumeRepository::getRepository()->setMemoryBudget(0);
+    VolumeRepository::getRepository()->enforceMemoryBudget();
+
+    QVERIFY(volume->isPixelDataLoaded());
+}
+
+void test_VolumeRepository::enforceMemoryBudget_DoesNotEvictVolumesNotLoadedFromFiles()
+{
+    // Its pixel data couldn't be read again
+    Volume *volume = createLoadedVolume(false);
+
+    VolumeRepository::getRepository()->setMemoryBudget(1);
+    VolumeRepository::getRepository()->enforceMemoryBudget();
+
+    QVERIFY(volume->isPixelDataLoaded());
+}
+
+void test_VolumeRepository::setVolumesInUse_CountsHitsAndMisses()
+{
+    Volume *loadedVolume = createLoadedVolume();
+    Volume *notLoadedVolume = new Volume();
+    notLoadedVolume->setIdentifier(VolumeRepository::getRepository()->addVolume(notLoadedVolume));
+    m_volumes << notLoadedVolume;
+
+    VolumeRepository *repository = VolumeRepository::getRepository();
+    repository->setVolumesInUse(this, QList<Volume*>() << loadedVolume << notLoadedVolume);
+    // Volumes already in use are not counted again
+    repository->setVolumesInUse(this, QList<Volume*>() << loadedVolume << notLoadedVolume);
+
+    VolumeRepository::CacheStatistics statistics = repository->getCacheStatistics();
+    QCOMPARE(statistics.hits, m_initialStatistics.hits + 1);
+    QCOMPARE(statistics.misses, m_initialStatistics.misses + 1);
+}
+
+void test_VolumeRepository::setVolumesInUse_ReleasingAllVolumesMakesThemEvictable()
+{
+    Volume *volume = createLoadedVolume();
+
+    VolumeRepository *repository = VolumeRepository::getRepository();
+    repository->setVolumesInUse(this, QList<Volume*>() << volume);
+    repository->setMemoryBudget(1);
+    repository->enforceMemoryBudget();
+
+    QVERIFY(volume->isPixelDataLoaded());
+
+    repository->setVolumesInUse(this, QList<Volume*>());
+    repository->enforceMemoryBudget();
+
+    QVERIFY(!volume->isPixelDataLoaded());
+}
+
+void test_VolumeRepository::volumePixelDataLoaded_AfterEviction_CountsReload()
+{
+    Volume *volume = createLoadedVolume();
+
+    VolumeRepository *repository = VolumeRepository::getRepository();
+    repository->setMemoryBudget(1);
+    repository->enforceMemoryBudget();
+    QVERIFY(!volume->isPixelDataLoaded());
+
+    repository->setVolumesInUse(this, QList<Volume*>() << volume);
+    int dimensions[3] = { 64, 64, 4 };
+    int extent[6] = { 0, 63, 0, 63, 0, 3 };
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    volume->setPixelData(VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin));
+    repository->volumePixelDataLoaded(volume);
+
+    VolumeRepository::CacheStatistics statistics = repository->getCacheStatistics();
+    QCOMPARE(statistics.misses, m_initialStatistics.misses + 1);
+    QCOMPARE(statistics.reloads, m_initialStatistics.reloads + 1);
+    QVERIFY(statistics.totalReloadTime >= m_initialStatistics.totalReloadTime);
+    QVERIFY(statistics.residentBytes >= getPixelDataSize(volume));
+}
+
+Volume* test_VolumeRepository::createLoadedVolume(bool notifyLoaded)
+{
+    int dimensions[3] = { 64, 64, 4 };
+    int extent[6] = { 0, 63, 0, 63, 0, 3 };
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    double origin[3] = { 0.0, 0.0, 0.0 };
+
+    Volume *volume = new Volume();
+    volume->setPixelData(VolumePixelDataTestHelper::createVolumePixelData(dimensions, extent, spacing, origin));
+    volume->setIdentifier(VolumeRepository::getRepository()->addVolume(volume));
+    m_volumes << volume;
+
+    if (notifyLoaded)
+    {
+        VolumeRepository::getRepository()->volumePixelDataLoaded(volume);
+    }
+
+    return volume;
+}
+
+qint64 test_VolumeRepository::getPixelDataSize(Volume *volume)
+{
+    return static_cast<qint64>(volume->getPixelData()->getVtkData()->GetActualMemorySize()) * 1024;
+}
+
+DECLARE_TEST(test_VolumeRepository)
+
+#include "test_volumerepository.moc"
@@ -0,0 +1,192 @@
+#include "autotest.h"
+#include "localcachestorage.h"
+
+#include "testinglocalcachestorage.h"
+
+using namespace udg;
+using namespace testing;
+
+class test_LocalCacheStorage : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void getKnownCacheSize_ShouldUseSavedSizesAndMeasureOnlyUnknownStudies();
+
+    void getStudySize_UnknownStudy_ShouldMeasureAndSaveItsSize();
+    void getStudySize_KnownStudy_ShouldNotMeasureItAgain();
+
+    void updateStudySize_ShouldMeasureAgainAndSaveTheNewSize();
+
+    void removeStudySize_ShouldSubtractItFromTheCacheSize();
+
+    void deleteStudyFiles_ShouldCountTheFilesAsPendingDeletionUntilTheyAreRemoved();
+
+    void getFreeSpace_ShouldBeUpdatedWithTheChangesOfTheCacheWithoutMeasuringTheDiskAgain();
+    void getFreeSpace_StudiesMeasuredAfterTheDisk_ShouldNotChangeTheFreeSpace();
+    void measureFreeSpace_ShouldMeasureTheDiskAgain();
+};
+
+void test_LocalCacheStorage::getKnownCacheSize_ShouldUseSavedSizesAndMeasureOnlyUnknownStudies()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_savedStudySizes.insert("1", 100);
+    storage.m_savedStudySizes.insert("2", 200);
+    storage.m_savedStudySizes.insert("3", -1);
+    storage.m_studyDirectorySizes.insert("1", 100);
+    storage.m_studyDirectorySizes.insert("2", 200);
+    storage.m_studyDirectorySizes.insert("3", 300);
+
+    storage.getKnownCacheSize();
+    storage.waitForDone();
+
+    QCOMPARE(storage.getKnownCacheSize(), Q_INT64_C(600));
+    QCOMPARE(storage.getMeasuredStudies(), QStringList() << "3");
+    QCOMPARE(storage.getSavedStudySizes().value("3"), Q_INT64_C(300));
+}
+
+void test_LocalCacheStorage::getStudySize_UnknownStudy_ShouldMeasureAndSaveItsSize()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_savedStudySizes.insert("1", -1);
+    storage.m_studyDirectorySizes.insert("1", 100);
+
+    QCOMPARE(storage.getStudySize("1"), Q_INT64_C(100));
+    QCOMPARE(storage.getSavedStudySizes().value("1"), Q_INT64_C(100));
+
+    storage.waitForDone();
+    QCOMPARE(storage.getKnownCacheSize(), Q_INT64_C(100));
+}
+
+void test_LocalCacheStorage::getStudySize_KnownStudy_ShouldNotMeasureItAgain()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_savedStudySizes.insert("1", 100);
+    storage.m_studyDirectorySizes.insert("1", 100);
+    storage.getKnownCacheSize();
+
+    QCOMPARE(storage.getStudySize("1"), Q_INT64_C(100));
+    QCOMPARE(storage.getStudySize("1"), Q_INT64_C(100));
+
+    storage.waitForDone();
+    QVERIFY(storage.getMeasuredStudies().isEmpty());
+}
+
+void test_LocalCacheStorage::updateStudySize_ShouldMeasureAgainAndSaveTheNewSize()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_savedStudySizes.insert("1", 100);
+    storage.m_savedStudySizes.insert("2", 200);
+    storage.getKnownCacheSize();
+
+    storage.m_studyDirectorySizes.insert("1", 150);
+    storage.updateStudySize("1");
+    storage.waitForDone();
+
+    QCOMPARE(storage.getStudySize("1"), Q_INT64_C(150));
+    QCOMPARE(storage.getSavedStudySizes().value("1"), Q_INT64_C(150));
+    QCOMPARE(storage.getKnownCacheSize(), Q_INT64_C(350));
+}
+
+void test_LocalCacheStorage::removeStudySize_ShouldSubtractItFromTheCacheSize()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_savedStudySizes.insert("1", 100);
+    storage.m_savedStudySizes.insert("2", 200);
+    storage.getKnownCacheSize();
+
+    storage.removeStudySize("1");
+
+    QCOMPARE(storage.getKnownCacheSize(), Q_INT64_C(200));
+}
+
+void test_LocalCacheStorage::deleteStudyFiles_ShouldCountTheFilesAsPendingDeletionUntilTheyAreRemoved()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_savedStudySizes.insert("1", 100);
+    storage.m_savedStudySizes.insert("2", 200);
+    storage.m_studyDirectorySizes.insert("1", 100);
+    storage.m_studyDirectorySizes.insert("2", 200);
+    storage.getKnownCacheSize();
+
+    storage.blockStudyDirectoryRemoval();
+    storage.deleteStudyFiles("1");
+
+    QCOMPARE(storage.getKnownCacheSize(), Q_INT64_C(200));
+    QCOMPARE(storage.getBytesPendingDeletion(), Q_INT64_C(100));
+    QVERIFY(storage.getRemovedStudies().isEmpty());
+
+    storage.unblockStudyDirectoryRemoval();
+    storage.waitForStudyFilesDeleted("1");
+
+    QCOMPARE(storage.getBytesPendingDeletion(), Q_INT64_C(0));
+    QCOMPARE(storage.getRemovedStudies(), QStringList() << "1");
+}
+
+void test_LocalCacheStorage::getFreeSpace_ShouldBeUpdatedWithTheChangesOfTheCacheWithoutMeasuringTheDiskAgain()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_savedStudySizes.insert("1", 100);
+    storage.m_savedStudySizes.insert("2", 200);
+    storage.m_studyDirectorySizes.insert("1", 100);
+    storage.m_studyDirectorySizes.insert("2", 200);
+    storage.m_diskFreeSpace = 1000;
+
+    QCOMPARE(storage.getFreeSpace(), Q_INT64_C(1000));
+
+    // A retrieved study uses space
+    storage.m_studyDirectorySizes.insert("3", 300);
+    storage.updateStudySize("3");
+    storage.waitForDone();
+
+    QCOMPARE(storage.getFreeSpace(), Q_INT64_C(700));
+
+    // A deleted study frees up space as soon as it's deleted
+    storage.deleteStudyFiles("2");
+
+    QCOMPARE(storage.getFreeSpace(), Q_INT64_C(900));
+
+    storage.waitForDone();
+
+    QCOMPARE(storage.getFreeSpace(), Q_INT64_C(900));
+    QCOMPARE(storage.m_numberOfDiskFreeSpaceMeasurements, 1);
+}
+
+void test_LocalCacheStorage::getFreeSpace_StudiesMeasuredAfterTheDisk_ShouldNotChangeTheFreeSpace()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_savedStudySizes.insert("1", -1);
+    storage.m_savedStudySizes.insert("2", 200);
+    storage.m_studyDirectorySizes.insert("1", 100);
+    storage.m_studyDirectorySizes.insert("2", 200);
+    storage.m_diskFreeSpace = 1000;
+
+    storage.getFreeSpace();
+    storage.waitForDone();
+
+    // The files of the study were already on disk when the free space was measured
+    QCOMPARE(storage.getKnownCacheSize(), Q_INT64_C(300));
+    QCOMPARE(storage.getFreeSpace(), Q_INT64_C(1000));
+}
+
+void test_LocalCacheStorage::measureFreeSpace_ShouldMeasureTheDiskAgain()
+{
+    TestingLocalCacheStorage storage;
+    storage.m_diskFreeSpace = 1000;
+
+    QCOMPARE(storage.getFreeSpace(), Q_INT64_C(1000));
+
+    // Another application frees up space
+    storage.m_diskFreeSpace = 1500;
+
+    QCOMPARE(storage.getFreeSpace(), Q_INT64_C(1000));
+
+    storage.measureFreeSpace();
+
+    QCOMPARE(storage.getFreeSpace(), Q_INT64_C(1500));
+    QCOMPARE(storage.m_numberOfDiskFreeSpaceMeasurements, 2);
+}
+
+DECLARE_TEST(test_LocalCacheStorage)
+
+#include "test_localcachestorage.moc"
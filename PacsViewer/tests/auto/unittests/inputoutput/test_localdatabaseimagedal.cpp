@@ -0,0 +1,236 @@
+#include "autotest.h"
+#include "localdatabaseimagedal.h"
+
+#include "databaseconnection.h"
+#include "databasetesthelper.h"
+#include "dicommask.h"
+#include "displayshutter.h"
+#include "image.h"
+#include "localdatabasedisplayshutterdal.h"
+#include "localdatabasevoilutdal.h"
+#include "series.h"
+#include "study.h"
+#include "studytesthelper.h"
+
+using namespace udg;
+using namespace testing;
+
+class test_LocalDatabaseImageDAL : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void query_ShouldReturnImagesWithTheirDisplayShuttersAndVoiLuts();
+    void query_ShouldNotReturnDisplayShuttersNorVoiLutsOfOtherSeries();
+    void query_AfterSavingAgain_ShouldReturnTheNewDisplayShuttersAndVoiLuts();
+
+    void benchmarkQuery_3000ImagesSeries();
+    void benchmarkQueryWithTwoQueriesPerImage_3000ImagesSeries();
+
+private:
+    /// Creates a series with the given UID and number of images, each one with a display shutter and a VOI LUT, and saves it to the database.
+    Series* createAndSaveSeries(const QString &seriesInstanceUID, int numberOfImages);
+    /// Saves the images of the given series to the database with their display shutters and VOI LUTs.
+    void saveSeries(Series *series);
+    /// Returns a display shutter with the given value.
+    DisplayShutter createDisplayShutter(unsigned short value);
+    /// Returns a VOI LUT that starts at the given value.
+    VoiLut createVoiLut(double value);
+    /// Returns a mask that matches all the images of the given series.
+    DicomMask getSeriesMask(Series *series);
+    /// Returns the VOI LUTs of the given image that are LUTs, leaving out the window levels.
+    QList<VoiLut> getLuts(Image *image);
+
+private:
+    DatabaseConnection *m_databaseConnection;
+    Study *m_study;
+};
+
+void test_LocalDatabaseImageDAL::init()
+{
+    m_databaseConnection = DatabaseTestHelper::getCreatedDatabase();
+    m_study = StudyTestHelper::createStudyByUID("1");
+}
+
+void test_LocalDatabaseImageDAL::cleanup()
+{
+    StudyTestHelper::cleanUp(m_study);
+    delete m_databaseConnection;
+}
+
+void test_LocalDatabaseImageDAL::query_ShouldReturnImagesWithTheirDisplayShuttersAndVoiLuts()
+{
+    Series *series = createAndSaveSeries("1.1", 3);
+
+    QList<Image*> images = LocalDatabaseImageDAL(*m_databaseConnection).query(getSeriesMask(series));
+
+    QCOMPARE(images.size(), 3);
+
+    foreach (Image *image, images)
+    {
+        int index = image->getSOPInstanceUID().section('.', -1).toInt();
+
+        QCOMPARE(image->getDisplayShutters().size(), 1);
+        QCOMPARE(image->getDisplayShutters().first().getShutterValue(), static_cast<unsigned short>(index));
+        QCOMPARE(getLuts(image), QList<VoiLut>() << createVoiLut(index));
+    }
+
+    qDeleteAll(images);
+}
+
+void test_LocalDatabaseImageDAL::query_ShouldNotReturnDisplayShuttersNorVoiLutsOfOtherSeries()
+{
+    Series *series = createAndSaveSeries("1.1", 2);
+    Series *otherSeries = createAndSaveSeries("1.2", 2);
+    otherSeries->getImages().first()->setDisplayShutters(QList<DisplayShutter>() << createDisplayShutter(100) << createDisplayShutter(101));
+    saveSeries(otherSeries);
+
+    QList<Image*> images = LocalDatabaseImageDAL(*m_databaseConnection).query(getSeriesMask(series));
+
+    QCOMPARE(images.size(), 2);
+
+    foreach (Image *image, images)
+    {
+        QVERIFY(image->getSOPInstanceUID().startsWith("1.1."));
+        QCOMPARE(image->getDisplayShutters().size(), 1);
+        QCOMPARE(getLuts(image).size(), 1);
+    }
+
+    qDeleteAll(images);
+}
+
+void test_LocalDatabaseImageDAL::query_AfterSavingAgain_ShouldReturnTheNewDisplayShuttersAndVoiLuts()
+{
+    Series *series = createAndSaveSeries("1.1", 1);
+    Image *image = series->getImages().first();
+    image->setDisplayShutters(QList<DisplayShutter>());
+    image->addVoiLut(createVoiLut(50));
+    saveSeries(series);
+
+    QList<Image*> images = LocalDatabaseImageDAL(*m_databaseConnection).query(getSeriesMask(series));
+
+    QCOMPARE(images.size(), 1);
+    QCOMPARE(images.first()->getDisplayShutters().size(), 0);
+    QCOMPARE(getLuts(images.first()), QList<VoiLut>() << createVoiLut(0) << createVoiLut(50));
+
+    qDeleteAll(images);
+}
+
+void test_LocalDatabaseImageDAL::benchmarkQuery_3000ImagesSeries()
+{
+    Series *series = createAndSaveSeries("1.1", 3000);
+    QList<Image*> images;
+
+    QBENCHMARK
+    {
+        qDeleteAll(images);
+        images = LocalDatabaseImageDAL(*m_databaseConnection).query(getSeriesMask(series));
+    }
+
+    QCOMPARE(images.size(), 3000);
+    qDeleteAll(images);
+}
+
+void test_LocalDatabaseImageDAL::benchmarkQueryWithTwoQueriesPerImage_3000ImagesSeries()
+{
+    // Adds the two queries per image that were done before to load the display shutters and VOI LUTs, to compare with the benchmark above
+    Series *series = createAndSaveSeries("1.1", 3000);
+    LocalDatabaseDisplayShutterDAL shutterDAL(*m_databaseConnection);
+    LocalDatabaseVoiLutDAL voiLutDAL(*m_databaseConnection);
+    DicomMask seriesMask = getSeriesMask(series);
+    QList<Image*> images;
+
+    QBENCHMARK
+    {
+        qDeleteAll(images);
+        images = LocalDatabaseImageDAL(*m_databaseConnection).query(seriesMask);
+
+        foreach (Image *image, images)
+        {
+            DicomMask mask;
+            mask.setSOPInstanceUID(image->getSOPInstanceUID());
+            mask.setImageNumber(QString::number(image->getFrameNumber()));
+            shutterDAL.query(mask);
+            voiLutDAL.query(mask);
+        }
+    }
+
+    QCOMPARE(images.size(), 3000);
+    qDeleteAll(images);
+}
+
+Series* test_LocalDatabaseImageDAL::createAndSaveSeries(const QString &seriesInstanceUID, int numberOfImages)
+{
+    Series *series = new Series();
+    series->setInstanceUID(seriesInstanceUID);
+    m_study->addSeries(series);
+
+    for (int i = 0; i < numberOfImages; i++)
+    {
+        Image *image = new Image();
+        image->setSOPInstanceUID(seriesInstanceUID + "." + QString::number(i));
+        image->setDisplayShutters(QList<DisplayShutter>() << createDisplayShutter(i));
+        image->addVoiLut(createVoiLut(i));
+        series->addImage(image);
+    }
+
+    saveSeries(series);
+
+    return series;
+}
+
+void test_LocalDatabaseImageDAL::saveSeries(Series *series)
+{
+    m_databaseConnection->beginTransaction();
+    QVERIFY(LocalDatabaseImageDAL(*m_databaseConnection).insertOrReplace(series->getImages()));
+    QVERIFY(LocalDatabaseDisplayShutterDAL(*m_databaseConnection).replace(series->getImages()));
+    QVERIFY(LocalDatabaseVoiLutDAL(*m_databaseConnection).replace(series->getImages()));
+    m_databaseConnection->commitTransaction();
+}
+
+DisplayShutter test_LocalDatabaseImageDAL::createDisplayShutter(unsigned short value)
+{
+    DisplayShutter shutter;
+    shutter.setShape(DisplayShutter::RectangularShape);
+    shutter.setPoints(QPoint(0, 0), QPoint(10, 10));
+    shutter.setShutterValue(value);
+    return shutter;
+}
+
+VoiLut test_LocalDatabaseImageDAL::createVoiLut(double value)
+{
+    TransferFunction lut;
+    lut.set(value, Qt::white, 1.0);
+    lut.set(value + 1.0, Qt::black, 1.0);
+    return VoiLut(lut);
+}
+
+DicomMask test_LocalDatabaseImageDAL::getSeriesMask(Series *series)
+{
+    DicomMask mask;
+    mask.setStudyInstanceUID(series->getParentStudy()->getInstanceUID());
+    mask.setSeriesInstanceUID(series->getInstanceUID());
+    return mask;
+}
+
+QList<VoiLut> test_LocalDatabaseImageDAL::getLuts(Image *image)
+{
+    QList<VoiLut> luts;
+
+    for (int i = 0; i < image->getNumberOfVoiLuts(); i++)
+    {
+        if (image->getVoiLut(i).isLut())
+        {
+            luts << image->getVoiLut(i);
+        }
+    }
+
+    return luts;
+}
+
+DECLARE_TEST(test_LocalDatabaseImageDAL)
+
+#include "test_localdatabaseimagedal.moc"
@@ -0,0 +1,169 @@
+#include "autotest.h"
+#include "localdatabasepatientdal.h"
+
+#include "databaseconnection.h"
+#include "databasetesthelper.h"
+#include "dicommask.h"
+#include "localdatabasestudydal.h"
+#include "patient.h"
+#include "study.h"
+
+#include <QSqlQuery>
+
+using namespace udg;
+using namespace testing;
+
+class test_LocalDatabasePatientDAL : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void getNormalizedName_ShouldReturnExpectedValue_data();
+    void getNormalizedName_ShouldReturnExpectedValue();
+
+    void queryPatientStudy_ShouldFindStudiesByBeginningOfNameWords_data();
+    void queryPatientStudy_ShouldFindStudiesByBeginningOfNameWords();
+
+    void queryPatientStudy_AfterUpdatingOrDeletingPatient_ShouldUseCurrentNames();
+
+    void rebuildNameIndex_ShouldIndexAllPatients();
+
+private:
+    /// Saves to the database a patient with the given name and a study with the given UID.
+    Patient* savePatientWithStudy(const QString &name, const QString &studyInstanceUID);
+    /// Returns the UIDs of the studies found when searching by the given patient name.
+    QStringList searchByName(const QString &name);
+
+private:
+    DatabaseConnection *m_databaseConnection;
+    QList<Patient*> m_patients;
+};
+
+void test_LocalDatabasePatientDAL::init()
+{
+    m_databaseConnection = DatabaseTestHelper::getCreatedDatabase();
+}
+
+void test_LocalDatabasePatientDAL::cleanup()
+{
+    qDeleteAll(m_patients);
+    m_patients.clear();
+    delete m_databaseConnection;
+}
+
+void test_LocalDatabasePatientDAL::getNormalizedName_ShouldReturnExpectedValue_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QString>("expectedValue");
+
+    QTest::newRow("empty") << "" << "";
+    QTest::newRow("components") << "GARCIA^LOPEZ^JUAN" << "garcia lopez juan";
+    QTest::newRow("accents") << QString::fromUtf8("MUÑOZ^JOSÉ MARÍA") << "munoz jose maria";
+    QTest::newRow("symbols and wildcards") << "*O'BRIEN-SMITH^ANN*" << "o brien smith ann";
+    QTest::newRow("ideographic group") << QString::fromUtf8("Yamada^Tarou=山田^太郎") << QString::fromUtf8("yamada tarou 山田 太郎");
+}
+
+void test_LocalDatabasePatientDAL::getNormalizedName_ShouldReturnExpectedValue()
+{
+    QFETCH(QString, name);
+    QFETCH(QString, expectedValue);
+
+    QCOMPARE(LocalDatabasePatientDAL::getNormalizedName(name), expectedValue);
+}
+
+void test_LocalDatabasePatientDAL::queryPatientStudy_ShouldFindStudiesByBeginningOfNameWords_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QStringList>("expectedStudies");
+
+    QTest::newRow("whole word") << "garcia" << (QStringList() << "1" << "2");
+    QTest::newRow("beginning of word") << "*GARC*" << (QStringList() << "1" << "2");
+    QTest::newRow("several words in any order") << "juan gar" << (QStringList() << "1");
+    QTest::newRow("without accents") << "munoz" << (QStringList() << "3");
+    QTest::newRow("middle of word") << "arcia" << QStringList();
+    QTest::newRow("universal matching") << "*" << (QStringList() << "1" << "2" << "3");
+}
+
+void test_LocalDatabasePatientDAL::queryPatientStudy_ShouldFindStudiesByBeginningOfNameWords()
+{
+    QFETCH(QString, name);
+    QFETCH(QStringList, expectedStudies);
+
+    savePatientWithStudy("GARCIA^LOPEZ^JUAN", "1");
+    savePatientWithStudy("GARCIA^PEREZ^ANNA", "2");
+    savePatientWithStudy(QString::fromUtf8("MUÑOZ^JOSÉ"), "3");
+
+    QCOMPARE(searchByName(name), expectedStudies);
+}
+
+void test_LocalDatabasePatientDAL::queryPatientStudy_AfterUpdatingOrDeletingPatient_ShouldUseCurrentNames()
+{
+    Patient *updatedPatient = savePatientWithStudy("GARCIA^JUAN", "1");
+    Patient *deletedPatient = savePatientWithStudy("GARCIA^ANNA", "2");
+
+    updatedPatient->setFullName("LOPEZ^JUAN");
+    LocalDatabasePatientDAL patientDAL(*m_databaseConnection);
+    QVERIFY(patientDAL.update(updatedPatient));
+    QVERIFY(patientDAL.del(deletedPatient->getDatabaseID()));
+
+    QCOMPARE(searchByName("lopez"), QStringList() << "1");
+    QCOMPARE(searchByName("garcia"), QStringList());
+}
+
+void test_LocalDatabasePatientDAL::rebuildNameIndex_ShouldIndexAllPatients()
+{
+    savePatientWithStudy("GARCIA^JUAN", "1");
+    LocalDatabasePatientDAL patientDAL(*m_databaseConnection);
+    QVERIFY(patientDAL.isNameIndexUpToDate());
+
+    // Like a database created before the index existed
+    QSqlQuery(m_databaseConnection->getConnection()).exec("DROP TABLE PatientNameIndex");
+    QVERIFY(!patientDAL.isNameIndexUpToDate());
+
+    QVERIFY(patientDAL.rebuildNameIndex());
+    QVERIFY(patientDAL.isNameIndexUpToDate());
+    QCOMPARE(searchByName("garcia"), QStringList() << "1");
+}
+
+Patient* test_LocalDatabasePatientDAL::savePatientWithStudy(const QString &name, const QString &studyInstanceUID)
+{
+    Patient *patient = new Patient();
+    patient->setID(studyInstanceUID);
+    patient->setFullName(name);
+    Study *study = new Study();
+    study->setInstanceUID(studyInstanceUID);
+    study->setID(studyInstanceUID);
+    patient->addStudy(study);
+    m_patients << patient;
+
+    LocalDatabasePatientDAL(*m_databaseConnection).insert(patient);
+    LocalDatabaseStudyDAL(*m_databaseConnection).insert(study, QDate::currentDate());
+
+    return patient;
+}
+
+QStringList test_LocalDatabasePatientDAL::searchByName(const QString &name)
+{
+    DicomMask mask;
+    mask.setPatientName(name);
+    QList<Patient*> patients = LocalDatabaseStudyDAL(*m_databaseConnection).queryPatientStudy(mask);
+
+    QStringList studyInstanceUIDs;
+
+    foreach (Patient *patient, patients)
+    {
+        studyInstanceUIDs << patient->getStudies().first()->getInstanceUID();
+    }
+
+    qDeleteAll(patients);
+    studyInstanceUIDs.sort();
+
+    return studyInstanceUIDs;
+}
+
+DECLARE_TEST(test_LocalDatabasePatientDAL)
+
+#include "test_localdatabasepatientdal.moc"
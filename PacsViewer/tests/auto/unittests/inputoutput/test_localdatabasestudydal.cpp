@@ -0,0 +1,101 @@
+#include "autotest.h"
+#include "localdatabasestudydal.h"
+
+#include "databaseconnection.h"
+#include "databasetesthelper.h"
+#include "patient.h"
+#include "study.h"
+
+#include <QSqlQuery>
+
+using namespace udg;
+using namespace testing;
+
+class test_LocalDatabaseStudyDAL : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void querySizes_ShouldReturnSavedSizesAndMinusOneForUnmeasuredStudies();
+
+    void hasSizeColumn_CreatedDatabase_ShouldReturnTrue();
+
+    void addSizeColumn_DatabaseBeforeRevision9596_ShouldAllowToSaveAndQuerySizes();
+
+private:
+    /// Saves to the database a study with the given UID.
+    void saveStudy(const QString &studyInstanceUID);
+
+private:
+    DatabaseConnection *m_databaseConnection;
+};
+
+void test_LocalDatabaseStudyDAL::cleanup()
+{
+    delete m_databaseConnection;
+}
+
+void test_LocalDatabaseStudyDAL::querySizes_ShouldReturnSavedSizesAndMinusOneForUnmeasuredStudies()
+{
+    m_databaseConnection = DatabaseTestHelper::getCreatedDatabase();
+    saveStudy("1");
+    saveStudy("2");
+
+    LocalDatabaseStudyDAL studyDAL(*m_databaseConnection);
+    QVERIFY(studyDAL.updateSize("1", Q_INT64_C(5000000000)));
+
+    QHash<QString, qint64> sizes = studyDAL.querySizes();
+
+    QCOMPARE(sizes.size(), 2);
+    QCOMPARE(sizes.value("1"), Q_INT64_C(5000000000));
+    QCOMPARE(sizes.value("2"), Q_INT64_C(-1));
+}
+
+void test_LocalDatabaseStudyDAL::hasSizeColumn_CreatedDatabase_ShouldReturnTrue()
+{
+    m_databaseConnection = DatabaseTestHelper::getCreatedDatabase();
+
+    QVERIFY(LocalDatabaseStudyDAL(*m_databaseConnection).hasSizeColumn());
+}
+
+void test_LocalDatabaseStudyDAL::addSizeColumn_DatabaseBeforeRevision9596_ShouldAllowToSaveAndQuerySizes()
+{
+    // Study table as it was created before revision 9596
+    m_databaseConnection = DatabaseTestHelper::getEmptyDatabase();
+    QVERIFY(QSqlQuery(m_databaseConnection->getConnection()).exec(
+                "CREATE TABLE Study (InstanceUID TEXT PRIMARY KEY, PatientID TEXT NOT NULL, ID TEXT NOT NULL, PatientAge TEXT, PatientWeigth REAL, "
+                "PatientHeigth REAL, Modalities TEXT, Date TEXT, Time TEXT, AccessionNumber TEXT, Description TEXT, ReferringPhysicianName TEXT, "
+                "LastAccessDate TEXT, RetrievedDate TEXT, RetrievedTime TEXT, State INTEGER)"));
+    saveStudy("1");
+
+    LocalDatabaseStudyDAL studyDAL(*m_databaseConnection);
+    QVERIFY(!studyDAL.hasSizeColumn());
+
+    QVERIFY(studyDAL.addSizeColumn());
+    QVERIFY(studyDAL.hasSizeColumn());
+
+    // Studies saved before the column existed haven't been measured
+    QCOMPARE(studyDAL.querySizes().value("1"), Q_INT64_C(-1));
+
+    QVERIFY(studyDAL.updateSize("1", 100));
+    QCOMPARE(studyDAL.querySizes().value("1"), Q_INT64_C(100));
+}
+
+void test_LocalDatabaseStudyDAL::saveStudy(const QString &studyInstanceUID)
+{
+    Patient patient;
+    patient.setDatabaseID(1);
+    // The patient deletes the study, since it's its parent
+    Study *study = new Study();
+    study->setInstanceUID(studyInstanceUID);
+    study->setID(studyInstanceUID);
+    patient.addStudy(study);
+
+    QVERIFY(LocalDatabaseStudyDAL(*m_databaseConnection).insert(study, QDate::currentDate()));
+}
+
+DECLARE_TEST(test_LocalDatabaseStudyDAL)
+
+#include "test_localdatabasestudydal.moc"
@@ -0,0 +1,289 @@
+#include "autotest.h"
+#include "relatedstudiesquerycache.h"
+
+#include "dicommask.h"
+#include "inputoutputsettings.h"
+#include "pacsdevice.h"
+#include "patient.h"
+#include "study.h"
+#include "testingrelatedstudiesquerycache.h"
+
+#include <QSignalSpy>
+
+using namespace udg;
+using namespace testing;
+
+class test_RelatedStudiesQueryCache : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void getQueryKey_ShouldIgnoreSpacesThatDontChangeTheResults();
+
+    void getQueryKey_ShouldDistinguishPACSAndMatchingKeys_data();
+    void getQueryKey_ShouldDistinguishPACSAndMatchingKeys();
+
+    void query_IdenticalToARunningQuery_ShouldWaitForItsResults();
+
+    void query_WithinTheTimeToLive_ShouldReturnTheCachedResults();
+    void query_AfterTheTimeToLive_ShouldStartANewQuery();
+
+    void invalidatePatient_ShouldDiscardOnlyTheResultsOfThePatient();
+    void invalidatePatient_WhileAQueryIsRunning_ShouldNotCacheItsResults();
+
+    void cancelQuery_ShouldCancelTheRunningQueryWhenAllItsRequestsAreCancelled();
+
+    void runningQueryFinished_WhenTheQueryFails_ShouldNotifyTheFailure();
+
+private:
+    /// Returns a patient with the given ID and one study.
+    Patient* createPatient(const QString &patientID, const QString &studyInstanceUID);
+    /// Returns the study instance UIDs of the given patients, which are deleted.
+    QStringList takeStudyInstanceUIDs(const QList<Patient*> &patients);
+
+    /// Returns a PACS with the given ID.
+    PacsDevice createPACS(const QString &id);
+    /// Returns a mask to search the studies of the patient with the given ID and name.
+    DicomMask createMask(const QString &patientID, const QString &patientName);
+};
+
+Q_DECLARE_METATYPE(DicomMask)
+Q_DECLARE_METATYPE(PacsDevice)
+
+void test_RelatedStudiesQueryCache::getQueryKey_ShouldIgnoreSpacesThatDontChangeTheResults()
+{
+    PacsDevice pacs = createPACS("1");
+
+    QCOMPARE(RelatedStudiesQueryCache::getQueryKey(pacs, createMask(" 1234 ", "GARCIA^JUAN")),
+             RelatedStudiesQueryCache::getQueryKey(pacs, createMask("1234", "GARCIA^JUAN")));
+    QCOMPARE(RelatedStudiesQueryCache::getQueryKey(pacs, createMask("", " GARCIA  LOPEZ^JUAN ")),
+             RelatedStudiesQueryCache::getQueryKey(pacs, createMask("", "GARCIA LOPEZ^JUAN")));
+}
+
+void test_RelatedStudiesQueryCache::getQueryKey_ShouldDistinguishPACSAndMatchingKeys_data()
+{
+    QTest::addColumn<QString>("pacsID");
+    QTest::addColumn<DicomMask>("mask");
+
+    DicomMask untilDateMask = createMask("1234", "");
+    untilDateMask.setStudyDate(QDate(), QDate(2014, 5, 20));
+
+    DicomMask modalityMask = createMask("1234", "");
+    modalityMask.setStudyModality("CT");
+
+    QTest::newRow("other PACS") << "2" << createMask("1234", "");
+    QTest::newRow("other patient ID") << "1" << createMask("1235", "");
+    QTest::newRow("patient name instead of ID") << "1" << createMask("", "1234");
+    QTest::newRow("until date") << "1" << untilDateMask;
+    QTest::newRow("modality") << "1" << modalityMask;
+}
+
+void test_RelatedStudiesQueryCache::getQueryKey_ShouldDistinguishPACSAndMatchingKeys()
+{
+    QFETCH(QString, pacsID);
+    QFETCH(DicomMask, mask);
+
+    QVERIFY(RelatedStudiesQueryCache::getQueryKey(createPACS(pacsID), mask) != RelatedStudiesQueryCache::getQueryKey(createPACS("1"), createMask("1234", "")));
+}
+
+void test_RelatedStudiesQueryCache::query_IdenticalToARunningQuery_ShouldWaitForItsResults()
+{
+    TestingRelatedStudiesQueryCache cache;
+    QSignalSpy queryFinishedSpy(&cache, SIGNAL(queryFinished(int)));
+
+    int firstRequestID = cache.query(createPACS("1"), createMask("1234", ""));
+    int secondRequestID = cache.query(createPACS("1"), createMask(" 1234", ""));
+
+    QVERIFY(firstRequestID != secondRequestID);
+    QCOMPARE(cache.m_startedQueryIDs.size(), 1);
+
+    cache.finishQuery(cache.m_startedQueryIDs.first(), QList<Patient*>() << createPatient("1234", "1.2.3"));
+
+    QCOMPARE(queryFinishedSpy.count(), 2);
+    QCOMPARE(queryFinishedSpy.at(0).at(0).toInt(), firstRequestID);
+    QCOMPARE(queryFinishedSpy.at(1).at(0).toInt(), secondRequestID);
+
+    // Each request gets its own copy of the results
+    QList<Patient*> firstResults = cache.takeResults(firstRequestID);
+    QList<Patient*> secondResults = cache.takeResults(secondRequestID);
+    QCOMPARE(firstResults.size(), 1);
+    QCOMPARE(secondResults.size(), 1);
+    QVERIFY(firstResults.first() != secondResults.first());
+    QCOMPARE(takeStudyInstanceUIDs(firstResults), QStringList("1.2.3"));
+    QCOMPARE(takeStudyInstanceUIDs(secondResults), QStringList("1.2.3"));
+}
+
+void test_RelatedStudiesQueryCache::query_WithinTheTimeToLive_ShouldReturnTheCachedResults()
+{
+    TestingRelatedStudiesQueryCache cache;
+    cache.m_testingSettings.setValue(InputOutputSettings::RelatedStudiesQueryCacheTimeToLive, 300);
+
+    cache.query(createPACS("1"), createMask("1234", ""));
+    cache.finishQuery(cache.m_startedQueryIDs.first(), QList<Patient*>() << createPatient("1234", "1.2.3"));
+
+    QSignalSpy queryFinishedSpy(&cache, SIGNAL(queryFinished(int)));
+    cache.m_currentDateTime = cache.m_currentDateTime.addSecs(299);
+    int requestID = cache.query(createPACS("1"), createMask("1234", ""));
+
+    QCOMPARE(cache.m_startedQueryIDs.size(), 1);
+    // Notified once the requester knows the request ID
+    QCOMPARE(queryFinishedSpy.count(), 0);
+    QTRY_COMPARE(queryFinishedSpy.count(), 1);
+    QCOMPARE(queryFinishedSpy.first().first().toInt(), requestID);
+    QCOMPARE(takeStudyInstanceUIDs(cache.takeResults(requestID)), QStringList("1.2.3"));
+}
+
+void test_RelatedStudiesQueryCache::query_AfterTheTimeToLive_ShouldStartANewQuery()
+{
+    TestingRelatedStudiesQueryCache cache;
+    cache.m_testingSettings.setValue(InputOutputSettings::RelatedStudiesQueryCacheTimeToLive, 300);
+
+    cache.query(createPACS("1"), createMask("1234", ""));
+    cache.finishQuery(cache.m_startedQueryIDs.first(), QList<Patient*>() << createPatient("1234", "1.2.3"));
+
+    cache.m_currentDateTime = cache.m_currentDateTime.addSecs(300);
+    cache.query(createPACS("1"), createMask("1234", ""));
+
+    QCOMPARE(cache.m_startedQueryIDs.size(), 2);
+}
+
+void test_RelatedStudiesQueryCache::invalidatePatient_ShouldDiscardOnlyTheResultsOfThePatient()
+{
+    TestingRelatedStudiesQueryCache cache;
+    cache.m_testingSettings.setValue(InputOutputSettings::RelatedStudiesQueryCacheTimeToLive, 300);
+
+    cache.query(createPACS("1"), createMask("1234", ""));
+    cache.finishQuery(cache.m_startedQueryIDs.last(), QList<Patient*>() << createPatient("1234", "1.2.3"));
+    cache.query(createPACS("1"), createMask("5678", ""));
+    cache.finishQuery(cache.m_startedQueryIDs.last(), QList<Patient*>() << createPatient("5678", "1.2.4"));
+
+    cache.invalidatePatient("1234", "GARCIA^JUAN");
+
+    cache.query(createPACS("1"), createMask("5678", ""));
+    QCOMPARE(cache.m_startedQueryIDs.size(), 2);
+
+    cache.query(createPACS("1"), createMask("1234", ""));
+    QCOMPARE(cache.m_startedQueryIDs.size(), 3);
+}
+
+void test_RelatedStudiesQueryCache::invalidatePatient_WhileAQueryIsRunning_ShouldNotCacheItsResults()
+{
+    TestingRelatedStudiesQueryCache cache;
+    cache.m_testingSettings.setValue(InputOutputSettings::RelatedStudiesQueryCacheTimeToLive, 300);
+    QSignalSpy queryFinishedSpy(&cache, SIGNAL(queryFinished(int)));
+
+    int requestID = cache.query(createPACS("1"), createMask("1234", ""));
+    cache.invalidatePatient("1234", "");
+    cache.finishQuery(cache.m_startedQueryIDs.first(), QList<Patient*>() << createPatient("1234", "1.2.3"));
+
+    // The running request still gets the results
+    QCOMPARE(queryFinishedSpy.count(), 1);
+    QCOMPARE(takeStudyInstanceUIDs(cache.takeResults(requestID)), QStringList("1.2.3"));
+
+    cache.query(createPACS("1"), createMask("1234", ""));
+    QCOMPARE(cache.m_startedQueryIDs.size(), 2);
+}
+
+void test_RelatedStudiesQueryCache::cancelQuery_ShouldCancelTheRunningQueryWhenAllItsRequestsAreCancelled()
+{
+    TestingRelatedStudiesQueryCache cache;
+    QSignalSpy queryFinishedSpy(&cache, SIGNAL(queryFinished(int)));
+
+    int firstRequestID = cache.query(createPACS("1"), createMask("1234", ""));
+    int secondRequestID = cache.query(createPACS("1"), createMask("1234", ""));
+    int queryID = cache.m_startedQueryIDs.first();
+
+    cache.cancelQuery(firstRequestID);
+    QVERIFY(cache.m_cancelledQueryIDs.isEmpty());
+
+    cache.cancelQuery(secondRequestID);
+    QCOMPARE(cache.m_cancelledQueryIDs, QList<int>() << queryID);
+
+    // A new identical request doesn't wait for the cancelled query
+    int thirdRequestID = cache.query(createPACS("1"), createMask("1234", ""));
+    QCOMPARE(cache.m_startedQueryIDs.size(), 2);
+
+    // The cancelled query finishing afterwards isn't notified
+    cache.finishQuery(queryID, QList<Patient*>() << createPatient("1234", "1.2.3"));
+    QCOMPARE(queryFinishedSpy.count(), 0);
+    QVERIFY(cache.takeResults(firstRequestID).isEmpty());
+    QVERIFY(cache.takeResults(secondRequestID).isEmpty());
+
+    cache.finishQuery(cache.m_startedQueryIDs.last(), QList<Patient*>() << createPatient("1234", "1.2.3"));
+    QCOMPARE(queryFinishedSpy.count(), 1);
+    QCOMPARE(queryFinishedSpy.first().first().toInt(), thirdRequestID);
+    QCOMPARE(takeStudyInstanceUIDs(cache.takeResults(thirdRequestID)), QStringList("1.2.3"));
+}
+
+void test_RelatedStudiesQueryCache::runningQueryFinished_WhenTheQueryFails_ShouldNotifyTheFailure()
+{
+    qRegisterMetaType<PacsDevice>("PacsDevice");
+
+    TestingRelatedStudiesQueryCache cache;
+    cache.m_testingSettings.setValue(InputOutputSettings::RelatedStudiesQueryCacheTimeToLive, 300);
+    QSignalSpy queryFinishedSpy(&cache, SIGNAL(queryFinished(int)));
+    QSignalSpy queryFailedSpy(&cache, SIGNAL(queryFailed(int, PacsDevice)));
+
+    int requestID = cache.query(createPACS("1"), createMask("1234", ""));
+    cache.finishQuery(cache.m_startedQueryIDs.first(), QList<Patient*>(), PACSRequestStatus::QueryCanNotConnectToPACS);
+
+    QCOMPARE(queryFailedSpy.count(), 1);
+    QCOMPARE(queryFailedSpy.first().first().toInt(), requestID);
+    QCOMPARE(queryFinishedSpy.count(), 1);
+    QVERIFY(cache.takeResults(requestID).isEmpty());
+
+    // Failures aren't cached
+    cache.query(createPACS("1"), createMask("1234", ""));
+    QCOMPARE(cache.m_startedQueryIDs.size(), 2);
+}
+
+PacsDevice test_RelatedStudiesQueryCache::createPACS(const QString &id)
+{
+    PacsDevice pacs;
+    pacs.setID(id);
+    pacs.setAETitle("PACS_" + id);
+    return pacs;
+}
+
+DicomMask test_RelatedStudiesQueryCache::createMask(const QString &patientID, const QString &patientName)
+{
+    DicomMask mask;
+    mask.setPatientID(patientID);
+    mask.setPatientName(patientName);
+    mask.setStudyDate(QDate(), QDate());
+    mask.setStudyModality("");
+    return mask;
+}
+
+Patient* test_RelatedStudiesQueryCache::createPatient(const QString &patientID, const QString &studyInstanceUID)
+{
+    Patient *patient = new Patient();
+    patient->setID(patientID);
+
+    Study *study = new Study();
+    study->setInstanceUID(studyInstanceUID);
+    patient->addStudy(study);
+
+    return patient;
+}
+
+QStringList test_RelatedStudiesQueryCache::takeStudyInstanceUIDs(const QList<Patient*> &patients)
+{
+    QStringList studyInstanceUIDs;
+
+    foreach (Patient *patient, patients)
+    {
+        foreach (Study *study, patient->getStudies())
+        {
+            studyInstanceUIDs << study->getInstanceUID();
+        }
+    }
+
+    qDeleteAll(patients);
+
+    return studyInstanceUIDs;
+}
+
+DECLARE_TEST(test_RelatedStudiesQueryCache)
+
+#include "test_relatedstudiesquerycache.moc"
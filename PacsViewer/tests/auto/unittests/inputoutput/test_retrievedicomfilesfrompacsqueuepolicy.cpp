@@ -0,0 +1,101 @@
+#include "autotest.h"
+#include "retrievedicomfilesfrompacsqueuepolicy.h"
+
+#include "patient.h"
+#include "retrievedicomfilesfrompacsjob.h"
+#include "study.h"
+
+using namespace udg;
+
+class test_RetrieveDICOMFilesFromPACSQueuePolicy : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void canRun_ShouldLimitConcurrentRetrievesFromTheSamePACS();
+
+    void canRun_ShouldNotRunTwoRetrievesOfTheSameStudy();
+
+    void free_ShouldLetWaitingRetrievesRun();
+
+private:
+    /// Returns a retrieve job of the given study from a PACS with the given AE title.
+    ThreadWeaver::JobPointer createRetrieveJob(const QString &pacsAETitle, const QString &studyInstanceUID);
+
+private:
+    QList<Patient*> m_patients;
+};
+
+void test_RetrieveDICOMFilesFromPACSQueuePolicy::cleanup()
+{
+    qDeleteAll(m_patients);
+    m_patients.clear();
+}
+
+void test_RetrieveDICOMFilesFromPACSQueuePolicy::canRun_ShouldLimitConcurrentRetrievesFromTheSamePACS()
+{
+    ThreadWeaver::JobPointer firstJob = createRetrieveJob("PACS_A", "1.1");
+    ThreadWeaver::JobPointer secondJob = createRetrieveJob("PACS_A", "1.2");
+    ThreadWeaver::JobPointer thirdJob = createRetrieveJob("PACS_A", "1.3");
+    ThreadWeaver::JobPointer otherPACSJob = createRetrieveJob("PACS_B", "1.4");
+
+    RetrieveDICOMFilesFromPACSQueuePolicy policy;
+    policy.setMaximumNumberOfConcurrentRetrievesPerPACS(2);
+
+    QVERIFY(policy.canRun(firstJob));
+    QVERIFY(policy.canRun(secondJob));
+    QVERIFY(!policy.canRun(thirdJob));
+    QVERIFY(policy.canRun(otherPACSJob));
+}
+
+void test_RetrieveDICOMFilesFromPACSQueuePolicy::canRun_ShouldNotRunTwoRetrievesOfTheSameStudy()
+{
+    ThreadWeaver::JobPointer firstJob = createRetrieveJob("PACS_A", "1.1");
+    ThreadWeaver::JobPointer sameStudyJob = createRetrieveJob("PACS_B", "1.1");
+
+    RetrieveDICOMFilesFromPACSQueuePolicy policy;
+    policy.setMaximumNumberOfConcurrentRetrievesPerPACS(2);
+
+    QVERIFY(policy.canRun(firstJob));
+    QVERIFY(!policy.canRun(sameStudyJob));
+}
+
+void test_RetrieveDICOMFilesFromPACSQueuePolicy::free_ShouldLetWaitingRetrievesRun()
+{
+    ThreadWeaver::JobPointer firstJob = createRetrieveJob("PACS_A", "1.1");
+    ThreadWeaver::JobPointer samePACSJob = createRetrieveJob("PACS_A", "1.2");
+    ThreadWeaver::JobPointer sameStudyJob = createRetrieveJob("PACS_B", "1.1");
+
+    RetrieveDICOMFilesFromPACSQueuePolicy policy;
+
+    QVERIFY(policy.canRun(firstJob));
+    QVERIFY(!policy.canRun(samePACSJob));
+    QVERIFY(!policy.canRun(sameStudyJob));
+
+    policy.free(firstJob);
+
+    QVERIFY(policy.canRun(samePACSJob));
+    QVERIFY(policy.canRun(sameStudyJob));
+}
+
+ThreadWeaver::JobPointer test_RetrieveDICOMFilesFromPACSQueuePolicy::createRetrieveJob(const QString &pacsAETitle, const QString &studyInstanceUID)
+{
+    PacsDevice pacsDevice;
+    pacsDevice.setAETitle(pacsAETitle);
+    pacsDevice.setAddress("localhost");
+    pacsDevice.setQueryRetrieveServicePort(104);
+
+    Patient *patient = new Patient();
+    Study *study = new Study();
+    study->setInstanceUID(studyInstanceUID);
+    patient->addStudy(study);
+    m_patients << patient;
+
+    return ThreadWeaver::JobPointer(new RetrieveDICOMFilesFromPACSJob(pacsDevice, RetrieveDICOMFilesFromPACSJob::Medium, study));
+}
+
+DECLARE_TEST(test_RetrieveDICOMFilesFromPACSQueuePolicy)
+
+#include "test_retrievedicomfilesfrompacsqueuepolicy.moc"
@@ -2,6 +2,9 @@
 #include "testingsenddicomfilestopacs.h"
 
 #include "image.h"
+#include "inputoutputsettings.h"
+
+#include <QSignalSpy>
 
 using namespace udg;
 using namespace testing;
@@ -15,6 +18,11 @@ private slots:
     void send_ShouldSendExpectedNumberOfFiles_data();
     void send_ShouldSendExpectedNumberOfFiles();
 
+    void send_WithSeveralAssociations_ShouldSendEachFileOnce();
+
+    void send_LosingAnAssociation_ShouldSendItsFileThroughAnotherAssociation();
+    void send_LosingTheOnlyAssociation_ShouldReturnConnectionBroken();
+
 };
 
 Q_DECLARE_METATYPE(QList<Image*>)
@@ -108,6 +116,80 @@ void test_SendDICOMFilesToPACS::send_ShouldSendExpectedNumberOfFiles()
     QCOMPARE(sender.getNumberOfDICOMFilesSentWarning(), expectedNumberOfFilesSentWarning);
 }
 
+void test_SendDICOMFilesToPACS::send_WithSeveralAssociations_ShouldSendEachFileOnce()
+{
+    QList<Image*> images;
+
+    for (int i = 0; i < 50; i++)
+    {
+        Image *image = new Image(this);
+        image->setPath(QString::number(i));
+        images.append(image);
+    }
+
+    TestingSendDICOMFilesToPACS sender((PacsDevice()));
+    sender.m_testingSettings.setValue(InputOutputSettings::SendDICOMFilesAssociationsPerPACS, 4);
+    QSignalSpy DICOMFileSentSpy(&sender, SIGNAL(DICOMFileSent(Image*, int)));
+
+    QCOMPARE(sender.send(images), PACSRequestStatus::SendOk);
+    QCOMPARE(sender.getNumberOfDICOMFilesSentSuccesfully(), 50);
+    QCOMPARE(DICOMFileSentSpy.count(), 50);
+
+    QSet<Image*> imagesSent;
+
+    foreach (const QList<QVariant> &arguments, DICOMFileSentSpy)
+    {
+        imagesSent.insert(arguments.at(0).value<Image*>());
+    }
+
+    QCOMPARE(imagesSent, images.toSet());
+    // The signals are never emitted at the same time, so the last one counts all the files
+    QCOMPARE(DICOMFileSentSpy.last().at(1).toInt(), 50);
+}
+
+void test_SendDICOMFilesToPACS::send_LosingAnAssociation_ShouldSendItsFileThroughAnotherAssociation()
+{
+    QList<Image*> images;
+
+    for (int i = 0; i < 10; i++)
+    {
+        Image *image = new Image(this);
+        image->setPath(QString::number(i));
+        images.append(image);
+    }
+
+    TestingSendDICOMFilesToPACS sender((PacsDevice()));
+    sender.m_testingSettings.setValue(InputOutputSettings::SendDICOMFilesAssociationsPerPACS, 2);
+    // The last file, so that the other association has already sent all the rest when it's lost
+    sender.m_pathOfFileThatLosesAssociation = "9";
+    QSignalSpy DICOMFileSentSpy(&sender, SIGNAL(DICOMFileSent(Image*, int)));
+
+    QCOMPARE(sender.send(images), PACSRequestStatus::SendOk);
+    QCOMPARE(sender.getNumberOfDICOMFilesSentSuccesfully(), 10);
+    QCOMPARE(sender.getNumberOfDICOMFilesSentFailed(), 0);
+    QCOMPARE(DICOMFileSentSpy.count(), 10);
+}
+
+void test_SendDICOMFilesToPACS::send_LosingTheOnlyAssociation_ShouldReturnConnectionBroken()
+{
+    QList<Image*> images;
+
+    for (int i = 0; i < 3; i++)
+    {
+        Image *image = new Image(this);
+        image->setPath(QString::number(i));
+        images.append(image);
+    }
+
+    TestingSendDICOMFilesToPACS sender((PacsDevice()));
+    sender.m_testingSettings.setValue(InputOutputSettings::SendDICOMFilesAssociationsPerPACS, 1);
+    sender.m_pathOfFileThatLosesAssociation = "1";
+
+    QCOMPARE(sender.send(images), PACSRequestStatus::SendPACSConnectionBroken);
+    QCOMPARE(sender.getNumberOfDICOMFilesSentSuccesfully(), 1);
+    QCOMPARE(sender.getNumberOfDICOMFilesSentFailed(), 2);
+}
+
 DECLARE_TEST(test_SendDICOMFilesToPACS)
 
 #include "test_senddicomfilestopacs.moc"